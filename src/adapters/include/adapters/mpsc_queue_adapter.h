@@ -0,0 +1,89 @@
+/*
+MIT License - Copyright (c) 2023 Pierric Gimmig
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "sham/pool_allocator.h"
+#include "sham/queue_mpsc.h"
+#include "sham/shared_memory_buffer.h"
+
+namespace sham {
+
+// Adapter for mpsc::Queue used in tests and benchmarks, with a single consumer thread. The queue
+// and its pool live in an anonymous shared memory buffer holding up to about Size elements, push()
+// busy waits while the pool is out of memory. Each thread allocates and frees nodes through its own
+// PoolAllocator::Cache, created on first use and owned by the adapter so that it is flushed before
+// the buffer is unmapped.
+template <typename ElementT, size_t Size>
+struct MpscQueueAdapter {
+  using QueueT = mpsc::Queue<ElementT>;
+  static constexpr size_t kPoolCapacity =
+      (Size + 1) * QueueT::NodeSize() + 64 * PoolAllocator::kChunkSize;
+
+  MpscQueueAdapter()
+      : buffer_(SharedMemoryBuffer::CreateAnonymous(kPoolCapacity + 1024 * 1024)),
+        pool_(buffer_.Allocate<PoolAllocator>(buffer_, kPoolCapacity)),
+        queue_(buffer_.Allocate<QueueT>(*pool_)) {}
+  ~MpscQueueAdapter() {
+    caches_.clear();
+    queue_->~QueueT();
+  }
+
+  inline void push(const ElementT& e) {
+    while (!queue_->try_push(e, &cache())) {
+    }
+  }
+  inline bool try_push(const ElementT& e) { return queue_->try_push(e, &cache()); }
+  inline bool try_pop(ElementT& e) { return queue_->try_pop(e, &cache()); }
+  bool empty() const { return queue_->empty(); }
+  std::string description() { return "Sham mpsc queue"; }
+
+  PoolAllocator::Cache& cache() {
+    thread_local uint64_t adapter_id = 0;
+    thread_local PoolAllocator::Cache* cache = nullptr;
+    if (adapter_id != id_) {
+      std::lock_guard lock(mutex_);
+      caches_.push_back(std::make_unique<PoolAllocator::Cache>(*pool_));
+      cache = caches_.back().get();
+      adapter_id = id_;
+    }
+    return *cache;
+  }
+
+  // Unlike addresses, ids aren't reused by later adapters.
+  static inline std::atomic<uint64_t> next_id_ = 1;
+  const uint64_t id_ = next_id_++;
+  SharedMemoryBuffer buffer_;
+  PoolAllocator* pool_;
+  QueueT* queue_;
+  std::mutex mutex_;
+  std::vector<std::unique_ptr<PoolAllocator::Cache>> caches_;
+};
+
+}  // namespace sham
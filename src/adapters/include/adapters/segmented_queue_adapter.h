@@ -0,0 +1,84 @@
+/*
+MIT License - Copyright (c) 2023 Pierric Gimmig
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "sham/pool_allocator.h"
+#include "sham/queue_segmented.h"
+#include "sham/shared_memory_buffer.h"
+
+namespace sham {
+
+// Adapter for mpmc::SegmentedQueue used in tests and benchmarks. The queue and its pool live in an
+// anonymous shared memory buffer, push() busy waits while the pool is out of memory. Each thread
+// gets its own SegmentedQueue::Handle on first use, owned by the adapter so that it is released
+// before the buffer is unmapped.
+template <typename ElementT>
+struct SegmentedQueueAdapter {
+  using QueueT = mpmc::SegmentedQueue<ElementT>;
+  static constexpr size_t kPoolCapacity = 1024 * 1024 * 1024;
+
+  SegmentedQueueAdapter()
+      : buffer_(SharedMemoryBuffer::CreateAnonymous(kPoolCapacity + 1024 * 1024)),
+        pool_(buffer_.Allocate<PoolAllocator>(buffer_, kPoolCapacity)),
+        queue_(buffer_.Allocate<QueueT>(buffer_, *pool_)) {}
+  ~SegmentedQueueAdapter() { handles_.clear(); }
+
+  inline void push(const ElementT& e) {
+    while (!handle().try_push(e)) {
+    }
+  }
+  inline bool try_push(const ElementT& e) { return handle().try_push(e); }
+  inline bool try_pop(ElementT& e) { return handle().try_pop(e); }
+  bool empty() const { return queue_->empty(); }
+  std::string description() { return "Sham segmented queue"; }
+
+  typename QueueT::Handle& handle() {
+    thread_local uint64_t adapter_id = 0;
+    thread_local typename QueueT::Handle* handle = nullptr;
+    if (adapter_id != id_) {
+      std::lock_guard lock(mutex_);
+      handles_.push_back(std::make_unique<typename QueueT::Handle>(*queue_));
+      handle = handles_.back().get();
+      adapter_id = id_;
+    }
+    return *handle;
+  }
+
+  // Unlike addresses, ids aren't reused by later adapters.
+  static inline std::atomic<uint64_t> next_id_ = 1;
+  const uint64_t id_ = next_id_++;
+  SharedMemoryBuffer buffer_;
+  PoolAllocator* pool_;
+  QueueT* queue_;
+  std::mutex mutex_;
+  std::vector<std::unique_ptr<typename QueueT::Handle>> handles_;
+};
+
+}  // namespace sham
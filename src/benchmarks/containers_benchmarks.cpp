@@ -0,0 +1,137 @@
+/*
+MIT License - Copyright (c) 2023 Pierric Gimmig
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <list>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include "sham/containers.h"
+#include "sham/offset_ptr.h"
+#include "sham/shared_memory_buffer.h"
+
+// Measures the cost of addressing through sham::OffsetPtr instead of raw pointers: chasing the
+// links of a list shuffled in memory, and indexing a vector in shared memory.
+
+static constexpr const char* kSharedMemoryName = "sham_containers_benchmark";
+
+template <typename T>
+using RawPtr = T*;
+
+template <template <typename> typename Ptr>
+struct Node {
+  Ptr<Node> next;
+  int64_t value;
+};
+
+template <typename T>
+static T* Get(T* ptr) {
+  return ptr;
+}
+
+template <typename T>
+static T* Get(const sham::OffsetPtr<T>& ptr) {
+  return ptr.get();
+}
+
+template <template <typename> typename Ptr>
+static void BM_PointerChasing(benchmark::State& state) {
+  const size_t num_nodes = state.range(0);
+  std::vector<Node<Ptr>> nodes(num_nodes);
+  std::vector<size_t> order(num_nodes);
+  std::iota(order.begin(), order.end(), 0);
+  std::shuffle(order.begin() + 1, order.end(), std::mt19937(42));
+  for (size_t i = 0; i < num_nodes; ++i) {
+    nodes[order[i]].value = i;
+    nodes[order[i]].next = i + 1 < num_nodes ? &nodes[order[i + 1]] : nullptr;
+  }
+
+  for (auto _ : state) {
+    int64_t sum = 0;
+    for (Node<Ptr>* node = &nodes[0]; node != nullptr; node = Get(node->next)) {
+      sum += node->value;
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * num_nodes);
+}
+BENCHMARK_TEMPLATE(BM_PointerChasing, RawPtr)->Range(1 << 10, 1 << 20);
+BENCHMARK_TEMPLATE(BM_PointerChasing, sham::OffsetPtr)->Range(1 << 10, 1 << 20);
+
+template <typename ListT>
+static void BM_ListIteration(benchmark::State& state, ListT& list) {
+  for (auto _ : state) {
+    int64_t sum = 0;
+    for (int64_t value : list) sum += value;
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * list.size());
+}
+
+static void BM_StdList(benchmark::State& state) {
+  std::list<int64_t> list;
+  for (int64_t i = 0; i < state.range(0); ++i) list.push_back(i);
+  BM_ListIteration(state, list);
+}
+BENCHMARK(BM_StdList)->Range(1 << 10, 1 << 16);
+
+static void BM_ArenaList(benchmark::State& state) {
+  const size_t num_nodes = state.range(0);
+  sham::SharedMemoryBuffer buffer(kSharedMemoryName, 1024 + num_nodes * 32,
+                                  sham::SharedMemoryBuffer::Type::kCreate);
+  auto* list = buffer.Allocate<sham::ArenaList<int64_t>>(buffer, num_nodes);
+  for (size_t i = 0; i < num_nodes; ++i) benchmark::DoNotOptimize(list->push_back(i));
+  BM_ListIteration(state, *list);
+}
+BENCHMARK(BM_ArenaList)->Range(1 << 10, 1 << 16);
+
+template <typename VectorT>
+static void BM_VectorIndexing(benchmark::State& state, VectorT& vector) {
+  for (auto _ : state) {
+    int64_t sum = 0;
+    for (size_t i = 0; i < vector.size(); ++i) {
+      sum += vector[i];
+      benchmark::ClobberMemory();
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * vector.size());
+}
+
+static void BM_StdVector(benchmark::State& state) {
+  std::vector<int64_t> vector(state.range(0));
+  BM_VectorIndexing(state, vector);
+}
+BENCHMARK(BM_StdVector)->Arg(1 << 16);
+
+static void BM_ArenaVector(benchmark::State& state) {
+  const size_t size = state.range(0);
+  sham::SharedMemoryBuffer buffer(kSharedMemoryName, 1024 + size * sizeof(int64_t),
+                                  sham::SharedMemoryBuffer::Type::kCreate);
+  auto* vector = buffer.Allocate<sham::ArenaVector<int64_t>>(buffer, size);
+  for (size_t i = 0; i < size; ++i) benchmark::DoNotOptimize(vector->push_back(0));
+  BM_VectorIndexing(state, *vector);
+}
+BENCHMARK(BM_ArenaVector)->Arg(1 << 16);
@@ -0,0 +1,64 @@
+/*
+MIT License - Copyright (c) 2023 Pierric Gimmig
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include "sham/epoch.h"
+#include "sham/shared_memory_buffer.h"
+
+// Overhead of epoch-based reclamation: the cost of a critical section, paid by every read of a
+// lock-free structure, and the amortized cost of retiring a node, which includes advancing the
+// epoch and freeing nodes, while other threads enter and leave critical sections.
+
+static sham::EpochDomain* GetDomain() {
+  static sham::SharedMemoryBuffer buffer("sham_epoch_benchmark", 1024 * 1024,
+                                         sham::SharedMemoryBuffer::Type::kCreate);
+  static sham::EpochDomain* domain = buffer.Allocate<sham::EpochDomain>(buffer, 64);
+  return domain;
+}
+
+static void BM_EpochCriticalSection(benchmark::State& state) {
+  sham::EpochDomain::Participant participant(*GetDomain());
+  for (auto _ : state) {
+    sham::EpochGuard guard(participant);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_EpochCriticalSection)->ThreadRange(1, 8)->UseRealTime();
+
+// Thread 0 retires nodes, the other threads run critical sections.
+static void BM_EpochRetire(benchmark::State& state) {
+  sham::EpochDomain::Participant participant(*GetDomain());
+  uint64_t num_freed = 0;
+  auto free = [&num_freed](uint64_t) { ++num_freed; };
+  uint64_t token = 0;
+  for (auto _ : state) {
+    if (state.thread_index() == 0) {
+      (void)participant.Retire(++token, free);
+    } else {
+      sham::EpochGuard guard(participant);
+    }
+  }
+  benchmark::DoNotOptimize(num_freed);
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_EpochRetire)->ThreadRange(1, 8)->UseRealTime();
@@ -0,0 +1,143 @@
+/*
+MIT License - Copyright (c) 2023 Pierric Gimmig
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "sham/executor.h"
+#include "sham/queue_mpmc.h"
+
+// Fine-grained tasks on an Executor, whose workers own work-stealing deques, compared to a pool of
+// threads sharing a single mpmc::Queue, which every submission and every task goes through. The
+// argument is the number of worker threads.
+
+// Baseline pool: workers pop tasks from one shared queue and yield when it is empty.
+class SharedQueuePool {
+ public:
+  explicit SharedQueuePool(size_t num_threads) {
+    for (size_t i = 0; i < num_threads; ++i) threads_.emplace_back([this] { WorkerLoop(); });
+  }
+  ~SharedQueuePool() {
+    stopping_ = true;
+    for (std::thread& thread : threads_) thread.join();
+  }
+
+  template <typename Function>
+  void Submit(Function&& function) {
+    queue_->push(new std::function<void()>(std::forward<Function>(function)));
+  }
+
+ private:
+  void WorkerLoop() {
+    std::function<void()>* task = nullptr;
+    while (!stopping_) {
+      if (queue_->try_pop(task)) {
+        (*task)();
+        delete task;
+      } else {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  std::unique_ptr<sham::mpmc::Queue<std::function<void()>*, 64 * 1024 - 1>> queue_ =
+      std::make_unique<sham::mpmc::Queue<std::function<void()>*, 64 * 1024 - 1>>();
+  std::vector<std::thread> threads_;
+  std::atomic<bool> stopping_ = false;
+};
+
+// Each task submits two children down to `depth`, 2^(depth + 1) - 1 tasks in total.
+template <typename PoolT>
+static void FanOut(PoolT& pool, int depth, std::atomic<uint64_t>& num_runs) {
+  if (depth > 0) {
+    pool.Submit([&pool, depth, &num_runs] { FanOut(pool, depth - 1, num_runs); });
+    pool.Submit([&pool, depth, &num_runs] { FanOut(pool, depth - 1, num_runs); });
+  }
+  num_runs.fetch_add(1, std::memory_order_release);
+}
+
+template <typename PoolT>
+static void BM_FanOutThroughput(benchmark::State& state) {
+  static constexpr int kDepth = 13;
+  static constexpr uint64_t kNumTasks = (uint64_t{1} << (kDepth + 1)) - 1;
+  PoolT pool(state.range(0));
+  std::atomic<uint64_t> num_runs = 0;
+  for (auto _ : state) {
+    num_runs = 0;
+    pool.Submit([&pool, &num_runs] { FanOut(pool, kDepth, num_runs); });
+    while (num_runs.load(std::memory_order_acquire) != kNumTasks) std::this_thread::yield();
+  }
+  state.SetItemsProcessed(state.iterations() * kNumTasks);
+}
+BENCHMARK_TEMPLATE(BM_FanOutThroughput, sham::Executor)
+    ->RangeMultiplier(2)
+    ->Range(1, 8)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_FanOutThroughput, SharedQueuePool)
+    ->RangeMultiplier(2)
+    ->Range(1, 8)
+    ->UseRealTime();
+
+// Tasks submitted from outside the pool, as by a thread reading a queue of requests.
+template <typename PoolT>
+static void BM_ExternalSubmitThroughput(benchmark::State& state) {
+  static constexpr uint64_t kNumTasks = 10'000;
+  PoolT pool(state.range(0));
+  std::atomic<uint64_t> num_runs = 0;
+  for (auto _ : state) {
+    num_runs = 0;
+    for (uint64_t i = 0; i < kNumTasks; ++i) {
+      pool.Submit([&num_runs] { num_runs.fetch_add(1, std::memory_order_release); });
+    }
+    while (num_runs.load(std::memory_order_acquire) != kNumTasks) std::this_thread::yield();
+  }
+  state.SetItemsProcessed(state.iterations() * kNumTasks);
+}
+BENCHMARK_TEMPLATE(BM_ExternalSubmitThroughput, sham::Executor)
+    ->RangeMultiplier(2)
+    ->Range(1, 8)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_ExternalSubmitThroughput, SharedQueuePool)
+    ->RangeMultiplier(2)
+    ->Range(1, 8)
+    ->UseRealTime();
+
+// Time from the submission of a task to an idle pool to the task running. Executor workers are
+// asleep in the kernel, the baseline's workers are yielding.
+template <typename PoolT>
+static void BM_SubmitLatency(benchmark::State& state) {
+  PoolT pool(state.range(0));
+  std::atomic<bool> ran = false;
+  for (auto _ : state) {
+    ran = false;
+    pool.Submit([&ran] { ran.store(true, std::memory_order_release); });
+    while (!ran.load(std::memory_order_acquire)) {
+    }
+  }
+}
+BENCHMARK_TEMPLATE(BM_SubmitLatency, sham::Executor)->Arg(1)->Arg(4)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_SubmitLatency, SharedQueuePool)->Arg(1)->Arg(4)->UseRealTime();
@@ -0,0 +1,111 @@
+/*
+MIT License - Copyright (c) 2023 Pierric Gimmig
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+#include "sham/hash_map.h"
+#include "sham/shared_memory_buffer.h"
+
+// Lookups and insertions from 1 to 32 threads, in a map of kNumKeys keys at most 7/8 full, compared
+// to std::unordered_map behind a std::shared_mutex. Insertions are each followed by the erasure of
+// the key, which keeps the size of the map constant. Threads insert distinct keys.
+
+static constexpr uint64_t kNumKeys = 1024 * 1024;
+
+using MapT = sham::HashMap<uint64_t, uint64_t>;
+
+static MapT* GetMap() {
+  static sham::SharedMemoryBuffer buffer("sham_hash_map_benchmark", 256 * 1024 * 1024,
+                                         sham::SharedMemoryBuffer::Type::kCreate);
+  static MapT* map = [] {
+    auto* map = buffer.Allocate<MapT>(buffer, 2 * kNumKeys);
+    for (uint64_t i = 0; i < kNumKeys; ++i) map->Insert(i, i);
+    return map;
+  }();
+  return map;
+}
+
+struct LockedUnorderedMap {
+  LockedUnorderedMap() {
+    map.reserve(2 * kNumKeys);
+    for (uint64_t i = 0; i < kNumKeys; ++i) map.emplace(i, i);
+  }
+
+  std::shared_mutex mutex;
+  std::unordered_map<uint64_t, uint64_t> map;
+};
+
+static void BM_HashMapFind(benchmark::State& state) {
+  MapT* map = GetMap();
+  uint64_t key = state.thread_index() * 7919;
+  uint64_t sum = 0;
+  for (auto _ : state) {
+    key = (key + 104729) % kNumKeys;
+    sum += *map->Find(key);
+  }
+  benchmark::DoNotOptimize(sum);
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_HashMapFind)->ThreadRange(1, 32)->UseRealTime();
+
+static void BM_UnorderedMapFind(benchmark::State& state) {
+  static auto* map = new LockedUnorderedMap();
+  uint64_t key = state.thread_index() * 7919;
+  uint64_t sum = 0;
+  for (auto _ : state) {
+    key = (key + 104729) % kNumKeys;
+    std::shared_lock lock(map->mutex);
+    sum += map->map.find(key)->second;
+  }
+  benchmark::DoNotOptimize(sum);
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_UnorderedMapFind)->ThreadRange(1, 32)->UseRealTime();
+
+static void BM_HashMapInsert(benchmark::State& state) {
+  MapT* map = GetMap();
+  uint64_t key = kNumKeys + (static_cast<uint64_t>(state.thread_index()) << 32);
+  for (auto _ : state) {
+    map->Insert(key, key);
+    map->Erase(key);
+    ++key;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_HashMapInsert)->ThreadRange(1, 32)->UseRealTime();
+
+static void BM_UnorderedMapInsert(benchmark::State& state) {
+  static auto* map = new LockedUnorderedMap();
+  uint64_t key = kNumKeys + (static_cast<uint64_t>(state.thread_index()) << 32);
+  for (auto _ : state) {
+    std::unique_lock lock(map->mutex);
+    map->map.emplace(key, key);
+    map->map.erase(key);
+    ++key;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_UnorderedMapInsert)->ThreadRange(1, 32)->UseRealTime();
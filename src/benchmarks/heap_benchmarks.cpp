@@ -0,0 +1,98 @@
+/*
+MIT License - Copyright (c) 2023 Pierric Gimmig
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "sham/heap.h"
+#include "sham/shared_memory_buffer.h"
+
+// Compares sham::Heap to malloc on the same sequence of variable sized allocations: each thread
+// keeps a working set of live objects and replaces a random one at each iteration by a new one
+// whose size is log-uniformly distributed between 16 B and 64 KiB.
+
+static constexpr const char* kSharedMemoryName = "sham_heap_benchmark";
+static constexpr size_t kHeapCapacity = 512 * 1024 * 1024;
+static constexpr size_t kWorkingSetSize = 1024;
+static constexpr size_t kNumOperations = 64 * 1024;
+
+static sham::Heap& GetHeap() {
+  static sham::SharedMemoryBuffer buffer(kSharedMemoryName, 2 * kHeapCapacity,
+                                         sham::SharedMemoryBuffer::Type::kCreate);
+  static sham::Heap* heap = buffer.Allocate<sham::Heap>(buffer, kHeapCapacity);
+  return *heap;
+}
+
+struct Operation {
+  size_t slot;
+  size_t size;
+};
+
+static const std::vector<Operation>& GetOperations() {
+  static const std::vector<Operation> operations = [] {
+    std::mt19937_64 random(42);
+    std::uniform_real_distribution<double> log_size(std::log(16.0), std::log(64.0 * 1024));
+    std::vector<Operation> operations(kNumOperations);
+    for (Operation& operation : operations) {
+      operation.slot = random() % kWorkingSetSize;
+      operation.size = static_cast<size_t>(std::exp(log_size(random)));
+    }
+    return operations;
+  }();
+  return operations;
+}
+
+template <typename AllocatorT>
+static void ReplaceObjects(benchmark::State& state, AllocatorT& allocator) {
+  const std::vector<Operation>& operations = GetOperations();
+  std::vector<void*> objects(kWorkingSetSize);
+  for (size_t i = 0; i < kWorkingSetSize; ++i) objects[i] = allocator.Allocate(operations[i].size);
+  size_t index = 0;
+  for (auto _ : state) {
+    const Operation& operation = operations[index++ % kNumOperations];
+    allocator.Free(objects[operation.slot]);
+    objects[operation.slot] = allocator.Allocate(operation.size);
+    benchmark::DoNotOptimize(objects.data());
+  }
+  for (void* object : objects) allocator.Free(object);
+  state.SetItemsProcessed(state.iterations());
+}
+
+struct MallocAllocator {
+  void* Allocate(size_t size) { return std::malloc(size); }
+  void Free(void* ptr) { std::free(ptr); }
+};
+
+static void BM_ReplaceObjectsMalloc(benchmark::State& state) {
+  MallocAllocator allocator;
+  ReplaceObjects(state, allocator);
+}
+BENCHMARK(BM_ReplaceObjectsMalloc)->ThreadRange(1, 4)->UseRealTime();
+
+static void BM_ReplaceObjectsHeap(benchmark::State& state) {
+  ReplaceObjects(state, GetHeap());
+}
+BENCHMARK(BM_ReplaceObjectsHeap)->ThreadRange(1, 4)->UseRealTime();
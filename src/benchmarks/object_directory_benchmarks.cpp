@@ -0,0 +1,81 @@
+/*
+MIT License - Copyright (c) 2023 Pierric Gimmig
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <string>
+#include <vector>
+
+#include "sham/shared_memory_buffer.h"
+
+// Measures name lookups in the object directory of a segment holding kNumObjects named objects,
+// both through Find and through FindOrConstruct on names that already exist.
+
+static constexpr const char* kSharedMemoryName = "sham_object_directory_benchmark";
+static constexpr size_t kNumObjects = 4096;
+
+static sham::SharedMemoryBuffer& GetBuffer() {
+  static sham::SharedMemoryBuffer buffer = [] {
+    sham::SharedMemoryBufferOptions options;
+    options.directory_capacity = 2 * kNumObjects;
+    sham::SharedMemoryBuffer buffer(kSharedMemoryName, 4 * 1024 * 1024,
+                                    sham::SharedMemoryBuffer::Type::kCreate, options);
+    for (size_t i = 0; i < kNumObjects; ++i) {
+      buffer.FindOrConstruct<uint64_t>("object_" + std::to_string(i), i);
+    }
+    return buffer;
+  }();
+  return buffer;
+}
+
+static const std::vector<std::string>& GetNames() {
+  static const std::vector<std::string> names = [] {
+    std::vector<std::string> names;
+    for (size_t i = 0; i < kNumObjects; ++i) names.push_back("object_" + std::to_string(i));
+    return names;
+  }();
+  return names;
+}
+
+static void BM_ObjectDirectoryFind(benchmark::State& state) {
+  sham::SharedMemoryBuffer& buffer = GetBuffer();
+  const std::vector<std::string>& names = GetNames();
+  uint64_t sum = 0;
+  for (auto _ : state) {
+    for (const std::string& name : names) sum += *buffer.Find<uint64_t>(name);
+  }
+  benchmark::DoNotOptimize(sum);
+  state.SetItemsProcessed(state.iterations() * kNumObjects);
+}
+BENCHMARK(BM_ObjectDirectoryFind);
+
+static void BM_ObjectDirectoryFindOrConstruct(benchmark::State& state) {
+  sham::SharedMemoryBuffer& buffer = GetBuffer();
+  const std::vector<std::string>& names = GetNames();
+  uint64_t sum = 0;
+  for (auto _ : state) {
+    for (const std::string& name : names) sum += *buffer.FindOrConstruct<uint64_t>(name, 0);
+  }
+  benchmark::DoNotOptimize(sum);
+  state.SetItemsProcessed(state.iterations() * kNumObjects);
+}
+BENCHMARK(BM_ObjectDirectoryFindOrConstruct);
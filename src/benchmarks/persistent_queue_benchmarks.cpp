@@ -0,0 +1,71 @@
+/*
+MIT License - Copyright (c) 2023 Pierric Gimmig
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <filesystem>
+
+#include "sham/benchmark.h"
+#include "sham/queue_mpmc.h"
+#include "sham/shared_memory_buffer.h"
+
+// Measures the throughput of a queue living in a persistent, file backed, buffer depending on how
+// often it is checkpointed to disk, relative to the same queue in regular shared memory.
+
+static constexpr size_t kQueueCapacity = 64 * 1024 - 1;
+
+using Queue = sham::mpmc::Queue<sham::Element, kQueueCapacity>;
+
+static void PushPop(benchmark::State& state, sham::SharedMemoryBuffer& buffer,
+                    size_t checkpoint_interval) {
+  Queue* queue = buffer.Allocate<Queue>(sham::kZeroInitialized);
+  sham::Element element = {};
+  size_t num_operations = 0;
+  for (auto _ : state) {
+    queue->push({0, 0, num_operations});
+    queue->pop(element);
+    if (checkpoint_interval != 0 && ++num_operations % checkpoint_interval == 0) {
+      buffer.Checkpoint();
+    }
+  }
+  benchmark::DoNotOptimize(element);
+  state.SetItemsProcessed(state.iterations());
+}
+
+static void BM_SharedMemoryQueue(benchmark::State& state) {
+  sham::SharedMemoryBuffer buffer("sham_persistent_benchmark", sizeof(Queue),
+                                  sham::SharedMemoryBuffer::Type::kCreate);
+  PushPop(state, buffer, 0);
+}
+BENCHMARK(BM_SharedMemoryQueue);
+
+// The argument is the number of push/pop pairs between checkpoints, 0 meaning never.
+static void BM_PersistentQueue(benchmark::State& state) {
+  std::filesystem::path path = std::filesystem::temp_directory_path() / "sham_benchmark.sham";
+  std::filesystem::remove(path);
+  {
+    auto buffer = sham::SharedMemoryBuffer::CreatePersistent(path.string(), sizeof(Queue));
+    PushPop(state, buffer, state.range(0));
+  }
+  std::filesystem::remove(path);
+}
+BENCHMARK(BM_PersistentQueue)->Arg(0)->Arg(1 << 16)->Arg(1 << 12)->Arg(1 << 8)->Arg(1 << 4);
@@ -0,0 +1,119 @@
+/*
+MIT License - Copyright (c) 2023 Pierric Gimmig
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#include <benchmark/benchmark.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <vector>
+
+#include "sham/pool_allocator.h"
+#include "sham/shared_memory_buffer.h"
+#include "sham/timer.h"
+
+// Measures allocating and freeing message buffers from a sham::PoolAllocator, through per-thread
+// caches or directly through the shared free lists, compared to malloc. Each iteration allocates a
+// burst of blocks and frees them, from several threads or several processes.
+
+static constexpr const char* kSharedMemoryName = "sham_pool_allocator_benchmark";
+static constexpr size_t kPoolCapacity = 256 * 1024 * 1024;
+static constexpr size_t kBurstSize = 16;
+static constexpr size_t kBlockSize = 256;
+
+static sham::SharedMemoryBuffer& GetBuffer() {
+  static sham::SharedMemoryBuffer buffer(kSharedMemoryName, 2 * kPoolCapacity,
+                                         sham::SharedMemoryBuffer::Type::kCreate);
+  return buffer;
+}
+
+static sham::PoolAllocator& GetPool() {
+  static sham::PoolAllocator* pool =
+      GetBuffer().Allocate<sham::PoolAllocator>(GetBuffer(), kPoolCapacity);
+  return *pool;
+}
+
+template <typename AllocatorT>
+static void AllocateAndFree(benchmark::State& state, AllocatorT& allocator) {
+  void* blocks[kBurstSize];
+  for (auto _ : state) {
+    for (void*& block : blocks) block = allocator.Allocate(kBlockSize);
+    benchmark::DoNotOptimize(blocks);
+    for (void* block : blocks) allocator.Free(block);
+  }
+  state.SetItemsProcessed(state.iterations() * kBurstSize);
+}
+
+struct Malloc {
+  void* Allocate(size_t size) { return std::malloc(size); }
+  void Free(void* ptr) { std::free(ptr); }
+};
+
+static void BM_Malloc(benchmark::State& state) {
+  Malloc allocator;
+  AllocateAndFree(state, allocator);
+}
+BENCHMARK(BM_Malloc)->ThreadRange(1, 4)->UseRealTime();
+
+static void BM_PoolAllocator(benchmark::State& state) {
+  AllocateAndFree(state, GetPool());
+}
+BENCHMARK(BM_PoolAllocator)->ThreadRange(1, 4)->UseRealTime();
+
+static void BM_PoolAllocatorCache(benchmark::State& state) {
+  sham::PoolAllocator::Cache cache(GetPool());
+  AllocateAndFree(state, cache);
+}
+BENCHMARK(BM_PoolAllocatorCache)->ThreadRange(1, 4)->UseRealTime();
+
+// Each process allocates and frees through its own cache and its own mapping of the pool.
+static void BM_PoolAllocatorProcesses(benchmark::State& state) {
+  static constexpr size_t kNumBursts = 100'000;
+  const size_t num_processes = state.range(0);
+  const size_t pool_offset = reinterpret_cast<uint8_t*>(&GetPool()) - GetBuffer().data();
+  for (auto _ : state) {
+    uint64_t duration_ns = 0;
+    {
+      sham::Timer timer(&duration_ns);
+      std::vector<pid_t> pids;
+      for (size_t i = 0; i < num_processes; ++i) {
+        pid_t pid = fork();
+        if (pid == 0) {
+          sham::SharedMemoryBuffer buffer(kSharedMemoryName, 2 * kPoolCapacity,
+                                          sham::SharedMemoryBuffer::Type::kAccessExisting);
+          sham::PoolAllocator::Cache cache(*buffer.As<sham::PoolAllocator>(pool_offset));
+          void* blocks[kBurstSize];
+          for (size_t j = 0; j < kNumBursts; ++j) {
+            for (void*& block : blocks) block = cache.Allocate(kBlockSize);
+            for (void* block : blocks) cache.Free(block);
+          }
+          _exit(0);
+        }
+        pids.push_back(pid);
+      }
+      for (pid_t pid : pids) waitpid(pid, nullptr, 0);
+    }
+    state.SetIterationTime(static_cast<double>(duration_ns) * 1e-9);
+  }
+  state.SetItemsProcessed(state.iterations() * num_processes * kNumBursts * kBurstSize);
+}
+BENCHMARK(BM_PoolAllocatorProcesses)->RangeMultiplier(2)->Range(1, 4)->UseManualTime();
@@ -0,0 +1,82 @@
+/*
+MIT License - Copyright (c) 2023 Pierric Gimmig
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "sham/benchmark.h"
+#include "sham/queue_arena.h"
+#include "sham/queue_spsc.h"
+#include "sham/shared_memory_buffer.h"
+
+// Thousands of simultaneously active SPSC queues, e.g. one per client session. Each iteration
+// pushes one element to every queue then pops one element from every queue, so the cost is
+// dominated by cache and TLB misses on the queues' indices and slots. Compares queues packed in a
+// QueueArena, with and without huge pages, to one shared memory segment per queue.
+
+using QueueT = sham::SPSCQueue<sham::Element, 1023>;
+using Arena = sham::QueueArena<QueueT>;
+
+static void PushPopAll(benchmark::State& state, const std::vector<QueueT*>& queues) {
+  uint64_t sum = 0;
+  for (auto _ : state) {
+    for (QueueT* queue : queues) queue->push({0, 0, 1});
+    for (QueueT* queue : queues) {
+      sum += queue->front()->value;
+      queue->pop();
+    }
+  }
+  benchmark::DoNotOptimize(sum);
+  state.SetItemsProcessed(state.iterations() * queues.size());
+}
+
+static void BM_ManyQueuesArena(benchmark::State& state, bool huge_pages) {
+  size_t num_queues = state.range(0);
+  sham::SharedMemoryBufferOptions options;
+  options.huge_pages = huge_pages;
+  sham::SharedMemoryBuffer buffer("sham_queue_arena_benchmark",
+                                  num_queues * Arena::kStride + 1024 * 1024,
+                                  sham::SharedMemoryBuffer::Type::kCreate, options);
+  Arena* arena = buffer.Allocate<Arena>(buffer, num_queues);
+  std::vector<QueueT*> queues;
+  for (size_t i = 0; i < num_queues; ++i) queues.push_back(arena->Get(arena->Acquire()));
+  PushPopAll(state, queues);
+}
+BENCHMARK_CAPTURE(BM_ManyQueuesArena, 4k_pages, false)->Arg(64)->Arg(1024)->Arg(5000);
+BENCHMARK_CAPTURE(BM_ManyQueuesArena, huge_pages, true)->Arg(64)->Arg(1024)->Arg(5000);
+
+static void BM_ManyQueuesOneSegmentEach(benchmark::State& state) {
+  size_t num_queues = state.range(0);
+  std::vector<std::unique_ptr<sham::SharedMemoryBuffer>> buffers;
+  std::vector<QueueT*> queues;
+  for (size_t i = 0; i < num_queues; ++i) {
+    buffers.push_back(std::make_unique<sham::SharedMemoryBuffer>(
+        "sham_queue_segment_benchmark_" + std::to_string(i), sizeof(QueueT),
+        sham::SharedMemoryBuffer::Type::kCreate));
+    queues.push_back(buffers.back()->Allocate<QueueT>());
+  }
+  PushPopAll(state, queues);
+}
+BENCHMARK(BM_ManyQueuesOneSegmentEach)->Arg(64)->Arg(1024)->Arg(5000);
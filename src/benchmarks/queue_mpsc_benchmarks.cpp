@@ -0,0 +1,89 @@
+/*
+MIT License - Copyright (c) 2023 Pierric Gimmig
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include "sham/benchmark.h"
+#include "sham/pool_allocator.h"
+#include "sham/queue_mpmc.h"
+#include "sham/queue_mpsc.h"
+#include "sham/shared_memory_buffer.h"
+
+// Many producers feeding a single consumer. Thread 0 is the consumer and pops as many elements per
+// iteration as there are producers, each producer pushes one element per iteration. Compares
+// mpsc::Queue, whose producers only exchange the head and whose consumer doesn't contend with
+// them, to mpmc::Queue, whose consumer updates the tail with compare-and-swaps.
+
+static void SetItemsProcessed(benchmark::State& state) {
+  state.SetItemsProcessed(state.thread_index() == 0 ? 0 : state.iterations());
+}
+
+static void BM_ManyToOneMpmcQueue(benchmark::State& state) {
+  using QueueT = sham::mpmc::Queue<sham::Element, 64 * 1024 - 1>;
+  static auto* queue = new QueueT();
+  uint64_t num_producers = state.threads() - 1;
+  uint64_t id = state.thread_index();
+  uint64_t sum = 0;
+  sham::Element element;
+  for (auto _ : state) {
+    if (id == 0) {
+      for (uint64_t i = 0; i < num_producers; ++i) {
+        while (!queue->try_pop(element)) {
+        }
+        sum += element.value;
+      }
+    } else {
+      queue->push({id, 0, 1});
+    }
+  }
+  benchmark::DoNotOptimize(sum);
+  SetItemsProcessed(state);
+}
+BENCHMARK(BM_ManyToOneMpmcQueue)->Threads(2)->Threads(5)->Threads(17)->Threads(33)->UseRealTime();
+
+static void BM_ManyToOneMpscQueue(benchmark::State& state) {
+  using QueueT = sham::mpsc::Queue<sham::Element>;
+  static sham::SharedMemoryBuffer buffer("sham_mpsc_benchmark", 256 * 1024 * 1024,
+                                         sham::SharedMemoryBuffer::Type::kCreate);
+  static auto* pool = buffer.Allocate<sham::PoolAllocator>(buffer, 255 * 1024 * 1024);
+  static auto* queue = buffer.Allocate<QueueT>(*pool);
+  sham::PoolAllocator::Cache cache(*pool);
+  uint64_t num_producers = state.threads() - 1;
+  uint64_t id = state.thread_index();
+  uint64_t sum = 0;
+  sham::Element element;
+  for (auto _ : state) {
+    if (id == 0) {
+      for (uint64_t i = 0; i < num_producers; ++i) {
+        while (!queue->try_pop(element, &cache)) {
+        }
+        sum += element.value;
+      }
+    } else {
+      while (!queue->try_push({id, 0, 1}, &cache)) {
+      }
+    }
+  }
+  benchmark::DoNotOptimize(sum);
+  SetItemsProcessed(state);
+}
+BENCHMARK(BM_ManyToOneMpscQueue)->Threads(2)->Threads(5)->Threads(17)->Threads(33)->UseRealTime();
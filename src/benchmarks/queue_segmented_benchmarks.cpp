@@ -0,0 +1,113 @@
+/*
+MIT License - Copyright (c) 2023 Pierric Gimmig
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include "adapters/concurrentqueue_adapter.h"
+#include "sham/benchmark.h"
+#include "sham/pool_allocator.h"
+#include "sham/queue_mpmc.h"
+#include "sham/queue_segmented.h"
+#include "sham/shared_memory_buffer.h"
+
+// Unbounded queues, mpmc::SegmentedQueue against moodycamel::ConcurrentQueue, with the bounded
+// mpmc::Queue as a reference. Each thread pushes then pops one element per iteration, so all
+// threads are both producers and consumers.
+
+using SegmentedQueueT = sham::mpmc::SegmentedQueue<sham::Element>;
+
+static SegmentedQueueT* GetSegmentedQueue() {
+  static sham::SharedMemoryBuffer buffer("sham_segmented_benchmark", 256 * 1024 * 1024,
+                                         sham::SharedMemoryBuffer::Type::kCreate);
+  static auto* pool = buffer.Allocate<sham::PoolAllocator>(buffer, 255 * 1024 * 1024);
+  static auto* queue = buffer.Allocate<SegmentedQueueT>(buffer, *pool);
+  return queue;
+}
+
+static void BM_PushPopMpmcQueue(benchmark::State& state) {
+  static auto* queue = new sham::mpmc::Queue<sham::Element, 64 * 1024 - 1>();
+  uint64_t id = state.thread_index();
+  sham::Element element;
+  for (auto _ : state) {
+    queue->push({id, 0, 1});
+    while (!queue->try_pop(element)) {
+    }
+    benchmark::DoNotOptimize(element);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PushPopMpmcQueue)->ThreadRange(1, 16)->UseRealTime();
+
+static void BM_PushPopConcurrentQueue(benchmark::State& state) {
+  static auto* queue = new sham::ConcurrentQueueAdapter<sham::Element>();
+  uint64_t id = state.thread_index();
+  sham::Element element;
+  for (auto _ : state) {
+    queue->push({id, 0, 1});
+    while (!queue->try_pop(element)) {
+    }
+    benchmark::DoNotOptimize(element);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PushPopConcurrentQueue)->ThreadRange(1, 16)->UseRealTime();
+
+static void BM_PushPopSegmentedQueue(benchmark::State& state) {
+  SegmentedQueueT::Handle handle(*GetSegmentedQueue());
+  uint64_t id = state.thread_index();
+  sham::Element element;
+  for (auto _ : state) {
+    while (!handle.try_push({id, 0, 1})) {
+    }
+    while (!handle.try_pop(element)) {
+    }
+    benchmark::DoNotOptimize(element);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PushPopSegmentedQueue)->ThreadRange(1, 16)->UseRealTime();
+
+// Bursts of state.range(0) elements, pushed then popped by a single thread. The segmented queue
+// allocates segments for the burst and recycles them as it drains.
+static void BM_BurstConcurrentQueue(benchmark::State& state) {
+  sham::ConcurrentQueueAdapter<sham::Element> queue;
+  sham::Element element;
+  for (auto _ : state) {
+    for (int64_t i = 0; i < state.range(0); ++i) queue.push({0, 0, 1});
+    for (int64_t i = 0; i < state.range(0); ++i) queue.try_pop(element);
+    benchmark::DoNotOptimize(element);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_BurstConcurrentQueue)->Arg(1024)->Arg(64 * 1024)->Arg(1024 * 1024);
+
+static void BM_BurstSegmentedQueue(benchmark::State& state) {
+  SegmentedQueueT::Handle handle(*GetSegmentedQueue());
+  sham::Element element;
+  for (auto _ : state) {
+    for (int64_t i = 0; i < state.range(0); ++i) (void)handle.try_push({0, 0, 1});
+    for (int64_t i = 0; i < state.range(0); ++i) (void)handle.try_pop(element);
+    benchmark::DoNotOptimize(element);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_BurstSegmentedQueue)->Arg(1024)->Arg(64 * 1024)->Arg(1024 * 1024);
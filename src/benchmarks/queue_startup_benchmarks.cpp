@@ -0,0 +1,73 @@
+/*
+MIT License - Copyright (c) 2023 Pierric Gimmig
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+
+#include "sham/benchmark.h"
+#include "sham/queue_mpmc.h"
+#include "sham/queue_spsc.h"
+#include "sham/shared_memory_buffer.h"
+
+// Measures how long it takes for a process to create a queue in a new shared memory segment and
+// for another one to attach to it. Queues constructed with sham::kZeroInitialized rely on the
+// segment being zero-filled and don't touch their ring, the others initialize every slot.
+
+static constexpr const char* kSharedMemoryName = "sham_queue_startup_benchmark";
+static constexpr size_t kQueueCapacity = 1 * 1024 * 1024 - 1;
+
+using MpmcQueue = sham::mpmc::Queue<sham::Element, kQueueCapacity>;
+using SpscQueue = sham::SPSCQueue<sham::Element, kQueueCapacity>;
+
+template <typename QueueT, bool kZeroInitialized>
+static void BM_CreateQueue(benchmark::State& state) {
+  for (auto _ : state) {
+    sham::SharedMemoryBuffer buffer(kSharedMemoryName, sizeof(QueueT),
+                                    sham::SharedMemoryBuffer::Type::kCreate);
+    QueueT* queue = nullptr;
+    if constexpr (kZeroInitialized) {
+      queue = buffer.Allocate<QueueT>(sham::kZeroInitialized);
+    } else {
+      queue = buffer.Allocate<QueueT>();
+    }
+    benchmark::DoNotOptimize(queue);
+    std::destroy_at(queue);
+  }
+}
+BENCHMARK_TEMPLATE(BM_CreateQueue, MpmcQueue, false)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_CreateQueue, MpmcQueue, true)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_CreateQueue, SpscQueue, false)->Unit(benchmark::kMicrosecond);
+
+template <typename QueueT>
+static void BM_AttachQueue(benchmark::State& state) {
+  sham::SharedMemoryBuffer buffer(kSharedMemoryName, sizeof(QueueT),
+                                  sham::SharedMemoryBuffer::Type::kCreate);
+  buffer.Allocate<QueueT>(sham::kZeroInitialized);
+  for (auto _ : state) {
+    sham::SharedMemoryBuffer attached(kSharedMemoryName, sizeof(QueueT),
+                                      sham::SharedMemoryBuffer::Type::kAccessExisting);
+    QueueT* queue = attached.As<QueueT>();
+    benchmark::DoNotOptimize(queue->empty());
+  }
+}
+BENCHMARK_TEMPLATE(BM_AttachQueue, MpmcQueue)->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,99 @@
+/*
+MIT License - Copyright (c) 2023 Pierric Gimmig
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+
+#include "sham/seqlock.h"
+#include "sham/shared_memory_buffer.h"
+
+// Throughput of a SeqLock cell and of a SeqLockArray as the number of readers grows. Thread 0 is
+// the writer, the other threads are readers. Readers retry while the cell they read is being
+// written, so read throughput drops with the write rate, while the writer never waits.
+
+struct TopOfBook {
+  uint64_t timestamp_ns;
+  double bid_price;
+  double ask_price;
+  uint64_t bid_size;
+  uint64_t ask_size;
+};
+
+static void SetCounters(benchmark::State& state) {
+  bool writer = state.thread_index() == 0;
+  state.counters["writes"] = benchmark::Counter(writer ? state.iterations() : 0,
+                                                benchmark::Counter::kIsRate);
+  state.counters["reads"] = benchmark::Counter(writer ? 0 : state.iterations(),
+                                               benchmark::Counter::kIsRate);
+}
+
+static void BM_SeqLockReadersOneWriter(benchmark::State& state) {
+  static sham::SeqLock<TopOfBook> cell;
+  uint64_t sum = 0;
+  if (state.thread_index() == 0) {
+    TopOfBook book{};
+    for (auto _ : state) {
+      ++book.timestamp_ns;
+      cell.Store(book);
+    }
+  } else {
+    for (auto _ : state) sum += cell.Load().timestamp_ns;
+  }
+  benchmark::DoNotOptimize(sum);
+  SetCounters(state);
+}
+BENCHMARK(BM_SeqLockReadersOneWriter)->ThreadRange(1, 16)->UseRealTime();
+
+// Readers and the writer access random symbols, so that they rarely contend on the same cell.
+static void BM_SeqLockArrayReadersOneWriter(benchmark::State& state) {
+  static constexpr size_t kNumSymbols = 4096;
+  static sham::SharedMemoryBuffer* buffer = nullptr;
+  static sham::SeqLockArray<TopOfBook>* books = nullptr;
+  if (state.thread_index() == 0) {
+    buffer = new sham::SharedMemoryBuffer("sham_seqlock_benchmark", kNumSymbols * 64 + 4096,
+                                          sham::SharedMemoryBuffer::Type::kCreate);
+    books = buffer->Allocate<sham::SeqLockArray<TopOfBook>>(*buffer, kNumSymbols);
+  }
+  uint64_t sum = 0;
+  uint64_t random = state.thread_index() + 1;
+  // The timed loop starts once thread 0 has created the array.
+  for (auto _ : state) {
+    // Xorshift, cheaper than the accesses it generates.
+    random ^= random << 13;
+    random ^= random >> 7;
+    random ^= random << 17;
+    size_t symbol = random % kNumSymbols;
+    if (state.thread_index() == 0) {
+      books->Store(symbol, {random, 1.0, 2.0, 100, 200});
+    } else {
+      sum += books->Load(symbol).timestamp_ns;
+    }
+  }
+  benchmark::DoNotOptimize(sum);
+  SetCounters(state);
+  if (state.thread_index() == 0) {
+    delete buffer;
+    buffer = nullptr;
+  }
+}
+BENCHMARK(BM_SeqLockArrayReadersOneWriter)->ThreadRange(1, 16)->UseRealTime();
@@ -0,0 +1,156 @@
+/*
+MIT License - Copyright (c) 2023 Pierric Gimmig
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <thread>
+
+#include "sham/queue_spsc.h"
+#include "sham/sequenced_ring.h"
+
+// The pipeline decode -> enrich -> (risk, persist) -> publish, with one thread per stage, on a
+// SequencedRing against a chain of SPSCQueues that copies events at every hop. Thread 0 produces
+// state.range(0) events per iteration, and every other thread processes as many.
+
+struct Event {
+  uint64_t id;
+  uint64_t price;
+  uint64_t quantity;
+  uint64_t enriched;
+  uint64_t risk;
+  uint64_t persisted;
+  uint64_t padding[2];
+};
+
+static constexpr size_t kCapacity = 4096;
+static constexpr int kNumThreads = 5;
+
+static void BM_PipelineSequencedRing(benchmark::State& state) {
+  using RingT = sham::SequencedRing<Event, kCapacity>;
+  static auto* ring = [] {
+    auto* ring = new RingT();
+    int enrich = *ring->AddStage();
+    int risk = *ring->AddStage({enrich});
+    int persist = *ring->AddStage({enrich});
+    ring->AddStage({risk, persist});
+    return ring;
+  }();
+  size_t batch = state.range(0);
+  uint64_t sum = 0;
+  if (state.thread_index() == 0) {
+    RingT::Producer producer(*ring);
+    for (auto _ : state) {
+      int64_t first = producer.Claim(batch);
+      for (int64_t i = first; i < first + static_cast<int64_t>(batch); ++i) {
+        producer[i].id = i;
+        producer[i].price = 100;
+        producer[i].quantity = 10;
+      }
+      producer.Publish();
+    }
+  } else {
+    RingT::Stage stage(*ring, state.thread_index() - 1);
+    auto process = [&](Event& event, int64_t) {
+      switch (state.thread_index()) {
+        case 1:
+          event.enriched = event.price * event.quantity;
+          break;
+        case 2:
+          event.risk = event.enriched > 500;
+          break;
+        case 3:
+          event.persisted = event.id;
+          break;
+        case 4:
+          sum += event.risk + event.persisted;
+          break;
+      }
+    };
+    for (auto _ : state) {
+      for (size_t n = 0; n < batch;) n += stage.Consume(process, batch - n);
+    }
+  }
+  benchmark::DoNotOptimize(sum);
+  state.SetItemsProcessed(state.thread_index() == 0 ? state.iterations() * batch : 0);
+}
+BENCHMARK(BM_PipelineSequencedRing)->Threads(kNumThreads)->Arg(1)->Arg(16)->Arg(256)->UseRealTime();
+
+static void BM_PipelineSPSCQueues(benchmark::State& state) {
+  using QueueT = sham::SPSCQueue<Event, kCapacity>;
+  // decode -> enrich, enrich -> risk, enrich -> persist, risk -> publish, persist -> publish.
+  static auto* queues = new QueueT[5];
+  size_t batch = state.range(0);
+  uint64_t sum = 0;
+  // Same waiting strategy as SequencedRing.
+  auto push = [](QueueT& queue, const Event& event) {
+    for (int spins = 0; !queue.try_push(event);) {
+      if (++spins > 64) std::this_thread::yield();
+    }
+  };
+  auto pop = [](QueueT& queue) {
+    Event* event;
+    for (int spins = 0; (event = queue.front()) == nullptr;) {
+      if (++spins > 64) std::this_thread::yield();
+    }
+    Event copy = *event;
+    queue.pop();
+    return copy;
+  };
+  for (auto _ : state) {
+    for (size_t i = 0; i < batch; ++i) {
+      switch (state.thread_index()) {
+        case 0:
+          push(queues[0], {i, 100, 10, 0, 0, 0, {}});
+          break;
+        case 1: {
+          Event event = pop(queues[0]);
+          event.enriched = event.price * event.quantity;
+          push(queues[1], event);
+          push(queues[2], event);
+          break;
+        }
+        case 2: {
+          Event event = pop(queues[1]);
+          event.risk = event.enriched > 500;
+          push(queues[3], event);
+          break;
+        }
+        case 3: {
+          Event event = pop(queues[2]);
+          event.persisted = event.id;
+          push(queues[4], event);
+          break;
+        }
+        case 4: {
+          Event risk = pop(queues[3]);
+          Event persisted = pop(queues[4]);
+          sum += risk.risk + persisted.persisted;
+          break;
+        }
+      }
+    }
+  }
+  benchmark::DoNotOptimize(sum);
+  state.SetItemsProcessed(state.thread_index() == 0 ? state.iterations() * batch : 0);
+}
+BENCHMARK(BM_PipelineSPSCQueues)->Threads(kNumThreads)->Arg(1)->Arg(16)->Arg(256)->UseRealTime();
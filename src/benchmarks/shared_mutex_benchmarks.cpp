@@ -0,0 +1,91 @@
+/*
+MIT License - Copyright (c) 2023 Pierric Gimmig
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+
+#include "sham/shared_mutex.h"
+#include "sham/sync.h"
+
+// Read-mostly access to shared data, e.g. a configuration, from 1 to all the cores. Each
+// iteration takes the lock for reading and reads a value. SharedMutex counts readers in per-slot
+// cache lines, std::shared_mutex in a single one, which all the readers modify.
+
+template <typename MutexT>
+static void BM_ReadLock(benchmark::State& state) {
+  static MutexT mutex;
+  static uint64_t value = 42;
+  uint64_t sum = 0;
+  for (auto _ : state) {
+    std::shared_lock lock(mutex);
+    sum += value;
+  }
+  benchmark::DoNotOptimize(sum);
+  state.SetItemsProcessed(state.iterations());
+}
+
+// Baseline: an exclusive lock taken for reads.
+static void BM_ReadMutex(benchmark::State& state) {
+  static sham::Mutex mutex;
+  static uint64_t value = 42;
+  uint64_t sum = 0;
+  for (auto _ : state) {
+    std::lock_guard lock(mutex);
+    sum += value;
+  }
+  benchmark::DoNotOptimize(sum);
+  state.SetItemsProcessed(state.iterations());
+}
+
+static void AllCores(benchmark::internal::Benchmark* benchmark) {
+  int num_cores = std::max(1u, std::thread::hardware_concurrency());
+  for (int threads = 1; threads < num_cores; threads *= 2) benchmark->Threads(threads);
+  benchmark->Threads(num_cores);
+  benchmark->UseRealTime();
+}
+
+BENCHMARK_TEMPLATE(BM_ReadLock, sham::SharedMutex)->Apply(AllCores);
+BENCHMARK_TEMPLATE(BM_ReadLock, std::shared_mutex)->Apply(AllCores);
+BENCHMARK(BM_ReadMutex)->Apply(AllCores);
+
+// Readers on all the cores but one, which writes every `state.range(0)` iterations.
+static void BM_SharedMutexReadMostly(benchmark::State& state) {
+  static sham::SharedMutex mutex;
+  static uint64_t value = 0;
+  uint64_t sum = 0;
+  int64_t i = 0;
+  for (auto _ : state) {
+    if (state.thread_index() == 0 && ++i % state.range(0) == 0) {
+      std::unique_lock lock(mutex);
+      ++value;
+    } else {
+      std::shared_lock lock(mutex);
+      sum += value;
+    }
+  }
+  benchmark::DoNotOptimize(sum);
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SharedMutexReadMostly)->Arg(100)->Arg(10'000)->Apply(AllCores);
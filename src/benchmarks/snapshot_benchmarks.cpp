@@ -0,0 +1,101 @@
+/*
+MIT License - Copyright (c) 2023 Pierric Gimmig
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <thread>
+
+#include "sham/benchmark.h"
+#include "sham/queue_mpmc.h"
+#include "sham/shared_memory_buffer.h"
+#include "sham/snapshot.h"
+
+// Impact of snapshots on a writer. BM_SnapshotCapture measures the time to capture a segment
+// holding a 128 MiB queue. BM_WriterDuringSnapshots measures the throughput of a thread pushing and
+// popping elements of that queue while another thread captures snapshots back to back (Arg 1) or
+// doesn't (Arg 0). Reading the segment steals the queue's cache lines from the writer, which pays
+// a cache miss for each line it writes next. The snapshots go to /dev/null so that only the capture
+// is measured, writing to disk happens after it and doesn't affect writers.
+
+static constexpr const char* kSharedMemoryName = "sham_snapshot_benchmark";
+static constexpr size_t kQueueCapacity = 2 * 1024 * 1024;
+using QueueT = sham::mpmc::Queue<sham::Element, kQueueCapacity>;
+
+static sham::SharedMemoryBuffer& GetBuffer() {
+  static sham::SharedMemoryBuffer buffer(kSharedMemoryName, sizeof(QueueT) + 1024 * 1024,
+                                         sham::SharedMemoryBuffer::Type::kCreate);
+  static QueueT* queue = [] {
+    QueueT* queue = buffer.Allocate<QueueT>(sham::kZeroInitialized);
+    // Touch the whole queue so that snapshots copy it entirely.
+    sham::Element element;
+    for (size_t i = 0; i < kQueueCapacity; ++i) {
+      queue->push({0, 0, i});
+      queue->pop(element);
+    }
+    return queue;
+  }();
+  benchmark::DoNotOptimize(queue);
+  return buffer;
+}
+
+static void BM_SnapshotCapture(benchmark::State& state) {
+  sham::SharedMemoryBuffer& buffer = GetBuffer();
+  sham::SnapshotInfo info;
+  uint64_t capture_duration_ns = 0;
+  for (auto _ : state) {
+    sham::WriteSnapshot(buffer, "/dev/null", &info);
+    capture_duration_ns += info.capture_duration_ns;
+  }
+  state.SetBytesProcessed(state.iterations() * info.size);
+  state.counters["capture_ms"] =
+      benchmark::Counter(capture_duration_ns / 1e6 / state.iterations());
+}
+BENCHMARK(BM_SnapshotCapture)->Unit(benchmark::kMillisecond);
+
+static void BM_WriterDuringSnapshots(benchmark::State& state) {
+  sham::SharedMemoryBuffer& buffer = GetBuffer();
+  QueueT* queue = buffer.As<QueueT>(0);
+  std::atomic<bool> done = false;
+  std::atomic<size_t> num_snapshots = 0;
+  std::thread snapshotter;
+  if (state.range(0) != 0) {
+    snapshotter = std::thread([&] {
+      while (!done) {
+        sham::WriteSnapshot(buffer, "/dev/null");
+        ++num_snapshots;
+      }
+    });
+  }
+  sham::Element element;
+  uint64_t i = 0;
+  for (auto _ : state) {
+    queue->push({0, 0, i++});
+    queue->pop(element);
+  }
+  done = true;
+  if (snapshotter.joinable()) snapshotter.join();
+  benchmark::DoNotOptimize(element);
+  state.SetItemsProcessed(state.iterations());
+  state.counters["snapshots"] = num_snapshots.load();
+}
+BENCHMARK(BM_WriterDuringSnapshots)->Arg(0)->Arg(1)->UseRealTime();
@@ -0,0 +1,125 @@
+/*
+MIT License - Copyright (c) 2023 Pierric Gimmig
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <mutex>
+#include <thread>
+
+#include "sham/sync.h"
+
+// Cost of the process-shared synchronization primitives of sham/sync.h. The uncontended benchmarks
+// measure the fast paths, which never enter the kernel. The contended ones run several threads on
+// the same primitive, so that threads block and wake each other through futexes.
+
+template <typename MutexT>
+static MutexT& GetMutex() {
+  static MutexT mutex;
+  return mutex;
+}
+
+template <typename MutexT>
+static void BM_MutexLockUnlock(benchmark::State& state) {
+  MutexT& mutex = GetMutex<MutexT>();
+  uint64_t counter = 0;
+  for (auto _ : state) {
+    std::lock_guard lock(mutex);
+    ++counter;
+  }
+  benchmark::DoNotOptimize(counter);
+  state.SetItemsProcessed(state.iterations());
+}
+
+struct RobustMutex : sham::Mutex {
+  RobustMutex() : sham::Mutex(/*robust=*/true) {}
+};
+
+BENCHMARK_TEMPLATE(BM_MutexLockUnlock, std::mutex)->Threads(1)->Threads(4)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_MutexLockUnlock, sham::Mutex)->Threads(1)->Threads(4)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_MutexLockUnlock, RobustMutex)->Threads(1)->Threads(4)->UseRealTime();
+
+static void BM_SemaphoreReleaseAcquire(benchmark::State& state) {
+  static sham::Semaphore semaphore;
+  for (auto _ : state) {
+    semaphore.release();
+    semaphore.acquire();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SemaphoreReleaseAcquire);
+
+// Round trip between two threads, each waking the other: measures the latency of a futex wake up.
+static void BM_EventPingPong(benchmark::State& state) {
+  sham::Event ping;
+  sham::Event pong;
+  std::atomic<bool> done = false;
+  std::thread responder([&] {
+    while (ping.wait() == sham::SyncStatus::kOk && !done) pong.set();
+  });
+  for (auto _ : state) {
+    ping.set();
+    pong.wait();
+  }
+  done = true;
+  ping.set();
+  responder.join();
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_EventPingPong)->UseRealTime();
+
+static void BM_ConditionVariablePingPong(benchmark::State& state) {
+  sham::Mutex mutex;
+  sham::ConditionVariable condition;
+  uint64_t turn = 0;
+  bool done = false;
+  std::thread responder([&] {
+    std::unique_lock lock(mutex);
+    while (!done) {
+      condition.wait(mutex, [&] { return turn % 2 == 1 || done; });
+      ++turn;
+      condition.notify_one();
+    }
+  });
+  for (auto _ : state) {
+    std::unique_lock lock(mutex);
+    ++turn;
+    condition.notify_one();
+    condition.wait(mutex, [&] { return turn % 2 == 0; });
+  }
+  {
+    std::unique_lock lock(mutex);
+    done = true;
+    condition.notify_one();
+  }
+  responder.join();
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ConditionVariablePingPong)->UseRealTime();
+
+static void BM_BarrierArriveAndWait(benchmark::State& state) {
+  static sham::Barrier* barrier = nullptr;
+  if (state.thread_index() == 0) barrier = new sham::Barrier(state.threads());
+  // Google Benchmark starts the timed loop of all threads together.
+  for (auto _ : state) barrier->arrive_and_wait();
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_BarrierArriveAndWait)->Threads(2)->Threads(4)->UseRealTime();
@@ -0,0 +1,128 @@
+/*
+MIT License - Copyright (c) 2023 Pierric Gimmig
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <queue>
+#include <random>
+#include <vector>
+
+#include "sham/pool_allocator.h"
+#include "sham/shared_memory_buffer.h"
+#include "sham/timer.h"
+#include "sham/timer_queue.h"
+
+// Timers with state.range(0) pending at all times, against a std::priority_queue. Each iteration
+// advances time by one tick of 1ms, schedules kTimersPerTick timers with random delays, and pops
+// the timers due, so that as many are delivered as scheduled once the pending timers reached
+// their steady state.
+
+static constexpr uint64_t kTickNs = 1'000'000;
+static constexpr uint64_t kTimersPerTick = 1024;
+
+using TimerQueueT = sham::TimerQueue<uint64_t>;
+
+// Uniform delays averaging `num_pending` / kTimersPerTick ticks keep `num_pending` timers pending.
+static uint64_t RandomDelay(std::mt19937_64& random, uint64_t num_pending) {
+  return random() % (2 * num_pending / kTimersPerTick * kTickNs);
+}
+
+static void BM_TimerQueue(benchmark::State& state) {
+  uint64_t num_pending = state.range(0);
+  // Room for the timers, and the buckets of the wheel and of the caches.
+  uint64_t pool_capacity = 2 * num_pending * TimerQueueT::NodeSize() + 16 * 1024 * 1024;
+  sham::SharedMemoryBuffer buffer =
+      sham::SharedMemoryBuffer::CreateAnonymous(pool_capacity + 1024 * 1024);
+  auto* pool = buffer.Allocate<sham::PoolAllocator>(buffer, pool_capacity);
+  auto* timers = buffer.Allocate<TimerQueueT>(*pool, kTickNs, 0);
+  sham::PoolAllocator::Cache cache(*pool);
+  std::mt19937_64 random(1);
+  uint64_t now = 0;
+  uint64_t sum = 0;
+  auto deliver = [&](uint64_t& value) { sum += value; };
+  for (uint64_t i = 0; i < num_pending; ++i) {
+    if (!timers->ScheduleAt(RandomDelay(random, num_pending), i, &cache)) {
+      state.SkipWithError("Out of memory");
+      return;
+    }
+  }
+  // Moves the initial timers to the wheel.
+  timers->PopDue(now, deliver, &cache);
+  for (auto _ : state) {
+    now += kTickNs;
+    for (uint64_t i = 0; i < kTimersPerTick; ++i) {
+      if (!timers->ScheduleAt(now + RandomDelay(random, num_pending), i, &cache)) {
+        state.SkipWithError("Out of memory");
+        return;
+      }
+    }
+    timers->PopDue(now, deliver, &cache);
+  }
+  benchmark::DoNotOptimize(sum);
+  state.SetItemsProcessed(state.iterations() * kTimersPerTick);
+}
+BENCHMARK(BM_TimerQueue)->Arg(1 << 14)->Arg(1 << 20)->Arg(4 << 20)->Unit(benchmark::kMicrosecond);
+
+static void BM_PriorityQueue(benchmark::State& state) {
+  uint64_t num_pending = state.range(0);
+  using Timer = std::pair<uint64_t, uint64_t>;
+  std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timers;
+  std::mt19937_64 random(1);
+  uint64_t now = 0;
+  uint64_t sum = 0;
+  for (uint64_t i = 0; i < num_pending; ++i) timers.emplace(RandomDelay(random, num_pending), i);
+  for (auto _ : state) {
+    now += kTickNs;
+    for (uint64_t i = 0; i < kTimersPerTick; ++i) {
+      timers.emplace(now + RandomDelay(random, num_pending), i);
+    }
+    while (!timers.empty() && timers.top().first <= now) {
+      sum += timers.top().second;
+      timers.pop();
+    }
+  }
+  benchmark::DoNotOptimize(sum);
+  state.SetItemsProcessed(state.iterations() * kTimersPerTick);
+}
+BENCHMARK(BM_PriorityQueue)->Arg(1 << 20)->Arg(4 << 20)->Unit(benchmark::kMicrosecond);
+
+// Scheduling from several threads, with the coarse clock, while thread 0 also pops due timers.
+static void BM_TimerQueueSchedule(benchmark::State& state) {
+  static sham::SharedMemoryBuffer buffer =
+      sham::SharedMemoryBuffer::CreateAnonymous(1024 * 1024 * 1024);
+  static auto* pool = buffer.Allocate<sham::PoolAllocator>(buffer, 1000 * 1024 * 1024);
+  static auto* timers = buffer.Allocate<TimerQueueT>(*pool, kTickNs);
+  sham::PoolAllocator::Cache cache(*pool);
+  uint64_t sum = 0;
+  uint64_t delay = 0;
+  for (auto _ : state) {
+    delay = (delay + 7919) % (10 * kTickNs);
+    while (!timers->ScheduleAfter(delay, delay, &cache)) {
+    }
+    if (state.thread_index() == 0 && delay < 7919) {
+      timers->PopDue([&](uint64_t& value) { sum += value; }, &cache);
+    }
+  }
+  benchmark::DoNotOptimize(sum);
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TimerQueueSchedule)->ThreadRange(1, 8)->UseRealTime();
@@ -0,0 +1,139 @@
+/*
+MIT License - Copyright (c) 2023 Pierric Gimmig
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+#include "sham/queue_spsc.h"
+#include "sham/seqlock.h"
+#include "sham/triple_buffer.h"
+
+// Publication of large latest values, e.g. snapshots of an order book, from a writer thread to a
+// reader thread. Each iteration of the writer writes a full payload and publishes it, each
+// iteration of the reader gets the newest payload and reads it in full. Compares a TripleBuffer to
+// a SeqLock, whose reader retries while the writer rewrites the payload, and to an SPSCQueue
+// drained by the reader, which copies each element to keep the newest one.
+
+template <size_t kSize>
+struct Payload {
+  uint64_t words[kSize / sizeof(uint64_t)];
+};
+
+template <size_t kSize>
+static void Fill(Payload<kSize>* payload, uint64_t value) {
+  for (uint64_t& word : payload->words) word = value;
+}
+
+template <size_t kSize>
+static uint64_t Sum(const Payload<kSize>& payload) {
+  uint64_t sum = 0;
+  for (uint64_t word : payload.words) sum += word;
+  return sum;
+}
+
+static void SetCounters(benchmark::State& state) {
+  bool writer = state.thread_index() == 0;
+  state.counters["writes"] = benchmark::Counter(writer ? state.iterations() : 0,
+                                                benchmark::Counter::kIsRate);
+  state.counters["reads"] = benchmark::Counter(writer ? 0 : state.iterations(),
+                                               benchmark::Counter::kIsRate);
+}
+
+template <size_t kSize>
+static void BM_LatestValueTripleBuffer(benchmark::State& state) {
+  static std::unique_ptr<sham::TripleBuffer<Payload<kSize>>> triple_buffer;
+  if (state.thread_index() == 0) {
+    triple_buffer = std::make_unique<sham::TripleBuffer<Payload<kSize>>>();
+  }
+  uint64_t sum = 0;
+  uint64_t i = 0;
+  for (auto _ : state) {
+    if (state.thread_index() == 0) {
+      Fill(triple_buffer->write_buffer(), ++i);
+      triple_buffer->Publish();
+    } else {
+      sum += Sum(triple_buffer->Read());
+    }
+  }
+  benchmark::DoNotOptimize(sum);
+  SetCounters(state);
+}
+
+template <size_t kSize>
+static void BM_LatestValueSeqLock(benchmark::State& state) {
+  static std::unique_ptr<sham::SeqLock<Payload<kSize>>> seqlock;
+  if (state.thread_index() == 0) seqlock = std::make_unique<sham::SeqLock<Payload<kSize>>>();
+  auto payload = std::make_unique<Payload<kSize>>();
+  uint64_t sum = 0;
+  uint64_t retries = 0;
+  uint64_t i = 0;
+  for (auto _ : state) {
+    if (state.thread_index() == 0) {
+      seqlock->Update([&](Payload<kSize>& value) { Fill(&value, ++i); });
+    } else {
+      while (!seqlock->TryLoad(payload.get())) ++retries;
+      sum += Sum(*payload);
+    }
+  }
+  benchmark::DoNotOptimize(sum);
+  SetCounters(state);
+  // Counters are summed over threads, the writer's is 0.
+  state.counters["retries_per_read"] = static_cast<double>(retries) / state.iterations();
+}
+
+template <size_t kSize>
+static void BM_LatestValueSPSCQueue(benchmark::State& state) {
+  using QueueT = sham::SPSCQueue<Payload<kSize>, 15>;
+  static std::unique_ptr<QueueT> queue;
+  if (state.thread_index() == 0) queue = std::make_unique<QueueT>();
+  auto payload = std::make_unique<Payload<kSize>>();
+  uint64_t sum = 0;
+  uint64_t i = 0;
+  for (auto _ : state) {
+    if (state.thread_index() == 0) {
+      // A full queue drops the value, the reader only wants the newest one.
+      Fill(payload.get(), ++i);
+      (void)queue->try_push(*payload);
+    } else {
+      while (Payload<kSize>* front = queue->front()) {
+        std::memcpy(payload.get(), front, kSize);
+        queue->pop();
+      }
+      sum += Sum(*payload);
+    }
+  }
+  benchmark::DoNotOptimize(sum);
+  SetCounters(state);
+}
+
+BENCHMARK_TEMPLATE(BM_LatestValueTripleBuffer, 1024)->Threads(2)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_LatestValueTripleBuffer, 8 * 1024)->Threads(2)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_LatestValueTripleBuffer, 64 * 1024)->Threads(2)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_LatestValueSeqLock, 1024)->Threads(2)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_LatestValueSeqLock, 8 * 1024)->Threads(2)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_LatestValueSeqLock, 64 * 1024)->Threads(2)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_LatestValueSPSCQueue, 1024)->Threads(2)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_LatestValueSPSCQueue, 8 * 1024)->Threads(2)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_LatestValueSPSCQueue, 64 * 1024)->Threads(2)->UseRealTime();
@@ -29,6 +29,7 @@ SOFTWARE.
 #include <thread>
 #include <vector>
 
+#include "sham/numa.h"
 #include "sham/string_format.h"
 #include "sham/timer.h"
 
@@ -143,6 +144,13 @@ class Benchmark {
     summary.million_pop_operations_per_second = pop_result_.MillionOperationsPerSecond();
   }
 
+  // Pins push and pop threads to the cpus of the given NUMA nodes. A negative node leaves the
+  // corresponding threads unpinned. Must be called before Run().
+  void SetNumaNodes(int push_node, int pop_node) {
+    push_numa_node_ = push_node;
+    pop_numa_node_ = pop_node;
+  }
+
   size_t GetRequestedNumElementsToPush() const { return num_elements_to_push_; }
   size_t GetNumPushedElements() const { return push_result_.TotalNumOperations(); }
   size_t GetNumPoppedElements() const { return pop_result_.TotalNumOperations(); }
@@ -174,6 +182,7 @@ class Benchmark {
 
   void PushThread(size_t id, ThreadResult* result) {
     result->id = id;
+    if (push_numa_node_ >= 0) PinThreadToNumaNode(push_numa_node_);
     size_t push_per_thread = num_elements_to_push_ / push_result_.threads.size();
     RegisterAndBusyWaitForAllThreads();
     Timer timer(&result->duration_ns);
@@ -185,6 +194,7 @@ class Benchmark {
 
   void PopThread(size_t id, ThreadResult* result) {
     result->id = id;
+    if (pop_numa_node_ >= 0) PinThreadToNumaNode(pop_numa_node_);
     Element element;
     RegisterAndBusyWaitForAllThreads();
     Timer timer(&result->duration_ns);
@@ -224,6 +234,8 @@ class Benchmark {
 
   size_t num_push_threads_ = 0;
   size_t num_pop_threads_ = 0;
+  int push_numa_node_ = -1;
+  int pop_numa_node_ = -1;
 
   Result push_result_;
   Result pop_result_;
@@ -0,0 +1,426 @@
+/*
+MIT License - Copyright (c) 2023 Pierric Gimmig
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#include "sham/offset_ptr.h"
+#include "sham/shared_memory_buffer.h"
+
+namespace sham {
+
+// Containers that can be placed in shared memory and used from every process mapping it. They
+// never allocate: elements live either inline, in a fixed-size array (Fixed*), or in memory carved
+// out of a SharedMemoryBuffer when the container is constructed (Arena*). Internal links are
+// OffsetPtrs, so an arena-backed container must live in the same buffer as its elements. In both
+// cases, zero-filled memory is a valid empty container and containers are neither copyable nor
+// movable. Operations that would exceed the capacity fail instead of reallocating.
+//
+// Example:
+//   auto* pids = buffer.Allocate<sham::ArenaVector<int>>(buffer, /*capacity=*/64);
+//   if (!pids->push_back(getpid())) HandleFull();
+
+// Storage for kCapacity elements of type T inside the container.
+template <typename T, size_t kCapacity>
+class InlineStorage {
+ public:
+  T* data() { return reinterpret_cast<T*>(data_); }
+  const T* data() const { return reinterpret_cast<const T*>(data_); }
+  static constexpr size_t capacity() { return kCapacity; }
+
+ private:
+  alignas(T) std::byte data_[sizeof(T) * kCapacity];
+};
+
+// Storage for `capacity` elements of type T allocated from a SharedMemoryBuffer. The capacity is 0
+// if the buffer is full or `capacity` elements don't fit in memory.
+template <typename T>
+class ArenaStorage {
+ public:
+  ArenaStorage() = default;
+  ArenaStorage(T* data, size_t capacity) : data_(data), capacity_(data ? capacity : 0) {}
+  ArenaStorage(SharedMemoryBuffer& buffer, size_t capacity)
+      : ArenaStorage(Allocate(buffer, capacity), capacity) {}
+
+  T* data() { return data_.get(); }
+  const T* data() const { return data_.get(); }
+  size_t capacity() const { return capacity_; }
+
+ private:
+  static T* Allocate(SharedMemoryBuffer& buffer, size_t capacity) {
+    if (capacity > SIZE_MAX / sizeof(T)) return nullptr;
+    return reinterpret_cast<T*>(buffer.Allocate(sizeof(T) * capacity, alignof(T)));
+  }
+
+  OffsetPtr<T> data_;
+  size_t capacity_ = 0;
+};
+
+template <typename T, typename Storage>
+class BasicVector {
+ public:
+  using value_type = T;
+  using iterator = T*;
+  using const_iterator = const T*;
+
+  // Arguments are forwarded to the storage.
+  template <typename... StorageArgs>
+  explicit BasicVector(StorageArgs&&... args) : storage_(std::forward<StorageArgs>(args)...) {}
+  ~BasicVector() { clear(); }
+
+  BasicVector(const BasicVector&) = delete;
+  BasicVector& operator=(const BasicVector&) = delete;
+
+  // Returns nullptr if the vector is full.
+  template <typename... Args>
+  T* emplace_back(Args&&... args) {
+    if (full()) return nullptr;
+    T* element = new (data() + size_) T(std::forward<Args>(args)...);
+    ++size_;
+    return element;
+  }
+
+  [[nodiscard]] bool push_back(const T& value) { return emplace_back(value) != nullptr; }
+  [[nodiscard]] bool push_back(T&& value) { return emplace_back(std::move(value)) != nullptr; }
+
+  void pop_back() {
+    assert(!empty());
+    std::destroy_at(data() + --size_);
+  }
+
+  void clear() {
+    std::destroy(begin(), end());
+    size_ = 0;
+  }
+
+  T& operator[](size_t index) {
+    assert(index < size_);
+    return data()[index];
+  }
+  const T& operator[](size_t index) const {
+    assert(index < size_);
+    return data()[index];
+  }
+
+  T& front() { return (*this)[0]; }
+  const T& front() const { return (*this)[0]; }
+  T& back() { return (*this)[size_ - 1]; }
+  const T& back() const { return (*this)[size_ - 1]; }
+
+  T* data() { return storage_.data(); }
+  const T* data() const { return storage_.data(); }
+  iterator begin() { return data(); }
+  iterator end() { return data() + size_; }
+  const_iterator begin() const { return data(); }
+  const_iterator end() const { return data() + size_; }
+
+  size_t size() const { return size_; }
+  size_t capacity() const { return storage_.capacity(); }
+  bool empty() const { return size_ == 0; }
+  bool full() const { return size_ == capacity(); }
+
+ private:
+  Storage storage_;
+  size_t size_ = 0;
+};
+
+template <typename T, size_t kCapacity>
+using FixedVector = BasicVector<T, InlineStorage<T, kCapacity>>;
+
+// Constructed with (SharedMemoryBuffer&, capacity).
+template <typename T>
+using ArenaVector = BasicVector<T, ArenaStorage<T>>;
+
+// Null-terminated string of at most "storage capacity - 1" characters.
+template <typename Storage>
+class BasicString {
+ public:
+  using value_type = char;
+  using iterator = char*;
+  using const_iterator = const char*;
+
+  // Arguments are forwarded to the storage.
+  template <typename... StorageArgs>
+  explicit BasicString(StorageArgs&&... args) : storage_(std::forward<StorageArgs>(args)...) {
+    if (storage_.capacity() > 0) storage_.data()[0] = '\0';
+  }
+
+  BasicString(const BasicString&) = delete;
+  BasicString& operator=(const BasicString&) = delete;
+
+  // Returns false and leaves the string unchanged if `str` doesn't fit.
+  [[nodiscard]] bool assign(std::string_view str) {
+    if (str.size() > capacity()) return false;
+    size_ = 0;
+    return append(str);
+  }
+
+  // Returns false and leaves the string unchanged if `str` doesn't fit.
+  [[nodiscard]] bool append(std::string_view str) {
+    if (str.size() > capacity() - size_) return false;
+    std::memcpy(data() + size_, str.data(), str.size());
+    size_ += str.size();
+    data()[size_] = '\0';
+    return true;
+  }
+
+  [[nodiscard]] bool push_back(char c) { return append(std::string_view(&c, 1)); }
+
+  void clear() {
+    size_ = 0;
+    if (storage_.capacity() > 0) data()[0] = '\0';
+  }
+
+  char& operator[](size_t index) {
+    assert(index < size_);
+    return data()[index];
+  }
+  char operator[](size_t index) const {
+    assert(index < size_);
+    return data()[index];
+  }
+
+  std::string_view view() const { return std::string_view(c_str(), size_); }
+  operator std::string_view() const { return view(); }
+  const char* c_str() const { return storage_.capacity() > 0 ? data() : ""; }
+
+  char* data() { return storage_.data(); }
+  const char* data() const { return storage_.data(); }
+  iterator begin() { return data(); }
+  iterator end() { return data() + size_; }
+  const_iterator begin() const { return data(); }
+  const_iterator end() const { return data() + size_; }
+
+  size_t size() const { return size_; }
+  size_t capacity() const { return storage_.capacity() > 0 ? storage_.capacity() - 1 : 0; }
+  bool empty() const { return size_ == 0; }
+
+  friend bool operator==(const BasicString& a, std::string_view b) { return a.view() == b; }
+  friend bool operator!=(const BasicString& a, std::string_view b) { return a.view() != b; }
+
+ private:
+  Storage storage_;
+  size_t size_ = 0;
+};
+
+// String of at most kMaxSize characters.
+template <size_t kMaxSize>
+using FixedString = BasicString<InlineStorage<char, kMaxSize + 1>>;
+
+// Constructed with (SharedMemoryBuffer&, capacity), holds at most capacity - 1 characters.
+using ArenaString = BasicString<ArenaStorage<char>>;
+
+template <typename T>
+struct ListNode {
+  OffsetPtr<ListNode> next;
+  OffsetPtr<ListNode> prev;
+  alignas(T) std::byte value[sizeof(T)];
+};
+
+// Doubly linked list whose nodes come from a fixed pool. Nodes are handed out in order the first
+// time, then recycled through a free list, so the pool is never initialized up front.
+template <typename T, typename Storage>
+class BasicList {
+  using Node = ListNode<T>;
+
+ public:
+  using value_type = T;
+
+  template <bool kConst>
+  class Iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = std::conditional_t<kConst, const T*, T*>;
+    using reference = std::conditional_t<kConst, const T&, T&>;
+
+    Iterator() = default;
+    explicit Iterator(Node* node) : node_(node) {}
+    operator Iterator<true>() const { return Iterator<true>(node_); }
+
+    reference operator*() const { return *Value(node_); }
+    pointer operator->() const { return Value(node_); }
+    Iterator& operator++() {
+      node_ = node_->next.get();
+      return *this;
+    }
+    Iterator operator++(int) {
+      Iterator it = *this;
+      ++*this;
+      return it;
+    }
+    friend bool operator==(const Iterator& a, const Iterator& b) { return a.node_ == b.node_; }
+    friend bool operator!=(const Iterator& a, const Iterator& b) { return a.node_ != b.node_; }
+
+   private:
+    friend class BasicList;
+    Node* node_ = nullptr;
+  };
+
+  using iterator = Iterator<false>;
+  using const_iterator = Iterator<true>;
+
+  // Arguments are forwarded to the storage of the nodes.
+  template <typename... StorageArgs>
+  explicit BasicList(StorageArgs&&... args) : storage_(std::forward<StorageArgs>(args)...) {}
+  ~BasicList() { clear(); }
+
+  BasicList(const BasicList&) = delete;
+  BasicList& operator=(const BasicList&) = delete;
+
+  // Returns nullptr if the list is full.
+  template <typename... Args>
+  T* emplace_back(Args&&... args) {
+    Node* node = NewNode(std::forward<Args>(args)...);
+    if (node == nullptr) return nullptr;
+    node->prev = tail_;
+    if (tail_) {
+      tail_->next = node;
+    } else {
+      head_ = node;
+    }
+    tail_ = node;
+    return Value(node);
+  }
+
+  // Returns nullptr if the list is full.
+  template <typename... Args>
+  T* emplace_front(Args&&... args) {
+    Node* node = NewNode(std::forward<Args>(args)...);
+    if (node == nullptr) return nullptr;
+    node->next = head_;
+    if (head_) {
+      head_->prev = node;
+    } else {
+      tail_ = node;
+    }
+    head_ = node;
+    return Value(node);
+  }
+
+  [[nodiscard]] bool push_back(const T& value) { return emplace_back(value) != nullptr; }
+  [[nodiscard]] bool push_back(T&& value) { return emplace_back(std::move(value)) != nullptr; }
+  [[nodiscard]] bool push_front(const T& value) { return emplace_front(value) != nullptr; }
+  [[nodiscard]] bool push_front(T&& value) { return emplace_front(std::move(value)) != nullptr; }
+
+  void pop_front() {
+    assert(!empty());
+    erase(begin());
+  }
+
+  void pop_back() {
+    assert(!empty());
+    erase(iterator(tail_.get()));
+  }
+
+  // Returns the iterator following the erased element.
+  iterator erase(const_iterator pos) {
+    Node* node = pos.node_;
+    Node* next = node->next.get();
+    Node* prev = node->prev.get();
+    if (prev) {
+      prev->next = next;
+    } else {
+      head_ = next;
+    }
+    if (next) {
+      next->prev = prev;
+    } else {
+      tail_ = prev;
+    }
+    DeleteNode(node);
+    return iterator(next);
+  }
+
+  void clear() {
+    while (!empty()) pop_front();
+  }
+
+  T& front() { return *begin(); }
+  const T& front() const { return *begin(); }
+  T& back() { return *Value(tail_.get()); }
+  const T& back() const { return *Value(tail_.get()); }
+
+  iterator begin() { return iterator(head_.get()); }
+  iterator end() { return iterator(); }
+  const_iterator begin() const { return const_iterator(head_.get()); }
+  const_iterator end() const { return const_iterator(); }
+
+  size_t size() const { return size_; }
+  size_t capacity() const { return storage_.capacity(); }
+  bool empty() const { return size_ == 0; }
+  bool full() const { return free_ == nullptr && num_used_nodes_ == capacity(); }
+
+ private:
+  static T* Value(Node* node) { return reinterpret_cast<T*>(node->value); }
+
+  template <typename... Args>
+  Node* NewNode(Args&&... args) {
+    Node* node = free_.get();
+    if (node != nullptr) {
+      free_ = node->next;
+    } else if (num_used_nodes_ < capacity()) {
+      node = storage_.data() + num_used_nodes_++;
+    } else {
+      return nullptr;
+    }
+    new (node->value) T(std::forward<Args>(args)...);
+    node->next = nullptr;
+    node->prev = nullptr;
+    ++size_;
+    return node;
+  }
+
+  void DeleteNode(Node* node) {
+    std::destroy_at(Value(node));
+    node->next = free_;
+    free_ = node;
+    --size_;
+  }
+
+  Storage storage_;
+  OffsetPtr<Node> head_;
+  OffsetPtr<Node> tail_;
+  OffsetPtr<Node> free_;
+  size_t num_used_nodes_ = 0;
+  size_t size_ = 0;
+};
+
+template <typename T, size_t kCapacity>
+using FixedList = BasicList<T, InlineStorage<ListNode<T>, kCapacity>>;
+
+// Constructed with (SharedMemoryBuffer&, capacity).
+template <typename T>
+using ArenaList = BasicList<T, ArenaStorage<ListNode<T>>>;
+
+}  // namespace sham
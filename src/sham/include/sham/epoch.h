@@ -0,0 +1,271 @@
+/*
+MIT License - Copyright (c) 2023 Pierric Gimmig
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <thread>
+
+#include "sham/offset_ptr.h"
+#include "sham/process.h"
+#include "sham/shared_memory_buffer.h"
+
+namespace sham {
+
+// Epoch-based reclamation (EBR) for lock-free structures in shared memory: tells when a node
+// removed from a structure can be reused because no thread of any process can still be reading it.
+//
+// Threads register as participants, each owning a record of the domain. A thread reads the
+// structure inside a critical section, see EpochGuard, during which its record announces the
+// global epoch it observed. A node removed from the structure is retired with a token identifying
+// it, e.g. its index in a pool or its offset in the buffer, and the epoch at the time. The global
+// epoch advances once every thread in a critical section has observed it, and a token retired at
+// epoch e is freed, by calling the free function passed to Retire() or Collect(), once the global
+// epoch reaches e + 2. Entering and leaving a critical section only write to the thread's own
+// record, and advancing the epoch, which scans all the records, is attempted every
+// kCollectInterval retirements, so the overhead per operation is amortized O(1).
+//
+// A process dying in a critical section would block the epoch forever: when a record keeps blocking
+// the epoch, the process owning it is checked, by pid and start time, and the records of dead
+// processes are released. Tokens retired by a thread and not freed yet stay in its record and are
+// freed by the next thread to register with that record, so processes sharing a domain must agree
+// on the meaning of tokens. A thread that stays in a critical section blocks reclamation, see
+// Retire() for what happens once a thread has kLimboCapacity tokens waiting to be freed.
+//
+// The domain must live in the same SharedMemoryBuffer as its records. Zero-filled records are
+// free.
+//
+// Example:
+//   auto* domain = buffer.FindOrConstruct<sham::EpochDomain>("epochs", buffer, 64);
+//   sham::EpochDomain::Participant participant(*domain);  // One per thread.
+//   uint32_t node;
+//   {
+//     sham::EpochGuard guard(participant);
+//     node = list->Unlink(key);
+//   }
+//   participant.Retire(node, [&](uint64_t node) { pool->Free(node); });
+class EpochDomain {
+ public:
+  static constexpr size_t kLimboCapacity = 128;
+  static constexpr size_t kCollectInterval = 32;
+  // Number of attempts to advance the epoch blocked by a thread between two checks of whether the
+  // process of that thread is still alive.
+  static constexpr size_t kLivenessCheckInterval = 64;
+
+  class Participant;
+
+  // Allocates `capacity` participant records in `buffer`. The capacity is 0 if the buffer is full.
+  EpochDomain(SharedMemoryBuffer& buffer, size_t capacity) {
+    uint8_t* records = buffer.Allocate(capacity * sizeof(Record), alignof(Record));
+    if (records == nullptr) return;
+    records_ = reinterpret_cast<Record*>(records);
+    for (size_t i = 0; i < capacity; ++i) new (&records_[i]) Record();
+    capacity_ = capacity;
+  }
+
+  EpochDomain(const EpochDomain&) = delete;
+  EpochDomain& operator=(const EpochDomain&) = delete;
+
+  uint64_t epoch() const { return epoch_.load(std::memory_order_acquire); }
+
+  // Advances the global epoch if every thread in a critical section observed it, releasing the
+  // records of dead processes that prevent it. Returns true if the epoch advanced.
+  bool TryAdvance() {
+    uint64_t epoch = epoch_.load(std::memory_order_seq_cst);
+    for (size_t i = 0; i < capacity_; ++i) {
+      Record& record = records_[i];
+      uint64_t state = record.state.load(std::memory_order_seq_cst);
+      if ((state & kActive) == 0 || (state >> 1) == epoch) continue;
+      uint64_t owner = record.owner.load(std::memory_order_relaxed);
+      // A record released since its state was read is either free or used by a thread that
+      // entered its critical section at the current epoch.
+      if (owner == 0) continue;
+      // Checking the owner reads /proc, don't do it on every attempt while a live thread lingers
+      // in its critical section.
+      if (blocked_advances_.fetch_add(1, std::memory_order_relaxed) % kLivenessCheckInterval != 0 ||
+          IsProcessInstanceAlive(owner) || !ReleaseDeadRecord(record, owner)) {
+        return false;
+      }
+    }
+    return epoch_.compare_exchange_strong(epoch, epoch + 1, std::memory_order_seq_cst);
+  }
+
+  // Number of records owned by a participant, or by a process that died without releasing them.
+  size_t num_participants() const {
+    size_t count = 0;
+    for (size_t i = 0; i < capacity_; ++i) count += records_[i].owner.load() != 0;
+    return count;
+  }
+
+  size_t capacity() const { return capacity_; }
+
+ private:
+  static constexpr uint64_t kActive = 1;
+
+  struct RetiredToken {
+    uint64_t epoch;
+    uint64_t token;
+  };
+
+  struct alignas(64) Record {
+    // Observed epoch shifted left by one, or'ed with kActive while in a critical section.
+    std::atomic<uint64_t> state = 0;
+    // Process owning the record, see CurrentProcessInstance(). 0 if the record is free.
+    std::atomic<uint64_t> owner = 0;
+    // Tokens retired and not freed yet, only accessed by the owner.
+    alignas(64) uint32_t limbo_head = 0;
+    uint32_t limbo_size = 0;
+    RetiredToken limbo[kLimboCapacity] = {};
+  };
+
+  Record* Acquire() {
+    uint64_t self = CurrentProcessInstance();
+    for (size_t i = 0; i < capacity_; ++i) {
+      uint64_t owner = 0;
+      if (records_[i].owner.compare_exchange_strong(owner, self)) return &records_[i];
+    }
+    return nullptr;
+  }
+
+  // Only one of the threads finding a dead record releases it. Its retired tokens are kept.
+  bool ReleaseDeadRecord(Record& record, uint64_t owner) {
+    if (!record.owner.compare_exchange_strong(owner, CurrentProcessInstance())) return false;
+    record.state.store(0, std::memory_order_seq_cst);
+    record.owner.store(0, std::memory_order_release);
+    return true;
+  }
+
+  std::atomic<uint64_t> epoch_ = 0;
+  std::atomic<uint64_t> blocked_advances_ = 0;
+  OffsetPtr<Record> records_;
+  size_t capacity_ = 0;
+};
+
+// Registration of a thread with an EpochDomain, used by that thread only. A child process must
+// register its own participants rather than use those inherited through fork().
+class EpochDomain::Participant {
+ public:
+  // Registers with `domain`. Not valid() if all the records of the domain are in use.
+  explicit Participant(EpochDomain& domain) : domain_(&domain), record_(domain.Acquire()) {}
+
+  // Leaves the tokens not freed yet to the next participant using the record.
+  ~Participant() {
+    if (record_ == nullptr) return;
+    record_->state.store(0, std::memory_order_release);
+    record_->owner.store(0, std::memory_order_release);
+  }
+
+  Participant(const Participant&) = delete;
+  Participant& operator=(const Participant&) = delete;
+
+  // Starts a critical section, during which nodes reachable from the structure aren't freed.
+  // Critical sections can be nested.
+  void Enter() {
+    if (nesting_++ > 0) return;
+    uint64_t epoch = domain_->epoch_.load(std::memory_order_relaxed);
+    record_->state.store((epoch << 1) | kActive, std::memory_order_relaxed);
+    // Orders the announcement before the reads of the structure, and before re-reading the epoch
+    // which could have advanced meanwhile.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    uint64_t current_epoch = domain_->epoch_.load(std::memory_order_relaxed);
+    if (current_epoch != epoch) {
+      record_->state.store((current_epoch << 1) | kActive, std::memory_order_seq_cst);
+    }
+  }
+
+  void Exit() {
+    if (--nesting_ > 0) return;
+    record_->state.store(record_->state.load(std::memory_order_relaxed) & ~kActive,
+                         std::memory_order_release);
+  }
+
+  // Retires the node identified by `token`, which must already be unreachable from the structure,
+  // and frees the tokens retired long enough ago, by calling `free(uint64_t token)`.
+  //
+  // Once kLimboCapacity tokens wait to be freed, Retire() waits for the epoch to advance, unless
+  // called in a critical section, which would block the epoch: it then returns false without
+  // retiring `token`, and the caller must retire it again after Exit().
+  template <typename FreeFn>
+  [[nodiscard]] bool Retire(uint64_t token, FreeFn&& free) {
+    if (record_->limbo_size == kLimboCapacity) {
+      domain_->TryAdvance();
+      while (Collect(free) == 0) {
+        if (nesting_ > 0) return false;
+        if (!domain_->TryAdvance()) std::this_thread::yield();
+      }
+    }
+    uint32_t tail = (record_->limbo_head + record_->limbo_size) % kLimboCapacity;
+    record_->limbo[tail] = {domain_->epoch_.load(std::memory_order_seq_cst), token};
+    if (++record_->limbo_size % kCollectInterval == 0) {
+      domain_->TryAdvance();
+      Collect(free);
+    }
+    return true;
+  }
+
+  // Frees the tokens retired at least two epochs ago, by calling `free(uint64_t token)`. Returns
+  // the number of tokens freed.
+  template <typename FreeFn>
+  size_t Collect(FreeFn&& free) {
+    uint64_t epoch = domain_->epoch_.load(std::memory_order_acquire);
+    size_t num_freed = 0;
+    while (record_->limbo_size > 0) {
+      RetiredToken& retired = record_->limbo[record_->limbo_head];
+      if (retired.epoch + 2 > epoch) break;
+      free(retired.token);
+      record_->limbo_head = (record_->limbo_head + 1) % kLimboCapacity;
+      --record_->limbo_size;
+      ++num_freed;
+    }
+    return num_freed;
+  }
+
+  // Number of tokens retired and not freed yet.
+  size_t num_retired() const { return record_->limbo_size; }
+
+  bool valid() const { return record_ != nullptr; }
+
+ private:
+  EpochDomain* domain_;
+  Record* record_;
+  uint32_t nesting_ = 0;
+};
+
+// Critical section of an EpochDomain::Participant for the duration of a scope.
+class EpochGuard {
+ public:
+  explicit EpochGuard(EpochDomain::Participant& participant) : participant_(participant) {
+    participant_.Enter();
+  }
+  ~EpochGuard() { participant_.Exit(); }
+
+  EpochGuard(const EpochGuard&) = delete;
+  EpochGuard& operator=(const EpochGuard&) = delete;
+
+ private:
+  EpochDomain::Participant& participant_;
+};
+
+}  // namespace sham
@@ -0,0 +1,218 @@
+/*
+MIT License - Copyright (c) 2023 Pierric Gimmig
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "sham/futex.h"
+#include "sham/queue_mpmc.h"
+#include "sham/work_stealing_deque.h"
+
+namespace sham {
+
+// Fixed pool of worker threads running fine-grained tasks, e.g. the fan-out compute stage behind a
+// queue. Each worker owns a WorkStealingDeque: tasks submitted by a running task go to the
+// worker's own deque, other tasks go through a shared mpmc::Queue. A worker runs the tasks of its
+// own deque first, newest first, then tasks from the shared queue, then steals the oldest tasks of
+// other workers. Workers that find no task sleep on a futex and are woken by Submit().
+//
+// The executor and its tasks are private to the process. Destroying the executor runs the tasks
+// already submitted, including the tasks they submit, before joining the workers.
+//
+// Example:
+//   sham::Executor executor(8);
+//   executor.Submit([&] { for (Chunk& chunk : chunks) executor.Submit([&] { Process(chunk); }); });
+class Executor {
+ public:
+  static constexpr size_t kDequeCapacity = 4096;
+  static constexpr size_t kQueueCapacity = 64 * 1024 - 1;
+  static constexpr std::chrono::microseconds kStoppingPollInterval{100};
+
+  explicit Executor(size_t num_threads = std::max(1u, std::thread::hardware_concurrency()))
+      : queue_(std::make_unique<mpmc::Queue<Task*, kQueueCapacity>>()) {
+    for (size_t i = 0; i < num_threads; ++i) workers_.push_back(std::make_unique<Worker>());
+    for (size_t i = 0; i < num_threads; ++i) {
+      workers_[i]->thread = std::thread(&Executor::WorkerLoop, this, i);
+    }
+  }
+
+  ~Executor() {
+    stopping_.store(true, std::memory_order_seq_cst);
+    WakeAll();
+    for (auto& worker : workers_) worker->thread.join();
+  }
+
+  Executor(const Executor&) = delete;
+  Executor& operator=(const Executor&) = delete;
+
+  // Runs `function()` on a worker. Can be called from any thread of the process, including tasks.
+  // Blocks while the shared queue is full.
+  template <typename Function>
+  void Submit(Function&& function) {
+    Task* task = new TaskImpl<std::decay_t<Function>>(std::forward<Function>(function));
+    Worker* worker = current_worker_;
+    if (worker != nullptr && worker->executor == this) {
+      worker->num_submitted.store(worker->num_submitted.load(std::memory_order_relaxed) + 1,
+                                  std::memory_order_relaxed);
+      if (!worker->deque.push(task)) queue_->push(task);
+    } else {
+      num_submitted_externally_.fetch_add(1, std::memory_order_relaxed);
+      queue_->push(task);
+    }
+    // Pairs with the fence of a worker going to sleep: either the worker sees the task, or this
+    // thread sees the worker is idle.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    WakeOne();
+  }
+
+  size_t num_threads() const { return workers_.size(); }
+
+ private:
+  struct Task {
+    virtual ~Task() = default;
+    virtual void Run() = 0;
+  };
+
+  template <typename Function>
+  struct TaskImpl : Task {
+    explicit TaskImpl(Function function) : function(std::move(function)) {}
+    void Run() override { function(); }
+    Function function;
+  };
+
+  struct Worker {
+    WorkStealingDeque<Task*, kDequeCapacity> deque;
+    Executor* executor = nullptr;
+    std::thread thread;
+    // Only modified by the worker, so that counting tasks doesn't make workers share cache lines.
+    alignas(64) std::atomic<uint64_t> num_submitted = 0;
+    std::atomic<uint64_t> num_completed = 0;
+  };
+
+  Task* FindTask(size_t index, uint64_t& random) {
+    Worker& worker = *workers_[index];
+    if (std::optional<Task*> task = worker.deque.pop()) return *task;
+    Task* task = nullptr;
+    if (queue_->try_pop(task)) return task;
+    // Steals from the other workers, starting at a random one.
+    size_t num_workers = workers_.size();
+    random ^= random << 13;
+    random ^= random >> 7;
+    random ^= random << 17;
+    for (size_t i = 0; i < num_workers; ++i) {
+      size_t victim = (random + i) % num_workers;
+      if (victim == index) continue;
+      if (std::optional<Task*> stolen = workers_[victim]->deque.steal()) return *stolen;
+    }
+    return nullptr;
+  }
+
+  void WorkerLoop(size_t index) {
+    Worker& worker = *workers_[index];
+    worker.executor = this;
+    current_worker_ = &worker;
+    uint64_t random = index + 1;
+    bool woken_up = false;
+    while (true) {
+      if (Task* task = FindTask(index, random)) {
+        // A single worker is woken up at a time, it wakes up the next one if there is more work.
+        if (woken_up && queue_->size() > 0) WakeOne();
+        woken_up = false;
+        RunTask(worker, task);
+        continue;
+      }
+      // Sleeps unless a task was submitted since the wake up sequence number was read.
+      uint32_t sequence = wake_sequence_.load(std::memory_order_acquire);
+      num_idle_.fetch_add(1, std::memory_order_seq_cst);
+      if (Task* task = FindTask(index, random)) {
+        LeaveIdle();
+        RunTask(worker, task);
+        continue;
+      }
+      bool stopping = stopping_.load(std::memory_order_seq_cst);
+      if (stopping && !HasPendingTasks()) {
+        LeaveIdle();
+        break;
+      }
+      // While stopping, the last running task completing doesn't wake up the other workers, which
+      // check again for pending tasks after a short sleep.
+      FutexWait(&wake_sequence_, sequence, stopping ? kStoppingPollInterval : kInfinite);
+      LeaveIdle();
+      woken_up = true;
+    }
+    current_worker_ = nullptr;
+  }
+
+  void RunTask(Worker& worker, Task* task) {
+    task->Run();
+    delete task;
+    worker.num_completed.store(worker.num_completed.load(std::memory_order_relaxed) + 1,
+                               std::memory_order_seq_cst);
+  }
+
+  // Returns true if tasks were submitted and not completed. Completion counts are read first: a
+  // task is counted as submitted before the task that submitted it completes, so a count of zero
+  // pending tasks is never too low.
+  bool HasPendingTasks() const {
+    uint64_t num_completed = 0;
+    for (const auto& worker : workers_) num_completed += worker->num_completed.load();
+    uint64_t num_submitted = num_submitted_externally_.load();
+    for (const auto& worker : workers_) num_submitted += worker->num_submitted.load();
+    return num_submitted != num_completed;
+  }
+
+  // Wakes up an idle worker if there is one. Busy workers don't make system calls.
+  void WakeOne() {
+    if (num_idle_.load(std::memory_order_relaxed) == 0) return;
+    wake_sequence_.fetch_add(1, std::memory_order_release);
+    FutexWake(&wake_sequence_, 1);
+  }
+
+  void LeaveIdle() { num_idle_.fetch_sub(1, std::memory_order_relaxed); }
+
+  void WakeAll() {
+    wake_sequence_.fetch_add(1, std::memory_order_release);
+    FutexWakeAll(&wake_sequence_);
+  }
+
+  static inline thread_local Worker* current_worker_ = nullptr;
+
+  std::unique_ptr<mpmc::Queue<Task*, kQueueCapacity>> queue_;
+  std::vector<std::unique_ptr<Worker>> workers_;
+  alignas(64) std::atomic<uint32_t> wake_sequence_ = 0;
+  alignas(64) std::atomic<uint32_t> num_idle_ = 0;
+  alignas(64) std::atomic<uint64_t> num_submitted_externally_ = 0;
+  std::atomic<bool> stopping_ = false;
+};
+
+}  // namespace sham
@@ -0,0 +1,93 @@
+/*
+MIT License - Copyright (c) 2023 Pierric Gimmig
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <thread>
+
+#ifdef __linux__
+#include <errno.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+// Cross-platform interface to wait on a 32-bit word of shared memory until another thread or
+// process changes it, without involving the kernel unless there is a waiter.
+namespace sham {
+
+// Timeout meaning no timeout.
+constexpr std::chrono::nanoseconds kInfinite = std::chrono::nanoseconds::max();
+
+// Blocks while `*word` is `expected`, until FutexWake() is called on `word` or `timeout` expires.
+// Returns false on timeout. Can return spuriously, callers must check the value of `word` again.
+// Works across processes: `word` can be in shared memory mapped at different addresses.
+inline bool FutexWait(std::atomic<uint32_t>* word, uint32_t expected,
+                      std::chrono::nanoseconds timeout = kInfinite);
+// Wakes up to `count` threads blocked in FutexWait() on `word`.
+inline void FutexWake(std::atomic<uint32_t>* word, uint32_t count = 1);
+// Wakes all the threads blocked in FutexWait() on `word`.
+inline void FutexWakeAll(std::atomic<uint32_t>* word) { FutexWake(word, INT_MAX); }
+
+}  // namespace sham
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t));
+
+#ifdef __linux__
+// Not FUTEX_PRIVATE_FLAG: the kernel keys the wait queue by the physical page so that processes
+// mapping the word at different addresses find each other.
+bool sham::FutexWait(std::atomic<uint32_t>* word, uint32_t expected,
+                     std::chrono::nanoseconds timeout) {
+  timespec relative_timeout = {};
+  if (timeout != kInfinite) {
+    relative_timeout.tv_sec = timeout.count() / 1'000'000'000;
+    relative_timeout.tv_nsec = timeout.count() % 1'000'000'000;
+  }
+  long result = syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT, expected,
+                        timeout == kInfinite ? nullptr : &relative_timeout, nullptr, 0);
+  return result == 0 || errno != ETIMEDOUT;
+}
+
+void sham::FutexWake(std::atomic<uint32_t>* word, uint32_t count) {
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE, count, nullptr, nullptr, 0);
+}
+#else
+// WaitOnAddress() and __ulock_wait() only work between threads of a process, other platforms
+// poll the word.
+bool sham::FutexWait(std::atomic<uint32_t>* word, uint32_t expected,
+                     std::chrono::nanoseconds timeout) {
+  auto deadline = std::chrono::steady_clock::now() + std::min(timeout, std::chrono::hours(24));
+  while (word->load(std::memory_order_acquire) == expected) {
+    if (std::chrono::steady_clock::now() >= deadline) return false;
+    std::this_thread::sleep_for(std::chrono::microseconds(50));
+  }
+  return true;
+}
+
+void sham::FutexWake(std::atomic<uint32_t>*, uint32_t) {}
+#endif
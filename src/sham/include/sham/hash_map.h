@@ -0,0 +1,430 @@
+/*
+MIT License - Copyright (c) 2023 Pierric Gimmig
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <optional>
+#include <thread>
+#include <type_traits>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "sham/offset_ptr.h"
+#include "sham/shared_memory_buffer.h"
+
+namespace sham {
+namespace internal {
+
+// Control bytes of a group of 16 slots: the 7-bit fingerprint of the key of a full slot, or
+// kEmptyControl. Matches return a bitmask of slots, bit i for slot i.
+inline constexpr uint8_t kEmptyControl = 0x80;
+
+#if defined(__SSE2__)
+
+inline uint32_t MatchControl(const uint8_t* control, uint8_t fingerprint) {
+  __m128i group = _mm_loadu_si128(reinterpret_cast<const __m128i*>(control));
+  __m128i match = _mm_cmpeq_epi8(group, _mm_set1_epi8(static_cast<char>(fingerprint)));
+  return static_cast<uint32_t>(_mm_movemask_epi8(match));
+}
+
+inline uint32_t MatchEmpty(const uint8_t* control) {
+  __m128i group = _mm_loadu_si128(reinterpret_cast<const __m128i*>(control));
+  return static_cast<uint32_t>(_mm_movemask_epi8(group));
+}
+
+#else
+
+// Gathers the high bit of each byte of the two words.
+inline uint32_t PackHighBits(uint64_t low, uint64_t high) {
+  uint32_t mask = 0;
+  for (; low != 0; low &= low - 1) mask |= 1u << (std::countr_zero(low) / 8);
+  for (; high != 0; high &= high - 1) mask |= 1u << (8 + std::countr_zero(high) / 8);
+  return mask;
+}
+
+// SWAR fallback. Can report false positives after a matching byte, which comparing keys filters.
+inline uint32_t MatchControl(const uint8_t* control, uint8_t fingerprint) {
+  constexpr uint64_t kLsbs = 0x0101010101010101;
+  constexpr uint64_t kMsbs = 0x8080808080808080;
+  uint64_t words[2];
+  std::memcpy(words, control, sizeof(words));
+  for (uint64_t& word : words) {
+    word ^= kLsbs * fingerprint;
+    word = (word - kLsbs) & ~word & kMsbs;
+  }
+  return PackHighBits(words[0], words[1]);
+}
+
+inline uint32_t MatchEmpty(const uint8_t* control) {
+  constexpr uint64_t kMsbs = 0x8080808080808080;
+  uint64_t words[2];
+  std::memcpy(words, control, sizeof(words));
+  return PackHighBits(words[0] & kMsbs, words[1] & kMsbs);
+}
+
+#endif
+
+}  // namespace internal
+
+// Fixed-capacity open-addressing hash map that processes can share, e.g. for symbol to id lookups.
+// Slots are organized in groups of 16, whose control bytes hold 7-bit fingerprints of the keys and
+// are matched 16 at a time with SSE2, or with SWAR on other targets. Keys probe groups linearly
+// from their home group, until the group holding them or the first group with an empty slot.
+//
+// Each group has a sequence number used as a seqlock. Find() never writes shared memory: it reads
+// groups optimistically and retries a group modified meanwhile. Writers lock the groups on the
+// probe sequence of their key by compare-and-swapping their sequence numbers, so writers of keys
+// with different probe sequences don't contend. Erase() leaves no tombstones: it shifts entries of
+// later groups back into the freed slot, so that lookups never scan groups emptied by erasures.
+// Readers that miss a key check that no group on its probe sequence was modified meanwhile.
+//
+// Reads are not lock-free: a reader waits for the writers holding groups on the probe sequence of
+// its key, and for ever if such a writer dies. Readers of other keys are not affected.
+//
+// Keys and values are copied in and out and must be trivially copyable, and Hash must give the same
+// results in all processes. Capacity is fixed at construction, with groups at most 7/8 full.
+//
+// Example:
+//   auto* map = buffer.Allocate<sham::HashMap<uint64_t, OrderState>>(buffer, 1'000'000);
+//   map->Insert(order_id, state);
+//   std::optional<OrderState> state = map->Find(order_id);
+template <typename Key, typename Value, typename Hash = std::hash<Key>,
+          typename KeyEqual = std::equal_to<Key>>
+class HashMap {
+ public:
+  static_assert(std::is_trivially_copyable_v<Key> && std::is_trivially_copyable_v<Value>);
+  static constexpr size_t kGroupSize = 16;
+
+  // Allocates groups for `capacity` entries in `buffer`. The capacity is 0 if the buffer is full.
+  HashMap(SharedMemoryBuffer& buffer, size_t capacity) {
+    size_t min_groups = (capacity * 8 / 7 + kGroupSize - 1) / kGroupSize;
+    size_t num_groups = std::bit_ceil(std::max<size_t>(min_groups, 1));
+    uint8_t* groups = buffer.Allocate(num_groups * sizeof(Group), alignof(Group));
+    if (groups == nullptr) return;
+    groups_ = reinterpret_cast<Group*>(groups);
+    for (size_t i = 0; i < num_groups; ++i) new (&groups_[i]) Group();
+    group_mask_ = num_groups - 1;
+    capacity_ = capacity;
+  }
+
+  HashMap(const HashMap&) = delete;
+  HashMap& operator=(const HashMap&) = delete;
+
+  std::optional<Value> Find(const Key& key) const {
+    uint64_t hash = HashOf(key);
+    while (true) {
+      // Sum of the sequence numbers of the groups read, see Group::sequence.
+      uint64_t sequences = 0;
+      size_t num_groups = 0;
+      bool has_empty = false;
+      for (size_t index = HomeGroup(hash); !has_empty; index = NextGroup(index), ++num_groups) {
+        uint32_t sequence = 0;
+        std::optional<Value> value =
+            FindInGroup(groups_[index], key, Fingerprint(hash), has_empty, sequence);
+        if (value.has_value()) return value;
+        sequences += sequence;
+      }
+      // A miss is only valid if no group of the probe sequence was modified meanwhile, e.g. by an
+      // Erase() moving the key back to a group already read.
+      std::atomic_thread_fence(std::memory_order_acquire);
+      uint64_t current_sequences = 0;
+      for (size_t i = 0, index = HomeGroup(hash); i < num_groups; ++i, index = NextGroup(index)) {
+        current_sequences += groups_[index].sequence.load(std::memory_order_relaxed);
+      }
+      if (current_sequences == sequences) return std::nullopt;
+    }
+  }
+
+  bool Contains(const Key& key) const { return Find(key).has_value(); }
+
+  // Returns false if the key is already in the map, or if the map is full.
+  bool Insert(const Key& key, const Value& value) {
+    return Write(key, [&](Value*) { return false; }, &value);
+  }
+
+  // Inserts the key or assigns the value of the existing entry. Returns false if the map is full.
+  bool InsertOrAssign(const Key& key, const Value& value) {
+    return Write(
+        key,
+        [&](Value* current) {
+          *current = value;
+          return true;
+        },
+        &value);
+  }
+
+  // Replaces the value of `key` with `desired` if it is bitwise equal to `expected`. Otherwise
+  // loads the current value into `expected`. Returns false if the value differs or the key is not
+  // in the map.
+  bool CompareExchange(const Key& key, Value& expected, const Value& desired) {
+    return Write(
+        key,
+        [&](Value* current) {
+          if (std::memcmp(current, &expected, sizeof(Value)) != 0) {
+            expected = *current;
+            return false;
+          }
+          *current = desired;
+          return true;
+        },
+        nullptr);
+  }
+
+  // Returns false if the key is not in the map.
+  bool Erase(const Key& key) {
+    uint64_t hash = HashOf(key);
+    while (true) {
+      LockedRange range(*this, HomeGroup(hash));
+      if (!range.valid()) continue;
+      // Finds the key, then the end of the entries that may have to move back to its slot.
+      std::optional<size_t> slot;
+      while (!(slot = FindSlot(range.last(), key, Fingerprint(hash))).has_value()) {
+        if (internal::MatchEmpty(range.last().control) != 0) return false;
+        if (!range.LockNext()) break;
+      }
+      if (!slot.has_value()) continue;
+      size_t hole_group = range.last_index();
+      while (internal::MatchEmpty(range.last().control) == 0) {
+        if (!range.LockNext()) break;
+      }
+      if (internal::MatchEmpty(range.last().control) == 0) continue;
+
+      groups_[hole_group].control[*slot] = internal::kEmptyControl;
+      range.SetModified(hole_group);
+      if (range.last_index() != hole_group) ShiftBack(hole_group, *slot, range);
+      size_.fetch_sub(1, std::memory_order_relaxed);
+      return true;
+    }
+  }
+
+  // Approximate when called concurrently with writers.
+  size_t size() const { return size_.load(std::memory_order_relaxed); }
+  size_t capacity() const { return capacity_; }
+
+ private:
+  struct Entry {
+    Key key;
+    Value value;
+  };
+
+  struct alignas(64) Group {
+    Group() { std::memset(control, internal::kEmptyControl, sizeof(control)); }
+
+    // Odd while a writer holds the group. Writers that don't modify the group restore it, others
+    // increment it again, so it never goes below an even value read before. Equal sums of the
+    // sequence numbers of several groups thus mean that none of them was modified.
+    std::atomic<uint32_t> sequence = 0;
+    uint8_t control[kGroupSize];
+    Entry entries[kGroupSize];
+  };
+
+  // Groups locked by a writer, from the home group of its key. Locking later groups fails, rather
+  // than waits, if another writer holds them, since that writer may itself wait for this range.
+  class LockedRange {
+   public:
+    LockedRange(HashMap& map, size_t first) : map_(map), first_(first) {
+      valid_ = Lock(first, /*wait=*/true);
+    }
+    ~LockedRange() { Unlock(); }
+
+    bool valid() const { return valid_; }
+    size_t last_index() const { return (first_ + count_ - 1) & map_.group_mask_; }
+    Group& last() const { return map_.groups_[last_index()]; }
+    bool contains(size_t index) const { return ((index - first_) & map_.group_mask_) < count_; }
+
+    bool LockNext() {
+      if (count_ == map_.group_mask_ + 1) return false;
+      if (Lock(map_.NextGroup(last_index()), /*wait=*/false)) return true;
+      Unlock();
+      std::this_thread::yield();
+      return false;
+    }
+
+    // The sequence numbers of the first 64 groups are restored if they weren't modified, so that
+    // readers don't retry them.
+    void SetModified(size_t index) {
+      size_t i = (index - first_) & map_.group_mask_;
+      if (i < 64) modified_ |= uint64_t{1} << i;
+    }
+
+    void Unlock() {
+      for (size_t i = count_; i-- > 0;) {
+        Group& group = map_.groups_[(first_ + i) & map_.group_mask_];
+        uint32_t sequence = group.sequence.load(std::memory_order_relaxed);
+        bool modified = i >= 64 || (modified_ & (uint64_t{1} << i)) != 0;
+        group.sequence.store(modified ? sequence + 1 : sequence - 1, std::memory_order_release);
+      }
+      count_ = 0;
+      modified_ = 0;
+      valid_ = false;
+    }
+
+   private:
+    bool Lock(size_t index, bool wait) {
+      Group& group = map_.groups_[index];
+      for (int attempt = 0;; ++attempt) {
+        uint32_t sequence = group.sequence.load(std::memory_order_relaxed);
+        if ((sequence & 1) == 0 &&
+            group.sequence.compare_exchange_weak(sequence, sequence + 1,
+                                                 std::memory_order_acquire)) {
+          break;
+        }
+        if (!wait) return false;
+        if (attempt > 64) std::this_thread::yield();
+      }
+      // Orders the odd sequence number before the writes to the group, see SeqLock.
+      std::atomic_thread_fence(std::memory_order_release);
+      ++count_;
+      return true;
+    }
+
+    HashMap& map_;
+    size_t first_;
+    size_t count_ = 0;
+    bool valid_ = false;
+    uint64_t modified_ = 0;
+  };
+
+  uint64_t HashOf(const Key& key) const {
+    // Spreads hashes that are the identity, as std::hash of integers is with libstdc++.
+    return static_cast<uint64_t>(Hash{}(key)) * 0x9e3779b97f4a7c15;
+  }
+  static uint8_t Fingerprint(uint64_t hash) { return static_cast<uint8_t>(hash >> 57); }
+  size_t HomeGroup(uint64_t hash) const { return (hash ^ (hash >> 32)) & group_mask_; }
+  size_t NextGroup(size_t index) const { return (index + 1) & group_mask_; }
+  size_t Distance(size_t from, size_t to) const { return (to - from) & group_mask_; }
+
+  // Reads `group` consistently, waiting for the writer holding it if any. Sets `has_empty` if the
+  // group has an empty slot, and `read_sequence` to the sequence number of the state read.
+  std::optional<Value> FindInGroup(const Group& group, const Key& key, uint8_t fingerprint,
+                                   bool& has_empty, uint32_t& read_sequence) const {
+    while (true) {
+      uint32_t sequence = group.sequence.load(std::memory_order_acquire);
+      if ((sequence & 1) != 0) {
+        std::this_thread::yield();
+        continue;
+      }
+      uint8_t control[kGroupSize];
+      std::memcpy(control, group.control, sizeof(control));
+      std::optional<Value> value;
+      for (uint32_t match = internal::MatchControl(control, fingerprint); match != 0;
+           match &= match - 1) {
+        Entry entry;
+        std::memcpy(&entry, &group.entries[std::countr_zero(match)], sizeof(Entry));
+        if (KeyEqual{}(entry.key, key)) {
+          value = entry.value;
+          break;
+        }
+      }
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (group.sequence.load(std::memory_order_relaxed) != sequence) continue;
+      has_empty = internal::MatchEmpty(control) != 0;
+      read_sequence = sequence;
+      return value;
+    }
+  }
+
+  // Only called on locked groups.
+  std::optional<size_t> FindSlot(const Group& group, const Key& key, uint8_t fingerprint) const {
+    for (uint32_t match = internal::MatchControl(group.control, fingerprint); match != 0;
+         match &= match - 1) {
+      size_t slot = std::countr_zero(match);
+      if (KeyEqual{}(group.entries[slot].key, key)) return slot;
+    }
+    return std::nullopt;
+  }
+
+  // Locks the probe sequence of `key` up to the group holding it, then calls `update` with its
+  // value, which returns whether it modified it. Otherwise inserts `value` in the first group with
+  // an empty slot, unless it is null. Returns the result of `update` or of the insertion.
+  template <typename UpdateFn>
+  bool Write(const Key& key, UpdateFn&& update, const Value* value) {
+    uint64_t hash = HashOf(key);
+    uint8_t fingerprint = Fingerprint(hash);
+    while (true) {
+      LockedRange range(*this, HomeGroup(hash));
+      if (!range.valid()) continue;
+      while (true) {
+        Group& group = range.last();
+        if (std::optional<size_t> slot = FindSlot(group, key, fingerprint)) {
+          bool modified = update(&group.entries[*slot].value);
+          if (modified) range.SetModified(range.last_index());
+          return modified;
+        }
+        if (uint32_t empty = internal::MatchEmpty(group.control)) {
+          if (value == nullptr) return false;
+          if (size_.fetch_add(1, std::memory_order_relaxed) >= capacity_) {
+            size_.fetch_sub(1, std::memory_order_relaxed);
+            return false;
+          }
+          size_t slot = std::countr_zero(empty);
+          group.entries[slot] = {key, *value};
+          group.control[slot] = fingerprint;
+          range.SetModified(range.last_index());
+          return true;
+        }
+        if (!range.LockNext()) break;
+      }
+    }
+  }
+
+  // Fills the slot freed in `hole_group` with an entry of a later group of `range` whose probe
+  // sequence goes through it, then does the same for the slot freed by that move, up to the last
+  // group of the range, which had an empty slot and so ends all the probe sequences going through
+  // the range.
+  void ShiftBack(size_t hole_group, size_t hole_slot, LockedRange& range) {
+    for (size_t index = NextGroup(hole_group); range.contains(index); index = NextGroup(index)) {
+      Group& group = groups_[index];
+      for (uint32_t full = ~internal::MatchEmpty(group.control) & 0xffff; full != 0;
+           full &= full - 1) {
+        size_t slot = std::countr_zero(full);
+        size_t home = HomeGroup(HashOf(group.entries[slot].key));
+        if (Distance(home, index) < Distance(hole_group, index)) continue;
+        Group& hole = groups_[hole_group];
+        hole.entries[hole_slot] = group.entries[slot];
+        hole.control[hole_slot] = group.control[slot];
+        group.control[slot] = internal::kEmptyControl;
+        range.SetModified(index);
+        hole_group = index;
+        hole_slot = slot;
+        break;
+      }
+    }
+  }
+
+  OffsetPtr<Group> groups_;
+  size_t group_mask_ = 0;
+  size_t capacity_ = 0;
+  alignas(64) std::atomic<size_t> size_ = 0;
+};
+
+}  // namespace sham
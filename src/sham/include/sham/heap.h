@@ -0,0 +1,332 @@
+/*
+MIT License - Copyright (c) 2023 Pierric Gimmig
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+
+#include "sham/offset_ptr.h"
+#include "sham/shared_memory_buffer.h"
+#include "sham/sync.h"
+
+namespace sham {
+
+// General purpose allocator for variable sized objects, living in a SharedMemoryBuffer and usable
+// from every process mapping it. Implements the Two-Level Segregated Fit algorithm: free blocks are
+// binned by size in a two-level table of lists with a bitmap per level, so that Allocate() and
+// Free() run in constant time, and returned blocks are the best fit up to 1/kNumSecondLevels of
+// their size. Adjacent free blocks are merged immediately, which bounds fragmentation.
+//
+// All blocks are 16 bytes aligned and carry a 16 bytes header, links between blocks are offsets.
+// Operations are serialized by a Mutex in shared memory, threads waiting for it sleep in the
+// kernel. A process dying while holding the mutex leaves the heap locked.
+//
+// Example:
+//   auto* heap = buffer.Allocate<sham::Heap>(buffer, /*capacity=*/64 * 1024 * 1024);
+//   auto* book = heap->Allocate<OrderBook>("AAPL");
+//   heap->Free(book);
+class Heap {
+ public:
+  static constexpr size_t kAlignment = 16;
+  static constexpr size_t kNumSecondLevels = 32;
+
+  // Carves `capacity` bytes out of `buffer`. The heap must live in the same buffer. The capacity is
+  // 0 if the buffer is full.
+  Heap(SharedMemoryBuffer& buffer, size_t capacity) {
+    std::fill(std::begin(second_level_bitmaps_), std::end(second_level_bitmaps_), 0);
+    for (auto& lists : free_lists_) std::fill(std::begin(lists), std::end(lists), kNull);
+    capacity = std::min(capacity, kMaxBlockSize) & ~(kAlignment - 1);
+    if (capacity < kMinBlockSize + kHeaderSize) return;
+    uint8_t* memory = buffer.Allocate(capacity, sham::GetPageSize());
+    if (memory == nullptr) return;
+    memory_ = memory;
+    capacity_ = capacity;
+
+    // A single free block spans the heap, followed by an allocated sentinel with no payload so
+    // that every block has a next block.
+    uint64_t size = capacity - kHeaderSize;
+    Block* block = At(0);
+    block->prev = kNull;
+    block->size = size;
+    Block* sentinel = At(size);
+    sentinel->prev = 0;
+    sentinel->size = 0;
+    Insert(0, size);
+  }
+
+  Heap(const Heap&) = delete;
+  Heap& operator=(const Heap&) = delete;
+
+  // Returns `size` bytes aligned to `alignment`, which must be a power of 2, or nullptr if there is
+  // no large enough free block.
+  void* Allocate(size_t size, size_t alignment = kAlignment) {
+    if (size >= capacity_ || alignment >= capacity_) return nullptr;
+    uint64_t block_size = BlockSize(size);
+    // Over-aligned allocations reserve room for a free block in front of the aligned payload.
+    uint64_t search_size = alignment > kAlignment ? block_size + alignment + kMinBlockSize
+                                                  : block_size;
+    if (search_size > capacity_) return nullptr;
+
+    Lock();
+    uint64_t offset = FindAndRemove(search_size);
+    if (offset == kNull) {
+      Unlock();
+      return nullptr;
+    }
+    if (alignment > kAlignment) offset = AlignPayload(offset, alignment);
+    Split(offset, block_size);
+    SetUsed(offset);
+    Unlock();
+    return Payload(offset);
+  }
+
+  // Allocates and constructs a T. Returns nullptr if the heap is out of memory.
+  template <typename T, typename... Args>
+  T* Allocate(Args&&... args) {
+    void* memory = Allocate(sizeof(T), alignof(T));
+    if (memory == nullptr) return nullptr;
+    return new (memory) T(std::forward<Args>(args)...);
+  }
+
+  // Frees memory returned by Allocate(), in any process.
+  void Free(void* ptr) {
+    if (ptr == nullptr) return;
+    uint64_t offset = static_cast<uint8_t*>(ptr) - memory_.get() - kHeaderSize;
+    Lock();
+    used_bytes_ -= At(offset)->size;
+    offset = MergeWithNeighbors(offset);
+    Insert(offset, At(offset)->size);
+    Unlock();
+  }
+
+  // Destroys and frees an object returned by Allocate<T>().
+  template <typename T>
+  void Free(T* ptr) {
+    if (ptr == nullptr) return;
+    std::destroy_at(ptr);
+    Free(const_cast<void*>(static_cast<const void*>(ptr)));
+  }
+
+  // Number of usable bytes in the block returned for `ptr`, at least the size requested.
+  size_t UsableSize(const void* ptr) const {
+    return At(static_cast<const uint8_t*>(ptr) - memory_.get() - kHeaderSize)->size - kHeaderSize;
+  }
+
+  size_t capacity() const { return capacity_; }
+  // Bytes used by allocated blocks, headers included.
+  size_t used_bytes() const { return used_bytes_; }
+
+ private:
+  struct Block {
+    // Offset of the physically previous block, kNull for the first one.
+    uint64_t prev;
+    // Size of the block, header included, multiple of kAlignment. The lowest bit is set if the
+    // block is free.
+    uint64_t size;
+    // Links in the free list, only valid in free blocks, in place of the payload.
+    uint64_t next_free;
+    uint64_t prev_free;
+  };
+
+  static constexpr uint64_t kNull = ~uint64_t{0};
+  static constexpr uint64_t kFree = 1;
+  static constexpr size_t kHeaderSize = 2 * sizeof(uint64_t);
+  static constexpr size_t kMinBlockSize = sizeof(Block);
+  static constexpr size_t kSecondLevelShift = std::countr_zero(kNumSecondLevels);
+  static constexpr size_t kFirstLevelShift = kSecondLevelShift + std::countr_zero(kAlignment);
+  // Blocks smaller than this are all binned in the first row, in steps of kAlignment.
+  static constexpr size_t kSmallBlockSize = size_t{1} << kFirstLevelShift;
+  static constexpr size_t kNumFirstLevels = 32;
+  static constexpr size_t kMaxBlockSize = size_t{1} << (kNumFirstLevels + kFirstLevelShift - 1);
+
+  static_assert(kHeaderSize % kAlignment == 0);
+
+  struct Index {
+    size_t first;
+    size_t second;
+  };
+
+  // Bin of a free block of `size` bytes.
+  static Index BinOf(uint64_t size) {
+    if (size < kSmallBlockSize) return {0, size / (kSmallBlockSize / kNumSecondLevels)};
+    size_t log2 = std::bit_width(size) - 1;
+    return {log2 - kFirstLevelShift + 1, (size >> (log2 - kSecondLevelShift)) ^ kNumSecondLevels};
+  }
+
+  // Smallest bin whose blocks are all large enough for `size` bytes.
+  static Index SearchBinOf(uint64_t size) {
+    if (size >= kSmallBlockSize) {
+      size += (uint64_t{1} << (std::bit_width(size) - 1 - kSecondLevelShift)) - 1;
+    }
+    return BinOf(size);
+  }
+
+  static uint64_t BlockSize(size_t size) {
+    uint64_t block_size = (std::max<uint64_t>(size, 1) + kHeaderSize + kAlignment - 1) &
+                          ~uint64_t{kAlignment - 1};
+    return std::max<uint64_t>(block_size, kMinBlockSize);
+  }
+
+  // Removes and returns a free block of at least `size` bytes, kNull if there is none.
+  uint64_t FindAndRemove(uint64_t size) {
+    Index bin = SearchBinOf(size);
+    uint32_t second_level_map = 0;
+    if (bin.first < kNumFirstLevels) {
+      second_level_map = second_level_bitmaps_[bin.first] & (~uint32_t{0} << bin.second);
+      if (second_level_map == 0) {
+        uint64_t first_level_map = first_level_bitmap_ & (~uint64_t{0} << (bin.first + 1));
+        if (first_level_map != 0) {
+          bin.first = std::countr_zero(first_level_map);
+          second_level_map = second_level_bitmaps_[bin.first];
+        }
+      }
+    }
+    if (second_level_map == 0) {
+      // All the blocks of larger bins are too small, the first block of the bin of `size` might
+      // still be large enough, e.g. when allocating most of the heap.
+      bin = BinOf(size);
+      uint64_t offset = free_lists_[bin.first][bin.second];
+      if (offset == kNull || (At(offset)->size & ~kFree) < size) return kNull;
+      Remove(offset, bin);
+      return offset;
+    }
+    bin.second = std::countr_zero(second_level_map);
+    uint64_t offset = free_lists_[bin.first][bin.second];
+    Remove(offset, bin);
+    return offset;
+  }
+
+  void Insert(uint64_t offset, uint64_t size) {
+    Index bin = BinOf(size);
+    Block* block = At(offset);
+    block->size = size | kFree;
+    block->prev_free = kNull;
+    block->next_free = free_lists_[bin.first][bin.second];
+    if (block->next_free != kNull) At(block->next_free)->prev_free = offset;
+    free_lists_[bin.first][bin.second] = offset;
+    first_level_bitmap_ |= uint64_t{1} << bin.first;
+    second_level_bitmaps_[bin.first] |= uint32_t{1} << bin.second;
+  }
+
+  void Remove(uint64_t offset, Index bin) {
+    Block* block = At(offset);
+    if (block->prev_free != kNull) {
+      At(block->prev_free)->next_free = block->next_free;
+    } else {
+      free_lists_[bin.first][bin.second] = block->next_free;
+      if (block->next_free == kNull) {
+        second_level_bitmaps_[bin.first] &= ~(uint32_t{1} << bin.second);
+        if (second_level_bitmaps_[bin.first] == 0) {
+          first_level_bitmap_ &= ~(uint64_t{1} << bin.first);
+        }
+      }
+    }
+    if (block->next_free != kNull) At(block->next_free)->prev_free = block->prev_free;
+    block->size &= ~kFree;
+  }
+
+  // Gives the front of the free block at `offset` back to the heap so that the payload of the rest
+  // is aligned to `alignment`. Returns the offset of the rest.
+  uint64_t AlignPayload(uint64_t offset, size_t alignment) {
+    uintptr_t payload = reinterpret_cast<uintptr_t>(Payload(offset));
+    uintptr_t aligned = (payload + alignment - 1) & ~(alignment - 1);
+    if (aligned == payload) return offset;
+    if (aligned - payload < kMinBlockSize) {
+      aligned = (payload + kMinBlockSize + alignment - 1) & ~(alignment - 1);
+    }
+    uint64_t gap = aligned - payload;
+    uint64_t aligned_offset = offset + gap;
+    Block* block = At(offset);
+    Block* aligned_block = At(aligned_offset);
+    aligned_block->prev = offset;
+    aligned_block->size = block->size - gap;
+    Next(aligned_offset)->prev = aligned_offset;
+    // The previous block is allocated, otherwise it would have been merged with this one.
+    Insert(offset, gap);
+    return aligned_offset;
+  }
+
+  // Gives the end of the block at `offset` back to the heap if it is larger than `size` bytes by
+  // at least a minimal block.
+  void Split(uint64_t offset, uint64_t size) {
+    Block* block = At(offset);
+    if (block->size < size + kMinBlockSize) return;
+    uint64_t rest_offset = offset + size;
+    Block* rest = At(rest_offset);
+    rest->prev = offset;
+    rest->size = block->size - size;
+    Next(rest_offset)->prev = rest_offset;
+    block->size = size;
+    // The next block is allocated, otherwise it would have been merged with this one.
+    Insert(rest_offset, rest->size);
+  }
+
+  void SetUsed(uint64_t offset) { used_bytes_ += At(offset)->size; }
+
+  // Merges the block at `offset` with its free neighbors, returns the offset of the merged block.
+  uint64_t MergeWithNeighbors(uint64_t offset) {
+    Block* block = At(offset);
+    uint64_t next_offset = offset + block->size;
+    Block* next = At(next_offset);
+    if (next->size & kFree) {
+      Remove(next_offset, BinOf(next->size & ~kFree));
+      block->size += next->size;
+      Next(offset)->prev = offset;
+    }
+    if (block->prev != kNull && (At(block->prev)->size & kFree)) {
+      uint64_t prev_offset = block->prev;
+      Block* prev = At(prev_offset);
+      Remove(prev_offset, BinOf(prev->size & ~kFree));
+      prev->size += block->size;
+      Next(prev_offset)->prev = prev_offset;
+      offset = prev_offset;
+    }
+    return offset;
+  }
+
+  Block* At(uint64_t offset) { return reinterpret_cast<Block*>(memory_.get() + offset); }
+  const Block* At(uint64_t offset) const {
+    return reinterpret_cast<const Block*>(memory_.get() + offset);
+  }
+  Block* Next(uint64_t offset) { return At(offset + (At(offset)->size & ~kFree)); }
+  void* Payload(uint64_t offset) { return memory_.get() + offset + kHeaderSize; }
+
+  void Lock() { mutex_.lock(); }
+  void Unlock() { mutex_.unlock(); }
+
+  alignas(64) Mutex mutex_;
+  uint64_t first_level_bitmap_ = 0;
+  uint32_t second_level_bitmaps_[kNumFirstLevels];
+  uint64_t free_lists_[kNumFirstLevels][kNumSecondLevels];
+  OffsetPtr<uint8_t> memory_;
+  size_t capacity_ = 0;
+  size_t used_bytes_ = 0;
+};
+
+}  // namespace sham
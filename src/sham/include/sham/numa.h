@@ -0,0 +1,209 @@
+/*
+MIT License - Copyright (c) 2023 Pierric Gimmig
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Cross-platform interface for NUMA aware memory placement and thread pinning. On platforms
+// without NUMA support, and on machines with a single NUMA node, every operation is a successful
+// no-op.
+namespace sham {
+
+struct NumaPolicy {
+  enum class Type {
+    // Leave the placement to the process or system default policy.
+    kDefault,
+    // Allocate pages on `node` only.
+    kBind,
+    // Interleave pages across all online nodes.
+    kInterleave,
+    // Allocate pages on the node of the thread that first touches them.
+    kLocal
+  };
+
+  static NumaPolicy Bind(int node) { return {Type::kBind, node}; }
+  static NumaPolicy Interleave() { return {Type::kInterleave}; }
+  static NumaPolicy Local() { return {Type::kLocal}; }
+
+  Type type = Type::kDefault;
+  int node = 0;
+};
+
+// Returns the ids of the online NUMA nodes. Returns {0} if NUMA is not supported.
+inline std::vector<int> GetNumaNodes();
+// Returns the number of online NUMA nodes. Returns 1 if NUMA is not supported.
+inline size_t GetNumNumaNodes();
+// Applies `policy` to the pages of [address, address + size). For shared memory the policy is
+// attached to the shared memory object itself and affects every process that maps it.
+inline bool SetNumaPolicy(void* address, size_t size, const NumaPolicy& policy);
+// Applies `policy` to all future allocations of the calling thread.
+inline bool SetThreadNumaPolicy(const NumaPolicy& policy);
+// Restricts the calling thread to the cpus of `node`.
+inline bool PinThreadToNumaNode(int node);
+
+}  // namespace sham
+
+#ifdef __linux__
+namespace sham::detail {
+
+// From <linux/mempolicy.h>, redefined to avoid a dependency on libnuma headers.
+constexpr int kMpolDefault = 0;
+constexpr int kMpolBind = 2;
+constexpr int kMpolInterleave = 3;
+constexpr int kMpolLocal = 4;
+
+constexpr size_t kMaxNumaNodes = 1024;
+constexpr size_t kBitsPerMaskWord = 8 * sizeof(unsigned long);
+using NumaNodeMask = unsigned long[kMaxNumaNodes / kBitsPerMaskWord];
+
+// Parses a kernel cpu or node list such as "0-3,8,10-11".
+inline std::vector<int> ParseKernelList(const std::string& list) {
+  std::vector<int> result;
+  size_t pos = 0;
+  while (pos < list.size()) {
+    size_t end = list.find(',', pos);
+    if (end == std::string::npos) end = list.size();
+    std::string range = list.substr(pos, end - pos);
+    size_t dash = range.find('-');
+    try {
+      int first = std::stoi(range.substr(0, dash));
+      int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+      for (int i = first; i <= last; ++i) result.push_back(i);
+    } catch (const std::exception&) {
+      return {};
+    }
+    pos = end + 1;
+  }
+  return result;
+}
+
+inline std::vector<int> ReadKernelList(const std::string& path) {
+  std::ifstream file(path);
+  std::string list;
+  if (!file || !std::getline(file, list)) return {};
+  return ParseKernelList(list);
+}
+
+inline long MemPolicyMode(const NumaPolicy& policy, NumaNodeMask& mask) {
+  switch (policy.type) {
+    case NumaPolicy::Type::kBind:
+      if (policy.node < 0 || static_cast<size_t>(policy.node) >= kMaxNumaNodes) return -1;
+      mask[policy.node / kBitsPerMaskWord] |= 1ul << (policy.node % kBitsPerMaskWord);
+      return kMpolBind;
+    case NumaPolicy::Type::kInterleave:
+      for (int node : GetNumaNodes()) {
+        mask[node / kBitsPerMaskWord] |= 1ul << (node % kBitsPerMaskWord);
+      }
+      return kMpolInterleave;
+    case NumaPolicy::Type::kLocal:
+      return kMpolLocal;
+    case NumaPolicy::Type::kDefault:
+      return kMpolDefault;
+  }
+  return -1;
+}
+
+inline bool IsOnlineNumaNode(int node) {
+  for (int online_node : GetNumaNodes()) {
+    if (online_node == node) return true;
+  }
+  return false;
+}
+
+}  // namespace sham::detail
+
+std::vector<int> sham::GetNumaNodes() {
+  std::vector<int> nodes = detail::ReadKernelList("/sys/devices/system/node/online");
+  if (nodes.empty()) nodes.push_back(0);
+  return nodes;
+}
+
+size_t sham::GetNumNumaNodes() { return GetNumaNodes().size(); }
+
+bool sham::SetNumaPolicy(void* address, size_t size, const NumaPolicy& policy) {
+  if (policy.type == NumaPolicy::Type::kDefault || GetNumNumaNodes() == 1) return true;
+  if (policy.type == NumaPolicy::Type::kBind && !detail::IsOnlineNumaNode(policy.node)) {
+    return false;
+  }
+  detail::NumaNodeMask mask = {};
+  long mode = detail::MemPolicyMode(policy, mask);
+  if (mode < 0) return false;
+  if (syscall(SYS_mbind, address, size, mode, mask, detail::kMaxNumaNodes, 0) == -1) {
+    perror("Can't set NUMA policy on memory range");
+    return false;
+  }
+  return true;
+}
+
+bool sham::SetThreadNumaPolicy(const NumaPolicy& policy) {
+  if (GetNumNumaNodes() == 1) return true;
+  if (policy.type == NumaPolicy::Type::kBind && !detail::IsOnlineNumaNode(policy.node)) {
+    return false;
+  }
+  detail::NumaNodeMask mask = {};
+  long mode = detail::MemPolicyMode(policy, mask);
+  if (mode < 0) return false;
+  if (syscall(SYS_set_mempolicy, mode, mask, detail::kMaxNumaNodes) == -1) {
+    perror("Can't set thread NUMA policy");
+    return false;
+  }
+  return true;
+}
+
+bool sham::PinThreadToNumaNode(int node) {
+  if (GetNumNumaNodes() == 1) return true;
+  std::vector<int> cpus =
+      detail::ReadKernelList("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+  if (cpus.empty()) return false;
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  for (int cpu : cpus) CPU_SET(cpu, &cpu_set);
+  if (sched_setaffinity(0, sizeof(cpu_set), &cpu_set) == -1) {
+    perror("Can't pin thread to NUMA node");
+    return false;
+  }
+  return true;
+}
+#else
+std::vector<int> sham::GetNumaNodes() { return {0}; }
+
+size_t sham::GetNumNumaNodes() { return 1; }
+
+bool sham::SetNumaPolicy(void*, size_t, const NumaPolicy&) { return true; }
+
+bool sham::SetThreadNumaPolicy(const NumaPolicy&) { return true; }
+
+bool sham::PinThreadToNumaNode(int) { return true; }
+#endif
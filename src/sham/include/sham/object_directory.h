@@ -0,0 +1,178 @@
+/*
+MIT License - Copyright (c) 2023 Pierric Gimmig
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <thread>
+#include <utility>
+
+namespace sham {
+
+// 64-bit FNV-1a hash, stable across processes and builds.
+constexpr uint64_t Fnv1aHash(std::string_view str) {
+  uint64_t hash = 0xcbf29ce484222325;
+  for (char c : str) {
+    hash ^= static_cast<uint8_t>(c);
+    hash *= 0x100000001b3;
+  }
+  return hash;
+}
+
+// Hash of the name of T as spelled by the compiler, identical in all processes built with the same
+// compiler. Used to detect processes disagreeing on the type of a shared object.
+template <typename T>
+constexpr uint64_t TypeHash() {
+#if defined(_MSC_VER)
+  return Fnv1aHash(__FUNCSIG__);
+#else
+  return Fnv1aHash(__PRETTY_FUNCTION__);
+#endif
+}
+
+// Lock-free hash table mapping names to objects of a shared memory segment, see
+// SharedMemoryBuffer::FindOrConstruct(). Entries are inserted with linear probing and never
+// removed. The first process to insert a name constructs the object while the others wait for it
+// to be published, so each object is constructed exactly once. If the construction fails, the
+// next process to insert the name constructs it instead. A process dying while constructing an
+// object blocks the processes looking it up. Zero-filled memory is an empty directory.
+class ObjectDirectory {
+ public:
+  static constexpr size_t kMaxNameSize = 87;
+
+  struct alignas(64) Entry {
+    enum State : uint32_t { kEmpty, kClaimed, kConstructing, kReady, kFailed };
+
+    bool ready() const { return state.load(std::memory_order_acquire) == kReady; }
+    std::string_view name() const { return std::string_view(name_data, name_size); }
+
+    std::atomic<uint32_t> state;
+    uint32_t name_size;
+    uint64_t name_hash;
+    uint64_t type_hash;
+    uint64_t size;
+    // Offset of the object from SharedMemoryBuffer::data().
+    uint64_t offset;
+    char name_data[kMaxNameSize + 1];
+  };
+
+  static_assert(sizeof(Entry) == 128);
+
+  ObjectDirectory() = default;
+  ObjectDirectory(Entry* entries, size_t capacity) : entries_(entries), capacity_(capacity) {}
+
+  // Returns the entry of `name` once its object is constructed or its construction failed, nullptr
+  // if the directory has no such entry.
+  const Entry* Find(std::string_view name) const {
+    if (capacity_ == 0 || name.size() > kMaxNameSize) return nullptr;
+    uint64_t name_hash = Fnv1aHash(name);
+    for (size_t i = 0; i < capacity_; ++i) {
+      Entry& entry = entries_[(name_hash + i) % capacity_];
+      if (WaitForName(entry) == Entry::kEmpty) return nullptr;
+      if (entry.name_hash == name_hash && entry.name() == name) return Wait(entry);
+    }
+    return nullptr;
+  }
+
+  // Returns the entry of `name` and whether it was inserted by this call, or taken over after a
+  // failed construction, in which case the caller must construct the object and call Publish() or
+  // Abort(). Otherwise, waits for the object to be constructed. Returns nullptr if the directory is
+  // full or the name is too long.
+  std::pair<Entry*, bool> FindOrInsert(std::string_view name, uint64_t type_hash, uint64_t size) {
+    if (capacity_ == 0 || name.size() > kMaxNameSize) return {nullptr, false};
+    uint64_t name_hash = Fnv1aHash(name);
+    for (size_t i = 0; i < capacity_; ++i) {
+      Entry& entry = entries_[(name_hash + i) % capacity_];
+      uint32_t state = Entry::kEmpty;
+      if (entry.state.compare_exchange_strong(state, Entry::kClaimed, std::memory_order_acquire)) {
+        entry.name_size = static_cast<uint32_t>(name.size());
+        entry.name_hash = name_hash;
+        entry.type_hash = type_hash;
+        entry.size = size;
+        std::memcpy(entry.name_data, name.data(), name.size());
+        entry.name_data[name.size()] = '\0';
+        entry.state.store(Entry::kConstructing, std::memory_order_release);
+        return {&entry, true};
+      }
+      WaitForName(entry);
+      if (entry.name_hash != name_hash || entry.name() != name) continue;
+      while (true) {
+        state = Wait(entry)->state.load(std::memory_order_acquire);
+        if (state != Entry::kFailed) return {&entry, false};
+        if (entry.state.compare_exchange_strong(state, Entry::kConstructing,
+                                                std::memory_order_acquire)) {
+          entry.type_hash = type_hash;
+          entry.size = size;
+          return {&entry, true};
+        }
+      }
+    }
+    return {nullptr, false};
+  }
+
+  // Makes the object of an entry returned by FindOrInsert() available to other processes.
+  static void Publish(Entry* entry, uint64_t offset) {
+    entry->offset = offset;
+    entry->state.store(Entry::kReady, std::memory_order_release);
+  }
+
+  // Marks the construction of the object of an entry returned by FindOrInsert() as failed.
+  static void Abort(Entry* entry) { entry->state.store(Entry::kFailed, std::memory_order_release); }
+
+  // Calls `fn` with each entry whose object is ready.
+  template <typename Fn>
+  void ForEach(Fn&& fn) const {
+    for (size_t i = 0; i < capacity_; ++i) {
+      if (entries_[i].ready()) fn(entries_[i]);
+    }
+  }
+
+  size_t capacity() const { return capacity_; }
+
+ private:
+  // Waits until the name of a claimed entry is written and returns the state of the entry.
+  static uint32_t WaitForName(const Entry& entry) {
+    uint32_t state = entry.state.load(std::memory_order_acquire);
+    while (state == Entry::kClaimed) {
+      std::this_thread::yield();
+      state = entry.state.load(std::memory_order_acquire);
+    }
+    return state;
+  }
+
+  // Waits until the object of an entry is constructed or its construction failed.
+  static Entry* Wait(Entry& entry) {
+    while (entry.state.load(std::memory_order_acquire) == Entry::kConstructing) {
+      std::this_thread::yield();
+    }
+    return &entry;
+  }
+  static const Entry* Wait(const Entry& entry) { return Wait(const_cast<Entry&>(entry)); }
+
+  Entry* entries_ = nullptr;
+  size_t capacity_ = 0;
+};
+
+}  // namespace sham
@@ -0,0 +1,130 @@
+/*
+MIT License - Copyright (c) 2023 Pierric Gimmig
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <type_traits>
+
+namespace sham {
+
+// Pointer stored as the distance between its own address and its target. A structure made of
+// OffsetPtrs that lives entirely in a shared memory buffer stays valid in every process, wherever
+// the buffer is mapped. An offset of 0 is the null pointer so that zero-filled memory holds null
+// OffsetPtrs; as a consequence an OffsetPtr can't point to itself.
+//
+// Copying an OffsetPtr recomputes the offset for the new location. Copying the raw bytes of an
+// OffsetPtr (memcpy) is only correct if its target is copied along with it.
+template <typename T>
+class OffsetPtr {
+ public:
+  using element_type = T;
+  using value_type = std::remove_cv_t<T>;
+  using difference_type = std::ptrdiff_t;
+  using pointer = T*;
+  using reference = std::add_lvalue_reference_t<T>;
+  using iterator_category = std::random_access_iterator_tag;
+
+  OffsetPtr() = default;
+  OffsetPtr(std::nullptr_t) {}
+  OffsetPtr(T* ptr) { set(ptr); }
+  OffsetPtr(const OffsetPtr& other) { set(other.get()); }
+  template <typename U, typename = std::enable_if_t<std::is_convertible_v<U*, T*>>>
+  OffsetPtr(const OffsetPtr<U>& other) {
+    set(other.get());
+  }
+
+  OffsetPtr& operator=(const OffsetPtr& other) {
+    set(other.get());
+    return *this;
+  }
+  OffsetPtr& operator=(T* ptr) {
+    set(ptr);
+    return *this;
+  }
+  OffsetPtr& operator=(std::nullptr_t) {
+    offset_ = 0;
+    return *this;
+  }
+
+  T* get() const {
+    if (offset_ == 0) return nullptr;
+    return reinterpret_cast<T*>(reinterpret_cast<intptr_t>(this) + offset_);
+  }
+
+  reference operator*() const { return *get(); }
+  T* operator->() const { return get(); }
+  reference operator[](difference_type index) const { return get()[index]; }
+  explicit operator bool() const { return offset_ != 0; }
+
+  // Raw distance to the target, 0 for null.
+  difference_type offset() const { return offset_; }
+
+  OffsetPtr& operator+=(difference_type n) {
+    set(get() + n);
+    return *this;
+  }
+  OffsetPtr& operator-=(difference_type n) {
+    set(get() - n);
+    return *this;
+  }
+  OffsetPtr& operator++() { return *this += 1; }
+  OffsetPtr& operator--() { return *this -= 1; }
+  T* operator++(int) {
+    T* ptr = get();
+    ++*this;
+    return ptr;
+  }
+  T* operator--(int) {
+    T* ptr = get();
+    --*this;
+    return ptr;
+  }
+
+  friend T* operator+(const OffsetPtr& ptr, difference_type n) { return ptr.get() + n; }
+  friend T* operator-(const OffsetPtr& ptr, difference_type n) { return ptr.get() - n; }
+  friend difference_type operator-(const OffsetPtr& a, const OffsetPtr& b) {
+    return a.get() - b.get();
+  }
+
+  friend bool operator==(const OffsetPtr& a, const OffsetPtr& b) { return a.get() == b.get(); }
+  friend bool operator!=(const OffsetPtr& a, const OffsetPtr& b) { return a.get() != b.get(); }
+  friend bool operator==(const OffsetPtr& a, const T* b) { return a.get() == b; }
+  friend bool operator!=(const OffsetPtr& a, const T* b) { return a.get() != b; }
+  friend bool operator==(const OffsetPtr& a, std::nullptr_t) { return !a; }
+  friend bool operator!=(const OffsetPtr& a, std::nullptr_t) { return !!a; }
+  friend bool operator<(const OffsetPtr& a, const OffsetPtr& b) { return a.get() < b.get(); }
+
+ private:
+  void set(const T* ptr) {
+    offset_ = ptr == nullptr ? 0
+                             : reinterpret_cast<intptr_t>(ptr) - reinterpret_cast<intptr_t>(this);
+  }
+
+  difference_type offset_ = 0;
+};
+
+static_assert(sizeof(OffsetPtr<int>) == sizeof(int*));
+
+}  // namespace sham
@@ -0,0 +1,252 @@
+/*
+MIT License - Copyright (c) 2023 Pierric Gimmig
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+#include "sham/offset_ptr.h"
+#include "sham/shared_memory_buffer.h"
+#include "sham/tagged_index_stack.h"
+
+namespace sham {
+
+// Allocator of blocks of power-of-2 sizes, from kMinBlockSize to kMaxBlockSize bytes, that any
+// thread of any process mapping the pool can allocate and free. The pool's memory is split in
+// chunks of kChunkSize bytes, each assigned to a single size class the first time that class runs
+// out of blocks. Free blocks are linked in batches, and each size class has a lock-free stack of
+// batches shared by all processes.
+//
+// Threads allocating and freeing at high rates should go through a Cache, which keeps a few batches
+// of blocks per size class so that most Allocate/Free pairs never touch the shared stacks. The pool
+// must live in the same SharedMemoryBuffer as its memory. Memory assigned to a size class is never
+// returned to the other classes.
+//
+// Example:
+//   auto* pool = buffer.Allocate<sham::PoolAllocator>(buffer, /*capacity=*/64 * 1024 * 1024);
+//   sham::PoolAllocator::Cache cache(*pool);
+//   void* message = cache.Allocate(200);  // 256 bytes block.
+//   cache.Free(message);
+class PoolAllocator {
+ public:
+  static constexpr size_t kChunkSize = 256 * 1024;
+  static constexpr size_t kMinBlockSize = 16;
+  static constexpr size_t kMaxBlockSize = 64 * 1024;
+  static constexpr size_t kNumSizeClasses =
+      std::countr_zero(kMaxBlockSize) - std::countr_zero(kMinBlockSize) + 1;
+  // Blocks are identified by their offset in units of kMinBlockSize in 32 bits.
+  static constexpr size_t kMaxCapacity = size_t{TaggedIndexStack::kEmpty} * kMinBlockSize;
+  // Maximum number of blocks moved at once between a Cache and the pool.
+  static constexpr size_t kMaxBatchSize = 32;
+
+  // Carves `capacity` bytes, rounded down to a multiple of kChunkSize, out of `buffer`. The
+  // capacity is 0 if the buffer is full.
+  PoolAllocator(SharedMemoryBuffer& buffer, size_t capacity) {
+    size_t num_chunks = std::min(capacity, kMaxCapacity) / kChunkSize;
+    uint8_t* chunks = buffer.Allocate(num_chunks * kChunkSize, sham::GetPageSize());
+    auto* chunk_classes = reinterpret_cast<std::atomic<uint8_t>*>(buffer.Allocate(num_chunks));
+    if (chunks == nullptr || chunk_classes == nullptr) return;
+    chunks_ = chunks;
+    chunk_classes_ = chunk_classes;
+    num_chunks_ = num_chunks;
+  }
+
+  PoolAllocator(const PoolAllocator&) = delete;
+  PoolAllocator& operator=(const PoolAllocator&) = delete;
+
+  // Returns a block of at least `size` bytes, aligned to its size up to the page size. Returns
+  // nullptr if the pool is out of memory for that size class or `size` exceeds kMaxBlockSize.
+  void* Allocate(size_t size) {
+    if (size > kMaxBlockSize) return nullptr;
+    size_t size_class = SizeClass(size);
+    uint32_t batch = PopBatch(size_class);
+    if (batch == TaggedIndexStack::kEmpty) return nullptr;
+    uint32_t rest = Link(batch).next_in_batch.load(std::memory_order_relaxed);
+    if (rest != TaggedIndexStack::kEmpty) PushBatch(size_class, rest);
+    return Block(batch);
+  }
+
+  // Frees a block returned by Allocate() or by any Cache of this pool, in any process.
+  void Free(void* ptr) {
+    if (ptr == nullptr) return;
+    uint32_t index = Index(ptr);
+    Link(index).next_in_batch.store(TaggedIndexStack::kEmpty, std::memory_order_relaxed);
+    PushBatch(ChunkClass(index), index);
+  }
+
+  // Per-thread cache of free blocks, private to the process that created it. Blocks cached when
+  // the cache is destroyed are returned to the pool.
+  class Cache {
+   public:
+    explicit Cache(PoolAllocator& pool) : pool_(&pool) {}
+    ~Cache() { Flush(); }
+
+    Cache(const Cache&) = delete;
+    Cache& operator=(const Cache&) = delete;
+
+    void* Allocate(size_t size) {
+      if (size > kMaxBlockSize) return nullptr;
+      size_t size_class = SizeClass(size);
+      Magazine& magazine = magazines_[size_class];
+      if (magazine.count == 0 && !Refill(size_class)) return nullptr;
+      return pool_->Block(magazine.blocks[--magazine.count]);
+    }
+
+    void Free(void* ptr) {
+      if (ptr == nullptr) return;
+      uint32_t index = pool_->Index(ptr);
+      size_t size_class = pool_->ChunkClass(index);
+      Magazine& magazine = magazines_[size_class];
+      if (magazine.count == 2 * BatchSize(size_class)) Release(size_class);
+      magazine.blocks[magazine.count++] = index;
+    }
+
+    // Returns all cached blocks to the pool.
+    void Flush() {
+      for (size_t size_class = 0; size_class < kNumSizeClasses; ++size_class) {
+        while (magazines_[size_class].count > 0) Release(size_class);
+      }
+    }
+
+   private:
+    struct Magazine {
+      uint32_t count = 0;
+      uint32_t blocks[2 * kMaxBatchSize];
+    };
+
+    bool Refill(size_t size_class) {
+      Magazine& magazine = magazines_[size_class];
+      for (uint32_t index = pool_->PopBatch(size_class); index != TaggedIndexStack::kEmpty;
+           index = pool_->Link(index).next_in_batch.load(std::memory_order_relaxed)) {
+        magazine.blocks[magazine.count++] = index;
+      }
+      return magazine.count > 0;
+    }
+
+    // Returns up to one batch of blocks to the pool.
+    void Release(size_t size_class) {
+      Magazine& magazine = magazines_[size_class];
+      uint32_t batch = TaggedIndexStack::kEmpty;
+      for (size_t i = 0; i < BatchSize(size_class) && magazine.count > 0; ++i) {
+        uint32_t index = magazine.blocks[--magazine.count];
+        pool_->Link(index).next_in_batch.store(batch, std::memory_order_relaxed);
+        batch = index;
+      }
+      pool_->PushBatch(size_class, batch);
+    }
+
+    PoolAllocator* pool_;
+    Magazine magazines_[kNumSizeClasses];
+  };
+
+  // Size of the blocks returned for allocations of `size` bytes.
+  static constexpr size_t BlockSize(size_t size) { return kMinBlockSize << SizeClass(size); }
+
+  size_t capacity() const { return num_chunks_ * kChunkSize; }
+  // Number of chunks not assigned to a size class yet.
+  size_t num_free_chunks() const { return num_chunks_ - num_used_chunks_.load(); }
+
+ private:
+  // Links of a free block, stored in the block itself.
+  struct FreeBlock {
+    // Next block of the same batch.
+    std::atomic<uint32_t> next_in_batch;
+    // Next batch in the stack of the size class, see TaggedIndexStack.
+    std::atomic<uint32_t> next_batch;
+  };
+  static_assert(sizeof(FreeBlock) <= kMinBlockSize);
+
+  // Classes of large blocks have small batches, so that caches don't hold on to a lot of memory.
+  static constexpr size_t BatchSize(size_t size_class) {
+    return std::clamp<size_t>(kChunkSize / (kMinBlockSize << size_class) / 8, 1, kMaxBatchSize);
+  }
+
+  static constexpr size_t SizeClass(size_t size) {
+    return size <= kMinBlockSize ? 0 : std::bit_width(size - 1) - std::countr_zero(kMinBlockSize);
+  }
+
+  uint32_t PopBatch(size_t size_class) {
+    uint32_t batch = free_lists_[size_class].stack.Pop(
+        [this](uint32_t index) -> std::atomic<uint32_t>& { return Link(index).next_batch; });
+    return batch != TaggedIndexStack::kEmpty ? batch : CarveChunk(size_class);
+  }
+
+  void PushBatch(size_t size_class, uint32_t batch) {
+    free_lists_[size_class].stack.Push(
+        batch, [this](uint32_t index) -> std::atomic<uint32_t>& { return Link(index).next_batch; });
+  }
+
+  // Assigns a new chunk to `size_class`, splits it in batches and returns one of them.
+  uint32_t CarveChunk(size_t size_class) {
+    // Stops counting at num_chunks_, so that failing allocations can't wrap the count around.
+    uint32_t chunk = num_used_chunks_.load(std::memory_order_relaxed);
+    do {
+      if (chunk >= num_chunks_) return TaggedIndexStack::kEmpty;
+    } while (!num_used_chunks_.compare_exchange_weak(chunk, chunk + 1, std::memory_order_relaxed));
+    chunk_classes_[chunk].store(static_cast<uint8_t>(size_class), std::memory_order_relaxed);
+
+    const uint32_t block_units = (kMinBlockSize << size_class) / kMinBlockSize;
+    const uint32_t first = chunk * (kChunkSize / kMinBlockSize);
+    const uint32_t end = first + kChunkSize / kMinBlockSize;
+    uint32_t batch = TaggedIndexStack::kEmpty;
+    size_t batch_size = 0;
+    for (uint32_t index = end - block_units;; index -= block_units) {
+      Link(index).next_in_batch.store(batch, std::memory_order_relaxed);
+      batch = index;
+      if (index == first) break;
+      if (++batch_size == BatchSize(size_class)) {
+        PushBatch(size_class, batch);
+        batch = TaggedIndexStack::kEmpty;
+        batch_size = 0;
+      }
+    }
+    return batch;
+  }
+
+  size_t ChunkClass(uint32_t index) const {
+    return chunk_classes_[index / (kChunkSize / kMinBlockSize)].load(std::memory_order_relaxed);
+  }
+
+  void* Block(uint32_t index) { return chunks_.get() + size_t{index} * kMinBlockSize; }
+  uint32_t Index(const void* ptr) const {
+    return static_cast<uint32_t>((static_cast<const uint8_t*>(ptr) - chunks_.get()) /
+                                 kMinBlockSize);
+  }
+  FreeBlock& Link(uint32_t index) { return *static_cast<FreeBlock*>(Block(index)); }
+
+  // Aligned on cacheline boundary to eliminate false sharing between size classes.
+  struct alignas(64) FreeList {
+    TaggedIndexStack stack;
+  };
+
+  FreeList free_lists_[kNumSizeClasses];
+  OffsetPtr<uint8_t> chunks_;
+  OffsetPtr<std::atomic<uint8_t>> chunk_classes_;
+  size_t num_chunks_ = 0;
+  std::atomic<uint32_t> num_used_chunks_ = 0;
+};
+
+}  // namespace sham
@@ -0,0 +1,189 @@
+/*
+MIT License - Copyright (c) 2023 Pierric Gimmig
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+
+// Cross-platform helpers to identify processes and check if they are still running, e.g. to find
+// resources in shared memory left behind by a crashed process.
+namespace sham {
+
+// Id of the calling process. Cached, getpid() being a system call.
+inline uint32_t CurrentProcessId();
+// Start time of process `pid` in an OS specific unit, 0 if it can't be determined. Together with
+// the process id, it identifies a process even once its id is reused by a new process.
+inline uint64_t GetProcessStartTime(uint32_t pid);
+// Returns true if process `pid` is running and, unless `start_time` is 0, was started at
+// `start_time` as returned by GetProcessStartTime().
+inline bool IsProcessAlive(uint32_t pid, uint64_t start_time = 0);
+
+// Identifies the calling process in 64 bits, e.g. as the owner of a resource in shared memory: its
+// pid in the low 32 bits and the low 32 bits of its start time in the high ones. Unlike the pid,
+// it isn't mistaken for a new process reusing the pid once the process died. Cached, never 0.
+inline uint64_t CurrentProcessInstance();
+constexpr uint32_t ProcessInstancePid(uint64_t instance) {
+  return static_cast<uint32_t>(instance);
+}
+// Returns true if the process identified by `instance`, see CurrentProcessInstance(), is running.
+// Only its pid is checked if its start time couldn't be determined.
+inline bool IsProcessInstanceAlive(uint64_t instance);
+
+}  // namespace sham
+
+#ifdef _WIN32
+uint32_t sham::CurrentProcessId() { return static_cast<uint32_t>(::GetCurrentProcessId()); }
+
+uint64_t sham::GetProcessStartTime(uint32_t pid) {
+  HANDLE process = ::OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
+  if (process == nullptr) return 0;
+  FILETIME creation_time, exit_time, kernel_time, user_time;
+  uint64_t start_time = 0;
+  if (::GetProcessTimes(process, &creation_time, &exit_time, &kernel_time, &user_time)) {
+    start_time = (static_cast<uint64_t>(creation_time.dwHighDateTime) << 32) |
+                 creation_time.dwLowDateTime;
+  }
+  CloseHandle(process);
+  return start_time;
+}
+
+uint64_t sham::CurrentProcessInstance() {
+  static const uint64_t instance =
+      CurrentProcessId() | (GetProcessStartTime(CurrentProcessId()) << 32);
+  return instance;
+}
+
+bool sham::IsProcessAlive(uint32_t pid, uint64_t start_time) {
+  HANDLE process = ::OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
+  if (process == nullptr) return GetLastError() == ERROR_ACCESS_DENIED;
+  DWORD exit_code = 0;
+  bool alive = ::GetExitCodeProcess(process, &exit_code) && exit_code == STILL_ACTIVE;
+  CloseHandle(process);
+  return alive && (start_time == 0 || GetProcessStartTime(pid) == start_time);
+}
+#else
+namespace sham::internal {
+
+// Only the thread calling fork() runs in the child, it resets the caches before fork() returns.
+inline std::atomic<uint32_t> cached_process_id = 0;
+inline std::atomic<uint64_t> cached_process_instance = 0;
+
+}  // namespace sham::internal
+
+uint32_t sham::CurrentProcessId() {
+  uint32_t pid = internal::cached_process_id.load(std::memory_order_relaxed);
+  if (pid != 0) return pid;
+  static bool registered = pthread_atfork(nullptr, nullptr, [] {
+    internal::cached_process_id.store(0, std::memory_order_relaxed);
+    internal::cached_process_instance.store(0, std::memory_order_relaxed);
+  }) == 0;
+  pid = static_cast<uint32_t>(getpid());
+  if (registered) internal::cached_process_id.store(pid, std::memory_order_relaxed);
+  return pid;
+}
+
+namespace sham::internal {
+
+// Reads the state (field 3) and the start time in clock ticks since boot (field 22) of process
+// `pid` from /proc/<pid>/stat. Returns false if the process doesn't exist.
+inline bool ReadProcessStat(uint32_t pid, char* state, uint64_t* start_time) {
+#ifdef __linux__
+  std::string path = "/proc/" + std::to_string(pid) + "/stat";
+  FILE* file = fopen(path.c_str(), "r");
+  if (file == nullptr) return false;
+  char stat[1024];
+  size_t size = fread(stat, 1, sizeof(stat) - 1, file);
+  fclose(file);
+  stat[size] = '\0';
+  // The command name in field 2 can contain spaces and parentheses, the next fields start after
+  // its last ')'.
+  std::string_view fields(stat, size);
+  size_t position = fields.rfind(')');
+  if (position == std::string_view::npos || position + 2 >= size) return false;
+  *state = stat[position + 2];
+  ++position;
+  for (int field = 3; field < 22 && position != std::string_view::npos; ++field) {
+    position = fields.find(' ', position + 1);
+  }
+  if (position == std::string_view::npos) return false;
+  *start_time = std::strtoull(stat + position + 1, nullptr, 10);
+  return true;
+#else
+  return false;
+#endif
+}
+
+}  // namespace sham::internal
+
+uint64_t sham::GetProcessStartTime(uint32_t pid) {
+  char state = 0;
+  uint64_t start_time = 0;
+  return internal::ReadProcessStat(pid, &state, &start_time) ? start_time : 0;
+}
+
+bool sham::IsProcessAlive(uint32_t pid, uint64_t start_time) {
+  if (pid == 0) return false;
+  // EPERM means the process exists but belongs to another user.
+  if (kill(static_cast<pid_t>(pid), 0) == -1 && errno != EPERM) return false;
+  char state = 0;
+  uint64_t current_start_time = 0;
+  if (!internal::ReadProcessStat(pid, &state, &current_start_time)) return true;
+  // A zombie has exited, it only waits for its parent to collect its exit status.
+  if (state == 'Z' || state == 'X') return false;
+  return start_time == 0 || current_start_time == start_time;
+}
+
+uint64_t sham::CurrentProcessInstance() {
+  uint64_t instance = internal::cached_process_instance.load(std::memory_order_relaxed);
+  if (instance != 0) return instance;
+  uint32_t pid = CurrentProcessId();
+  instance = pid | (GetProcessStartTime(pid) << 32);
+  // Only cached if the process id is, i.e. if the cache is reset on fork().
+  if (internal::cached_process_id.load(std::memory_order_relaxed) == pid) {
+    internal::cached_process_instance.store(instance, std::memory_order_relaxed);
+  }
+  return instance;
+}
+#endif
+
+bool sham::IsProcessInstanceAlive(uint64_t instance) {
+  uint32_t pid = ProcessInstancePid(instance);
+  uint64_t start_time = instance >> 32;
+  uint64_t current_start_time = GetProcessStartTime(pid) & 0xffffffff;
+  return IsProcessAlive(pid) &&
+         (start_time == 0 || current_start_time == 0 || current_start_time == start_time);
+}
@@ -0,0 +1,120 @@
+/*
+MIT License - Copyright (c) 2023 Pierric Gimmig
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+
+#include "sham/offset_ptr.h"
+#include "sham/shared_memory_buffer.h"
+#include "sham/tagged_index_stack.h"
+
+namespace sham {
+
+// Fixed number of queues of type QueueT, e.g. SPSCQueue<Msg, 1023>, carved out of a single
+// allocation of a shared memory buffer. Thousands of queues, e.g. one per client session, then
+// share one file descriptor and one mapping, which can be backed by huge pages with
+// SharedMemoryBufferOptions::huge_pages, instead of each taking its own segment.
+//
+// Queues start on 128-byte boundaries, so that neither false sharing nor the adjacent cache line
+// prefetcher couple neighbouring queues. They are identified by a Handle, an index valid in all the
+// processes mapping the buffer. Acquire() and Release() are lock-free. The arena must live in the
+// same SharedMemoryBuffer as its queues.
+//
+// Example:
+//   using Arena = sham::QueueArena<sham::SPSCQueue<Msg, 1023>>;
+//   auto* arena = buffer.Allocate<Arena>(buffer, /*capacity=*/5000);
+//   Arena::Handle handle = arena->Acquire();  // Sent to the peer process along with the session.
+//   arena->Get(handle)->push(msg);
+template <typename QueueT>
+class QueueArena {
+ public:
+  using Handle = uint32_t;
+  static constexpr Handle kInvalidHandle = TaggedIndexStack::kEmpty;
+  static constexpr size_t kQueueAlignment = std::max<size_t>(128, alignof(QueueT));
+  // Distance between consecutive queues.
+  static constexpr size_t kStride =
+      (sizeof(QueueT) + kQueueAlignment - 1) / kQueueAlignment * kQueueAlignment;
+
+  // Carves room for `capacity` queues out of `buffer`. Queues are constructed by Acquire(), memory
+  // of queues never acquired is never touched. The capacity is 0 if the buffer is full.
+  QueueArena(SharedMemoryBuffer& buffer, size_t capacity) {
+    static_assert(kQueueAlignment <= SharedMemoryHeader::kSize);
+    capacity = std::min<size_t>(capacity, kInvalidHandle);
+    uint8_t* queues = buffer.Allocate(capacity * kStride, std::max(kQueueAlignment, GetPageSize()));
+    auto* links = reinterpret_cast<std::atomic<uint32_t>*>(
+        buffer.Allocate(capacity * sizeof(std::atomic<uint32_t>), alignof(std::atomic<uint32_t>)));
+    if (queues == nullptr || links == nullptr) return;
+    queues_ = queues;
+    links_ = links;
+    capacity_ = capacity;
+  }
+
+  QueueArena(const QueueArena&) = delete;
+  QueueArena& operator=(const QueueArena&) = delete;
+
+  // Constructs a queue with `args` and returns its handle, kInvalidHandle if all the queues are in
+  // use. Released queues are reused first, their memory is likely still cached.
+  template <typename... Args>
+  Handle Acquire(Args&&... args) {
+    Handle handle = free_handles_.Pop([this](uint32_t index) -> auto& { return links_[index]; });
+    if (handle == kInvalidHandle) {
+      size_t next = next_unused_.load(std::memory_order_relaxed);
+      do {
+        if (next >= capacity_) return kInvalidHandle;
+      } while (!next_unused_.compare_exchange_weak(next, next + 1, std::memory_order_relaxed));
+      handle = static_cast<Handle>(next);
+    }
+    new (Get(handle)) QueueT(std::forward<Args>(args)...);
+    return handle;
+  }
+
+  // Destroys a queue returned by Acquire(), in any process. No process must access it anymore.
+  // Handles out of range are ignored.
+  void Release(Handle handle) {
+    if (handle >= capacity_) return;
+    Get(handle)->~QueueT();
+    free_handles_.Push(handle, [this](uint32_t index) -> auto& { return links_[index]; });
+  }
+
+  QueueT* Get(Handle handle) {
+    return reinterpret_cast<QueueT*>(queues_.get() + size_t{handle} * kStride);
+  }
+
+  size_t capacity() const { return capacity_; }
+
+ private:
+  OffsetPtr<uint8_t> queues_;
+  // Links of the stack of released handles.
+  OffsetPtr<std::atomic<uint32_t>> links_;
+  size_t capacity_ = 0;
+  // Queues from next_unused_ on were never acquired.
+  std::atomic<size_t> next_unused_ = 0;
+  TaggedIndexStack free_handles_;
+};
+
+}  // namespace sham
@@ -24,14 +24,18 @@ SOFTWARE.
 
 #include <stdint.h>
 
+#include <cstddef>
 #include <iostream>
 #include <mutex>
+#include <new>
+#include <type_traits>
 #include <vector>
 
 namespace sham {
 namespace mpmc {
 
-// Locking mpmc queue. The push and pop operations block by busy waiting.
+// Locking mpmc queue. The push and pop operations block by busy waiting. Elements are only
+// constructed on push, so creating the queue does not touch its storage.
 template <typename T, size_t kCapacity>
 class LockingQueue {
  public:
@@ -39,7 +43,13 @@ class LockingQueue {
     static_assert(kCapacity > 0);
     static_assert(IsPowerOfTwoMinusOne(kCapacity));
   }
-  ~LockingQueue() {}
+  ~LockingQueue() {
+    if constexpr (!std::is_trivially_destructible_v<T>) {
+      for (size_t i = out_; i != in_; i = inc(i)) {
+        slot(i)->~T();
+      }
+    }
+  }
 
   // non-copyable and non-movable
   LockingQueue(const LockingQueue&) = delete;
@@ -51,7 +61,7 @@ class LockingQueue {
   bool try_emplace(Args&&... args) {
     std::lock_guard lk(mutex_);
     if (is_full(lk)) return false;
-    new (&data_[in_]) T(std::forward<Args>(args)...);
+    new (slot(in_)) T(std::forward<Args>(args)...);
     in_ = inc(in_);
     return true;
   }
@@ -70,7 +80,9 @@ class LockingQueue {
   bool try_pop(T& v) {
     std::lock_guard lk(mutex_);
     if (in_ == out_) return false;
-    v = data_[out_];
+    T* element = slot(out_);
+    v = std::move(*element);
+    element->~T();
     out_ = inc(out_);
     return true;
   }
@@ -103,12 +115,13 @@ class LockingQueue {
   // We need one extra slot to distinguish between full and empty.
   static constexpr size_t kInternalCapacity = kCapacity + 1;
 
+  [[nodiscard]] inline T* slot(size_t idx) { return reinterpret_cast<T*>(data_) + idx; }
   [[nodiscard]] inline size_t inc(size_t idx) const { return (idx + 1) % kInternalCapacity; }
   [[nodiscard]] inline bool empty(std::lock_guard<std::mutex>&) const { return in_ == out_; }
   [[nodiscard]] inline bool is_full(std::lock_guard<std::mutex>&) const { return inc(in_) == out_; }
 
  private:
-  T data_[kInternalCapacity];
+  alignas(T) std::byte data_[sizeof(T) * kInternalCapacity];
   mutable std::mutex mutex_;
   size_t in_ = 0;
   size_t out_ = 0;
@@ -25,11 +25,16 @@ SOFTWARE.
 #include <atomic>
 #include <cassert>
 #include <cstddef>  // offsetof
+#include <cstring>
 #include <limits>
 #include <memory>
 #include <new>  // std::hardware_destructive_interference_size
 #include <stdexcept>
 #include <string>
+#include <type_traits>
+
+#include "sham/shared_memory.h"
+#include "sham/zero_initialized.h"
 
 namespace sham {
 namespace mpmc {
@@ -40,6 +45,9 @@ namespace mpmc {
 //  different address spaces.
 //  - Removed the capacity_ member variable in favor of kCapacity template argument.
 //  - Added descriptions() method to be used when benchmarking.
+//  - Slots live in raw storage so that zero-filled memory is a valid empty queue, see
+//  Queue(ZeroInitialized).
+//  - Added release_unused_memory() and resident_size() to reclaim the memory of idle queues.
 
 #if defined(__cpp_lib_hardware_interference_size) && !defined(__APPLE__)
 static constexpr size_t hardwareInterferenceSize = std::hardware_destructive_interference_size;
@@ -47,14 +55,9 @@ static constexpr size_t hardwareInterferenceSize = std::hardware_destructive_int
 static constexpr size_t hardwareInterferenceSize = 64;
 #endif
 
+// A zero-filled slot is a valid empty slot for turn 0.
 template <typename T>
 struct Slot {
-  ~Slot() noexcept {
-    if (turn & 1) {
-      destroy();
-    }
-  }
-
   template <typename... Args>
   void construct(Args&&... args) noexcept {
     static_assert(std::is_nothrow_constructible<T, Args&&...>::value,
@@ -84,13 +87,20 @@ class Queue {
   static_assert(std::is_nothrow_destructible<T>::value, "T must be nothrow destructible");
 
  public:
-  explicit Queue() : head_(0), tail_(0) {
+  // Constructs an empty queue in memory of unknown content, e.g. on the heap. Every slot is
+  // initialized, which touches the whole ring.
+  explicit Queue() : Queue(kZeroInitialized) {
+    for (size_t i = 0; i < kInternalCapacity; ++i) {
+      new (&slots()[i]) Slot<T>();
+    }
+  }
+
+  // Constructs an empty queue in zero-filled memory, e.g. a freshly created SharedMemoryBuffer.
+  // The slots are not touched: construction is O(1) and the ring is committed lazily as it fills.
+  explicit Queue(ZeroInitialized) : head_(0), tail_(0) {
     if (reinterpret_cast<size_t>(slots_) % alignof(Slot<T>) != 0) {
       throw std::bad_alloc();
     }
-    for (size_t i = 0; i < kInternalCapacity; ++i) {
-      new (&slots_[i]) Slot<T>();
-    }
     static_assert(alignof(Slot<T>) == hardwareInterferenceSize,
                   "Slot must be aligned to cache line boundary to prevent false sharing");
     static_assert(sizeof(Slot<T>) % hardwareInterferenceSize == 0,
@@ -104,9 +114,16 @@ class Queue {
                   "head and tail must be a cache line apart to prevent false sharing");
   }
 
+  // Only destroys the elements still in the queue, the rest of the ring is not touched.
   ~Queue() noexcept {
-    for (size_t i = 0; i < kInternalCapacity; ++i) {
-      slots_[i].~Slot();
+    if constexpr (!std::is_trivially_destructible_v<T>) {
+      size_t const head = head_.load(std::memory_order_relaxed);
+      for (size_t i = tail_.load(std::memory_order_relaxed); i < head; ++i) {
+        auto& slot = slots()[idx(i)];
+        if (slot.turn.load(std::memory_order_relaxed) & 1) {
+          slot.destroy();
+        }
+      }
     }
   }
 
@@ -119,7 +136,7 @@ class Queue {
     static_assert(std::is_nothrow_constructible<T, Args&&...>::value,
                   "T must be nothrow constructible with Args&&...");
     auto const head = head_.fetch_add(1);
-    auto& slot = slots_[idx(head)];
+    auto& slot = slots()[idx(head)];
     while (turn(head) * 2 != slot.turn.load(std::memory_order_acquire))
       ;
     slot.construct(std::forward<Args>(args)...);
@@ -132,7 +149,7 @@ class Queue {
                   "T must be nothrow constructible with Args&&...");
     auto head = head_.load(std::memory_order_acquire);
     for (;;) {
-      auto& slot = slots_[idx(head)];
+      auto& slot = slots()[idx(head)];
       if (turn(head) * 2 == slot.turn.load(std::memory_order_acquire)) {
         if (head_.compare_exchange_strong(head, head + 1)) {
           slot.construct(std::forward<Args>(args)...);
@@ -175,7 +192,7 @@ class Queue {
 
   void pop(T& v) noexcept {
     auto const tail = tail_.fetch_add(1);
-    auto& slot = slots_[idx(tail)];
+    auto& slot = slots()[idx(tail)];
     while (turn(tail) * 2 + 1 != slot.turn.load(std::memory_order_acquire))
       ;
     v = slot.move();
@@ -186,7 +203,7 @@ class Queue {
   bool try_pop(T& v) noexcept {
     auto tail = tail_.load(std::memory_order_acquire);
     for (;;) {
-      auto& slot = slots_[idx(tail)];
+      auto& slot = slots()[idx(tail)];
       if (turn(tail) * 2 + 1 == slot.turn.load(std::memory_order_acquire)) {
         if (tail_.compare_exchange_strong(tail, tail + 1)) {
           v = slot.move();
@@ -204,6 +221,28 @@ class Queue {
     }
   }
 
+  /// Copies the element pushed at position `index` without popping it. This is meant for observers
+  /// that can't modify the queue, e.g. a process following a persistent queue through a read-only
+  /// mapping, starting from tail(). Returns false if that element was not pushed yet or has
+  /// already been popped, in which case `v` is unspecified.
+  bool try_peek(size_t index, T& v) const noexcept {
+    static_assert(std::is_trivially_copyable<T>::value, "T must be trivially copyable");
+    auto const& slot = slots()[idx(index)];
+    if (turn(index) * 2 + 1 != slot.turn.load(std::memory_order_acquire)) {
+      return false;
+    }
+    std::memcpy(&v, &slot.storage, sizeof(T));
+    // A pop could have raced with the copy, in which case the turn has changed.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return turn(index) * 2 + 1 == slot.turn.load(std::memory_order_relaxed);
+  }
+
+  /// Position of the next element to be pushed.
+  size_t head() const noexcept { return head_.load(std::memory_order_acquire); }
+
+  /// Position of the next element to be popped.
+  size_t tail() const noexcept { return tail_.load(std::memory_order_acquire); }
+
   /// Returns the number of elements in the queue.
   /// The size can be negative when the queue is empty and there is at least one
   /// reader waiting. Since this is a concurrent queue the size is only a best
@@ -221,6 +260,24 @@ class Queue {
 
   [[nodiscard]] static size_t capacity() noexcept { return kCapacity; }
 
+  /// Returns the memory of the ring to the OS, see ReleaseMemory(), and rewinds the queue to its
+  /// initial state, in which the ring is only committed again as it fills up. Slot turns go back
+  /// to 0 along with the indices, so the queue stays valid. The queue must be in shared memory or
+  /// in private anonymous memory, it must be empty, and no thread of any process may use it during
+  /// the call, e.g. call it from the process owning a session after it went idle. Returns false,
+  /// leaving the queue untouched, if the queue isn't empty or the memory can't be released.
+  bool release_unused_memory() noexcept {
+    size_t const head = head_.load(std::memory_order_acquire);
+    if (head != tail_.load(std::memory_order_acquire)) return false;
+    if (!ReleaseMemory(slots_, sizeof(slots_))) return false;
+    head_.store(0, std::memory_order_relaxed);
+    tail_.store(0, std::memory_order_release);
+    return true;
+  }
+
+  /// Returns the number of bytes of the queue resident in memory.
+  size_t resident_size() const noexcept { return GetResidentSize(this, sizeof(*this)); }
+
   std::string description() { return "Rigtorp mpmc queue"; }
 
  private:
@@ -230,8 +287,12 @@ class Queue {
 
   static constexpr size_t kInternalCapacity = kCapacity + 1;
 
+  Slot<T>* slots() noexcept { return reinterpret_cast<Slot<T>*>(slots_); }
+  const Slot<T>* slots() const noexcept { return reinterpret_cast<const Slot<T>*>(slots_); }
+
  private:
-  Slot<T> slots_[kInternalCapacity];
+  // Raw storage so that constructing the queue does not construct, and thus touch, every slot.
+  alignas(Slot<T>) std::byte slots_[sizeof(Slot<T>) * kInternalCapacity];
 
   // Align to avoid false sharing between head_ and tail_
   alignas(hardwareInterferenceSize) std::atomic<size_t> head_;
@@ -0,0 +1,195 @@
+/*
+MIT License - Copyright (c) 2023 Pierric Gimmig
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+
+#include "sham/offset_ptr.h"
+#include "sham/pool_allocator.h"
+
+namespace sham {
+namespace mpsc {
+
+// Link embedded in the nodes of an IntrusiveQueue.
+struct Hook {
+  std::atomic<int64_t> next;
+};
+
+// Unbounded intrusive multi-producer single-consumer queue of Vyukov, for many producers feeding
+// one aggregator. Producers push with a single atomic exchange and never wait for each other. The
+// consumer only loads and stores, except when it pops the last node, which takes one exchange to
+// put the queue's own stub node back.
+//
+// Nodes embed a Hook and are owned by the caller, e.g. blocks of a PoolAllocator. Links are
+// offsets from the queue, so nodes must be in the same SharedMemoryBuffer as the queue and the
+// queue works across processes. A node pushed is visible to the consumer once the producer linked
+// it to its predecessor: a producer preempted between its exchange and that store holds back the
+// nodes pushed after it, Pop() then returns nullptr although the queue isn't empty.
+class IntrusiveQueue {
+ public:
+  IntrusiveQueue() : head_(Offset(&stub_)), tail_(Offset(&stub_)) {
+    stub_.next.store(kNull, std::memory_order_relaxed);
+  }
+
+  IntrusiveQueue(const IntrusiveQueue&) = delete;
+  IntrusiveQueue& operator=(const IntrusiveQueue&) = delete;
+
+  // Can be called by any number of threads of any process.
+  void Push(Hook* node) {
+    node->next.store(kNull, std::memory_order_relaxed);
+    int64_t previous = head_.exchange(Offset(node), std::memory_order_acq_rel);
+    At(previous)->next.store(Offset(node), std::memory_order_release);
+  }
+
+  // Returns the oldest node, or nullptr if there is none ready. Consumer only.
+  Hook* Pop() {
+    Hook* tail = At(tail_);
+    int64_t next = tail->next.load(std::memory_order_acquire);
+    if (tail == &stub_) {
+      if (next == kNull) return nullptr;
+      tail_ = next;
+      tail = At(next);
+      next = tail->next.load(std::memory_order_acquire);
+    }
+    if (next != kNull) {
+      tail_ = next;
+      return tail;
+    }
+    // The tail is the last node linked. If it is also the head, the stub is pushed behind it so
+    // that it can be popped, otherwise a producer is about to link the next node.
+    if (Offset(tail) != head_.load(std::memory_order_acquire)) return nullptr;
+    Push(&stub_);
+    next = tail->next.load(std::memory_order_acquire);
+    if (next == kNull) return nullptr;
+    tail_ = next;
+    return tail;
+  }
+
+  // Returns true if no node was pushed since the last one popped. Consumer only.
+  bool empty() const {
+    return At(tail_) == &stub_ && stub_.next.load(std::memory_order_acquire) == kNull;
+  }
+
+ private:
+  // Offsets of nodes are never 0, which is the queue itself.
+  static constexpr int64_t kNull = 0;
+
+  int64_t Offset(const Hook* node) const {
+    return reinterpret_cast<const uint8_t*>(node) - reinterpret_cast<const uint8_t*>(this);
+  }
+  Hook* At(int64_t offset) const {
+    return reinterpret_cast<Hook*>(const_cast<uint8_t*>(reinterpret_cast<const uint8_t*>(this)) +
+                                   offset);
+  }
+
+  // Written by producers.
+  alignas(64) std::atomic<int64_t> head_;
+  // Read by the consumer, written by the producer pushing after it.
+  alignas(64) Hook stub_;
+  // Consumer only.
+  alignas(64) int64_t tail_;
+};
+
+// Unbounded MPSC queue of values of type T, on top of an IntrusiveQueue whose nodes are allocated
+// from a PoolAllocator. The pool, which can be shared by several queues, must live in the same
+// SharedMemoryBuffer as the queue. Pushing fails only when the pool is out of memory.
+//
+// Allocating and freeing nodes in the pool takes atomic operations on the pool's free lists. Pass
+// a PoolAllocator::Cache, one per thread, to amortize them over batches of nodes.
+//
+// Example:
+//   auto* pool = buffer.Allocate<sham::PoolAllocator>(buffer, 64 * 1024 * 1024);
+//   auto* queue = buffer.Allocate<sham::mpsc::Queue<Order>>(*pool);
+//   sham::PoolAllocator::Cache cache(*pool);  // In each thread.
+//   queue->try_push(order, &cache);           // Producers.
+//   queue->try_pop(order, &cache);            // Aggregator.
+template <typename T>
+class Queue {
+ public:
+  explicit Queue(PoolAllocator& pool) : pool_(&pool) {}
+
+  // Frees the nodes still in the queue. Must be called by the consumer, or once all the threads
+  // are done with the queue.
+  ~Queue() {
+    while (Hook* hook = queue_.Pop()) Free(static_cast<Node*>(hook), nullptr);
+  }
+
+  Queue(const Queue&) = delete;
+  Queue& operator=(const Queue&) = delete;
+
+  // Size of the pool blocks taken by each element.
+  static constexpr size_t NodeSize() { return PoolAllocator::BlockSize(sizeof(Node)); }
+
+  template <typename... Args>
+  [[nodiscard]] bool try_emplace(PoolAllocator::Cache* cache, Args&&... args) {
+    void* memory = cache != nullptr ? cache->Allocate(sizeof(Node)) : pool_->Allocate(sizeof(Node));
+    if (memory == nullptr) return false;
+    Node* node = new (memory) Node{{}, T(std::forward<Args>(args)...)};
+    queue_.Push(node);
+    return true;
+  }
+
+  [[nodiscard]] bool try_push(const T& value, PoolAllocator::Cache* cache = nullptr) {
+    return try_emplace(cache, value);
+  }
+  [[nodiscard]] bool try_push(T&& value, PoolAllocator::Cache* cache = nullptr) {
+    return try_emplace(cache, std::move(value));
+  }
+
+  // Consumer only.
+  [[nodiscard]] bool try_pop(T& value, PoolAllocator::Cache* cache = nullptr) {
+    Hook* hook = queue_.Pop();
+    if (hook == nullptr) return false;
+    Node* node = static_cast<Node*>(hook);
+    value = std::move(node->value);
+    Free(node, cache);
+    return true;
+  }
+
+  // Consumer only.
+  bool empty() const { return queue_.empty(); }
+
+ private:
+  struct Node : Hook {
+    T value;
+  };
+
+  void Free(Node* node, PoolAllocator::Cache* cache) {
+    node->~Node();
+    if (cache != nullptr) {
+      cache->Free(node);
+    } else {
+      pool_->Free(node);
+    }
+  }
+
+  IntrusiveQueue queue_;
+  OffsetPtr<PoolAllocator> pool_;
+};
+
+}  // namespace mpsc
+}  // namespace sham
@@ -0,0 +1,260 @@
+/*
+MIT License - Copyright (c) 2023 Pierric Gimmig
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+
+#include "sham/epoch.h"
+#include "sham/offset_ptr.h"
+#include "sham/pool_allocator.h"
+#include "sham/shared_memory_buffer.h"
+
+namespace sham {
+namespace mpmc {
+namespace internal {
+
+template <typename T>
+struct SegmentSlot {
+  std::atomic<uint32_t> state;
+  T value;
+};
+
+// As many slots as fit in the largest pool block, after the three cache lines of indices.
+template <typename T>
+inline constexpr size_t kDefaultSegmentSize =
+    (PoolAllocator::kMaxBlockSize - 3 * 64) / sizeof(SegmentSlot<T>);
+
+}  // namespace internal
+
+// Unbounded multi-producer multi-consumer queue made of linked segments of kSegmentSize slots, in
+// the style of the FAA array queue of Ramalhete and Correia. Memory grows with bursts and shrinks
+// back as the queue drains, instead of being reserved for the worst case like mpmc::Queue.
+//
+// Producers and consumers claim slots of the tail and head segments with a single fetch_add, then
+// exchange the state of their slot. A consumer that reaches a slot before its producer marks it as
+// taken, and the producer claims another slot. Only the thread filling the last slot of a segment
+// takes the slow path, which links a new segment. Segments are allocated from a PoolAllocator,
+// linked by offsets, and returned to the pool once drained and no thread of any process can still
+// access them, which is tracked by an EpochDomain owned by the queue.
+//
+// Threads access the queue through a Handle, which registers with the queue's EpochDomain and
+// caches pool blocks. The queue and its pool must live in the same SharedMemoryBuffer. T must be
+// trivially copyable.
+//
+// Example:
+//   auto* pool = buffer.Allocate<sham::PoolAllocator>(buffer, 256 * 1024 * 1024);
+//   auto* queue = buffer.Allocate<sham::mpmc::SegmentedQueue<Order>>(buffer, *pool);
+//   sham::mpmc::SegmentedQueue<Order>::Handle handle(*queue);  // One per thread.
+//   handle.try_push(order);
+//   handle.try_pop(order);
+template <typename T, size_t kSegmentSize = internal::kDefaultSegmentSize<T>>
+class SegmentedQueue {
+ public:
+  static_assert(std::is_trivially_copyable_v<T>);
+
+  class Handle;
+
+  // Allocates the EpochDomain of the queue, for up to `max_threads` handles at a time, in `buffer`,
+  // and the first segment in `pool`. The queue isn't valid() if either is full.
+  SegmentedQueue(SharedMemoryBuffer& buffer, PoolAllocator& pool, size_t max_threads = 256)
+      : pool_(&pool) {
+    EpochDomain* epochs = buffer.Allocate<EpochDomain>(buffer, max_threads);
+    if (epochs == nullptr || epochs->capacity() == 0) return;
+    void* memory = pool.Allocate(sizeof(Segment));
+    if (memory == nullptr) return;
+    int64_t segment = Offset(new (memory) Segment());
+    head_.store(segment, std::memory_order_relaxed);
+    tail_.store(segment, std::memory_order_relaxed);
+    epochs_ = epochs;
+  }
+
+  SegmentedQueue(const SegmentedQueue&) = delete;
+  SegmentedQueue& operator=(const SegmentedQueue&) = delete;
+
+  bool valid() const { return epochs_ != nullptr; }
+
+  // Approximate when called concurrently with other operations.
+  bool empty() const {
+    const Segment* head = At(head_.load(std::memory_order_acquire));
+    return head->dequeue_index.load(std::memory_order_relaxed) >=
+               head->enqueue_index.load(std::memory_order_relaxed) &&
+           head->next.load(std::memory_order_acquire) == kNull;
+  }
+
+ private:
+  enum SlotState : uint32_t { kEmpty, kFull, kTaken };
+  enum class Result { kDone, kRetry, kEmpty, kOutOfMemory };
+  // Offsets of segments are never 0, which is the queue itself.
+  static constexpr int64_t kNull = 0;
+
+  using Slot = internal::SegmentSlot<T>;
+
+  struct Segment {
+    Segment() {
+      for (Slot& slot : slots) slot.state.store(kEmpty, std::memory_order_relaxed);
+    }
+
+    alignas(64) std::atomic<int64_t> enqueue_index = 0;
+    alignas(64) std::atomic<int64_t> dequeue_index = 0;
+    alignas(64) std::atomic<int64_t> next = kNull;
+    alignas(64) Slot slots[kSegmentSize];
+  };
+  static_assert(sizeof(Segment) <= PoolAllocator::kMaxBlockSize,
+                "Segments must fit in a block of the pool, reduce kSegmentSize");
+
+  int64_t Offset(const Segment* segment) const {
+    return reinterpret_cast<const uint8_t*>(segment) - reinterpret_cast<const uint8_t*>(this);
+  }
+  Segment* At(int64_t offset) const {
+    return reinterpret_cast<Segment*>(const_cast<uint8_t*>(reinterpret_cast<const uint8_t*>(this)) +
+                                      offset);
+  }
+
+  // Single attempt, in a critical section of the queue's EpochDomain.
+  Result TryPush(const T& value, PoolAllocator::Cache& cache) {
+    int64_t tail_offset = tail_.load(std::memory_order_acquire);
+    Segment* tail = At(tail_offset);
+    int64_t index = tail->enqueue_index.fetch_add(1, std::memory_order_relaxed);
+    if (index < static_cast<int64_t>(kSegmentSize)) {
+      Slot& slot = tail->slots[index];
+      slot.value = value;
+      return slot.state.exchange(kFull, std::memory_order_acq_rel) == kEmpty ? Result::kDone
+                                                                             : Result::kRetry;
+    }
+    // The tail segment is full, link a new one holding `value` unless another thread did.
+    if (tail_offset != tail_.load(std::memory_order_acquire)) return Result::kRetry;
+    int64_t next = tail->next.load(std::memory_order_acquire);
+    if (next == kNull) {
+      void* memory = cache.Allocate(sizeof(Segment));
+      if (memory == nullptr) return Result::kOutOfMemory;
+      Segment* segment = new (memory) Segment();
+      segment->slots[0].value = value;
+      segment->slots[0].state.store(kFull, std::memory_order_relaxed);
+      segment->enqueue_index.store(1, std::memory_order_relaxed);
+      if (tail->next.compare_exchange_strong(next, Offset(segment), std::memory_order_acq_rel,
+                                             std::memory_order_acquire)) {
+        tail_.compare_exchange_strong(tail_offset, Offset(segment), std::memory_order_acq_rel);
+        return Result::kDone;
+      }
+      cache.Free(segment);
+    }
+    tail_.compare_exchange_strong(tail_offset, next, std::memory_order_acq_rel);
+    return Result::kRetry;
+  }
+
+  // Single attempt, in a critical section of the queue's EpochDomain. Sets `retired` to the head
+  // segment if this thread unlinked it.
+  Result TryPop(T& value, int64_t& retired) {
+    int64_t head_offset = head_.load(std::memory_order_acquire);
+    Segment* head = At(head_offset);
+    if (head->dequeue_index.load(std::memory_order_relaxed) >=
+            head->enqueue_index.load(std::memory_order_relaxed) &&
+        head->next.load(std::memory_order_acquire) == kNull) {
+      return Result::kEmpty;
+    }
+    int64_t index = head->dequeue_index.fetch_add(1, std::memory_order_relaxed);
+    if (index < static_cast<int64_t>(kSegmentSize)) {
+      Slot& slot = head->slots[index];
+      if (slot.state.exchange(kTaken, std::memory_order_acq_rel) != kFull) return Result::kRetry;
+      value = slot.value;
+      return Result::kDone;
+    }
+    // The head segment is drained, move to the next one.
+    int64_t next = head->next.load(std::memory_order_acquire);
+    if (next == kNull) return Result::kEmpty;
+    // The tail can lag behind when the thread that linked `next` hasn't moved it yet. The segment
+    // must be unreachable from the tail too before it is retired.
+    int64_t tail_offset = head_offset;
+    tail_.compare_exchange_strong(tail_offset, next, std::memory_order_acq_rel);
+    if (head_.compare_exchange_strong(head_offset, next, std::memory_order_acq_rel)) {
+      retired = head_offset;
+    }
+    return Result::kRetry;
+  }
+
+  void FreeSegment(uint64_t offset, PoolAllocator::Cache& cache) {
+    cache.Free(At(static_cast<int64_t>(offset)));
+  }
+
+  // Offsets of the first and last segments.
+  alignas(64) std::atomic<int64_t> head_ = kNull;
+  alignas(64) std::atomic<int64_t> tail_ = kNull;
+  alignas(64) OffsetPtr<PoolAllocator> pool_;
+  OffsetPtr<EpochDomain> epochs_;
+};
+
+// Access to a SegmentedQueue by one thread.
+template <typename T, size_t kSegmentSize>
+class SegmentedQueue<T, kSegmentSize>::Handle {
+ public:
+  // Not valid() if the queue's EpochDomain has no free record.
+  explicit Handle(SegmentedQueue& queue)
+      : queue_(&queue), participant_(*queue.epochs_), cache_(*queue.pool_) {}
+
+  Handle(const Handle&) = delete;
+  Handle& operator=(const Handle&) = delete;
+
+  bool valid() const { return participant_.valid(); }
+
+  // Returns false only if the pool is out of memory for a new segment.
+  [[nodiscard]] bool try_push(const T& value) {
+    while (true) {
+      Result result;
+      {
+        EpochGuard guard(participant_);
+        result = queue_->TryPush(value, cache_);
+      }
+      if (result != Result::kRetry) return result == Result::kDone;
+    }
+  }
+
+  [[nodiscard]] bool try_pop(T& value) {
+    while (true) {
+      Result result;
+      int64_t retired = kNull;
+      {
+        EpochGuard guard(participant_);
+        result = queue_->TryPop(value, retired);
+      }
+      // Out of the critical section, so that Retire() can wait for the epoch to advance.
+      if (retired != kNull) {
+        (void)participant_.Retire(retired, [this](uint64_t segment) {
+          queue_->FreeSegment(segment, cache_);
+        });
+      }
+      if (result != Result::kRetry) return result == Result::kDone;
+    }
+  }
+
+ private:
+  SegmentedQueue* queue_;
+  EpochDomain::Participant participant_;
+  PoolAllocator::Cache cache_;
+};
+
+}  // namespace mpmc
+}  // namespace sham
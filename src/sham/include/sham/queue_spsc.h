@@ -30,6 +30,8 @@ SOFTWARE.
 #include <stdexcept>
 #include <type_traits>  // std::enable_if, std::is_*_constructible
 
+#include "sham/shared_memory.h"
+
 namespace sham {
 
 // NOTE: This is a copy of https://github.com/rigtorp/SPSCQueue, with the following modifications
@@ -37,6 +39,9 @@ namespace sham {
 //  - Removed allocations for internal slots in favor of in-place array to avoid pointers in
 //  different address spaces.
 //  - Removed the capacity_ member variable in favor of kCapacity template argument.
+//  - Slots live in raw storage so that constructing the queue does not touch them and zero-filled
+//  memory is a valid empty queue.
+//  - Added release_unused_memory() and resident_size() to reclaim the memory of idle queues.
 template <typename T, size_t kCapacity>
 class SPSCQueue {
  public:
@@ -70,7 +75,7 @@ class SPSCQueue {
     while (nextWriteIdx == readIdxCache_) {
       readIdxCache_ = readIdx_.load(std::memory_order_acquire);
     }
-    new (&slots_[writeIdx + kPadding]) T(std::forward<Args>(args)...);
+    new (slot(writeIdx)) T(std::forward<Args>(args)...);
     writeIdx_.store(nextWriteIdx, std::memory_order_release);
   }
 
@@ -90,7 +95,7 @@ class SPSCQueue {
         return false;
       }
     }
-    new (&slots_[writeIdx + kPadding]) T(std::forward<Args>(args)...);
+    new (slot(writeIdx)) T(std::forward<Args>(args)...);
     writeIdx_.store(nextWriteIdx, std::memory_order_release);
     return true;
   }
@@ -126,14 +131,14 @@ class SPSCQueue {
         return nullptr;
       }
     }
-    return &slots_[readIdx + kPadding];
+    return slot(readIdx);
   }
 
   void pop() noexcept {
     static_assert(std::is_nothrow_destructible<T>::value, "T must be nothrow destructible");
     auto const readIdx = readIdx_.load(std::memory_order_relaxed);
     assert(writeIdx_.load(std::memory_order_acquire) != readIdx);
-    slots_[readIdx + kPadding].~T();
+    slot(readIdx)->~T();
     auto nextReadIdx = readIdx + 1;
     if (nextReadIdx == kInternalCapacity) {
       nextReadIdx = 0;
@@ -156,6 +161,28 @@ class SPSCQueue {
 
   [[nodiscard]] size_t capacity() const noexcept { return kCapacity; }
 
+  // Returns the memory of the slots to the OS, see ReleaseMemory(), and rewinds the queue to its
+  // initial state, in which the slots are only committed again as the queue fills up. The queue
+  // must be in shared memory or in private anonymous memory, it must be empty, and neither the
+  // producer nor the consumer may use it during the call. Returns false, leaving the queue
+  // untouched, if the queue isn't empty or the memory can't be released.
+  bool release_unused_memory() noexcept {
+    auto const writeIdx = writeIdx_.load(std::memory_order_acquire);
+    if (writeIdx != readIdx_.load(std::memory_order_acquire)) return false;
+    if (!ReleaseMemory(slots_, sizeof(slots_))) return false;
+    writeIdx_.store(0, std::memory_order_relaxed);
+    readIdx_.store(0, std::memory_order_relaxed);
+    readIdxCache_ = 0;
+    writeIdxCache_ = 0;
+    std::atomic_thread_fence(std::memory_order_release);
+    return true;
+  }
+
+  // Returns the number of bytes of the queue resident in memory.
+  [[nodiscard]] size_t resident_size() const noexcept {
+    return GetResidentSize(this, sizeof(*this));
+  }
+
  private:
 #ifdef __cpp_lib_hardware_interference_size
   static constexpr size_t kCacheLineSize = std::hardware_destructive_interference_size;
@@ -168,8 +195,10 @@ class SPSCQueue {
   // The queue needs one slack element
   static constexpr size_t kInternalCapacity = kCapacity + 1;
 
+  T* slot(size_t idx) noexcept { return reinterpret_cast<T*>(slots_) + idx + kPadding; }
+
  private:
-  T slots_[kInternalCapacity];
+  alignas(T) std::byte slots_[sizeof(T) * (kInternalCapacity + 2 * kPadding)];
 
   // Align to cache line size in order to avoid false sharing
   // readIdxCache_ and writeIdxCache_ is used to reduce the amount of cache
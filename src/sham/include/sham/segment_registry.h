@@ -0,0 +1,294 @@
+/*
+MIT License - Copyright (c) 2023 Pierric Gimmig
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "sham/process.h"
+#include "sham/shared_memory.h"
+
+namespace sham {
+
+// A segment recorded in a SegmentRegistry.
+struct SegmentInfo {
+  std::string name;
+  // Size of the segment and memory it actually uses, as of the call to SegmentRegistry::List(). The
+  // size is the one at registration if the segment can't be opened anymore.
+  size_t size = 0;
+  size_t allocated_size = 0;
+  uint32_t creator_pid = 0;
+  // Seconds since the epoch.
+  int64_t creation_time = 0;
+  // Processes mapping the segment, including its creator, running or not.
+  std::vector<uint32_t> pids;
+  // True if none of the processes mapping the segment is running anymore.
+  bool orphaned = false;
+};
+
+// Table of the named shared memory segments of a machine, itself stored in a shared memory segment
+// that outlives the processes using it. It records who created each segment, when, and which
+// processes map it, so that segments leaked by crashed processes can be found and reclaimed, see
+// ReclaimOrphans(). Segments created with SharedMemoryBufferOptions::registry are registered and
+// unregistered automatically. All operations are lock-free and safe between processes.
+class SegmentRegistry {
+ public:
+  static constexpr const char* kDefaultName = "sham_registry";
+  static constexpr size_t kMaxSegments = 1024;
+  static constexpr size_t kMaxProcessesPerSegment = 16;
+  static constexpr size_t kMaxNameSize = 63;
+
+  // Opens the registry called `name`, creating it if needed.
+  explicit SegmentRegistry(std::string_view name = kDefaultName)
+      : handle_(sham::OpenOrCreateFileMapping(name, sizeof(Table))) {
+    if (handle_ == kInvalidFileHandle) return;
+    if (sham::GetFileMappingSize(handle_) == sizeof(Table)) {
+      table_ = reinterpret_cast<Table*>(sham::MapViewOfFile(handle_, sizeof(Table)));
+    }
+  }
+
+  ~SegmentRegistry() {
+    sham::UnMapViewOfFile(reinterpret_cast<uint8_t*>(table_), sizeof(Table));
+    sham::CloseFileMapping(handle_);
+  }
+
+  SegmentRegistry(const SegmentRegistry&) = delete;
+  SegmentRegistry& operator=(const SegmentRegistry&) = delete;
+
+  // Removes the registry called `name`. Processes that opened it keep using their copy.
+  static bool Destroy(std::string_view name = kDefaultName) {
+    return sham::UnlinkFileMapping(name);
+  }
+
+  // Records the segment `segment_name` of `size` bytes as created and mapped by this process.
+  // Replaces the record of a previous segment of the same name. Returns false if the registry is
+  // full or the name is longer than kMaxNameSize.
+  bool Register(std::string_view segment_name, size_t size) {
+    if (!valid() || segment_name.size() > kMaxNameSize) return false;
+    Entry* entry = Find(segment_name);
+    if (entry == nullptr || !Lock(entry, Entry::kReady)) {
+      entry = nullptr;
+      for (Entry& free_entry : table_->entries) {
+        if (Lock(&free_entry, Entry::kFree)) {
+          entry = &free_entry;
+          break;
+        }
+      }
+      if (entry == nullptr) return false;
+    }
+    uint64_t process = CurrentProcessInstance();
+    entry->name_size = static_cast<uint32_t>(segment_name.size());
+    std::memcpy(entry->name, segment_name.data(), segment_name.size());
+    entry->size = size;
+    entry->creation_time = std::chrono::duration_cast<std::chrono::seconds>(
+                               std::chrono::system_clock::now().time_since_epoch())
+                               .count();
+    entry->creator = process;
+    entry->processes[0] = process;
+    for (size_t i = 1; i < kMaxProcessesPerSegment; ++i) entry->processes[i] = 0;
+    Unlock(entry, Entry::kReady);
+    return true;
+  }
+
+  // Removes the record of segment `segment_name`, e.g. when its creator destroys it.
+  bool Unregister(std::string_view segment_name) {
+    Entry* entry = Find(segment_name);
+    if (entry == nullptr || !Lock(entry, Entry::kReady)) return false;
+    Free(entry);
+    return true;
+  }
+
+  // Records that this process maps segment `segment_name`. Returns false if the segment isn't
+  // registered, or if kMaxProcessesPerSegment processes already map it, in which case this process
+  // doesn't prevent the segment from being reclaimed if the others die.
+  bool Attach(std::string_view segment_name) {
+    Entry* entry = Find(segment_name);
+    if (entry == nullptr) return false;
+    uint64_t process = CurrentProcessInstance();
+    for (std::atomic<uint64_t>& slot : entry->processes) {
+      uint64_t expected = 0;
+      if (!slot.compare_exchange_strong(expected, process)) continue;
+      // The segment could have been reclaimed or replaced since it was found.
+      if (entry->state.load() == Entry::kReady && entry->name_view() == segment_name) return true;
+      slot.store(0);
+      return false;
+    }
+    return false;
+  }
+
+  // Removes this process from the processes mapping segment `segment_name`.
+  bool Detach(std::string_view segment_name) {
+    Entry* entry = Find(segment_name);
+    if (entry == nullptr) return false;
+    uint64_t process = CurrentProcessInstance();
+    for (std::atomic<uint64_t>& slot : entry->processes) {
+      uint64_t expected = process;
+      if (slot.compare_exchange_strong(expected, 0)) return true;
+    }
+    return false;
+  }
+
+  // Returns the registered segments.
+  std::vector<SegmentInfo> List() const {
+    std::vector<SegmentInfo> segments;
+    if (!valid()) return segments;
+    for (const Entry& entry : table_->entries) {
+      if (entry.state.load() != Entry::kReady) continue;
+      SegmentInfo info;
+      info.name = entry.name_view();
+      info.size = entry.size;
+      info.creator_pid = ProcessInstancePid(entry.creator);
+      info.creation_time = entry.creation_time;
+      info.orphaned = true;
+      for (const std::atomic<uint64_t>& slot : entry.processes) {
+        uint64_t process = slot.load();
+        if (process == 0) continue;
+        info.pids.push_back(ProcessInstancePid(process));
+        if (IsProcessInstanceAlive(process)) info.orphaned = false;
+      }
+      // The entry could have been freed or replaced while being read.
+      if (entry.state.load() != Entry::kReady || entry.name_view() != info.name) continue;
+      FileHandle handle = sham::TryOpenFileMapping(info.name);
+      if (handle != kInvalidFileHandle) {
+        info.size = sham::GetFileMappingSize(handle);
+        info.allocated_size = sham::GetFileMappingAllocatedSize(handle);
+        sham::CloseFileMapping(handle);
+      }
+      segments.push_back(std::move(info));
+    }
+    return segments;
+  }
+
+  // Unlinks the segments none of whose processes is running anymore, and forgets dead processes
+  // of the other segments. Entries left locked by a process that died while modifying them are
+  // freed, without unlinking their segment, whose name may be partly written. Returns the names of
+  // the unlinked segments.
+  std::vector<std::string> ReclaimOrphans() {
+    std::vector<std::string> reclaimed;
+    if (!valid()) return reclaimed;
+    for (Entry& entry : table_->entries) {
+      uint64_t locker = entry.locker.load();
+      if (locker != 0 && !IsProcessInstanceAlive(locker) &&
+          entry.locker.compare_exchange_strong(locker, CurrentProcessInstance())) {
+        if (entry.state.load() == Entry::kLocked) {
+          Free(&entry);
+          continue;
+        }
+        // The locker died before changing the state, or after restoring it.
+        entry.locker.store(0);
+      }
+      if (entry.state.load() != Entry::kReady) continue;
+      bool orphaned = true;
+      for (std::atomic<uint64_t>& slot : entry.processes) {
+        uint64_t process = slot.load();
+        if (process == 0) continue;
+        if (IsProcessInstanceAlive(process)) {
+          orphaned = false;
+        } else {
+          slot.compare_exchange_strong(process, 0);
+        }
+      }
+      if (!orphaned || !Lock(&entry, Entry::kReady)) continue;
+      // A process could have attached before the entry was locked, processes attaching after it
+      // see that it is locked and give up.
+      bool attached = false;
+      for (std::atomic<uint64_t>& slot : entry.processes) attached |= slot.load() != 0;
+      if (attached) {
+        Unlock(&entry, Entry::kReady);
+        continue;
+      }
+      std::string name(entry.name_view());
+      sham::UnlinkFileMapping(name);
+      reclaimed.push_back(std::move(name));
+      Free(&entry);
+    }
+    return reclaimed;
+  }
+
+  bool valid() const { return table_ != nullptr; }
+
+ private:
+  struct alignas(64) Entry {
+    // Only the process that moved an entry to kLocked, its locker, modifies it.
+    enum State : uint32_t { kFree, kLocked, kReady };
+
+    std::string_view name_view() const { return std::string_view(name, name_size); }
+
+    std::atomic<uint32_t> state;
+    uint32_t name_size;
+    uint64_t size;
+    int64_t creation_time;
+    uint64_t creator;
+    char name[kMaxNameSize + 1];
+    std::atomic<uint64_t> processes[kMaxProcessesPerSegment];
+    // Process holding or taking the lock, 0 if none. Set before the state, so that an entry locked
+    // by a process that died can be recovered.
+    std::atomic<uint64_t> locker;
+  };
+
+  // Zero-filled memory is an empty registry.
+  struct Table {
+    Entry entries[kMaxSegments];
+  };
+
+  static_assert(sizeof(Entry) == 256);
+
+  // Locks an entry in state `state`.
+  static bool Lock(Entry* entry, uint32_t state) {
+    if (entry->state.load() != state) return false;
+    uint64_t none = 0;
+    if (!entry->locker.compare_exchange_strong(none, CurrentProcessInstance())) return false;
+    if (entry->state.compare_exchange_strong(state, Entry::kLocked)) return true;
+    entry->locker.store(0);
+    return false;
+  }
+
+  static void Unlock(Entry* entry, uint32_t state) {
+    entry->state.store(state);
+    entry->locker.store(0);
+  }
+
+  static void Free(Entry* entry) {
+    entry->name_size = 0;
+    for (std::atomic<uint64_t>& slot : entry->processes) slot.store(0);
+    Unlock(entry, Entry::kFree);
+  }
+
+  Entry* Find(std::string_view segment_name) const {
+    if (!valid()) return nullptr;
+    for (Entry& entry : table_->entries) {
+      if (entry.state.load() == Entry::kReady && entry.name_view() == segment_name) return &entry;
+    }
+    return nullptr;
+  }
+
+  FileHandle handle_ = kInvalidFileHandle;
+  Table* table_ = nullptr;
+};
+
+}  // namespace sham
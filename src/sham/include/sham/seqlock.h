@@ -0,0 +1,149 @@
+/*
+MIT License - Copyright (c) 2023 Pierric Gimmig
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <type_traits>
+
+#include "sham/offset_ptr.h"
+#include "sham/shared_memory_buffer.h"
+
+namespace sham {
+
+// Latest value of a T, e.g. the top of book of a symbol or the current risk limits, published by
+// one writer to any number of readers in any process. Unlike a queue, readers only ever see the
+// newest value and a slow reader never holds back the writer.
+//
+// Writes are wait-free: a sequence number is made odd, the value copied in, then the sequence
+// number made even again. Readers copy the value out and retry if the sequence number was odd or
+// changed during the copy, so they never block the writer and never return a torn value, but can
+// starve if the value is rewritten faster than it can be copied. Keep T small and trivially
+// copyable.
+//
+// Only one thread may write at a time, concurrent writers must be serialized by the caller. Cells
+// are aligned on cache lines so that neighbouring cells never share one, the sequence number and
+// the first bytes of the value share the first line. Zero-filled memory is a valid cell holding a
+// zero-filled T.
+//
+// Example:
+//   auto* limits = buffer.FindOrConstruct<sham::SeqLock<RiskLimits>>("risk_limits");
+//   limits->Store(new_limits);             // Writer process.
+//   RiskLimits current = limits->Load();  // Reader processes.
+template <typename T>
+class alignas(64) SeqLock {
+ public:
+  static_assert(std::is_trivially_copyable_v<T>);
+
+  SeqLock() = default;
+  explicit SeqLock(const T& value) : value_(value) {}
+
+  SeqLock(const SeqLock&) = delete;
+  SeqLock& operator=(const SeqLock&) = delete;
+
+  void Store(const T& value) {
+    Update([&value](T& current) { std::memcpy(&current, &value, sizeof(T)); });
+  }
+
+  // Modifies the value in place with `update(T&)`, e.g. to change a few fields of a large T.
+  // Readers retry until `update` returns.
+  template <typename UpdateFn>
+  void Update(UpdateFn&& update) {
+    uint64_t sequence = sequence_.load(std::memory_order_relaxed);
+    sequence_.store(sequence + 1, std::memory_order_relaxed);
+    // Orders the odd sequence number before the writes to the value.
+    std::atomic_thread_fence(std::memory_order_release);
+    update(value_);
+    sequence_.store(sequence + 2, std::memory_order_release);
+  }
+
+  T Load() const {
+    T value;
+    while (!TryLoad(&value)) {
+    }
+    return value;
+  }
+
+  // Single attempt at reading the value, fails if a write is in progress or completed meanwhile.
+  bool TryLoad(T* value) const {
+    uint64_t sequence = sequence_.load(std::memory_order_acquire);
+    if (sequence & 1) return false;
+    std::memcpy(value, &value_, sizeof(T));
+    // Orders the reads of the value before the second read of the sequence number.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return sequence_.load(std::memory_order_relaxed) == sequence;
+  }
+
+  // Number of completed writes. A reader polls it to learn whether the value changed since its
+  // last Load() without copying the value.
+  uint64_t version() const { return sequence_.load(std::memory_order_acquire) / 2; }
+
+ private:
+  std::atomic<uint64_t> sequence_ = 0;
+  T value_{};
+};
+
+// Fixed number of SeqLock<T> cells, e.g. one per symbol, allocated in a shared memory buffer. Each
+// cell is written and read independently, see SeqLock. The array must live in the same
+// SharedMemoryBuffer as its cells.
+//
+// Example:
+//   auto* books = buffer.Allocate<sham::SeqLockArray<TopOfBook>>(buffer, kNumSymbols);
+//   books->Store(symbol_id, book);
+//   TopOfBook book = books->Load(symbol_id);
+template <typename T>
+class SeqLockArray {
+ public:
+  using Cell = SeqLock<T>;
+
+  // Allocates `size` cells in `buffer`. The size is 0 if the buffer is full.
+  SeqLockArray(SharedMemoryBuffer& buffer, size_t size) {
+    uint8_t* cells = buffer.Allocate(size * sizeof(Cell), alignof(Cell));
+    if (cells == nullptr) return;
+    cells_ = reinterpret_cast<Cell*>(cells);
+    for (size_t i = 0; i < size; ++i) new (&cells_[i]) Cell();
+    size_ = size;
+  }
+
+  SeqLockArray(const SeqLockArray&) = delete;
+  SeqLockArray& operator=(const SeqLockArray&) = delete;
+
+  void Store(size_t index, const T& value) { cells_[index].Store(value); }
+  T Load(size_t index) const { return cells_[index].Load(); }
+  bool TryLoad(size_t index, T* value) const { return cells_[index].TryLoad(value); }
+
+  Cell& operator[](size_t index) { return cells_[index]; }
+  const Cell& operator[](size_t index) const { return cells_[index]; }
+
+  size_t size() const { return size_; }
+
+ private:
+  OffsetPtr<Cell> cells_;
+  size_t size_ = 0;
+};
+
+}  // namespace sham
@@ -0,0 +1,241 @@
+/*
+MIT License - Copyright (c) 2023 Pierric Gimmig
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <limits>
+#include <optional>
+#include <thread>
+
+namespace sham {
+
+// Pre-allocated ring of events processed in place by a pipeline of stages, in the style of the LMAX
+// Disruptor. A single producer claims and publishes events, and each stage tracks how far it has
+// processed them with its own cursor. A stage only processes the events that all of its upstream
+// stages, or the producer if it has none, have released, and the producer only reuses the slots of
+// events released by all the stages without downstream stages. Stages thus form a dependency graph
+// over a single copy of each event, e.g. decode -> enrich -> (risk, persist) -> publish, instead of
+// copying events from one queue to the next.
+//
+// Producers claim, and stages consume, batches of events: a single load of the upstream cursors and
+// a single store of their own cursor per batch. Handles cache the cursors they depend on, so that
+// they only read them again once they have caught up.
+//
+// Stages are added before the producer starts, and then attached to by one thread each through a
+// Stage handle. The ring can live in shared memory, with stages in different processes.
+//
+// Example:
+//   using Ring = sham::SequencedRing<Order, 4096>;
+//   auto* ring = buffer.Allocate<Ring>();
+//   int enrich = *ring->AddStage();
+//   int risk = *ring->AddStage({enrich});
+//   int persist = *ring->AddStage({enrich});
+//   int publish = *ring->AddStage({risk, persist});
+//
+//   // Producer thread.
+//   Ring::Producer producer(*ring);
+//   int64_t first = producer.Claim(16);
+//   for (int64_t i = first; i < first + 16; ++i) Decode(producer[i]);
+//   producer.Publish();
+//
+//   // Risk thread.
+//   Ring::Stage stage(*ring, risk);
+//   stage.Consume([](Order& order, int64_t sequence) { order.risk_checked = Check(order); });
+template <typename T, size_t kCapacity, size_t kMaxStages = 16>
+class SequencedRing {
+ public:
+  static_assert(std::has_single_bit(kCapacity), "kCapacity must be a power of 2");
+  static_assert(kMaxStages <= 32);
+
+  class Producer;
+  class Stage;
+
+  SequencedRing() = default;
+  SequencedRing(const SequencedRing&) = delete;
+  SequencedRing& operator=(const SequencedRing&) = delete;
+
+  // Adds a stage that processes events after the `upstream` stages, or after the producer if the
+  // list is empty. Returns the id of the stage, or std::nullopt if there are already kMaxStages
+  // stages or an upstream stage doesn't exist. Stages can only depend on stages added before them.
+  std::optional<int> AddStage(std::initializer_list<int> upstream = {}) {
+    int id = num_stages_.load(std::memory_order_relaxed);
+    if (id == static_cast<int>(kMaxStages)) return std::nullopt;
+    uint32_t upstream_mask = 0;
+    for (int stage : upstream) {
+      if (stage < 0 || stage >= id) return std::nullopt;
+      upstream_mask |= 1u << stage;
+    }
+    stages_[id].upstream_mask = upstream_mask;
+    stages_[id].cursor.store(cursor_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    uint32_t terminal_mask = terminal_mask_.load(std::memory_order_relaxed);
+    terminal_mask_.store((terminal_mask & ~upstream_mask) | (1u << id), std::memory_order_relaxed);
+    num_stages_.store(id + 1, std::memory_order_release);
+    return id;
+  }
+
+  int num_stages() const { return num_stages_.load(std::memory_order_acquire); }
+  static constexpr size_t capacity() { return kCapacity; }
+
+  // Number of events published by the producer.
+  int64_t cursor() const { return cursor_.load(std::memory_order_acquire); }
+  // Number of events released by `stage`.
+  int64_t cursor(int stage) const { return stages_[stage].cursor.load(std::memory_order_acquire); }
+
+ private:
+  static constexpr int64_t kMask = kCapacity - 1;
+
+  struct alignas(64) StageState {
+    std::atomic<int64_t> cursor = 0;
+    uint32_t upstream_mask = 0;
+  };
+
+  // Minimum of the cursors of the stages in `mask`, or `none` if the mask is empty.
+  int64_t MinCursor(uint32_t mask, int64_t none) const {
+    int64_t min = std::numeric_limits<int64_t>::max();
+    for (; mask != 0; mask &= mask - 1) {
+      min = std::min(min, stages_[std::countr_zero(mask)].cursor.load(std::memory_order_acquire));
+    }
+    return min == std::numeric_limits<int64_t>::max() ? none : min;
+  }
+
+  static void Backoff(int& spins) {
+    if (++spins > 64) std::this_thread::yield();
+  }
+
+  alignas(64) std::atomic<int64_t> cursor_ = 0;
+  alignas(64) std::atomic<int> num_stages_ = 0;
+  std::atomic<uint32_t> terminal_mask_ = 0;
+  StageState stages_[kMaxStages];
+  alignas(64) T events_[kCapacity];
+};
+
+// Claims, fills and publishes events. Used by a single thread.
+template <typename T, size_t kCapacity, size_t kMaxStages>
+class SequencedRing<T, kCapacity, kMaxStages>::Producer {
+ public:
+  explicit Producer(SequencedRing& ring)
+      : ring_(&ring),
+        terminal_mask_(ring.terminal_mask_.load(std::memory_order_acquire)),
+        next_(ring.cursor_.load(std::memory_order_relaxed)),
+        released_(next_) {}
+
+  // Claims the next `n` events, waiting until they have been released by all the stages. Returns
+  // the sequence number of the first one. `n` must not exceed kCapacity.
+  int64_t Claim(size_t n = 1) {
+    std::optional<int64_t> first;
+    for (int spins = 0; !(first = TryClaim(n)).has_value();) Backoff(spins);
+    return *first;
+  }
+
+  // Returns std::nullopt if the `n` events haven't all been released yet.
+  std::optional<int64_t> TryClaim(size_t n = 1) {
+    int64_t end = next_ + static_cast<int64_t>(n);
+    if (end - released_ > static_cast<int64_t>(kCapacity)) {
+      released_ = ring_->MinCursor(terminal_mask_, next_);
+      if (end - released_ > static_cast<int64_t>(kCapacity)) return std::nullopt;
+    }
+    int64_t first = next_;
+    next_ = end;
+    return first;
+  }
+
+  // The event with sequence number `sequence`, which must have been claimed and not published.
+  T& operator[](int64_t sequence) { return ring_->events_[sequence & kMask]; }
+
+  // Makes all the claimed events available to the stages.
+  void Publish() { ring_->cursor_.store(next_, std::memory_order_release); }
+
+ private:
+  SequencedRing* ring_;
+  uint32_t terminal_mask_;
+  // Sequence number of the next event to claim.
+  int64_t next_;
+  // Cached minimum of the cursors of the terminal stages.
+  int64_t released_;
+};
+
+// Processes the events of one stage in place. Used by a single thread.
+template <typename T, size_t kCapacity, size_t kMaxStages>
+class SequencedRing<T, kCapacity, kMaxStages>::Stage {
+ public:
+  Stage(SequencedRing& ring, int id)
+      : ring_(&ring),
+        state_(&ring.stages_[id]),
+        upstream_mask_(state_->upstream_mask),
+        next_(state_->cursor.load(std::memory_order_relaxed)),
+        available_(next_) {}
+
+  // Number of events that the upstream stages have released and this stage hasn't.
+  size_t Available() {
+    if (available_ == next_) {
+      available_ = upstream_mask_ == 0 ? ring_->cursor_.load(std::memory_order_acquire)
+                                       : ring_->MinCursor(upstream_mask_, next_);
+    }
+    return static_cast<size_t>(available_ - next_);
+  }
+
+  // Calls `process(T& event, int64_t sequence)` on up to `max_batch` available events, then
+  // releases them to downstream stages. Returns the number of events processed, possibly 0.
+  template <typename ProcessFn>
+  size_t TryConsume(ProcessFn&& process, size_t max_batch = kCapacity) {
+    size_t n = std::min(Available(), max_batch);
+    if (n == 0) return 0;
+    for (int64_t sequence = next_; sequence < next_ + static_cast<int64_t>(n); ++sequence) {
+      process(ring_->events_[sequence & kMask], sequence);
+    }
+    Release(n);
+    return n;
+  }
+
+  // Same as TryConsume(), but waits for at least one event.
+  template <typename ProcessFn>
+  size_t Consume(ProcessFn&& process, size_t max_batch = kCapacity) {
+    for (int spins = 0;; Backoff(spins)) {
+      if (size_t n = TryConsume(process, max_batch)) return n;
+    }
+  }
+
+  // Access to available events for stages that release them separately, e.g. across calls.
+  int64_t next() const { return next_; }
+  T& operator[](int64_t sequence) { return ring_->events_[sequence & kMask]; }
+  void Release(size_t n) {
+    next_ += static_cast<int64_t>(n);
+    state_->cursor.store(next_, std::memory_order_release);
+  }
+
+ private:
+  SequencedRing* ring_;
+  StageState* state_;
+  uint32_t upstream_mask_;
+  // Sequence number of the next event to process.
+  int64_t next_;
+  // Cached minimum of the cursors of the upstream stages.
+  int64_t available_;
+};
+
+}  // namespace sham
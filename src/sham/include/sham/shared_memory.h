@@ -22,7 +22,15 @@ SOFTWARE.
 
 #pragma once
 
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
 #include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
 
 #ifdef _WIN32
 #include <windows.h>
@@ -46,16 +54,83 @@ using FileHandle = int;
 constexpr FileHandle kInvalidFileHandle = -1;
 #endif
 
+// Size of the transparent huge pages of x86-64 and of arm64 with 4 KiB base pages.
+constexpr size_t kHugePageSize = 2 * 1024 * 1024;
+
 // Create a new file mapping.
 inline FileHandle CreateFileMapping(std::string_view name, size_t size);
+// Create a new file mapping, or return kInvalidFileHandle without touching it if one with that
+// name exists, e.g. one still used by other processes.
+inline FileHandle CreateNewFileMapping(std::string_view name, size_t size);
 // Open a view on an existing file mapping.
 inline FileHandle OpenFileMapping(std::string_view name);
+// Open an existing file mapping without write access, e.g. to query its size. Unlike
+// OpenFileMapping(), a missing mapping isn't reported as an error.
+inline FileHandle TryOpenFileMapping(std::string_view name);
+// Open a file mapping, creating it if it doesn't exist. Unlike CreateFileMapping(), an existing
+// mapping keeps its content. It is extended with zeros if it is smaller than `size`.
+inline FileHandle OpenOrCreateFileMapping(std::string_view name, size_t size);
+// Remove the name of a file mapping, e.g. one left behind by a crashed process. Its memory is
+// released once the processes mapping it unmap it. Returns false if there is no such mapping.
+inline bool UnlinkFileMapping(std::string_view name);
 // Destroy a file mapping. Must be called by same process that called CreateFileMapping().
 inline void DestroyFileMapping(FileHandle file_handle, std::string_view name);
-// Map file into memory.
-inline uint8_t* MapViewOfFile(FileHandle file_handle, size_t size);
+// Close a handle obtained from OpenFileMapping() without destroying the file mapping.
+inline void CloseFileMapping(FileHandle file_handle);
+// Create an anonymous file mapping. It has no name that could collide or leak, and it is destroyed
+// when the last handle and view on it are closed. Other processes get access to it through its
+// handle, see SendFileHandle(). If `seal_size` is true, the size can never change afterwards so
+// peers can map it without re-validating its size. `debug_name` is only used for diagnostics.
+// Only supported on Linux, returns kInvalidFileHandle on other platforms.
+inline FileHandle CreateAnonymousFileMapping(std::string_view debug_name, size_t size,
+                                             bool seal_size);
+// Returns the size of the file mapping, or 0 if it can't be determined.
+inline size_t GetFileMappingSize(FileHandle file_handle);
+// Returns the memory actually used by the file mapping, which is smaller than its size until all
+// its pages are touched, or 0 if it can't be determined.
+inline size_t GetFileMappingAllocatedSize(FileHandle file_handle);
+// Returns true if the size of the file mapping is sealed, see CreateAnonymousFileMapping().
+inline bool IsFileMappingSizeSealed(FileHandle file_handle);
+// Create or open a file mapping backed by the regular file at `path`, so that its content survives
+// restarts. The file is extended with zeros if it is smaller than `size`.
+inline FileHandle CreatePersistentFileMapping(std::string_view path, size_t size);
+// Open an existing file mapping backed by the regular file at `path`.
+inline FileHandle OpenPersistentFileMapping(std::string_view path, bool read_only);
+// Map file into memory. Returns nullptr on failure.
+inline uint8_t* MapViewOfFile(FileHandle file_handle, size_t size, bool read_only = false);
 // Unmap file from memory.
 inline void UnMapViewOfFile(uint8_t* address, size_t size);
+// Write modified pages of [address, address + size) back to the file backing the mapping. If
+// `async` is false, waits for the writes to complete.
+inline bool FlushViewOfFile(uint8_t* address, size_t size, bool async = false);
+// Change the size of a file mapping. Views extending past the new end of a shrunk mapping must not
+// be accessed.
+inline bool ResizeFileMapping(FileHandle file_handle, size_t size);
+// Reserve `size` bytes of address space without committing any memory, so that a file mapping can
+// later be grown in place with MapViewOfFileAt(). The range starts at a multiple of `alignment`,
+// a power of 2, if it is larger than the page size. Release it with UnMapViewOfFile(). Returns
+// nullptr if not supported.
+inline uint8_t* ReserveAddressSpace(size_t size, size_t alignment = 0);
+// Ask for [address, address + size) to be backed by transparent huge pages, see kHugePageSize. For
+// shared memory, it only has an effect if /sys/kernel/mm/transparent_hugepage/shmem_enabled is
+// "advise" or "always", and only on huge pages aligned both in memory and in the file.
+inline bool AdviseHugePages(uint8_t* address, size_t size);
+// Map [offset, offset + size) of a file at `address`, in a range returned by
+// ReserveAddressSpace(). `offset` must be a multiple of the page size. Returns nullptr on failure.
+inline uint8_t* MapViewOfFileAt(FileHandle file_handle, uint8_t* address, size_t offset,
+                                size_t size, bool read_only = false);
+// Zero-fills [address, address + size) and returns the memory of the pages entirely inside it to
+// the OS, e.g. the slots of an idle queue. The range must be in shared memory, where the pages are
+// removed from the file mapping, or in private anonymous memory. Reading the range afterwards
+// returns zeros and touching it commits memory again. Returns false if the memory couldn't be
+// released, e.g. for a persistent segment on a filesystem that doesn't support holes, in which
+// case the range is left untouched.
+inline bool ReleaseMemory(void* address, size_t size);
+// Returns the number of bytes of the pages overlapping [address, address + size) that are resident
+// in memory, or 0 if it can't be determined.
+inline size_t GetResidentSize(const void* address, size_t size);
+// Size of a memory page.
+inline size_t GetPageSize();
 
 }  // namespace sham
 
@@ -71,6 +146,20 @@ sham::FileHandle sham::CreateFileMapping(std::string_view name, size_t capacity)
   return handle;
 }
 
+sham::FileHandle sham::CreateNewFileMapping(std::string_view name, size_t capacity) {
+  std::string map_name(name);
+  sham::FileHandle handle = ::CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0,
+                                                 static_cast<DWORD>(capacity), map_name.c_str());
+  if (handle != nullptr && GetLastError() == ERROR_ALREADY_EXISTS) {
+    CloseHandle(handle);
+    return kInvalidFileHandle;
+  }
+  if (handle == nullptr) {
+    std::cout << "Could not create file mapping for " << name << ":" << GetLastError() << std::endl;
+  }
+  return handle;
+}
+
 sham::FileHandle sham::OpenFileMapping(std::string_view name) {
   std::string map_name(name);
   FileHandle handle = ::OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, map_name.c_str());
@@ -81,16 +170,111 @@ sham::FileHandle sham::OpenFileMapping(std::string_view name) {
   return handle;
 }
 
+sham::FileHandle sham::TryOpenFileMapping(std::string_view name) {
+  std::string map_name(name);
+  return ::OpenFileMappingA(FILE_MAP_READ, FALSE, map_name.c_str());
+}
+
+sham::FileHandle sham::OpenOrCreateFileMapping(std::string_view name, size_t capacity) {
+  // Opens the existing mapping, with its original size, if there is one.
+  return CreateFileMapping(name, capacity);
+}
+
+// Named mappings are destroyed with their last handle, they can't leak.
+bool sham::UnlinkFileMapping(std::string_view) { return true; }
+
 void sham::DestroyFileMapping(FileHandle handle, std::string_view name) {
   if (handle) CloseHandle(handle);
 }
 
-uint8_t* sham::MapViewOfFile(FileHandle file_handle, size_t size) {
-  LPCTSTR ptr = (LPTSTR)::MapViewOfFile(file_handle, FILE_MAP_ALL_ACCESS, 0, 0, size);
+void sham::CloseFileMapping(FileHandle handle) {
+  if (handle) CloseHandle(handle);
+}
+
+sham::FileHandle sham::CreateAnonymousFileMapping(std::string_view, size_t, bool) {
+  return kInvalidFileHandle;
+}
+
+size_t sham::GetFileMappingSize(FileHandle) { return 0; }
+
+size_t sham::GetFileMappingAllocatedSize(FileHandle) { return 0; }
+
+bool sham::IsFileMappingSizeSealed(FileHandle) { return false; }
+
+sham::FileHandle sham::CreatePersistentFileMapping(std::string_view path, size_t size) {
+  std::string file_path(path);
+  HANDLE file = ::CreateFileA(file_path.c_str(), GENERIC_READ | GENERIC_WRITE,
+                              FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_ALWAYS,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    std::cout << "Could not open file " << path << ":" << GetLastError() << std::endl;
+    return kInvalidFileHandle;
+  }
+
+  // The mapping grows the file to `size` if needed and keeps it open once `file` is closed.
+  LARGE_INTEGER file_size = {};
+  GetFileSizeEx(file, &file_size);
+  uint64_t mapping_size = std::max<uint64_t>(file_size.QuadPart, size);
+  FileHandle handle =
+      ::CreateFileMappingA(file, nullptr, PAGE_READWRITE, static_cast<DWORD>(mapping_size >> 32),
+                           static_cast<DWORD>(mapping_size), nullptr);
+  if (handle == nullptr) {
+    std::cout << "Could not create file mapping for " << path << ":" << GetLastError() << std::endl;
+  }
+  CloseHandle(file);
+  return handle;
+}
+
+sham::FileHandle sham::OpenPersistentFileMapping(std::string_view path, bool read_only) {
+  std::string file_path(path);
+  DWORD access = read_only ? GENERIC_READ : GENERIC_READ | GENERIC_WRITE;
+  HANDLE file = ::CreateFileA(file_path.c_str(), access, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                              nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    std::cout << "Could not open file " << path << ":" << GetLastError() << std::endl;
+    return kInvalidFileHandle;
+  }
+
+  DWORD protection = read_only ? PAGE_READONLY : PAGE_READWRITE;
+  FileHandle handle = ::CreateFileMappingA(file, nullptr, protection, 0, 0, nullptr);
+  if (handle == nullptr) {
+    std::cout << "Could not create file mapping for " << path << ":" << GetLastError() << std::endl;
+  }
+  CloseHandle(file);
+  return handle;
+}
+
+uint8_t* sham::MapViewOfFile(FileHandle file_handle, size_t size, bool read_only) {
+  DWORD access = read_only ? FILE_MAP_READ : FILE_MAP_ALL_ACCESS;
+  LPCTSTR ptr = (LPTSTR)::MapViewOfFile(file_handle, access, 0, 0, size);
   return (uint8_t*)(ptr);
 }
 
 void sham::UnMapViewOfFile(uint8_t* address, size_t /*size*/) { UnmapViewOfFile(address); }
+
+bool sham::FlushViewOfFile(uint8_t* address, size_t size, bool /*async*/) {
+  return ::FlushViewOfFile(address, size) != 0;
+}
+
+// Growing a mapping in place would require placeholder views, it is not supported on Windows.
+bool sham::ResizeFileMapping(FileHandle, size_t) { return false; }
+
+uint8_t* sham::ReserveAddressSpace(size_t, size_t) { return nullptr; }
+
+bool sham::AdviseHugePages(uint8_t*, size_t) { return false; }
+
+uint8_t* sham::MapViewOfFileAt(FileHandle, uint8_t*, size_t, size_t, bool) { return nullptr; }
+
+// Discarded pages of a view keep their content on Windows, they are not zero-filled.
+bool sham::ReleaseMemory(void*, size_t) { return false; }
+
+size_t sham::GetResidentSize(const void*, size_t) { return 0; }
+
+size_t sham::GetPageSize() {
+  SYSTEM_INFO system_info;
+  GetSystemInfo(&system_info);
+  return system_info.dwPageSize;
+}
 #else
 sham::FileHandle sham::CreateFileMapping(std::string_view name, size_t size) {
   std::string map_name(name);
@@ -111,6 +295,26 @@ sham::FileHandle sham::CreateFileMapping(std::string_view name, size_t size) {
   return handle;
 }
 
+sham::FileHandle sham::CreateNewFileMapping(std::string_view name, size_t size) {
+  std::string map_name(name);
+  sham::FileHandle handle = shm_open(map_name.c_str(), O_RDWR | O_CREAT | O_EXCL,
+                                     S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH | S_IWOTH);
+  if (handle == -1) {
+    if (errno != EEXIST) perror("Can't create memory fd");
+    return kInvalidFileHandle;
+  }
+  // Change permission of the shared memory to make sure that non-root processes can access it.
+  if (fchmod(handle, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH | S_IWOTH) == -1) {
+    perror("Can't change permission on fd");
+  }
+  if (ftruncate(handle, size) == -1) {
+    perror("Can't truncate memory");
+    DestroyFileMapping(handle, name);
+    return kInvalidFileHandle;
+  }
+  return handle;
+}
+
 sham::FileHandle sham::OpenFileMapping(std::string_view name) {
   std::string map_name(name);
   FileHandle handle = shm_open(map_name.c_str(), O_RDWR, 0600);
@@ -120,16 +324,130 @@ sham::FileHandle sham::OpenFileMapping(std::string_view name) {
   return handle;
 }
 
+sham::FileHandle sham::TryOpenFileMapping(std::string_view name) {
+  std::string map_name(name);
+  FileHandle handle = shm_open(map_name.c_str(), O_RDONLY, 0);
+  if (handle == -1 && errno != ENOENT) perror("Can't open file descriptor");
+  return handle;
+}
+
+sham::FileHandle sham::OpenOrCreateFileMapping(std::string_view name, size_t size) {
+  std::string map_name(name);
+  sham::FileHandle handle = shm_open(map_name.c_str(), O_RDWR | O_CREAT,
+                                     S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH | S_IWOTH);
+  if (handle == -1) {
+    perror("Can't open memory fd");
+    return kInvalidFileHandle;
+  }
+
+  // Only the process that created it owns it, others can't change its permissions.
+  fchmod(handle, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH | S_IWOTH);
+
+  // Concurrent callers extend it to the same size, the content written in between is preserved.
+  if (GetFileMappingSize(handle) < size && ftruncate(handle, size) == -1) {
+    perror("Can't truncate memory");
+    close(handle);
+    return kInvalidFileHandle;
+  }
+  return handle;
+}
+
+bool sham::UnlinkFileMapping(std::string_view name) {
+  std::string map_name(name);
+  return shm_unlink(map_name.c_str()) == 0;
+}
+
 void sham::DestroyFileMapping(FileHandle handle, std::string_view name) {
   std::string map_name(name);
   if (handle != kInvalidFileHandle) shm_unlink(map_name.c_str());
+  CloseFileMapping(handle);
+}
+
+void sham::CloseFileMapping(FileHandle handle) {
+  if (handle != kInvalidFileHandle) close(handle);
+}
+
+#ifdef __linux__
+sham::FileHandle sham::CreateAnonymousFileMapping(std::string_view debug_name, size_t size,
+                                                  bool seal_size) {
+  std::string map_name(debug_name);
+  sham::FileHandle handle = memfd_create(map_name.c_str(), MFD_CLOEXEC | MFD_ALLOW_SEALING);
+  if (handle == -1) {
+    perror("Can't create anonymous memory fd");
+    return kInvalidFileHandle;
+  }
+
+  if ((ftruncate(handle, size)) == -1) {
+    perror("Can't truncate memory");
+    close(handle);
+    return kInvalidFileHandle;
+  }
+
+  if (seal_size && fcntl(handle, F_ADD_SEALS, F_SEAL_GROW | F_SEAL_SHRINK | F_SEAL_SEAL) == -1) {
+    perror("Can't seal memory fd");
+    close(handle);
+    return kInvalidFileHandle;
+  }
+  return handle;
+}
+
+bool sham::IsFileMappingSizeSealed(FileHandle file_handle) {
+  int seals = fcntl(file_handle, F_GET_SEALS);
+  return seals != -1 && (seals & F_SEAL_GROW) && (seals & F_SEAL_SHRINK);
+}
+#else
+sham::FileHandle sham::CreateAnonymousFileMapping(std::string_view, size_t, bool) {
+  return kInvalidFileHandle;
+}
+
+bool sham::IsFileMappingSizeSealed(FileHandle) { return false; }
+#endif
+
+size_t sham::GetFileMappingSize(FileHandle file_handle) {
+  struct stat file_stat;
+  if (fstat(file_handle, &file_stat) == -1) return 0;
+  return static_cast<size_t>(file_stat.st_size);
+}
+
+size_t sham::GetFileMappingAllocatedSize(FileHandle file_handle) {
+  struct stat file_stat;
+  if (fstat(file_handle, &file_stat) == -1) return 0;
+  // st_blocks is in units of 512 bytes, whatever the block size of the file system.
+  return static_cast<size_t>(file_stat.st_blocks) * 512;
+}
+
+sham::FileHandle sham::CreatePersistentFileMapping(std::string_view path, size_t size) {
+  std::string file_path(path);
+  sham::FileHandle handle =
+      open(file_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, S_IRUSR | S_IWUSR);
+  if (handle == -1) {
+    perror("Can't open file");
+    return kInvalidFileHandle;
+  }
+
+  if (GetFileMappingSize(handle) < size && ftruncate(handle, size) == -1) {
+    perror("Can't truncate file");
+    close(handle);
+    return kInvalidFileHandle;
+  }
+  return handle;
+}
+
+sham::FileHandle sham::OpenPersistentFileMapping(std::string_view path, bool read_only) {
+  std::string file_path(path);
+  sham::FileHandle handle = open(file_path.c_str(), (read_only ? O_RDONLY : O_RDWR) | O_CLOEXEC);
+  if (handle == -1) {
+    perror("Can't open file");
+  }
+  return handle;
 }
 
-uint8_t* sham::MapViewOfFile(FileHandle file_handle, size_t size) {
-  void* ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, file_handle, 0);
+uint8_t* sham::MapViewOfFile(FileHandle file_handle, size_t size, bool read_only) {
+  int protection = read_only ? PROT_READ : PROT_READ | PROT_WRITE;
+  void* ptr = mmap(NULL, size, protection, MAP_SHARED, file_handle, 0);
   if (ptr != MAP_FAILED) return static_cast<uint8_t*>(ptr);
   perror("Memory mapping failed");
-  return static_cast<uint8_t*>(ptr);
+  return nullptr;
 }
 
 void sham::UnMapViewOfFile(uint8_t* address, size_t size) {
@@ -137,4 +455,114 @@ void sham::UnMapViewOfFile(uint8_t* address, size_t size) {
   munmap(address, size);
 }
 
+bool sham::FlushViewOfFile(uint8_t* address, size_t size, bool async) {
+  if (address == nullptr) return false;
+  // msync requires a page aligned address.
+  uintptr_t page_size = GetPageSize();
+  uintptr_t begin = reinterpret_cast<uintptr_t>(address) & ~(page_size - 1);
+  uintptr_t end = reinterpret_cast<uintptr_t>(address) + size;
+  if (msync(reinterpret_cast<void*>(begin), end - begin, async ? MS_ASYNC : MS_SYNC) == -1) {
+    perror("Can't flush memory mapping");
+    return false;
+  }
+  return true;
+}
+
+bool sham::ResizeFileMapping(FileHandle file_handle, size_t size) {
+  if (ftruncate(file_handle, size) == -1) {
+    perror("Can't resize memory");
+    return false;
+  }
+  return true;
+}
+
+uint8_t* sham::ReserveAddressSpace(size_t size, size_t alignment) {
+  // Over-reserve to find an aligned range, then give back what lies outside of it.
+  size_t slack = alignment > GetPageSize() ? alignment : 0;
+  void* ptr =
+      mmap(NULL, size + slack, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (ptr == MAP_FAILED) {
+    perror("Address space reservation failed");
+    return nullptr;
+  }
+  uint8_t* address = static_cast<uint8_t*>(ptr);
+  if (slack == 0) return address;
+  uintptr_t begin = reinterpret_cast<uintptr_t>(address);
+  uint8_t* aligned = reinterpret_cast<uint8_t*>((begin + alignment - 1) & ~(alignment - 1));
+  if (aligned > address) munmap(address, aligned - address);
+  munmap(aligned + size, address + size + slack - (aligned + size));
+  return aligned;
+}
+
+bool sham::AdviseHugePages(uint8_t* address, size_t size) {
+#ifdef MADV_HUGEPAGE
+  if (madvise(address, size, MADV_HUGEPAGE) == -1) {
+    perror("Can't advise huge pages");
+    return false;
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+uint8_t* sham::MapViewOfFileAt(FileHandle file_handle, uint8_t* address, size_t offset,
+                               size_t size, bool read_only) {
+  int protection = read_only ? PROT_READ : PROT_READ | PROT_WRITE;
+  void* ptr = mmap(address, size, protection, MAP_SHARED | MAP_FIXED, file_handle,
+                   static_cast<off_t>(offset));
+  if (ptr != MAP_FAILED) return static_cast<uint8_t*>(ptr);
+  perror("Memory mapping failed");
+  return nullptr;
+}
+
+bool sham::ReleaseMemory(void* address, size_t size) {
+  uintptr_t page_size = GetPageSize();
+  uintptr_t begin = reinterpret_cast<uintptr_t>(address);
+  uintptr_t end = begin + size;
+  uintptr_t first_page = (begin + page_size - 1) & ~(page_size - 1);
+  uintptr_t last_page = end & ~(page_size - 1);
+  if (first_page < last_page) {
+    void* pages = reinterpret_cast<void*>(first_page);
+    // MADV_REMOVE punches a hole in the file backing a shared mapping, MADV_DONTNEED zero-fills
+    // private anonymous memory but has no effect on the content of shared mappings. MADV_REMOVE
+    // fails with EINVAL on private mappings only, other errors mean the file can't have holes,
+    // e.g. a persistent segment on a filesystem without hole punching, and leave the range as is.
+#ifdef MADV_REMOVE
+    if (madvise(pages, last_page - first_page, MADV_REMOVE) == -1 &&
+        (errno != EINVAL || madvise(pages, last_page - first_page, MADV_DONTNEED) == -1)) {
+      return false;
+    }
+#else
+    // Without MADV_REMOVE, shared pages are zero-filled in place and stay committed. MADV_DONTNEED
+    // then only returns private anonymous memory to the OS.
+    std::memset(pages, 0, last_page - first_page);
+    madvise(pages, last_page - first_page, MADV_DONTNEED);
+#endif
+  } else {
+    first_page = last_page = end;
+  }
+  // Partial pages at both ends stay resident.
+  std::memset(address, 0, first_page - begin);
+  std::memset(reinterpret_cast<void*>(last_page), 0, end - last_page);
+  return true;
+}
+
+size_t sham::GetResidentSize(const void* address, size_t size) {
+  uintptr_t page_size = GetPageSize();
+  uintptr_t begin = reinterpret_cast<uintptr_t>(address) & ~(page_size - 1);
+  uintptr_t end = reinterpret_cast<uintptr_t>(address) + size;
+  size_t num_pages = (end - begin + page_size - 1) / page_size;
+  std::vector<unsigned char> residency(num_pages);
+  if (mincore(reinterpret_cast<void*>(begin), end - begin, residency.data()) == -1) {
+    perror("Can't get memory residency");
+    return 0;
+  }
+  size_t num_resident_pages = 0;
+  for (unsigned char page : residency) num_resident_pages += page & 1;
+  return num_resident_pages * page_size;
+}
+
+size_t sham::GetPageSize() { return static_cast<size_t>(sysconf(_SC_PAGESIZE)); }
+
 #endif
@@ -22,32 +22,175 @@ SOFTWARE.
 
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+
+#include "sham/numa.h"
+#include "sham/object_directory.h"
+#include "sham/process.h"
+#include "sham/segment_registry.h"
 #include "sham/shared_memory.h"
 
 namespace sham {
 
+// Optional settings of a SharedMemoryBuffer.
+struct SharedMemoryBufferOptions {
+  // NUMA placement of the buffer's pages. Applied when the buffer is mapped, before any of its
+  // pages is touched. For shared memory, the policy is shared by all processes mapping the buffer.
+  NumaPolicy numa_policy;
+  // Capacity up to which the creator can grow the buffer, see SharedMemoryBuffer::Grow(). Only
+  // address space is reserved upfront. Values smaller than the capacity mean no growth.
+  size_t max_capacity = 0;
+  // Aligns the mapping on huge pages and asks for transparent huge pages, see AdviseHugePages(),
+  // to cover large buffers with few TLB entries, e.g. a QueueArena of thousands of queues.
+  bool huge_pages = false;
+  // Number of entries of the directory of named objects, see SharedMemoryBuffer::FindOrConstruct().
+  // The directory takes 128 bytes per entry at the start of the buffer. Keep it under half full
+  // for fast lookups.
+  size_t directory_capacity = 0;
+  // Registry recording named buffers and the processes mapping them, so that buffers leaked by
+  // crashed processes can be reclaimed. It must outlive the buffer.
+  SegmentRegistry* registry = nullptr;
+};
+
+// Header at the start of every segment mapped by a SharedMemoryBuffer, describing the segment to
+// all the processes mapping it. The memory handed out by the buffer starts right after it.
+struct SharedMemoryHeader {
+  static constexpr uint64_t kMagic = 0x6d616873'00000002;  // "sham", version 2.
+  // The largest page size of supported systems, e.g. 16KB on Apple silicon and 64KB on some ARM
+  // Linux kernels, so that data() is page aligned everywhere. Only the first page is ever touched.
+  static constexpr size_t kSize = 64 * 1024;
+  // How long processes accessing an existing segment wait for its creator to initialize the header.
+  static constexpr std::chrono::milliseconds kInitTimeout{1000};
+
+  bool valid() const { return magic.load(std::memory_order_acquire) == kMagic; }
+
+  // Written last by the creator, zero until the header is initialized. Only the creator writes the
+  // header, other processes wait for it to be initialized.
+  std::atomic<uint64_t> magic;
+  std::atomic<uint64_t> capacity;
+  std::atomic<uint64_t> max_capacity;
+  // Incremented each time the segment grows.
+  std::atomic<uint64_t> generation;
+  // Serializes growth between threads of the creator.
+  std::atomic<uint32_t> grow_lock;
+  // Process that created the segment, see CurrentProcessInstance(), so that a named segment is
+  // only replaced by a new creator once its creator is gone.
+  uint64_t creator;
+  // Number of bytes handed out by Allocate() in any process. Kept away from the fields above, which
+  // are read on every access past the mapped capacity.
+  alignas(64) std::atomic<uint64_t> size;
+  // Number of entries of the directory at the start of the buffer, see ObjectDirectory.
+  std::atomic<uint64_t> directory_capacity;
+};
+
+static_assert(sizeof(SharedMemoryHeader) <= SharedMemoryHeader::kSize);
+
 // Creates named shared memory buffer of specified capacity. The shared memory object is unlinked
-// when the SharedMemoryBuffer is destroyed.
+// when the SharedMemoryBuffer that created it is destroyed. A newly created buffer is zero-filled.
+// Anonymous buffers, see CreateAnonymous(), have no name and are shared by passing their handle.
+// Persistent buffers, see CreatePersistent(), are backed by a regular file that outlives them.
 class SharedMemoryBuffer {
  public:
   enum class Type { kInvalid, kCreate, kAccessExisting };
+  enum class Backend { kNamed, kAnonymous, kPersistent };
 
-  SharedMemoryBuffer(std::string_view name, size_t capacity, Type type)
-      : name_(name), capacity_(capacity) {
-    handle_ = type == Type::kCreate ? sham::CreateFileMapping(name, capacity)
-                                    : sham::OpenFileMapping(name);
-    buffer_ = sham::MapViewOfFile(handle_, capacity_);
+  // When accessing an existing buffer, `capacity` is ignored, the capacity of the buffer is the one
+  // set by its creator. The buffer is invalid if the creator doesn't initialize its header within
+  // SharedMemoryHeader::kInitTimeout. Creating a buffer whose name is taken by a segment whose
+  // creator is still running fails, while a segment left behind by a crashed creator is replaced by
+  // a new, zero-filled one. Processes still mapping the old segment keep it until they unmap it.
+  SharedMemoryBuffer(std::string_view name, size_t capacity, Type type,
+                     const SharedMemoryBufferOptions& options = {})
+      : SharedMemoryBuffer(type == Type::kCreate
+                               ? CreateNamedSegment(name, SharedMemoryHeader::kSize + capacity)
+                               : sham::OpenFileMapping(name),
+                           capacity, type, Backend::kNamed, options) {
+    name_ = name;
+    if (options.registry != nullptr && valid()) {
+      registry_ = options.registry;
+      if (type == Type::kCreate) {
+        registry_->Register(name_, SharedMemoryHeader::kSize + capacity);
+      } else {
+        registry_->Attach(name_);
+      }
+    }
+  }
+
+  // Creates an anonymous buffer, see CreateAnonymousFileMapping(). Send handle() to other
+  // processes, e.g. with SendFileHandle(), and have them call FromFileHandle(). Sealed buffers
+  // can't grow.
+  static SharedMemoryBuffer CreateAnonymous(size_t capacity, bool seal_size = true,
+                                            const SharedMemoryBufferOptions& options = {}) {
+    FileHandle handle =
+        sham::CreateAnonymousFileMapping("sham", SharedMemoryHeader::kSize + capacity, seal_size);
+    return SharedMemoryBuffer(handle, capacity, Type::kCreate, Backend::kAnonymous, options);
+  }
+
+  // Maps an existing file mapping from its handle, e.g. one received with ReceiveFileHandle(). The
+  // buffer takes ownership of the handle and spans the whole file mapping. Unless the mapping's
+  // size is sealed, another process could shrink it, in which case accessing the truncated range
+  // raises SIGBUS.
+  static SharedMemoryBuffer FromFileHandle(FileHandle handle,
+                                           const SharedMemoryBufferOptions& options = {}) {
+    size_t size = handle == kInvalidFileHandle ? 0 : sham::GetFileMappingSize(handle);
+    size_t capacity = size > SharedMemoryHeader::kSize ? size - SharedMemoryHeader::kSize : 0;
+    return SharedMemoryBuffer(handle, capacity, Type::kAccessExisting, Backend::kAnonymous,
+                              options);
+  }
+
+  // Creates a buffer backed by the regular file at `path`, or opens it if it exists, in which case
+  // its content is preserved. Modifications are written back to the file by the OS at any time and
+  // at the latest on Checkpoint(). The file is not removed when the buffer is destroyed, so a
+  // restarted process can resume where it left off, e.g. from the persisted indices of a queue.
+  static SharedMemoryBuffer CreatePersistent(std::string_view path, size_t capacity,
+                                             const SharedMemoryBufferOptions& options = {}) {
+    FileHandle handle =
+        sham::CreatePersistentFileMapping(path, SharedMemoryHeader::kSize + capacity);
+    return SharedMemoryBuffer(handle, capacity, Type::kCreate, Backend::kPersistent, options);
+  }
+
+  // Opens an existing file backed buffer without write access, e.g. to follow the progress of a
+  // queue written by another process. The buffer spans the whole file and can't allocate.
+  static SharedMemoryBuffer OpenPersistentReadOnly(std::string_view path,
+                                                   const SharedMemoryBufferOptions& options = {}) {
+    std::error_code error;
+    size_t size = std::filesystem::file_size(path, error);
+    size_t capacity = !error && size > SharedMemoryHeader::kSize ? size - SharedMemoryHeader::kSize
+                                                                 : 0;
+    FileHandle handle =
+        capacity == 0 ? kInvalidFileHandle : sham::OpenPersistentFileMapping(path, true);
+    return SharedMemoryBuffer(handle, capacity, Type::kAccessExisting, Backend::kPersistent,
+                              options, /*read_only=*/true);
   }
 
   SharedMemoryBuffer(SharedMemoryBuffer&& other) noexcept
-      : name_(std::move(other.name_)),
-        capacity_(other.capacity_),
-        handle_(other.handle_),
+      : handle_(other.handle_),
+        name_(std::move(other.name_)),
+        registry_(other.registry_),
         buffer_(other.buffer_),
-        size_(other.size_) {
+        capacity_(other.capacity_.load(std::memory_order_relaxed)),
+        mapped_size_(other.mapped_size_),
+        reserved_size_(other.reserved_size_),
+        numa_policy_(other.numa_policy_),
+        huge_pages_(other.huge_pages_),
+        type_(other.type_),
+        backend_(other.backend_),
+        read_only_(other.read_only_) {
     other.handle_ = kInvalidFileHandle;
+    other.registry_ = nullptr;
     other.buffer_ = nullptr;
-    other.size_ = 0;
+    other.capacity_ = 0;
+    other.type_ = Type::kInvalid;
   }
 
   SharedMemoryBuffer& operator=(SharedMemoryBuffer&& other) noexcept {
@@ -59,46 +202,337 @@ class SharedMemoryBuffer {
   }
 
   ~SharedMemoryBuffer() {
-    sham::UnMapViewOfFile(buffer_, capacity_);
-    sham::DestroyFileMapping(handle_, name_.c_str());
+    if (registry_ != nullptr) {
+      if (type_ == Type::kCreate) {
+        registry_->Unregister(name_);
+      } else {
+        registry_->Detach(name_);
+      }
+    }
+    sham::UnMapViewOfFile(buffer_, reserved_size_);
+    if (type_ == Type::kCreate && backend_ == Backend::kNamed) {
+      sham::DestroyFileMapping(handle_, name_.c_str());
+    } else {
+      sham::CloseFileMapping(handle_);
+    }
   }
 
   SharedMemoryBuffer() = delete;
   SharedMemoryBuffer(const SharedMemoryBuffer&) = delete;
   SharedMemoryBuffer& operator=(const SharedMemoryBuffer&) = delete;
 
-  uint8_t* Allocate(size_t num_bytes) {
-    size_t next_size = size_ + num_bytes;
-    if (next_size > capacity_) return nullptr;
-    uint8_t* ptr = buffer_ + size_;
-    size_ = next_size;
-    return ptr;
+  // Returns `num_bytes` bytes aligned to `alignment`, which must be a power of 2 no larger than
+  // the page size. Lock-free, any thread of any process mapping the buffer can allocate, and all of
+  // them share the same allocation cursor. Returns nullptr if the buffer is full. The creator of a
+  // growable buffer grows it instead.
+  uint8_t* Allocate(size_t num_bytes, size_t alignment = alignof(std::max_align_t)) {
+    if (!valid() || read_only_ || alignment > SharedMemoryHeader::kSize) return nullptr;
+    std::atomic<uint64_t>& size = header()->size;
+    uint64_t current_size = size.load(std::memory_order_relaxed);
+    uint64_t offset = 0;
+    uint64_t next_size = 0;
+    do {
+      // data() is page aligned, so aligning the offset aligns the address.
+      offset = (current_size + alignment - 1) & ~(alignment - 1);
+      next_size = offset + num_bytes;
+      if (next_size > capacity() && !Reserve(next_size)) return nullptr;
+    } while (!size.compare_exchange_weak(current_size, next_size, std::memory_order_relaxed));
+    return data() + offset;
   }
 
   template <typename T, typename... Args>
   T* Allocate(Args&&... args) {
-    void* buffer = Allocate(sizeof(T));
+    void* buffer = Allocate(sizeof(T), alignof(T));
     if (buffer == nullptr) return nullptr;
     return new (buffer)(T)(std::forward<Args>(args)...);
   }
 
+  // Returns the object registered under `name` in the buffer's directory, constructing it with
+  // `args` if it doesn't exist yet. All the threads and processes calling it with the same name get
+  // the same object, constructed exactly once. If the constructor throws, the exception propagates
+  // and a later call constructs the object again. Returns nullptr if the object exists with another
+  // type, if the buffer is full, or if the directory is full or missing, see
+  // SharedMemoryBufferOptions::directory_capacity. Read-only buffers only find existing objects.
+  template <typename T, typename... Args>
+  T* FindOrConstruct(std::string_view name, Args&&... args) {
+    if (read_only_) return Find<T>(name);
+    ObjectDirectory directory = this->directory();
+    auto [entry, inserted] = directory.FindOrInsert(name, TypeHash<T>(), sizeof(T));
+    if (entry == nullptr) return nullptr;
+    if (!inserted) return Get<T>(*entry);
+    uint8_t* memory = Allocate(sizeof(T), alignof(T));
+    if (memory == nullptr) {
+      ObjectDirectory::Abort(entry);
+      return nullptr;
+    }
+    T* object = nullptr;
+    try {
+      object = new (memory) T(std::forward<Args>(args)...);
+    } catch (...) {
+      // The memory is lost, the next caller constructs the object in a new allocation.
+      ObjectDirectory::Abort(entry);
+      throw;
+    }
+    ObjectDirectory::Publish(entry, memory - data());
+    return object;
+  }
+
+  // Returns the object registered under `name`, nullptr if there is none or it has another type.
+  template <typename T>
+  T* Find(std::string_view name) {
+    const ObjectDirectory::Entry* entry = directory().Find(name);
+    return entry == nullptr ? nullptr : Get<T>(*entry);
+  }
+
+  ObjectDirectory directory() {
+    if (!valid()) return {};
+    size_t capacity = header()->directory_capacity.load(std::memory_order_relaxed);
+    return ObjectDirectory(reinterpret_cast<ObjectDirectory::Entry*>(data()), capacity);
+  }
+
+  // Accesses past the mapped capacity first map the part of the buffer grown by its creator.
   template <typename T>
   T* As(size_t offset = 0) {
-    if (offset + sizeof(T) > capacity_) return nullptr;
-    return reinterpret_cast<T*>(buffer_ + offset);
+    if (offset + sizeof(T) > capacity() && (!Refresh() || offset + sizeof(T) > capacity())) {
+      return nullptr;
+    }
+    return reinterpret_cast<T*>(data() + offset);
+  }
+
+  template <typename T>
+  const T* As(size_t offset = 0) const {
+    if (offset + sizeof(T) > capacity()) return nullptr;
+    return reinterpret_cast<const T*>(data() + offset);
+  }
+
+  // Grows the buffer to `new_capacity`, which can't exceed max_capacity(). Only the process that
+  // created the buffer can grow it. Memory allocated so far keeps its offset and its address. Other
+  // processes map the new range lazily, when they first access it through As() or Allocate(), or
+  // when calling Refresh().
+  bool Grow(size_t new_capacity) {
+    if (!valid() || read_only_ || type_ != Type::kCreate) return false;
+    SharedMemoryHeader* header = this->header();
+    while (header->grow_lock.exchange(1, std::memory_order_acquire) != 0) {
+      std::this_thread::yield();
+    }
+    bool result = true;
+    if (new_capacity > header->capacity.load(std::memory_order_relaxed)) {
+      result = new_capacity <= header->max_capacity.load(std::memory_order_relaxed) &&
+               sham::ResizeFileMapping(handle_, SharedMemoryHeader::kSize + new_capacity) &&
+               MapUpTo(new_capacity);
+      if (result) {
+        header->capacity.store(new_capacity, std::memory_order_release);
+        header->generation.fetch_add(1, std::memory_order_release);
+      }
+    }
+    header->grow_lock.store(0, std::memory_order_release);
+    return result && Refresh();
   }
 
-  uint8_t* data() { return buffer_; }
-  size_t capacity() const { return capacity_; }
-  size_t size() const { return size_; }
+  // Maps the part of the buffer grown by its creator since this process last mapped it.
+  bool Refresh() {
+    if (!valid()) return false;
+    size_t capacity = header()->capacity.load(std::memory_order_acquire);
+    return capacity <= this->capacity() || MapUpTo(capacity);
+  }
+
+  // Synchronously writes the modified pages of [offset, offset + size) back to the backing file of
+  // a persistent buffer. Use it at points the data must survive a crash of the machine, a crash of
+  // the process alone doesn't lose data written to the buffer.
+  bool Checkpoint(size_t offset = 0, size_t size = std::numeric_limits<size_t>::max()) {
+    size_t capacity = this->capacity();
+    if (buffer_ == nullptr || backend_ != Backend::kPersistent || offset > capacity) return false;
+    return sham::FlushViewOfFile(data() + offset, std::min(size, capacity - offset));
+  }
+
+  uint8_t* data() { return buffer_ + SharedMemoryHeader::kSize; }
+  const uint8_t* data() const { return buffer_ + SharedMemoryHeader::kSize; }
+  FileHandle handle() const { return handle_; }
+  // Capacity currently mapped by this process.
+  size_t capacity() const { return capacity_.load(std::memory_order_acquire); }
+  size_t max_capacity() const {
+    return valid() ? header()->max_capacity.load(std::memory_order_relaxed) : 0;
+  }
+  // Number of times the buffer has grown.
+  uint64_t generation() const {
+    return valid() ? header()->generation.load(std::memory_order_acquire) : 0;
+  }
+  // Number of bytes allocated by all the processes.
+  size_t size() const { return valid() ? header()->size.load(std::memory_order_relaxed) : 0; }
   bool valid() const { return buffer_ != nullptr; }
+  bool read_only() const { return read_only_; }
+  Backend backend() const { return backend_; }
 
  private:
+  SharedMemoryBuffer(FileHandle handle, size_t capacity, Type type, Backend backend,
+                     const SharedMemoryBufferOptions& options, bool read_only = false)
+      : handle_(handle),
+        numa_policy_(options.numa_policy),
+        huge_pages_(options.huge_pages),
+        type_(type),
+        backend_(backend),
+        read_only_(read_only) {
+    if (handle_ == kInvalidFileHandle) return;
+
+    // An existing segment describes itself, e.g. one that was grown or a persistent one. Only its
+    // creator initializes the header, others wait for it.
+    size_t max_capacity = std::max(capacity, options.max_capacity);
+    std::chrono::milliseconds timeout{0};
+    if (type_ != Type::kCreate) timeout = SharedMemoryHeader::kInitTimeout;
+    bool initialized = ReadHeader(handle_, timeout, [&](const SharedMemoryHeader& header) {
+      capacity = header.capacity.load(std::memory_order_relaxed);
+      max_capacity = header.max_capacity.load(std::memory_order_relaxed);
+    });
+    if (!initialized && type_ != Type::kCreate) {
+      sham::CloseFileMapping(handle_);
+      handle_ = kInvalidFileHandle;
+      type_ = Type::kInvalid;
+      return;
+    }
+
+    if (!Map(capacity, max_capacity)) return;
+    if (type_ == Type::kCreate && !read_only_ && !header()->valid()) {
+      header()->capacity.store(capacity, std::memory_order_relaxed);
+      header()->max_capacity.store(max_capacity, std::memory_order_relaxed);
+      header()->creator = CurrentProcessInstance();
+      size_t directory_size = options.directory_capacity * sizeof(ObjectDirectory::Entry);
+      if (directory_size > 0 && directory_size <= capacity) {
+        header()->directory_capacity.store(options.directory_capacity, std::memory_order_relaxed);
+        header()->size.store(directory_size, std::memory_order_relaxed);
+      }
+      header()->magic.store(SharedMemoryHeader::kMagic, std::memory_order_release);
+    }
+  }
+
+  // Creates the named segment, replacing one left behind by a crashed creator. Returns
+  // kInvalidFileHandle if the name is taken by a segment whose creator is running, which is never
+  // truncated nor initialized again.
+  static FileHandle CreateNamedSegment(std::string_view name, size_t size) {
+    FileHandle handle = sham::CreateNewFileMapping(name, size);
+    if (handle != kInvalidFileHandle) return handle;
+    FileHandle existing = sham::OpenFileMapping(name);
+    if (existing != kInvalidFileHandle) {
+      // A segment whose header stays uninitialized wasn't created by a running SharedMemoryBuffer.
+      bool creator_alive = false;
+      ReadHeader(existing, SharedMemoryHeader::kInitTimeout, [&](const SharedMemoryHeader& header) {
+        creator_alive = IsProcessInstanceAlive(header.creator);
+      });
+      sham::CloseFileMapping(existing);
+      if (creator_alive) return kInvalidFileHandle;
+      sham::UnlinkFileMapping(name);
+    }
+    return sham::CreateNewFileMapping(name, size);
+  }
+
+  // Calls `fn` with the header of the segment of `handle`, waiting up to `timeout` for it to be
+  // initialized. Returns false if it isn't.
+  template <typename Fn>
+  static bool ReadHeader(FileHandle handle, std::chrono::milliseconds timeout, Fn&& fn) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (true) {
+#ifndef _WIN32
+      // Mapping the header before the creator sized the segment would raise SIGBUS on access.
+      if (sham::GetFileMappingSize(handle) >= SharedMemoryHeader::kSize)
+#endif
+      {
+        if (uint8_t* view = sham::MapViewOfFile(handle, SharedMemoryHeader::kSize, true)) {
+          auto* header = reinterpret_cast<const SharedMemoryHeader*>(view);
+          bool valid = header->valid();
+          if (valid) fn(*header);
+          sham::UnMapViewOfFile(view, SharedMemoryHeader::kSize);
+          if (valid) return true;
+        }
+      }
+      if (std::chrono::steady_clock::now() >= deadline) return false;
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+
+  // Maps the header and `capacity` bytes, in an address range large enough to later grow the
+  // mapping in place up to `max_capacity` bytes.
+  bool Map(size_t capacity, size_t max_capacity) {
+    size_t mapped_size = MappedSize(capacity);
+    size_t reserved_size = MappedSize(max_capacity);
+    if (reserved_size > mapped_size || huge_pages_) {
+      size_t alignment = huge_pages_ ? kHugePageSize : 0;
+      if (uint8_t* address = sham::ReserveAddressSpace(reserved_size, alignment)) {
+        buffer_ = sham::MapViewOfFileAt(handle_, address, 0, mapped_size, read_only_);
+        if (buffer_ == nullptr) sham::UnMapViewOfFile(address, reserved_size);
+      }
+    }
+    if (buffer_ == nullptr) {
+      reserved_size = mapped_size;
+      buffer_ = sham::MapViewOfFile(handle_, mapped_size, read_only_);
+      if (buffer_ == nullptr) return false;
+    }
+    sham::SetNumaPolicy(buffer_, mapped_size, numa_policy_);
+    if (huge_pages_) sham::AdviseHugePages(buffer_, mapped_size);
+    mapped_size_ = mapped_size;
+    reserved_size_ = reserved_size;
+    capacity_.store(capacity, std::memory_order_release);
+    return true;
+  }
+
+  // Extends the mapping in place so that it covers `capacity` bytes. Thread-safe.
+  bool MapUpTo(size_t capacity) {
+    std::lock_guard lock(map_mutex_);
+    size_t mapped_size = MappedSize(capacity);
+    if (mapped_size > reserved_size_) return false;
+    if (mapped_size > mapped_size_) {
+      uint8_t* address = buffer_ + mapped_size_;
+      size_t size = mapped_size - mapped_size_;
+      if (!sham::MapViewOfFileAt(handle_, address, mapped_size_, size, read_only_)) return false;
+      sham::SetNumaPolicy(address, size, numa_policy_);
+      if (huge_pages_) sham::AdviseHugePages(address, size);
+      mapped_size_ = mapped_size;
+    }
+    if (capacity > capacity_.load(std::memory_order_relaxed)) {
+      capacity_.store(capacity, std::memory_order_release);
+    }
+    return true;
+  }
+
+  // Makes room for `size` bytes, growing the buffer by at least a factor of 2 if it is growable.
+  bool Reserve(size_t size) {
+    if (Refresh() && size <= capacity()) return true;
+    size_t max_capacity = this->max_capacity();
+    if (size > max_capacity) return false;
+    return Grow(std::min(max_capacity, std::max(size, 2 * capacity()))) && size <= capacity();
+  }
+
+  template <typename T>
+  T* Get(const ObjectDirectory::Entry& entry) {
+    if (!entry.ready() || entry.type_hash != TypeHash<T>() || entry.size != sizeof(T)) {
+      return nullptr;
+    }
+    return As<T>(entry.offset);
+  }
+
+  static size_t MappedSize(size_t capacity) {
+    size_t page_size = sham::GetPageSize();
+    return (SharedMemoryHeader::kSize + capacity + page_size - 1) / page_size * page_size;
+  }
+
+  SharedMemoryHeader* header() { return reinterpret_cast<SharedMemoryHeader*>(buffer_); }
+  const SharedMemoryHeader* header() const {
+    return reinterpret_cast<const SharedMemoryHeader*>(buffer_);
+  }
+
   FileHandle handle_ = kInvalidFileHandle;
   std::string name_;
+  SegmentRegistry* registry_ = nullptr;
   uint8_t* buffer_ = nullptr;
-  size_t size_ = 0;
-  size_t capacity_ = 0;
+  // Mapped capacity, grows while other threads access the buffer.
+  std::atomic<size_t> capacity_ = 0;
+  // Guards mapped_size_.
+  std::mutex map_mutex_;
+  size_t mapped_size_ = 0;
+  size_t reserved_size_ = 0;
+  NumaPolicy numa_policy_;
+  bool huge_pages_ = false;
+  Type type_ = Type::kInvalid;
+  Backend backend_ = Backend::kNamed;
+  bool read_only_ = false;
 };
 
 }  // namespace sham
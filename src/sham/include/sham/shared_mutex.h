@@ -0,0 +1,143 @@
+/*
+MIT License - Copyright (c) 2023 Pierric Gimmig
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "sham/futex.h"
+#include "sham/process.h"
+#include "sham/sync.h"
+
+namespace sham {
+
+// Reader-writer lock for data read very often by many threads of many processes and rarely
+// written, e.g. configuration or symbol tables, with the interface of std::shared_mutex, usable
+// with std::shared_lock and std::unique_lock.
+//
+// Instead of a single count of readers, which every read would modify and bounce between cores,
+// readers are counted in kNumSlots counters on separate cache lines, in the style of big-reader
+// locks and BRAVO. A thread always uses the same slot, picked from its process and thread ids, so
+// uncontended reads only write to a cache line shared with the few other threads hashed to the same
+// slot, and read the writer flag, which stays cached in every core until a writer comes.
+//
+// A writer raises the writer flag, which new readers wait on, then waits for the count of every
+// slot to drop to zero, so writes cost O(kNumSlots) and readers can't starve writers. Waiting
+// threads sleep in FutexWait(). A process dying while holding the lock, for reading or writing,
+// leaves it locked. Zero-filled memory is a valid unlocked SharedMutex.
+class SharedMutex {
+ public:
+  static constexpr size_t kNumSlots = 64;
+
+  SharedMutex() = default;
+
+  SharedMutex(const SharedMutex&) = delete;
+  SharedMutex& operator=(const SharedMutex&) = delete;
+
+  void lock_shared() {
+    std::atomic<uint32_t>& readers = slots_[ThreadSlot()].readers;
+    while (true) {
+      // Sequentially consistent, like the writer's accesses: either the writer sees this reader,
+      // or this reader sees the writer flag.
+      readers.fetch_add(1, std::memory_order_seq_cst);
+      if (writer_.load(std::memory_order_seq_cst) == 0) return;
+      UnlockSlot(readers);
+      WaitForWriter();
+    }
+  }
+
+  bool try_lock_shared() {
+    std::atomic<uint32_t>& readers = slots_[ThreadSlot()].readers;
+    readers.fetch_add(1, std::memory_order_seq_cst);
+    if (writer_.load(std::memory_order_seq_cst) == 0) return true;
+    UnlockSlot(readers);
+    return false;
+  }
+
+  // Must be called by the thread that called lock_shared(), which uses a per-thread slot.
+  void unlock_shared() { UnlockSlot(slots_[ThreadSlot()].readers); }
+
+  void lock() {
+    writer_mutex_.lock();
+    writer_.store(1, std::memory_order_seq_cst);
+    for (Slot& slot : slots_) {
+      uint32_t readers;
+      while ((readers = slot.readers.load(std::memory_order_seq_cst)) != 0) {
+        FutexWait(&slot.readers, readers);
+      }
+    }
+  }
+
+  bool try_lock() {
+    if (!writer_mutex_.try_lock()) return false;
+    writer_.store(1, std::memory_order_seq_cst);
+    for (Slot& slot : slots_) {
+      if (slot.readers.load(std::memory_order_seq_cst) != 0) {
+        unlock();
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void unlock() {
+    writer_.store(0, std::memory_order_seq_cst);
+    FutexWakeAll(&writer_);
+    writer_mutex_.unlock();
+  }
+
+ private:
+  struct alignas(64) Slot {
+    std::atomic<uint32_t> readers = 0;
+  };
+
+  static size_t ThreadSlot() {
+    static std::atomic<uint32_t> next_thread_index = 0;
+    // Set when a thread first takes a read lock, kept by the thread calling fork() in the child.
+    thread_local size_t slot =
+        (CurrentProcessId() * 0x9e3779b1u + next_thread_index.fetch_add(1)) % kNumSlots;
+    return slot;
+  }
+
+  void UnlockSlot(std::atomic<uint32_t>& readers) {
+    // Sequentially consistent, so that either a writer that found the slot in use waits for the
+    // new count, or this reader sees the writer flag and wakes it up.
+    if (readers.fetch_sub(1, std::memory_order_seq_cst) == 1 &&
+        writer_.load(std::memory_order_seq_cst) != 0) {
+      FutexWakeAll(&readers);
+    }
+  }
+
+  void WaitForWriter() {
+    while (writer_.load(std::memory_order_acquire) != 0) FutexWait(&writer_, 1);
+  }
+
+  Slot slots_[kNumSlots];
+  // 1 while a writer holds or waits for the lock.
+  alignas(64) std::atomic<uint32_t> writer_ = 0;
+  // Serializes writers.
+  Mutex writer_mutex_;
+};
+
+}  // namespace sham
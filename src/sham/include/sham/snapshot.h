@@ -0,0 +1,108 @@
+/*
+MIT License - Copyright (c) 2023 Pierric Gimmig
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "sham/shared_memory_buffer.h"
+
+namespace sham {
+
+// Written at the end of a snapshot file, after the copy of the segment.
+struct SnapshotInfo {
+  static constexpr uint64_t kMagic = 0x70616e73'6d616873;  // "shamsnap".
+
+  uint64_t magic = kMagic;
+  // System time at the start of the capture, in nanoseconds since the epoch.
+  uint64_t capture_time_ns = 0;
+  // Time taken to copy the segment. Writes during that window may or may not be in the snapshot.
+  uint64_t capture_duration_ns = 0;
+  // Number of bytes of the buffer copied, from data(). The rest of the buffer reads as zeros.
+  uint64_t size = 0;
+  uint64_t capacity = 0;
+};
+
+// Captures the content of a live buffer, header included, and writes it to the file at `path`, e.g.
+// to analyze the state of a queue after an incident. Writers are never paused. The allocated part
+// of the buffer, see SharedMemoryBuffer::size(), is first copied to private memory in one pass, so
+// the capture lasts about as long as a memcpy of that size. Only then is the copy written to disk.
+//
+// The snapshot is not a point-in-time image: neither a MAP_PRIVATE view nor a fork() isolates a
+// process from writes to a shared mapping, so no copy-on-write scheme applies to shared memory.
+// Writes made during the capture can appear partially, and the snapshot of a data structure is
+// only as consistent as what a concurrent reader would see, e.g. slots whose turn or sequence
+// number doesn't match their content are being written. The cost for writers is the cache misses
+// on lines read by the capture, see snapshot_benchmarks.cpp.
+//
+// The file is itself a persistent segment: open it with
+// SharedMemoryBuffer::OpenPersistentReadOnly() to access the captured objects at their offsets, or
+// inspect it with the sham_snapshot tool.
+inline bool WriteSnapshot(SharedMemoryBuffer& buffer, std::string_view path,
+                          SnapshotInfo* info = nullptr) {
+  if (!buffer.valid()) return false;
+  buffer.Refresh();
+  SnapshotInfo snapshot_info;
+  snapshot_info.capacity = buffer.capacity();
+  snapshot_info.size = std::min<uint64_t>(buffer.size(), snapshot_info.capacity);
+
+  std::vector<uint8_t> copy(SharedMemoryHeader::kSize + snapshot_info.size);
+  auto start = std::chrono::steady_clock::now();
+  snapshot_info.capture_time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                      std::chrono::system_clock::now().time_since_epoch())
+                                      .count();
+  std::memcpy(copy.data(), buffer.data() - SharedMemoryHeader::kSize, copy.size());
+  snapshot_info.capture_duration_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                          std::chrono::steady_clock::now() - start)
+                                          .count();
+  // The buffer could have grown since it was mapped, the snapshot ends at the mapped capacity.
+  auto* header = reinterpret_cast<SharedMemoryHeader*>(copy.data());
+  header->capacity.store(snapshot_info.capacity, std::memory_order_relaxed);
+
+  // The part of the buffer that was never allocated is left as a hole in the file.
+  std::ofstream file(std::string(path), std::ios::binary | std::ios::trunc);
+  file.write(reinterpret_cast<const char*>(copy.data()), copy.size());
+  file.seekp(SharedMemoryHeader::kSize + snapshot_info.capacity);
+  file.write(reinterpret_cast<const char*>(&snapshot_info), sizeof(snapshot_info));
+  file.close();
+  if (!file) return false;
+  if (info != nullptr) *info = snapshot_info;
+  return true;
+}
+
+// Reads the SnapshotInfo of the snapshot file at `path`. Returns false if it isn't a snapshot.
+inline bool ReadSnapshotInfo(std::string_view path, SnapshotInfo* info) {
+  std::ifstream file(std::string(path), std::ios::binary | std::ios::ate);
+  if (!file || static_cast<size_t>(file.tellg()) < sizeof(SnapshotInfo)) return false;
+  file.seekg(-static_cast<std::streamoff>(sizeof(SnapshotInfo)), std::ios::end);
+  file.read(reinterpret_cast<char*>(info), sizeof(SnapshotInfo));
+  return file && info->magic == SnapshotInfo::kMagic;
+}
+
+}  // namespace sham
@@ -0,0 +1,465 @@
+/*
+MIT License - Copyright (c) 2023 Pierric Gimmig
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include "sham/futex.h"
+#include "sham/process.h"
+
+// Synchronization primitives that can live in shared memory and synchronize threads of different
+// processes. They only enter the kernel when a thread has to block or be woken up, through
+// FutexWait() and FutexWake(). Zero-filled memory is a valid, non-robust, unlocked Mutex, a
+// ConditionVariable, an empty Semaphore and an unset Event.
+//
+// In robust mode, waits check every kRobustPollInterval whether the processes they wait for are
+// still running, so that a process crashing doesn't block the others forever. Processes are
+// identified by their pid and start time, see CurrentProcessInstance(), so that a new process
+// reusing the pid of a dead one isn't taken for it: a process dying while one of its threads holds
+// a mutex is detected, a thread exiting while the rest of its process runs is not.
+namespace sham {
+
+enum class SyncStatus {
+  kOk,
+  kTimedOut,
+  // The process the caller waited for died, see the description of each primitive.
+  kOwnerDied,
+};
+
+// Interval at which robust waits check whether the processes they wait for are alive.
+constexpr std::chrono::milliseconds kRobustPollInterval(10);
+
+namespace internal {
+
+class Deadline {
+ public:
+  explicit Deadline(std::chrono::nanoseconds timeout)
+      : infinite_(timeout == kInfinite),
+        deadline_(infinite_ ? std::chrono::steady_clock::time_point()
+                            : std::chrono::steady_clock::now() + timeout) {}
+
+  // Time left, at most `max_wait`. Zero once the deadline passed.
+  std::chrono::nanoseconds Remaining(std::chrono::nanoseconds max_wait) const {
+    if (infinite_) return max_wait;
+    auto remaining = deadline_ - std::chrono::steady_clock::now();
+    return std::clamp<std::chrono::nanoseconds>(remaining, std::chrono::nanoseconds(0), max_wait);
+  }
+
+ private:
+  bool infinite_;
+  std::chrono::steady_clock::time_point deadline_;
+};
+
+// Pids fit in 30 bits on Linux, leaving room for flags in 32-bit words.
+inline uint32_t CurrentPid() { return CurrentProcessId() & 0x3fffffff; }
+
+}  // namespace internal
+
+// Mutual exclusion lock with the interface of std::mutex, usable with std::lock_guard. lock()
+// doesn't enter the kernel unless the mutex is held, unlock() unless a thread is waiting.
+//
+// A robust mutex held by a process that died is taken over by the next thread locking it, which
+// gets kOwnerDied and must restore the consistency of the data the mutex protects. Other mutexes
+// stay locked forever.
+class Mutex {
+ public:
+  explicit Mutex(bool robust = false) : robust_(robust) {}
+
+  Mutex(const Mutex&) = delete;
+  Mutex& operator=(const Mutex&) = delete;
+
+  // Returns kOk or kOwnerDied, the caller holds the mutex in both cases.
+  SyncStatus lock() { return try_lock_for(kInfinite); }
+
+  bool try_lock() {
+    uint32_t state = 0;
+    if (!state_.compare_exchange_strong(state, internal::CurrentPid(), std::memory_order_acquire,
+                                        std::memory_order_relaxed)) {
+      return false;
+    }
+    if (robust_) owner_.store(CurrentProcessInstance(), std::memory_order_relaxed);
+    return true;
+  }
+
+  // Returns kTimedOut, in which case the caller doesn't hold the mutex, if it couldn't be locked
+  // within `timeout`.
+  SyncStatus try_lock_for(std::chrono::nanoseconds timeout) {
+    uint32_t self = internal::CurrentPid();
+    uint32_t state = 0;
+    if (state_.compare_exchange_strong(state, self, std::memory_order_acquire,
+                                       std::memory_order_relaxed)) {
+      return Locked(SyncStatus::kOk);
+    }
+    internal::Deadline deadline(timeout);
+    while (true) {
+      // Not knowing whether other threads wait, a thread that had to wait locks with the waiters
+      // flag set so that unlock() wakes them.
+      if (state == 0) {
+        if (state_.compare_exchange_weak(state, self | kWaitersFlag, std::memory_order_acquire,
+                                         std::memory_order_relaxed)) {
+          return Locked(SyncStatus::kOk);
+        }
+        continue;
+      }
+      if (robust_ && OwnerDied(state & ~kWaitersFlag)) {
+        if (state_.compare_exchange_weak(state, self | kWaitersFlag, std::memory_order_acquire,
+                                         std::memory_order_relaxed)) {
+          return Locked(SyncStatus::kOwnerDied);
+        }
+        continue;
+      }
+      if ((state & kWaitersFlag) == 0 &&
+          !state_.compare_exchange_weak(state, state | kWaitersFlag, std::memory_order_relaxed)) {
+        continue;
+      }
+      auto wait = deadline.Remaining(robust_ ? kRobustPollInterval : kInfinite);
+      if (wait.count() == 0) return SyncStatus::kTimedOut;
+      FutexWait(&state_, state | kWaitersFlag, wait);
+      state = state_.load(std::memory_order_relaxed);
+    }
+  }
+
+  void unlock() {
+    if (robust_) owner_.store(0, std::memory_order_relaxed);
+    if (state_.exchange(0, std::memory_order_release) & kWaitersFlag) FutexWake(&state_);
+  }
+
+  bool robust() const { return robust_; }
+
+ private:
+  static constexpr uint32_t kWaitersFlag = 1u << 31;
+
+  SyncStatus Locked(SyncStatus status) {
+    if (robust_) owner_.store(CurrentProcessInstance(), std::memory_order_relaxed);
+    return status;
+  }
+
+  // Returns true if the process `pid` holding the mutex died.
+  bool OwnerDied(uint32_t pid) const {
+    uint64_t owner = owner_.load(std::memory_order_relaxed);
+    if ((ProcessInstancePid(owner) & 0x3fffffff) == pid) return !IsProcessInstanceAlive(owner);
+    // The owner hasn't recorded itself yet.
+    return !IsProcessAlive(pid);
+  }
+
+  // Pid of the owner, with kWaitersFlag if threads might be waiting, 0 if unlocked.
+  std::atomic<uint32_t> state_ = 0;
+  uint32_t robust_;
+  // Owner of a robust mutex, see CurrentProcessInstance(), recorded once it is locked.
+  std::atomic<uint64_t> owner_ = 0;
+};
+
+// Condition variable associated with a Mutex. notify_one() and notify_all() only enter the kernel
+// if a thread is waiting. The waits return the status of locking the mutex again, kOwnerDied if it
+// is robust and its owner died, or kTimedOut if the timeout expired first.
+class ConditionVariable {
+ public:
+  ConditionVariable() = default;
+  ConditionVariable(const ConditionVariable&) = delete;
+  ConditionVariable& operator=(const ConditionVariable&) = delete;
+
+  SyncStatus wait(Mutex& mutex) { return wait_for(mutex, kInfinite); }
+
+  template <typename Predicate>
+  SyncStatus wait(Mutex& mutex, Predicate predicate) {
+    SyncStatus status = SyncStatus::kOk;
+    while (!predicate()) {
+      if (wait(mutex) == SyncStatus::kOwnerDied) status = SyncStatus::kOwnerDied;
+    }
+    return status;
+  }
+
+  SyncStatus wait_for(Mutex& mutex, std::chrono::nanoseconds timeout) {
+    uint32_t sequence = sequence_.load();
+    num_waiters_.fetch_add(1);
+    mutex.unlock();
+    bool woken = FutexWait(&sequence_, sequence, timeout);
+    num_waiters_.fetch_sub(1, std::memory_order_relaxed);
+    SyncStatus status = mutex.lock();
+    return status == SyncStatus::kOk && !woken ? SyncStatus::kTimedOut : status;
+  }
+
+  void notify_one() {
+    sequence_.fetch_add(1);
+    if (num_waiters_.load() > 0) FutexWake(&sequence_);
+  }
+
+  void notify_all() {
+    sequence_.fetch_add(1);
+    if (num_waiters_.load() > 0) FutexWakeAll(&sequence_);
+  }
+
+ private:
+  // Incremented by each notification, waiters sleep until it changes.
+  std::atomic<uint32_t> sequence_ = 0;
+  std::atomic<uint32_t> num_waiters_ = 0;
+};
+
+// Counting semaphore. release() only enters the kernel if a thread is waiting.
+//
+// A robust semaphore tracks how many units each process holds, up to kMaxProcesses processes, and
+// waiters take back the units held by dead processes. This suits semaphores bounding the use of a
+// resource, where processes release the units they acquired. Units released by a process that
+// holds none are simply added.
+class Semaphore {
+ public:
+  static constexpr size_t kMaxProcesses = 64;
+
+  explicit Semaphore(uint32_t count = 0, bool robust = false) : count_(count), robust_(robust) {}
+
+  Semaphore(const Semaphore&) = delete;
+  Semaphore& operator=(const Semaphore&) = delete;
+
+  void acquire() { try_acquire_for(kInfinite); }
+
+  bool try_acquire() {
+    uint32_t count = count_.load(std::memory_order_relaxed);
+    while (count > 0) {
+      if (count_.compare_exchange_weak(count, count - 1, std::memory_order_acquire,
+                                       std::memory_order_relaxed)) {
+        if (robust_) Hold(1);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool try_acquire_for(std::chrono::nanoseconds timeout) {
+    internal::Deadline deadline(timeout);
+    while (!try_acquire()) {
+      if (robust_ && ReclaimFromDeadProcesses()) continue;
+      auto wait = deadline.Remaining(robust_ ? kRobustPollInterval : kInfinite);
+      if (wait.count() == 0) return false;
+      num_waiters_.fetch_add(1);
+      FutexWait(&count_, 0, wait);
+      num_waiters_.fetch_sub(1, std::memory_order_relaxed);
+    }
+    return true;
+  }
+
+  void release(uint32_t count = 1) {
+    if (robust_) Release(count);
+    count_.fetch_add(count, std::memory_order_release);
+    if (num_waiters_.load() > 0) FutexWake(&count_, count);
+  }
+
+  uint32_t count() const { return count_.load(std::memory_order_relaxed); }
+
+ private:
+  // Marks a holder being reclaimed.
+  static constexpr uint64_t kReclaiming = ~uint64_t{0};
+
+  struct Holder {
+    // See CurrentProcessInstance().
+    std::atomic<uint64_t> process;
+    std::atomic<uint32_t> count;
+  };
+
+  void Hold(uint32_t count) {
+    uint64_t self = CurrentProcessInstance();
+    for (Holder& holder : holders_) {
+      uint64_t process = 0;
+      if (holder.process.load() == self ||
+          holder.process.compare_exchange_strong(process, self) || process == self) {
+        holder.count.fetch_add(count);
+        return;
+      }
+    }
+  }
+
+  void Release(uint32_t count) {
+    uint64_t self = CurrentProcessInstance();
+    for (Holder& holder : holders_) {
+      if (holder.process.load() != self) continue;
+      uint32_t held = holder.count.load();
+      while (held > 0 && !holder.count.compare_exchange_weak(held, held - std::min(held, count))) {
+      }
+      count -= std::min(held, count);
+      if (count == 0) return;
+    }
+  }
+
+  // Returns true if units held by dead processes were released.
+  bool ReclaimFromDeadProcesses() {
+    bool reclaimed = false;
+    for (Holder& holder : holders_) {
+      uint64_t process = holder.process.load();
+      if (process == 0 || process == kReclaiming || IsProcessInstanceAlive(process)) continue;
+      if (!holder.process.compare_exchange_strong(process, kReclaiming)) continue;
+      uint32_t count = holder.count.exchange(0);
+      holder.process.store(0);
+      if (count > 0) {
+        count_.fetch_add(count, std::memory_order_release);
+        if (num_waiters_.load() > 0) FutexWake(&count_, count);
+        reclaimed = true;
+      }
+    }
+    return reclaimed;
+  }
+
+  std::atomic<uint32_t> count_;
+  std::atomic<uint32_t> num_waiters_ = 0;
+  uint32_t robust_;
+  Holder holders_[kMaxProcesses] = {};
+};
+
+// Auto-reset event: set() wakes one waiting thread, or the next one to wait, and the event is
+// reset as that thread returns. set() only enters the kernel if a thread is waiting.
+//
+// A robust event remembers the process that last set it. Waiting on an unset event whose last
+// setter died returns kOwnerDied instead of blocking forever. A setter that exits normally calls
+// detach() first, so that waiters don't take its exit for a crash.
+class Event {
+ public:
+  explicit Event(bool robust = false) : robust_(robust) {}
+
+  Event(const Event&) = delete;
+  Event& operator=(const Event&) = delete;
+
+  void set() {
+    if (robust_) setter_.store(CurrentProcessInstance(), std::memory_order_relaxed);
+    state_.store(1);
+    if (num_waiters_.load() > 0) FutexWake(&state_);
+  }
+
+  bool try_wait() {
+    uint32_t state = 1;
+    return state_.compare_exchange_strong(state, 0, std::memory_order_acquire,
+                                          std::memory_order_relaxed);
+  }
+
+  SyncStatus wait() { return wait_for(kInfinite); }
+
+  SyncStatus wait_for(std::chrono::nanoseconds timeout) {
+    internal::Deadline deadline(timeout);
+    while (!try_wait()) {
+      uint64_t setter = setter_.load(std::memory_order_relaxed);
+      if (robust_ && setter != 0 && !IsProcessInstanceAlive(setter)) return SyncStatus::kOwnerDied;
+      auto wait = deadline.Remaining(robust_ ? kRobustPollInterval : kInfinite);
+      if (wait.count() == 0) return SyncStatus::kTimedOut;
+      num_waiters_.fetch_add(1);
+      FutexWait(&state_, 0, wait);
+      num_waiters_.fetch_sub(1, std::memory_order_relaxed);
+    }
+    return SyncStatus::kOk;
+  }
+
+  // Forgets the calling process as the last setter of a robust event, whose waiters then block
+  // until another process sets it, whether the calling process exits or not.
+  void detach() {
+    uint64_t self = CurrentProcessInstance();
+    setter_.compare_exchange_strong(self, 0, std::memory_order_relaxed);
+  }
+
+ private:
+  std::atomic<uint32_t> state_ = 0;
+  std::atomic<uint32_t> num_waiters_ = 0;
+  uint32_t robust_;
+  // See CurrentProcessInstance().
+  std::atomic<uint64_t> setter_ = 0;
+};
+
+// Reusable barrier for a fixed number of threads, possibly in different processes.
+//
+// A robust barrier remembers the processes that arrived at it, up to kMaxProcesses. If one of them
+// dies, the barrier is broken: waiting threads and all later arrivals get kOwnerDied. A process
+// that stops taking part, e.g. to exit normally while others replace its threads, calls detach()
+// so that its exit doesn't break the barrier.
+class Barrier {
+ public:
+  static constexpr size_t kMaxProcesses = 64;
+
+  explicit Barrier(uint32_t num_threads, bool robust = false)
+      : num_threads_(num_threads), robust_(robust) {}
+
+  Barrier(const Barrier&) = delete;
+  Barrier& operator=(const Barrier&) = delete;
+
+  SyncStatus arrive_and_wait() {
+    if (broken_.load()) return SyncStatus::kOwnerDied;
+    if (robust_) Register();
+    // Read before arriving: the generation can't change until this thread arrives.
+    uint32_t generation = generation_.load(std::memory_order_acquire);
+    if (num_arrived_.fetch_add(1, std::memory_order_acq_rel) + 1 == num_threads_) {
+      num_arrived_.store(0, std::memory_order_relaxed);
+      generation_.fetch_add(1, std::memory_order_release);
+      FutexWakeAll(&generation_);
+      return SyncStatus::kOk;
+    }
+    while (generation_.load(std::memory_order_acquire) == generation) {
+      if (broken_.load()) return SyncStatus::kOwnerDied;
+      if (robust_ && AnyProcessDied()) {
+        broken_.store(1);
+        FutexWakeAll(&generation_);
+        return SyncStatus::kOwnerDied;
+      }
+      FutexWait(&generation_, generation, robust_ ? kRobustPollInterval : kInfinite);
+    }
+    return SyncStatus::kOk;
+  }
+
+  bool broken() const { return broken_.load() != 0; }
+
+  // Forgets the calling process as a participant of a robust barrier. Its threads must not arrive
+  // at the barrier anymore.
+  void detach() {
+    uint64_t self = CurrentProcessInstance();
+    for (std::atomic<uint64_t>& process : processes_) {
+      uint64_t expected = self;
+      if (process.compare_exchange_strong(expected, 0)) return;
+    }
+  }
+
+ private:
+  void Register() {
+    uint64_t self = CurrentProcessInstance();
+    for (std::atomic<uint64_t>& process : processes_) {
+      if (process.load(std::memory_order_relaxed) == self) return;
+    }
+    for (std::atomic<uint64_t>& process : processes_) {
+      uint64_t expected = 0;
+      if (process.compare_exchange_strong(expected, self) || expected == self) return;
+    }
+  }
+
+  bool AnyProcessDied() {
+    for (std::atomic<uint64_t>& process : processes_) {
+      uint64_t instance = process.load(std::memory_order_relaxed);
+      if (instance != 0 && !IsProcessInstanceAlive(instance)) return true;
+    }
+    return false;
+  }
+
+  std::atomic<uint32_t> generation_ = 0;
+  std::atomic<uint32_t> num_arrived_ = 0;
+  std::atomic<uint32_t> broken_ = 0;
+  uint32_t num_threads_;
+  uint32_t robust_;
+  // See CurrentProcessInstance().
+  std::atomic<uint64_t> processes_[kMaxProcesses] = {};
+};
+
+}  // namespace sham
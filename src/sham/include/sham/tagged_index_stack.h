@@ -0,0 +1,80 @@
+/*
+MIT License - Copyright (c) 2023 Pierric Gimmig
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+
+namespace sham {
+
+// Lock-free LIFO stack of 32-bit indices into an array of nodes owned by the caller, e.g. the free
+// blocks of a pool. The link to the next index is stored in the node itself and accessed through
+// the `link` callable passed to Push() and Pop(), which returns a std::atomic<uint32_t>& for an
+// index. The head is tagged with a counter incremented on each update to prevent the ABA problem,
+// so the stack works across processes without any pointer. Zero-filled memory is an empty stack.
+class TaggedIndexStack {
+ public:
+  static constexpr uint32_t kEmpty = std::numeric_limits<uint32_t>::max();
+
+  template <typename LinkFn>
+  void Push(uint32_t index, LinkFn&& link) {
+    uint64_t head = head_.load(std::memory_order_relaxed);
+    uint64_t new_head = 0;
+    do {
+      link(index).store(Index(head), std::memory_order_relaxed);
+      new_head = Head(index, Tag(head) + 1);
+    } while (!head_.compare_exchange_weak(head, new_head, std::memory_order_release,
+                                          std::memory_order_relaxed));
+  }
+
+  // Returns kEmpty if the stack is empty.
+  template <typename LinkFn>
+  uint32_t Pop(LinkFn&& link) {
+    uint64_t head = head_.load(std::memory_order_acquire);
+    while (Index(head) != kEmpty) {
+      // The node might have been popped and reused concurrently, in which case the link read here
+      // is garbage but the tag changed and the exchange fails.
+      uint32_t next = link(Index(head)).load(std::memory_order_relaxed);
+      if (head_.compare_exchange_weak(head, Head(next, Tag(head) + 1), std::memory_order_acquire,
+                                      std::memory_order_acquire)) {
+        return Index(head);
+      }
+    }
+    return kEmpty;
+  }
+
+  bool empty() const { return Index(head_.load(std::memory_order_relaxed)) == kEmpty; }
+
+ private:
+  // Indices are stored plus one so that a zero head is an empty stack.
+  static uint32_t Index(uint64_t head) { return static_cast<uint32_t>(head) - 1; }
+  static uint32_t Tag(uint64_t head) { return static_cast<uint32_t>(head >> 32); }
+  static uint64_t Head(uint32_t index, uint32_t tag) {
+    return (static_cast<uint64_t>(tag) << 32) | static_cast<uint32_t>(index + 1);
+  }
+
+  std::atomic<uint64_t> head_ = 0;
+};
+
+}  // namespace sham
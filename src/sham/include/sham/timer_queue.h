@@ -0,0 +1,381 @@
+/*
+MIT License - Copyright (c) 2023 Pierric Gimmig
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <new>
+#include <utility>
+
+#include "sham/offset_ptr.h"
+#include "sham/pool_allocator.h"
+#include "sham/queue_mpsc.h"
+#include "sham/timer.h"
+
+namespace sham {
+
+// Unbounded queue of values delivered not before their deadline, e.g. retries, expiries and
+// heartbeats, with producers in any thread of any process and a single consumer.
+//
+// Producers push timers to an mpsc::IntrusiveQueue with a single atomic exchange, whatever their
+// deadline. The consumer moves them to a hierarchical timing wheel that only it accesses, with
+// kLevels levels of kSlotsPerLevel slots each covering kSlotsPerLevel times the range of the level
+// below, see Varghese and Lauck. Scheduling, delivering, and each move of a timer to a lower level
+// as its deadline approaches, take constant time, whatever the number of pending timers. PopDue()
+// delivers all the timers due in one batch, and jumps over empty slots with per-level bitmaps.
+//
+// Slots hold buckets of the offsets and deadlines of their timers rather than lists linked through
+// the timers, so that moving timers between levels never touches them, and delivering them can
+// prefetch them: with millions of pending timers, each would otherwise be a cache miss. Buckets
+// take 1KB, so the pool needs up to 1MB for those of partly filled slots on top of the timers.
+//
+// Time is in nanoseconds of CoarseClockNs(), unless the caller passes its own times to
+// ScheduleAt() and PopDue(). Deadlines are rounded up to the next tick, of `tick_ns` nanoseconds.
+// Timers and buckets are allocated from a PoolAllocator, which must live in the same
+// SharedMemoryBuffer as the queue. Pass a PoolAllocator::Cache, one per thread, to amortize
+// allocations.
+//
+// Example:
+//   auto* pool = buffer.Allocate<sham::PoolAllocator>(buffer, 64 * 1024 * 1024);
+//   auto* timers = buffer.Allocate<sham::TimerQueue<OrderId>>(*pool);
+//   timers->ScheduleAfter(30'000'000'000, order_id, &cache);     // Producers.
+//   timers->PopDue([](OrderId& id) { Expire(id); }, &cache);     // Consumer.
+template <typename T>
+class TimerQueue {
+ public:
+  static constexpr size_t kLevels = 4;
+  static constexpr size_t kSlotsPerLevel = 256;
+
+  // Ticks are counted from `start_ns`. With the default tick of 1ms, deadlines up to about 50 days
+  // ahead fit in the wheel. Later ones are moved down when the last level comes around.
+  explicit TimerQueue(PoolAllocator& pool, uint64_t tick_ns = 1'000'000,
+                      uint64_t start_ns = CoarseClockNs())
+      : pool_(&pool), tick_ns_(tick_ns), start_ns_(start_ns) {}
+
+  // Frees the pending timers. Must be called by the consumer, or once all the threads are done
+  // with the queue.
+  ~TimerQueue() {
+    while (mpsc::Hook* hook = incoming_.Pop()) Free(static_cast<Node*>(hook), nullptr);
+    FreeList(deferred_, nullptr, [](T&) {});
+    for (size_t level = 0; level < kLevels; ++level) {
+      for (size_t slot = 0; slot < kSlotsPerLevel; ++slot) {
+        for (Bucket* bucket = TakeSlot(level, slot); bucket != nullptr;) {
+          for (uint32_t i = 0; i < bucket->size; ++i) {
+            Free(At<Node>(bucket->entries[i].node), nullptr);
+          }
+          bucket = FreeBucket(bucket, nullptr);
+        }
+      }
+    }
+  }
+
+  TimerQueue(const TimerQueue&) = delete;
+  TimerQueue& operator=(const TimerQueue&) = delete;
+
+  // Size of the pool blocks taken by each timer.
+  static constexpr size_t NodeSize() { return PoolAllocator::BlockSize(sizeof(Node)); }
+
+  // Can be called by any number of threads of any process. Returns false if the pool is out of
+  // memory.
+  [[nodiscard]] bool ScheduleAt(uint64_t deadline_ns, const T& value,
+                                PoolAllocator::Cache* cache = nullptr) {
+    void* memory = Allocate(sizeof(Node), cache);
+    if (memory == nullptr) return false;
+    uint64_t since_start = deadline_ns > start_ns_ ? deadline_ns - start_ns_ : 0;
+    incoming_.Push(new (memory) Node{{}, (since_start + tick_ns_ - 1) / tick_ns_, kNull, value});
+    return true;
+  }
+
+  [[nodiscard]] bool ScheduleAfter(uint64_t delay_ns, const T& value,
+                                   PoolAllocator::Cache* cache = nullptr) {
+    return ScheduleAt(CoarseClockNs() + delay_ns, value, cache);
+  }
+
+  // Calls `deliver(T& value)` on every timer whose deadline is not after `now_ns`, in the order of
+  // their deadline ticks unless the pool ran out of memory. Timers scheduled by `deliver` are left
+  // to the next call. Returns the number of timers delivered. Consumer only.
+  template <typename DeliverFn>
+  size_t PopDue(uint64_t now_ns, DeliverFn&& deliver, PoolAllocator::Cache* cache = nullptr) {
+    uint64_t now_tick = now_ns > start_ns_ ? (now_ns - start_ns_) / tick_ns_ : 0;
+    // Due timers are collected first, so that the wheel is consistent when `deliver` runs.
+    DueTimers due;
+    auto collect_or_insert = [&](const Entry& entry) {
+      bool is_due = entry.deadline_tick <= current_tick_;
+      if (is_due ? due.Append(*this, entry, cache) : Insert(entry, cache)) return;
+      // Out of memory for a bucket, the timer waits in a list linked through the timers.
+      int64_t& list = is_due ? due.list : deferred_;
+      Node* node = At<Node>(entry.node);
+      node->deadline_tick = entry.deadline_tick;
+      node->next = list;
+      list = entry.node;
+    };
+    while (mpsc::Hook* hook = incoming_.Pop()) {
+      Node* node = static_cast<Node*>(hook);
+      collect_or_insert({Offset(node), node->deadline_tick});
+    }
+
+    while (num_timers_ > 0) {
+      uint64_t tick = NextTickToVisit();
+      if (tick > now_tick) break;
+      current_tick_ = tick;
+      // Moves the timers of the slots of upper levels that start at this tick down, highest first,
+      // then collects those of the first level.
+      for (size_t level = kLevels; level-- > 0;) {
+        if ((tick & ((uint64_t{1} << (kSlotBits * level)) - 1)) != 0) continue;
+        for (Bucket* bucket = TakeSlot(level, SlotIndex(tick, level)); bucket != nullptr;) {
+          num_timers_ -= bucket->size;
+          for (uint32_t i = 0; i < bucket->size; ++i) collect_or_insert(bucket->entries[i]);
+          bucket = FreeBucket(bucket, cache);
+        }
+      }
+    }
+    current_tick_ = std::max(current_tick_, now_tick);
+    // Timers deferred for lack of memory, delivered after those of the wheel if they are due.
+    for (int64_t offset = std::exchange(deferred_, kNull); offset != kNull;) {
+      Node* node = At<Node>(offset);
+      int64_t next = node->next;
+      collect_or_insert({offset, node->deadline_tick});
+      offset = next;
+    }
+    return due.Deliver(*this, deliver, cache);
+  }
+
+  template <typename DeliverFn>
+  size_t PopDue(DeliverFn&& deliver, PoolAllocator::Cache* cache = nullptr) {
+    return PopDue(CoarseClockNs(), std::forward<DeliverFn>(deliver), cache);
+  }
+
+  // Returns true if there is no pending timer. Consumer only.
+  bool empty() const { return num_timers_ == 0 && deferred_ == kNull && incoming_.empty(); }
+
+ private:
+  static constexpr size_t kSlotBits = std::countr_zero(kSlotsPerLevel);
+  // Offsets of nodes and buckets are never 0, which is the queue itself.
+  static constexpr int64_t kNull = 0;
+  // Number of timers delivered ahead of the one prefetched.
+  static constexpr uint32_t kPrefetchDistance = 8;
+
+  struct Node : mpsc::Hook {
+    uint64_t deadline_tick;
+    // Next node in the list of the timers without a bucket.
+    int64_t next;
+    T value;
+  };
+
+  struct Entry {
+    int64_t node;
+    uint64_t deadline_tick;
+  };
+
+  // Entries of the timers of a slot, in a pool block.
+  struct Bucket {
+    static constexpr size_t kBlockSize = 1024;
+    static constexpr uint32_t kCapacity = (kBlockSize - 2 * sizeof(int64_t)) / sizeof(Entry);
+
+    int64_t next;
+    uint32_t size;
+    Entry entries[kCapacity];
+  };
+
+  // Timers collected by PopDue(), in buckets appended in order, then in a list of nodes for those
+  // collected once the pool was out of memory.
+  struct DueTimers {
+    bool Append(TimerQueue& queue, const Entry& entry, PoolAllocator::Cache* cache) {
+      Bucket* bucket = queue.At<Bucket>(tail);
+      if (bucket == nullptr || bucket->size == Bucket::kCapacity) {
+        Bucket* next = queue.NewBucket(kNull, cache);
+        if (next == nullptr) return false;
+        (bucket == nullptr ? head : bucket->next) = queue.Offset(next);
+        tail = queue.Offset(next);
+        bucket = next;
+      }
+      bucket->entries[bucket->size++] = entry;
+      return true;
+    }
+
+    template <typename DeliverFn>
+    size_t Deliver(TimerQueue& queue, DeliverFn& deliver, PoolAllocator::Cache* cache) {
+      size_t num_delivered = 0;
+      for (Bucket* bucket = queue.At<Bucket>(head); bucket != nullptr;) {
+        for (uint32_t i = 0; i < bucket->size; ++i) {
+#if defined(__GNUC__)
+          if (i + kPrefetchDistance < bucket->size) {
+            __builtin_prefetch(queue.At<Node>(bucket->entries[i + kPrefetchDistance].node));
+          }
+#endif
+          Node* node = queue.At<Node>(bucket->entries[i].node);
+          deliver(node->value);
+          queue.Free(node, cache);
+        }
+        num_delivered += bucket->size;
+        bucket = queue.FreeBucket(bucket, cache);
+      }
+      return num_delivered + queue.FreeList(list, cache, deliver);
+    }
+
+    int64_t head = kNull;
+    int64_t tail = kNull;
+    int64_t list = kNull;
+  };
+
+  static size_t SlotIndex(uint64_t tick, size_t level) {
+    return (tick >> (kSlotBits * level)) & (kSlotsPerLevel - 1);
+  }
+
+  template <typename U>
+  int64_t Offset(const U* object) const {
+    return reinterpret_cast<const uint8_t*>(object) - reinterpret_cast<const uint8_t*>(this);
+  }
+  template <typename U>
+  U* At(int64_t offset) const {
+    if (offset == kNull) return nullptr;
+    return reinterpret_cast<U*>(const_cast<uint8_t*>(reinterpret_cast<const uint8_t*>(this)) +
+                                offset);
+  }
+
+  void* Allocate(size_t size, PoolAllocator::Cache* cache) {
+    return cache != nullptr ? cache->Allocate(size) : pool_->Allocate(size);
+  }
+
+  void Free(void* block, PoolAllocator::Cache* cache) {
+    if (cache != nullptr) {
+      cache->Free(block);
+    } else {
+      pool_->Free(block);
+    }
+  }
+
+  void Free(Node* node, PoolAllocator::Cache* cache) {
+    node->~Node();
+    Free(static_cast<void*>(node), cache);
+  }
+
+  Bucket* NewBucket(int64_t next, PoolAllocator::Cache* cache) {
+    void* memory = Allocate(sizeof(Bucket), cache);
+    if (memory == nullptr) return nullptr;
+    auto* bucket = static_cast<Bucket*>(memory);
+    bucket->next = next;
+    bucket->size = 0;
+    return bucket;
+  }
+
+  // Returns the next bucket.
+  Bucket* FreeBucket(Bucket* bucket, PoolAllocator::Cache* cache) {
+    Bucket* next = At<Bucket>(bucket->next);
+    Free(static_cast<void*>(bucket), cache);
+    return next;
+  }
+
+  // Frees the nodes of a list linked through Node::next, after calling `deliver` on their value.
+  // Returns their number.
+  template <typename DeliverFn>
+  size_t FreeList(int64_t offset, PoolAllocator::Cache* cache, DeliverFn&& deliver) {
+    size_t num_nodes = 0;
+    for (Node* node = At<Node>(offset); node != nullptr; ++num_nodes) {
+      Node* next = At<Node>(node->next);
+      deliver(node->value);
+      Free(node, cache);
+      node = next;
+    }
+    return num_nodes;
+  }
+
+  // Puts a timer that isn't due yet in the lowest level whose range covers its deadline. Returns
+  // false if the pool is out of memory for a new bucket.
+  bool Insert(const Entry& entry, PoolAllocator::Cache* cache) {
+    uint64_t delta = entry.deadline_tick - current_tick_;
+    size_t level = 0;
+    while (level < kLevels - 1 && delta >= (uint64_t{1} << (kSlotBits * (level + 1)))) ++level;
+    size_t slot = SlotIndex(entry.deadline_tick, level);
+    Bucket* bucket = At<Bucket>(slots_[level][slot]);
+    if (bucket == nullptr || bucket->size == Bucket::kCapacity) {
+      bucket = NewBucket(slots_[level][slot], cache);
+      if (bucket == nullptr) return false;
+      slots_[level][slot] = Offset(bucket);
+    }
+    bucket->entries[bucket->size++] = entry;
+    occupied_[level][slot / 64] |= uint64_t{1} << (slot % 64);
+    ++num_timers_;
+    return true;
+  }
+
+  Bucket* TakeSlot(size_t level, size_t slot) {
+    Bucket* buckets = At<Bucket>(slots_[level][slot]);
+    slots_[level][slot] = kNull;
+    occupied_[level][slot / 64] &= ~(uint64_t{1} << (slot % 64));
+    return buckets;
+  }
+
+  // Returns the first occupied slot of `level` from `begin` to `end` excluded, or kSlotsPerLevel.
+  size_t FindOccupied(size_t level, size_t begin, size_t end) const {
+    for (size_t slot = begin; slot < end;) {
+      uint64_t word = occupied_[level][slot / 64] >> (slot % 64);
+      if (word != 0) {
+        slot += std::countr_zero(word);
+        return slot < end ? slot : kSlotsPerLevel;
+      }
+      slot = (slot / 64 + 1) * 64;
+    }
+    return kSlotsPerLevel;
+  }
+
+  // The first tick after current_tick_ at which an occupied slot starts. The slots of a level up to
+  // the current one were visited in the current round of the level, those still occupied start in
+  // the next round.
+  uint64_t NextTickToVisit() const {
+    uint64_t next = std::numeric_limits<uint64_t>::max();
+    for (size_t level = 0; level < kLevels; ++level) {
+      size_t shift = kSlotBits * level;
+      uint64_t round_size = uint64_t{kSlotsPerLevel} << shift;
+      uint64_t round_start = current_tick_ & ~(round_size - 1);
+      size_t index = SlotIndex(current_tick_, level);
+      size_t slot = FindOccupied(level, index + 1, kSlotsPerLevel);
+      if (slot == kSlotsPerLevel) {
+        slot = FindOccupied(level, 0, index + 1);
+        if (slot == kSlotsPerLevel) continue;
+        round_start += round_size;
+      }
+      next = std::min(next, round_start + (uint64_t{slot} << shift));
+    }
+    return next;
+  }
+
+  mpsc::IntrusiveQueue incoming_;
+  OffsetPtr<PoolAllocator> pool_;
+  uint64_t tick_ns_;
+  uint64_t start_ns_;
+  // Consumer only. All the timers in the wheel are due after current_tick_.
+  alignas(64) uint64_t current_tick_ = 0;
+  size_t num_timers_ = 0;
+  // Timers that didn't get a bucket when the pool was out of memory, linked through Node::next.
+  int64_t deferred_ = kNull;
+  // Bitmaps of the occupied slots of each level.
+  uint64_t occupied_[kLevels][kSlotsPerLevel / 64] = {};
+  // Offsets of the first bucket of each slot.
+  int64_t slots_[kLevels][kSlotsPerLevel] = {};
+};
+
+}  // namespace sham
@@ -0,0 +1,103 @@
+/*
+MIT License - Copyright (c) 2023 Pierric Gimmig
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace sham {
+
+// Latest-value channel from one writer to one reader, for values too large for a SeqLock, e.g. a
+// snapshot of tens of KB which a SeqLock reader could keep retrying to copy while the writer
+// rewrites it. Three buffers rotate between the writer, the reader, and a middle slot holding the
+// newest published value:
+//  - The writer fills its back buffer in place, then Publish() exchanges it with the middle one
+//    with a single atomic exchange.
+//  - Read() exchanges the reader's front buffer with the middle one if it holds a newer value, and
+//    returns the front buffer, which the writer never touches until the next Read().
+// Neither side ever blocks or retries, and the reader always gets a complete value, the newest
+// published at the time of the call. Values published between two reads are skipped.
+//
+// Only one thread may write and one thread read at a time. Use one TripleBuffer per reader to fan
+// out a value. T is constructed three times and copied only by Store(), so it needn't be trivially
+// copyable, but must be suitable for shared memory. Buffers and the indices owned by each side are
+// on separate cache lines.
+//
+// Example:
+//   auto* book = buffer.FindOrConstruct<sham::TripleBuffer<OrderBook>>("book");
+//   FillOrderBook(book->write_buffer());     // Writer process.
+//   book->Publish();
+//   const OrderBook& latest = book->Read();  // Reader process.
+template <typename T>
+class TripleBuffer {
+ public:
+  TripleBuffer() = default;
+
+  TripleBuffer(const TripleBuffer&) = delete;
+  TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+  // The buffer the writer fills before calling Publish(). It holds an older value, or a default
+  // constructed T, so it must be written in full.
+  T* write_buffer() { return &buffers_[back_].value; }
+
+  // Makes the content of write_buffer() the newest value and switches to a new back buffer.
+  void Publish() {
+    uint32_t middle = middle_.exchange(back_ | kNewFlag, std::memory_order_acq_rel);
+    back_ = middle & kIndexMask;
+  }
+
+  void Store(const T& value) {
+    *write_buffer() = value;
+    Publish();
+  }
+
+  // Returns the newest value, valid until the next call to Read().
+  const T& Read() {
+    if (middle_.load(std::memory_order_relaxed) & kNewFlag) {
+      uint32_t middle = middle_.exchange(front_, std::memory_order_acq_rel);
+      front_ = middle & kIndexMask;
+    }
+    return buffers_[front_].value;
+  }
+
+  // Returns true if a value was published since the last Read().
+  bool has_new_value() const { return middle_.load(std::memory_order_relaxed) & kNewFlag; }
+
+ private:
+  static constexpr uint32_t kIndexMask = 3;
+  // Set in middle_ by Publish(), cleared by Read().
+  static constexpr uint32_t kNewFlag = 4;
+
+  struct alignas(64) Buffer {
+    T value{};
+  };
+
+  Buffer buffers_[3];
+  // Index of the buffer owned by the writer.
+  alignas(64) uint32_t back_ = 0;
+  alignas(64) std::atomic<uint32_t> middle_ = 1;
+  // Index of the buffer owned by the reader.
+  alignas(64) uint32_t front_ = 2;
+};
+
+}  // namespace sham
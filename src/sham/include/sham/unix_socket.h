@@ -0,0 +1,206 @@
+/*
+MIT License - Copyright (c) 2023 Pierric Gimmig
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+#include "sham/shared_memory.h"
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+// Local Unix domain sockets used to hand file mapping handles to other processes. Socket paths
+// starting with '@' live in the Linux abstract namespace and don't leave files behind. Not
+// supported on Windows, where every function fails.
+namespace sham {
+
+using SocketHandle = int;
+constexpr SocketHandle kInvalidSocketHandle = -1;
+
+// Create a socket listening for connections on `path`. An existing socket file is replaced.
+inline SocketHandle ListenUnixSocket(std::string_view path);
+// Wait for and accept a connection on a listening socket.
+inline SocketHandle AcceptUnixSocket(SocketHandle listening_socket);
+// Connect to a socket listening on `path`.
+inline SocketHandle ConnectUnixSocket(std::string_view path);
+// Close a socket. If `path` is not empty, the socket file is removed.
+inline void CloseUnixSocket(SocketHandle socket, std::string_view path = {});
+// Send a file mapping handle to the connected peer using SCM_RIGHTS. The caller keeps its handle.
+inline bool SendFileHandle(SocketHandle socket, FileHandle file_handle);
+// Receive a file mapping handle sent with SendFileHandle(). The caller owns the returned handle.
+inline FileHandle ReceiveFileHandle(SocketHandle socket);
+
+}  // namespace sham
+
+#ifdef _WIN32
+sham::SocketHandle sham::ListenUnixSocket(std::string_view) { return kInvalidSocketHandle; }
+
+sham::SocketHandle sham::AcceptUnixSocket(SocketHandle) { return kInvalidSocketHandle; }
+
+sham::SocketHandle sham::ConnectUnixSocket(std::string_view) { return kInvalidSocketHandle; }
+
+void sham::CloseUnixSocket(SocketHandle, std::string_view) {}
+
+bool sham::SendFileHandle(SocketHandle, FileHandle) { return false; }
+
+sham::FileHandle sham::ReceiveFileHandle(SocketHandle) { return kInvalidFileHandle; }
+#else
+namespace sham::detail {
+
+inline bool MakeUnixSocketAddress(std::string_view path, sockaddr_un* address,
+                                  socklen_t* address_size) {
+  memset(address, 0, sizeof(sockaddr_un));
+  address->sun_family = AF_UNIX;
+  if (path.empty() || path.size() >= sizeof(address->sun_path)) return false;
+  memcpy(address->sun_path, path.data(), path.size());
+  if (path[0] == '@') address->sun_path[0] = '\0';
+  *address_size = static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + path.size());
+  return true;
+}
+
+inline bool IsAbstractSocketPath(std::string_view path) { return !path.empty() && path[0] == '@'; }
+
+#ifdef SOCK_CLOEXEC
+constexpr int kUnixSocketType = SOCK_STREAM | SOCK_CLOEXEC;
+#else
+constexpr int kUnixSocketType = SOCK_STREAM;
+#endif
+
+}  // namespace sham::detail
+
+sham::SocketHandle sham::ListenUnixSocket(std::string_view path) {
+  sockaddr_un address;
+  socklen_t address_size;
+  if (!detail::MakeUnixSocketAddress(path, &address, &address_size)) return kInvalidSocketHandle;
+
+  SocketHandle handle = socket(AF_UNIX, detail::kUnixSocketType, 0);
+  if (handle == -1) {
+    perror("Can't create socket");
+    return kInvalidSocketHandle;
+  }
+
+  if (!detail::IsAbstractSocketPath(path)) unlink(address.sun_path);
+  if (bind(handle, reinterpret_cast<sockaddr*>(&address), address_size) == -1 ||
+      listen(handle, SOMAXCONN) == -1) {
+    perror("Can't listen on socket");
+    close(handle);
+    return kInvalidSocketHandle;
+  }
+  return handle;
+}
+
+sham::SocketHandle sham::AcceptUnixSocket(SocketHandle listening_socket) {
+  SocketHandle handle = accept(listening_socket, nullptr, nullptr);
+  if (handle == -1) perror("Can't accept connection on socket");
+  return handle;
+}
+
+sham::SocketHandle sham::ConnectUnixSocket(std::string_view path) {
+  sockaddr_un address;
+  socklen_t address_size;
+  if (!detail::MakeUnixSocketAddress(path, &address, &address_size)) return kInvalidSocketHandle;
+
+  SocketHandle handle = socket(AF_UNIX, detail::kUnixSocketType, 0);
+  if (handle == -1) {
+    perror("Can't create socket");
+    return kInvalidSocketHandle;
+  }
+
+  if (connect(handle, reinterpret_cast<sockaddr*>(&address), address_size) == -1) {
+    perror("Can't connect to socket");
+    close(handle);
+    return kInvalidSocketHandle;
+  }
+  return handle;
+}
+
+void sham::CloseUnixSocket(SocketHandle socket, std::string_view path) {
+  if (socket != kInvalidSocketHandle) close(socket);
+  if (!path.empty() && !detail::IsAbstractSocketPath(path)) unlink(std::string(path).c_str());
+}
+
+bool sham::SendFileHandle(SocketHandle socket, FileHandle file_handle) {
+  // At least one byte of regular data must accompany the ancillary data.
+  char data = 0;
+  iovec io = {&data, sizeof(data)};
+  alignas(cmsghdr) char control[CMSG_SPACE(sizeof(FileHandle))] = {};
+
+  msghdr message = {};
+  message.msg_iov = &io;
+  message.msg_iovlen = 1;
+  message.msg_control = control;
+  message.msg_controllen = sizeof(control);
+
+  cmsghdr* control_message = CMSG_FIRSTHDR(&message);
+  control_message->cmsg_level = SOL_SOCKET;
+  control_message->cmsg_type = SCM_RIGHTS;
+  control_message->cmsg_len = CMSG_LEN(sizeof(FileHandle));
+  memcpy(CMSG_DATA(control_message), &file_handle, sizeof(FileHandle));
+
+  if (sendmsg(socket, &message, 0) == -1) {
+    perror("Can't send file handle");
+    return false;
+  }
+  return true;
+}
+
+sham::FileHandle sham::ReceiveFileHandle(SocketHandle socket) {
+  char data = 0;
+  iovec io = {&data, sizeof(data)};
+  alignas(cmsghdr) char control[CMSG_SPACE(sizeof(FileHandle))] = {};
+
+  msghdr message = {};
+  message.msg_iov = &io;
+  message.msg_iovlen = 1;
+  message.msg_control = control;
+  message.msg_controllen = sizeof(control);
+
+#ifdef MSG_CMSG_CLOEXEC
+  constexpr int kFlags = MSG_CMSG_CLOEXEC;
+#else
+  constexpr int kFlags = 0;
+#endif
+  if (recvmsg(socket, &message, kFlags) <= 0) {
+    perror("Can't receive file handle");
+    return kInvalidFileHandle;
+  }
+
+  cmsghdr* control_message = CMSG_FIRSTHDR(&message);
+  if (control_message == nullptr || control_message->cmsg_level != SOL_SOCKET ||
+      control_message->cmsg_type != SCM_RIGHTS ||
+      control_message->cmsg_len != CMSG_LEN(sizeof(FileHandle))) {
+    return kInvalidFileHandle;
+  }
+
+  FileHandle file_handle;
+  memcpy(&file_handle, CMSG_DATA(control_message), sizeof(FileHandle));
+  return file_handle;
+}
+#endif
@@ -0,0 +1,120 @@
+/*
+MIT License - Copyright (c) 2023 Pierric Gimmig
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <type_traits>
+
+namespace sham {
+
+// Chase-Lev work-stealing deque of kCapacity elements, in the C11 formulation of Le et al. The
+// owner thread pushes and pops elements at the bottom, LIFO, which keeps recently spawned work
+// cache-hot, while any other thread, in any process if the deque is in shared memory, steals the
+// oldest elements from the top. Push and pop are wait-free and only take a compare-and-swap when
+// the owner races with thieves for the last element, steal takes one compare-and-swap.
+//
+// Unlike the original deque, the circular array doesn't grow, so that the deque can live in shared
+// memory: push() fails when the deque is full. T must be trivially copyable, typically an index or
+// a pointer. Zero-filled memory is an empty deque.
+template <typename T, size_t kCapacity>
+class WorkStealingDeque {
+ public:
+  static_assert(std::is_trivially_copyable_v<T>);
+  static_assert(kCapacity > 0 && (kCapacity & (kCapacity - 1)) == 0);
+
+  WorkStealingDeque() = default;
+
+  WorkStealingDeque(const WorkStealingDeque&) = delete;
+  WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+  // Owner only. Returns false if the deque is full.
+  bool push(const T& value) {
+    int64_t bottom = bottom_.load(std::memory_order_relaxed);
+    int64_t top = top_.load(std::memory_order_acquire);
+    if (bottom - top >= static_cast<int64_t>(kCapacity)) return false;
+    slot(bottom).store(value, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom_.store(bottom + 1, std::memory_order_relaxed);
+    return true;
+  }
+
+  // Owner only. Returns the newest element.
+  std::optional<T> pop() {
+    int64_t bottom = bottom_.load(std::memory_order_relaxed) - 1;
+    bottom_.store(bottom, std::memory_order_relaxed);
+    // Orders the reservation of the bottom element before reading the top, see steal().
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t top = top_.load(std::memory_order_relaxed);
+    if (top > bottom) {
+      bottom_.store(bottom + 1, std::memory_order_relaxed);
+      return std::nullopt;
+    }
+    T value = slot(bottom).load(std::memory_order_relaxed);
+    if (top == bottom) {
+      // Last element, thieves may be taking it too.
+      bool won = top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                              std::memory_order_relaxed);
+      bottom_.store(bottom + 1, std::memory_order_relaxed);
+      if (!won) return std::nullopt;
+    }
+    return value;
+  }
+
+  // Any thread. Returns the oldest element, or nothing if the deque is empty or another thread
+  // took the element first.
+  std::optional<T> steal() {
+    int64_t top = top_.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t bottom = bottom_.load(std::memory_order_acquire);
+    if (top >= bottom) return std::nullopt;
+    T value = slot(top).load(std::memory_order_relaxed);
+    if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                      std::memory_order_relaxed)) {
+      return std::nullopt;
+    }
+    return value;
+  }
+
+  // Approximate when called concurrently with other operations.
+  size_t size() const {
+    int64_t size = bottom_.load(std::memory_order_relaxed) - top_.load(std::memory_order_relaxed);
+    return size > 0 ? static_cast<size_t>(size) : 0;
+  }
+  bool empty() const { return size() == 0; }
+
+  static constexpr size_t capacity() { return kCapacity; }
+
+ private:
+  std::atomic<T>& slot(int64_t index) { return slots_[index & (kCapacity - 1)]; }
+
+  // Modified by thieves.
+  alignas(64) std::atomic<int64_t> top_ = 0;
+  // Modified by the owner.
+  alignas(64) std::atomic<int64_t> bottom_ = 0;
+  alignas(64) std::atomic<T> slots_[kCapacity] = {};
+};
+
+}  // namespace sham
@@ -0,0 +1,213 @@
+/*
+MIT License - Copyright (c) 2023 Pierric Gimmig
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#include "sham/containers.h"
+
+#include <cstring>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "sham/offset_ptr.h"
+
+static constexpr const char* kSharedMemoryName = "containers_test";
+
+TEST(OffsetPtrTest, NullAndZeroMemory) {
+  sham::OffsetPtr<int> ptr;
+  EXPECT_FALSE(ptr);
+  EXPECT_EQ(ptr.get(), nullptr);
+  EXPECT_EQ(ptr, nullptr);
+
+  alignas(sham::OffsetPtr<int>) std::byte memory[sizeof(sham::OffsetPtr<int>)] = {};
+  EXPECT_EQ(reinterpret_cast<sham::OffsetPtr<int>*>(memory)->get(), nullptr);
+}
+
+TEST(OffsetPtrTest, PointsToTargetAfterCopy) {
+  int values[4] = {1, 2, 3, 4};
+  sham::OffsetPtr<int> ptr = &values[1];
+  EXPECT_EQ(*ptr, 2);
+  EXPECT_EQ(ptr[1], 3);
+
+  auto copy = std::make_unique<sham::OffsetPtr<int>>(ptr);
+  EXPECT_EQ(copy->get(), &values[1]);
+  EXPECT_NE(copy->offset(), ptr.offset());
+
+  ++ptr;
+  EXPECT_EQ(*ptr, 3);
+  ptr -= 2;
+  EXPECT_EQ(*ptr, 1);
+  EXPECT_EQ(*copy - ptr, 1);
+  sham::OffsetPtr<const int> const_ptr = ptr;
+  EXPECT_EQ(const_ptr.get(), &values[0]);
+  ptr = nullptr;
+  EXPECT_FALSE(ptr);
+}
+
+TEST(OffsetPtrTest, RawCopyWithTarget) {
+  struct Node {
+    int value;
+    sham::OffsetPtr<int> ptr;
+  };
+  Node a{42, nullptr};
+  a.ptr = &a.value;
+  Node b;
+  // Copies the bytes as a segment mapped elsewhere would see them, bypassing OffsetPtr's copy.
+  std::memcpy(static_cast<void*>(&b), &a, sizeof(Node));
+  EXPECT_EQ(b.ptr.get(), &b.value);
+}
+
+TEST(ContainersTest, FixedVector) {
+  sham::FixedVector<std::string, 3> vector;
+  EXPECT_TRUE(vector.empty());
+  EXPECT_EQ(vector.capacity(), 3);
+  EXPECT_TRUE(vector.push_back("a"));
+  EXPECT_NE(vector.emplace_back(2, 'b'), nullptr);
+  EXPECT_TRUE(vector.push_back("c"));
+  EXPECT_TRUE(vector.full());
+  EXPECT_FALSE(vector.push_back("d"));
+  EXPECT_EQ(std::vector<std::string>(vector.begin(), vector.end()),
+            (std::vector<std::string>{"a", "bb", "c"}));
+  vector.pop_back();
+  EXPECT_EQ(vector.back(), "bb");
+  vector.clear();
+  EXPECT_TRUE(vector.empty());
+}
+
+TEST(ContainersTest, FixedString) {
+  sham::FixedString<5> str;
+  EXPECT_STREQ(str.c_str(), "");
+  EXPECT_EQ(str.capacity(), 5);
+  EXPECT_TRUE(str.assign("abc"));
+  EXPECT_TRUE(str.append("de"));
+  EXPECT_FALSE(str.push_back('f'));
+  EXPECT_EQ(str, "abcde");
+  EXPECT_STREQ(str.c_str(), "abcde");
+  EXPECT_FALSE(str.assign("abcdef"));
+  EXPECT_EQ(str, "abcde");
+  str.clear();
+  EXPECT_EQ(str.view(), "");
+}
+
+TEST(ContainersTest, FixedList) {
+  sham::FixedList<int, 4> list;
+  EXPECT_TRUE(list.push_back(2));
+  EXPECT_TRUE(list.push_back(3));
+  EXPECT_TRUE(list.push_front(1));
+  EXPECT_TRUE(list.push_back(4));
+  EXPECT_TRUE(list.full());
+  EXPECT_FALSE(list.push_back(5));
+  EXPECT_EQ(std::vector<int>(list.begin(), list.end()), (std::vector<int>{1, 2, 3, 4}));
+
+  // Erased nodes are reused.
+  auto it = list.erase(std::next(list.begin()));
+  EXPECT_EQ(*it, 3);
+  list.pop_back();
+  list.pop_front();
+  EXPECT_EQ(list.size(), 1);
+  EXPECT_EQ(list.front(), 3);
+  EXPECT_EQ(list.back(), 3);
+  EXPECT_TRUE(list.push_front(2));
+  EXPECT_TRUE(list.push_back(4));
+  EXPECT_TRUE(list.push_back(5));
+  EXPECT_FALSE(list.push_back(6));
+  EXPECT_EQ(std::vector<int>(list.begin(), list.end()), (std::vector<int>{2, 3, 4, 5}));
+}
+
+TEST(ContainersTest, ZeroFilledMemoryIsEmpty) {
+  using Containers = std::tuple<sham::FixedVector<int, 8>, sham::FixedString<8>,
+                                sham::FixedList<int, 8>, sham::ArenaVector<int>>;
+  alignas(Containers) std::byte memory[sizeof(Containers)] = {};
+  auto& [vector, str, list, arena_vector] = *reinterpret_cast<Containers*>(memory);
+  EXPECT_TRUE(vector.empty());
+  EXPECT_STREQ(str.c_str(), "");
+  EXPECT_TRUE(list.empty());
+  EXPECT_TRUE(list.push_back(1));
+  EXPECT_EQ(list.front(), 1);
+  EXPECT_EQ(arena_vector.capacity(), 0);
+}
+
+TEST(ContainersTest, ArenaContainersInSharedMemory) {
+  sham::SharedMemoryBuffer buffer(kSharedMemoryName, 64 * 1024,
+                                  sham::SharedMemoryBuffer::Type::kCreate);
+  auto* list = buffer.Allocate<sham::ArenaList<sham::FixedString<15>>>(buffer, 16);
+  auto* vector = buffer.Allocate<sham::ArenaVector<int>>(buffer, 100);
+  auto* str = buffer.Allocate<sham::ArenaString>(buffer, 64);
+  ASSERT_NE(str, nullptr);
+  EXPECT_EQ(list->capacity(), 16);
+  EXPECT_EQ(vector->capacity(), 100);
+  EXPECT_EQ(str->capacity(), 63);
+
+  for (int i = 0; i < 100; ++i) EXPECT_TRUE(vector->push_back(i));
+  EXPECT_TRUE(list->emplace_back()->assign("world"));
+  EXPECT_TRUE(list->emplace_front()->assign("hello"));
+  EXPECT_TRUE(str->assign("shared memory"));
+
+  // A second mapping of the same memory, at a different address, sees the same containers.
+  sham::SharedMemoryBuffer other(kSharedMemoryName, 64 * 1024,
+                                 sham::SharedMemoryBuffer::Type::kAccessExisting);
+  ASSERT_NE(other.data(), buffer.data());
+  auto offset = [&](const void* ptr) {
+    return static_cast<const uint8_t*>(ptr) - static_cast<const uint8_t*>(buffer.data());
+  };
+  auto* other_list = other.As<sham::ArenaList<sham::FixedString<15>>>(offset(list));
+  auto* other_vector = other.As<sham::ArenaVector<int>>(offset(vector));
+  auto* other_str = other.As<sham::ArenaString>(offset(str));
+
+  std::vector<std::string> words;
+  for (const auto& word : *other_list) words.emplace_back(word.view());
+  EXPECT_EQ(words, (std::vector<std::string>{"hello", "world"}));
+  EXPECT_EQ(other_vector->size(), 100);
+  EXPECT_EQ((*other_vector)[99], 99);
+  EXPECT_EQ(*other_str, "shared memory");
+  EXPECT_NE(other_str->data(), str->data());
+}
+
+TEST(ContainersTest, ArenaStorageFromFullBuffer) {
+  sham::SharedMemoryBuffer buffer(kSharedMemoryName, 1024, sham::SharedMemoryBuffer::Type::kCreate);
+  sham::ArenaVector<int> vector(buffer, 1024);
+  EXPECT_EQ(vector.capacity(), 0);
+  EXPECT_FALSE(vector.push_back(1));
+  sham::ArenaString str(buffer, 2048);
+  EXPECT_EQ(str.capacity(), 0);
+  EXPECT_STREQ(str.c_str(), "");
+}
+
+TEST(ContainersTest, ArenaStorageAlignment) {
+  struct alignas(64) Record {
+    int value;
+  };
+  sham::SharedMemoryBuffer buffer(kSharedMemoryName, 64 * 1024,
+                                  sham::SharedMemoryBuffer::Type::kCreate);
+  ASSERT_NE(buffer.Allocate(1), nullptr);
+  sham::ArenaVector<Record> vector(buffer, 4);
+  ASSERT_EQ(vector.capacity(), 4);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(vector.data()) % alignof(Record), 0);
+  ASSERT_NE(buffer.Allocate(1), nullptr);
+  sham::ArenaList<Record> list(buffer, 4);
+  ASSERT_NE(list.emplace_back(Record{1}), nullptr);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(&list.front()) % alignof(Record), 0);
+  // The size of the storage would overflow.
+  sham::ArenaVector<Record> huge(buffer, SIZE_MAX / 2);
+  EXPECT_EQ(huge.capacity(), 0);
+}
@@ -0,0 +1,234 @@
+/*
+MIT License - Copyright (c) 2023 Pierric Gimmig
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#include "sham/epoch.h"
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "sham/shared_memory_buffer.h"
+#include "sham/tagged_index_stack.h"
+
+static constexpr const char* kSharedMemoryName = "epoch_test";
+static constexpr size_t kCapacity = 4 * 1024 * 1024;
+
+using Participant = sham::EpochDomain::Participant;
+
+static sham::EpochDomain* CreateDomain(sham::SharedMemoryBuffer& buffer, size_t capacity = 8) {
+  auto* domain = buffer.Allocate<sham::EpochDomain>(buffer, capacity);
+  return domain != nullptr && domain->capacity() == capacity ? domain : nullptr;
+}
+
+TEST(EpochTest, TokensFreedAfterCriticalSections) {
+  sham::SharedMemoryBuffer buffer(kSharedMemoryName, kCapacity,
+                                  sham::SharedMemoryBuffer::Type::kCreate);
+  sham::EpochDomain* domain = CreateDomain(buffer);
+  ASSERT_NE(domain, nullptr);
+  Participant writer(*domain);
+  Participant reader(*domain);
+  ASSERT_TRUE(writer.valid());
+  ASSERT_TRUE(reader.valid());
+  EXPECT_EQ(domain->num_participants(), 2);
+
+  std::vector<uint64_t> freed;
+  auto free = [&freed](uint64_t token) { freed.push_back(token); };
+  reader.Enter();
+  ASSERT_TRUE(writer.Retire(1, free));
+  EXPECT_EQ(writer.num_retired(), 1);
+  // The reader observed the current epoch, which can advance once but not twice.
+  EXPECT_TRUE(domain->TryAdvance());
+  EXPECT_FALSE(domain->TryAdvance());
+  EXPECT_EQ(writer.Collect(free), 0);
+
+  reader.Exit();
+  EXPECT_TRUE(domain->TryAdvance());
+  EXPECT_EQ(writer.Collect(free), 1);
+  EXPECT_EQ(freed, std::vector<uint64_t>{1});
+  EXPECT_EQ(writer.num_retired(), 0);
+
+  // Without critical sections, tokens are freed as the epoch advances.
+  for (uint64_t token = 2; token < 1000; ++token) ASSERT_TRUE(writer.Retire(token, free));
+  EXPECT_LE(writer.num_retired(), 3 * sham::EpochDomain::kCollectInterval);
+  EXPECT_EQ(freed.size() + writer.num_retired(), 999);
+}
+
+TEST(EpochTest, NestedCriticalSections) {
+  sham::SharedMemoryBuffer buffer(kSharedMemoryName, kCapacity,
+                                  sham::SharedMemoryBuffer::Type::kCreate);
+  sham::EpochDomain* domain = CreateDomain(buffer);
+  ASSERT_NE(domain, nullptr);
+  Participant participant(*domain);
+  {
+    sham::EpochGuard outer(participant);
+    { sham::EpochGuard inner(participant); }
+    EXPECT_TRUE(domain->TryAdvance());
+    EXPECT_FALSE(domain->TryAdvance());
+  }
+  EXPECT_TRUE(domain->TryAdvance());
+}
+
+TEST(EpochTest, RetireInCriticalSectionWhenFull) {
+  sham::SharedMemoryBuffer buffer(kSharedMemoryName, kCapacity,
+                                  sham::SharedMemoryBuffer::Type::kCreate);
+  sham::EpochDomain* domain = CreateDomain(buffer);
+  ASSERT_NE(domain, nullptr);
+  Participant participant(*domain);
+  size_t num_freed = 0;
+  auto free = [&num_freed](uint64_t) { ++num_freed; };
+
+  participant.Enter();
+  for (uint64_t token = 0; token < sham::EpochDomain::kLimboCapacity; ++token) {
+    ASSERT_TRUE(participant.Retire(token, free));
+  }
+  EXPECT_FALSE(participant.Retire(1000, free));
+  participant.Exit();
+  EXPECT_TRUE(participant.Retire(1000, free));
+  EXPECT_GT(num_freed, 0);
+}
+
+TEST(EpochTest, FullDomain) {
+  sham::SharedMemoryBuffer buffer(kSharedMemoryName, kCapacity,
+                                  sham::SharedMemoryBuffer::Type::kCreate);
+  sham::EpochDomain* domain = CreateDomain(buffer, 1);
+  ASSERT_NE(domain, nullptr);
+  Participant first(*domain);
+  EXPECT_TRUE(first.valid());
+  Participant second(*domain);
+  EXPECT_FALSE(second.valid());
+}
+
+TEST(EpochTest, NextParticipantFreesLeftoverTokens) {
+  sham::SharedMemoryBuffer buffer(kSharedMemoryName, kCapacity,
+                                  sham::SharedMemoryBuffer::Type::kCreate);
+  sham::EpochDomain* domain = CreateDomain(buffer, 1);
+  ASSERT_NE(domain, nullptr);
+  std::vector<uint64_t> freed;
+  auto free = [&freed](uint64_t token) { freed.push_back(token); };
+  {
+    Participant participant(*domain);
+    ASSERT_TRUE(participant.Retire(1, free));
+    ASSERT_TRUE(participant.Retire(2, free));
+  }
+  EXPECT_EQ(domain->num_participants(), 0);
+  Participant participant(*domain);
+  ASSERT_TRUE(participant.valid());
+  EXPECT_EQ(participant.num_retired(), 2);
+  EXPECT_TRUE(domain->TryAdvance());
+  EXPECT_TRUE(domain->TryAdvance());
+  EXPECT_EQ(participant.Collect(free), 2);
+  EXPECT_EQ(freed, (std::vector<uint64_t>{1, 2}));
+}
+
+TEST(EpochTest, DeadProcessDoesNotBlockEpoch) {
+  sham::SharedMemoryBuffer buffer(kSharedMemoryName, kCapacity,
+                                  sham::SharedMemoryBuffer::Type::kCreate);
+  sham::EpochDomain* domain = CreateDomain(buffer);
+  ASSERT_NE(domain, nullptr);
+  pid_t pid = fork();
+  if (pid == 0) {
+    // Dies in a critical section, without unregistering.
+    auto* participant = new Participant(*domain);
+    participant->Enter();
+    _exit(0);
+  }
+  ASSERT_EQ(waitpid(pid, nullptr, 0), pid);
+  EXPECT_EQ(domain->num_participants(), 1);
+
+  Participant participant(*domain);
+  size_t num_freed = 0;
+  ASSERT_TRUE(participant.Retire(1, [&num_freed](uint64_t) { ++num_freed; }));
+  EXPECT_TRUE(domain->TryAdvance());
+  // The dead process is detected within kLivenessCheckInterval attempts.
+  bool advanced = false;
+  for (size_t i = 0; i < sham::EpochDomain::kLivenessCheckInterval && !advanced; ++i) {
+    advanced = domain->TryAdvance();
+  }
+  EXPECT_TRUE(advanced);
+  EXPECT_EQ(domain->num_participants(), 1);
+  EXPECT_EQ(participant.Collect([&num_freed](uint64_t) { ++num_freed; }), 1);
+}
+
+// Writers replace the current node and retire the previous one, readers check that the node they
+// read is never freed while they are in a critical section.
+TEST(EpochTest, ReadersNeverSeeFreedNodes) {
+  static constexpr uint32_t kNumNodes = 1024;
+  static constexpr uint64_t kFreed = ~uint64_t{0};
+  static constexpr size_t kNumReaders = 2;
+  static constexpr size_t kNumWritesPerWriter = 5'000;
+  struct Node {
+    std::atomic<uint64_t> value;
+    std::atomic<uint32_t> next_free;
+  };
+  sham::SharedMemoryBuffer buffer(kSharedMemoryName, kCapacity,
+                                  sham::SharedMemoryBuffer::Type::kCreate);
+  sham::EpochDomain* domain = CreateDomain(buffer);
+  ASSERT_NE(domain, nullptr);
+  std::vector<Node> nodes(kNumNodes);
+  sham::TaggedIndexStack free_nodes;
+  auto link = [&nodes](uint32_t index) -> auto& { return nodes[index].next_free; };
+  for (uint32_t i = 1; i < kNumNodes; ++i) free_nodes.Push(i, link);
+  std::atomic<uint32_t> current = 0;
+  std::atomic<bool> done = false;
+  std::atomic<bool> saw_freed = false;
+
+  auto write = [&] {
+    Participant participant(*domain);
+    auto free = [&](uint64_t index) {
+      nodes[index].value.store(kFreed, std::memory_order_relaxed);
+      free_nodes.Push(static_cast<uint32_t>(index), link);
+    };
+    for (size_t i = 0; i < kNumWritesPerWriter; ++i) {
+      uint32_t node;
+      while ((node = free_nodes.Pop(link)) == sham::TaggedIndexStack::kEmpty) {
+        participant.Collect(free);
+        domain->TryAdvance();
+      }
+      nodes[node].value.store(i, std::memory_order_relaxed);
+      uint32_t previous = current.exchange(node, std::memory_order_acq_rel);
+      ASSERT_TRUE(participant.Retire(previous, free));
+    }
+  };
+  std::vector<std::thread> readers;
+  for (size_t i = 0; i < kNumReaders; ++i) {
+    readers.emplace_back([&] {
+      Participant participant(*domain);
+      while (!done) {
+        sham::EpochGuard guard(participant);
+        Node& node = nodes[current.load(std::memory_order_acquire)];
+        for (int j = 0; j < 10; ++j) {
+          if (node.value.load(std::memory_order_relaxed) == kFreed) saw_freed = true;
+        }
+      }
+    });
+  }
+  std::thread writer(write);
+  std::thread second_writer(write);
+  writer.join();
+  second_writer.join();
+  done = true;
+  for (std::thread& reader : readers) reader.join();
+  EXPECT_FALSE(saw_freed);
+}
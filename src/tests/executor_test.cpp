@@ -0,0 +1,94 @@
+/*
+MIT License - Copyright (c) 2023 Pierric Gimmig
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#include "sham/executor.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "gtest/gtest.h"
+
+TEST(ExecutorTest, RunsSubmittedTasks) {
+  static constexpr size_t kNumTasks = 100'000;
+  std::atomic<size_t> num_runs = 0;
+  {
+    sham::Executor executor(4);
+    EXPECT_EQ(executor.num_threads(), 4);
+    for (size_t i = 0; i < kNumTasks; ++i) executor.Submit([&num_runs] { ++num_runs; });
+    while (num_runs < kNumTasks) std::this_thread::yield();
+  }
+  EXPECT_EQ(num_runs, kNumTasks);
+}
+
+// Each task submits two children down to a depth, the tasks are spread by stealing.
+static void FanOut(sham::Executor& executor, int depth, std::atomic<size_t>& num_runs) {
+  ++num_runs;
+  if (depth == 0) return;
+  executor.Submit([&executor, depth, &num_runs] { FanOut(executor, depth - 1, num_runs); });
+  executor.Submit([&executor, depth, &num_runs] { FanOut(executor, depth - 1, num_runs); });
+}
+
+TEST(ExecutorTest, TasksSubmitTasks) {
+  static constexpr int kDepth = 15;
+  std::atomic<size_t> num_runs = 0;
+  {
+    sham::Executor executor(4);
+    executor.Submit([&] { FanOut(executor, kDepth, num_runs); });
+    // The destructor waits for the tasks submitted by tasks too.
+  }
+  EXPECT_EQ(num_runs, (size_t{1} << (kDepth + 1)) - 1);
+}
+
+TEST(ExecutorTest, IdleWorkersAreWokenUp) {
+  sham::Executor executor(2);
+  for (int i = 0; i < 10; ++i) {
+    // Leaves time for the workers to go to sleep.
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    std::atomic<bool> ran = false;
+    executor.Submit([&ran] { ran = true; });
+    while (!ran) std::this_thread::yield();
+  }
+}
+
+// Submits bursts of tasks from outside to a single worker that goes idle between bursts, so that
+// submissions race with the worker going to sleep and finding the first task of a burst.
+TEST(ExecutorTest, SingleWorkerBursts) {
+  static constexpr size_t kNumBursts = 100'000;
+  sham::Executor executor(1);
+  std::atomic<size_t> num_runs = 0;
+  size_t num_submitted = 0;
+  for (size_t burst = 0; burst < kNumBursts; ++burst) {
+    for (size_t i = 0; i <= burst % 4; ++i, ++num_submitted) {
+      executor.Submit([&num_runs] { ++num_runs; });
+    }
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (num_runs < num_submitted) {
+      ASSERT_LT(std::chrono::steady_clock::now(), deadline) << "Lost wake up in burst " << burst;
+      std::this_thread::yield();
+    }
+    // Varies when the next burst is submitted relative to the worker going idle.
+    for (size_t i = 0; i < burst % 64; ++i) std::this_thread::yield();
+  }
+}
+
+TEST(ExecutorTest, DestroyIdleExecutor) { sham::Executor executor(3); }
@@ -0,0 +1,197 @@
+/*
+MIT License - Copyright (c) 2023 Pierric Gimmig
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#include "sham/hash_map.h"
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "sham/shared_memory_buffer.h"
+
+static constexpr const char* kSharedMemoryName = "hash_map_test";
+static constexpr size_t kCapacity = 64 * 1024 * 1024;
+
+using MapT = sham::HashMap<uint64_t, uint64_t>;
+
+// Puts all keys in the same probe sequence, to exercise collisions and backward shifts.
+struct ConstantHash {
+  size_t operator()(uint64_t) const { return 42; }
+};
+using CollidingMapT = sham::HashMap<uint64_t, uint64_t, ConstantHash>;
+
+// Long probe sequences from 16 home groups.
+struct ClusteringHash {
+  size_t operator()(uint64_t key) const { return key % 16; }
+};
+using ClusteringMapT = sham::HashMap<uint64_t, uint64_t, ClusteringHash>;
+
+TEST(HashMapTest, InsertFindErase) {
+  sham::SharedMemoryBuffer buffer(kSharedMemoryName, kCapacity,
+                                  sham::SharedMemoryBuffer::Type::kCreate);
+  auto* map = buffer.Allocate<MapT>(buffer, 1000);
+  ASSERT_NE(map, nullptr);
+  EXPECT_EQ(map->capacity(), 1000u);
+  EXPECT_FALSE(map->Find(1).has_value());
+  EXPECT_FALSE(map->Erase(1));
+
+  for (uint64_t i = 0; i < 1000; ++i) ASSERT_TRUE(map->Insert(i, i * 10));
+  EXPECT_EQ(map->size(), 1000u);
+  // Full, and existing keys aren't overwritten by Insert().
+  EXPECT_FALSE(map->Insert(1000, 0));
+  EXPECT_FALSE(map->InsertOrAssign(1000, 0));
+  EXPECT_FALSE(map->Insert(5, 0));
+  for (uint64_t i = 0; i < 1000; ++i) ASSERT_EQ(map->Find(i), i * 10);
+  EXPECT_FALSE(map->Contains(1000));
+
+  EXPECT_TRUE(map->InsertOrAssign(5, 55));
+  EXPECT_EQ(map->Find(5), 55u);
+  uint64_t expected = 0;
+  EXPECT_FALSE(map->CompareExchange(5, expected, 1));
+  EXPECT_EQ(expected, 55u);
+  EXPECT_TRUE(map->CompareExchange(5, expected, 1));
+  EXPECT_EQ(map->Find(5), 1u);
+  EXPECT_FALSE(map->CompareExchange(1000, expected, 1));
+
+  for (uint64_t i = 0; i < 1000; i += 2) ASSERT_TRUE(map->Erase(i));
+  EXPECT_EQ(map->size(), 500u);
+  for (uint64_t i = 0; i < 1000; ++i) EXPECT_EQ(map->Contains(i), i % 2 == 1);
+  EXPECT_TRUE(map->Insert(1000, 0));
+}
+
+TEST(HashMapTest, ErasureShiftsEntriesBack) {
+  sham::SharedMemoryBuffer buffer(kSharedMemoryName, kCapacity,
+                                  sham::SharedMemoryBuffer::Type::kCreate);
+  // All keys collide, random insertions and erasures are checked against std::unordered_map.
+  auto* map = buffer.Allocate<CollidingMapT>(buffer, 200);
+  ASSERT_NE(map, nullptr);
+  std::unordered_map<uint64_t, uint64_t> expected;
+  std::mt19937_64 random(1);
+  for (int i = 0; i < 20'000; ++i) {
+    uint64_t key = random() % 300;
+    if (random() % 2 == 0) {
+      bool inserted = expected.size() < 200 && expected.emplace(key, i).second;
+      ASSERT_EQ(map->Insert(key, i), inserted);
+    } else {
+      ASSERT_EQ(map->Erase(key), expected.erase(key) == 1);
+    }
+    ASSERT_EQ(map->size(), expected.size());
+  }
+  for (uint64_t key = 0; key < 300; ++key) {
+    auto it = expected.find(key);
+    ASSERT_EQ(map->Find(key), it == expected.end() ? std::nullopt : std::optional(it->second));
+  }
+}
+
+TEST(HashMapTest, ReadersNeverMissStableKeys) {
+  static constexpr uint64_t kNumStableKeys = 1000;
+  sham::SharedMemoryBuffer buffer(kSharedMemoryName, kCapacity,
+                                  sham::SharedMemoryBuffer::Type::kCreate);
+  auto* map = buffer.Allocate<ClusteringMapT>(buffer, 4000);
+  ASSERT_NE(map, nullptr);
+  for (uint64_t i = 0; i < kNumStableKeys; ++i) ASSERT_TRUE(map->Insert(i, i));
+
+  // Writers insert and erase other keys, which moves stable keys back along their probe sequences,
+  // while readers look up the stable keys.
+  std::atomic<bool> stop = false;
+  std::vector<std::thread> writers;
+  for (uint64_t id = 0; id < 2; ++id) {
+    writers.emplace_back([&, id] {
+      std::mt19937_64 random(id);
+      for (int i = 0; i < 100'000; ++i) {
+        uint64_t key = kNumStableKeys + id * 10'000 + random() % 1000;
+        if (!map->Insert(key, key)) map->Erase(key);
+      }
+    });
+  }
+  std::vector<std::thread> readers;
+  std::atomic<uint64_t> num_misses = 0;
+  for (uint64_t id = 0; id < 2; ++id) {
+    readers.emplace_back([&] {
+      while (!stop) {
+        for (uint64_t i = 0; i < kNumStableKeys; ++i) {
+          if (map->Find(i) != i) ++num_misses;
+        }
+      }
+    });
+  }
+  for (std::thread& writer : writers) writer.join();
+  stop = true;
+  for (std::thread& reader : readers) reader.join();
+  EXPECT_EQ(num_misses, 0u);
+  for (uint64_t i = 0; i < kNumStableKeys; ++i) EXPECT_EQ(map->Find(i), i);
+}
+
+TEST(HashMapTest, ConcurrentUpdates) {
+  static constexpr uint64_t kNumThreads = 4;
+  static constexpr uint64_t kNumIncrements = 10'000;
+  sham::SharedMemoryBuffer buffer(kSharedMemoryName, kCapacity,
+                                  sham::SharedMemoryBuffer::Type::kCreate);
+  auto* map = buffer.Allocate<MapT>(buffer, 100);
+  ASSERT_TRUE(map->Insert(7, 0));
+  std::vector<std::thread> threads;
+  for (uint64_t id = 0; id < kNumThreads; ++id) {
+    threads.emplace_back([&] {
+      for (uint64_t i = 0; i < kNumIncrements; ++i) {
+        uint64_t value = *map->Find(7);
+        while (!map->CompareExchange(7, value, value + 1)) {
+        }
+      }
+    });
+  }
+  for (std::thread& thread : threads) thread.join();
+  EXPECT_EQ(map->Find(7), kNumThreads * kNumIncrements);
+}
+
+TEST(HashMapTest, WritersInProcesses) {
+  static constexpr uint64_t kNumProcesses = 4;
+  static constexpr uint64_t kNumKeysPerProcess = 10'000;
+  sham::SharedMemoryBuffer buffer(kSharedMemoryName, kCapacity,
+                                  sham::SharedMemoryBuffer::Type::kCreate);
+  auto* map = buffer.Allocate<MapT>(buffer, kNumProcesses * kNumKeysPerProcess);
+  ASSERT_NE(map, nullptr);
+
+  std::vector<pid_t> pids;
+  for (uint64_t id = 0; id < kNumProcesses; ++id) {
+    pid_t pid = fork();
+    if (pid == 0) {
+      // Every process inserts all keys, only the first insertion of each key succeeds.
+      for (uint64_t key = 0; key < kNumProcesses * kNumKeysPerProcess; ++key) {
+        map->Insert(key, key + 1);
+      }
+      _exit(0);
+    }
+    pids.push_back(pid);
+  }
+  for (pid_t pid : pids) ASSERT_EQ(waitpid(pid, nullptr, 0), pid);
+
+  EXPECT_EQ(map->size(), kNumProcesses * kNumKeysPerProcess);
+  for (uint64_t key = 0; key < kNumProcesses * kNumKeysPerProcess; ++key) {
+    ASSERT_EQ(map->Find(key), key + 1);
+  }
+}
@@ -0,0 +1,172 @@
+/*
+MIT License - Copyright (c) 2023 Pierric Gimmig
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#include "sham/heap.h"
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <array>
+#include <cstring>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+static constexpr const char* kSharedMemoryName = "heap_test";
+static constexpr size_t kHeapCapacity = 1024 * 1024;
+
+class HeapTest : public testing::Test {
+ protected:
+  HeapTest()
+      : buffer_(kSharedMemoryName, 2 * kHeapCapacity, sham::SharedMemoryBuffer::Type::kCreate),
+        heap_(buffer_.Allocate<sham::Heap>(buffer_, kHeapCapacity)) {}
+
+  sham::SharedMemoryBuffer buffer_;
+  sham::Heap* heap_;
+};
+
+TEST_F(HeapTest, AllocateAndFree) {
+  ASSERT_NE(heap_, nullptr);
+  EXPECT_EQ(heap_->capacity(), kHeapCapacity);
+  EXPECT_EQ(heap_->used_bytes(), 0);
+
+  void* a = heap_->Allocate(100);
+  void* b = heap_->Allocate(1);
+  ASSERT_NE(a, nullptr);
+  ASSERT_NE(b, nullptr);
+  EXPECT_GE(heap_->UsableSize(a), 100);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(a) % sham::Heap::kAlignment, 0);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(b) % sham::Heap::kAlignment, 0);
+  std::memset(a, 0xaa, 100);
+  std::memset(b, 0xbb, 1);
+  EXPECT_GT(heap_->used_bytes(), 0);
+
+  heap_->Free(a);
+  heap_->Free(b);
+  EXPECT_EQ(heap_->used_bytes(), 0);
+  EXPECT_EQ(heap_->Allocate(kHeapCapacity), nullptr);
+  EXPECT_NE(heap_->Allocate(kHeapCapacity / 2), nullptr);
+}
+
+TEST_F(HeapTest, FreeBlocksAreMerged) {
+  // Fill the heap with small blocks, free them in an interleaved order, and check that the whole
+  // heap can be allocated at once again.
+  std::vector<void*> blocks;
+  while (void* block = heap_->Allocate(1000)) blocks.push_back(block);
+  EXPECT_GT(blocks.size(), kHeapCapacity / 1100);
+  for (size_t i = 0; i < blocks.size(); i += 2) heap_->Free(blocks[i]);
+  for (size_t i = 1; i < blocks.size(); i += 2) heap_->Free(blocks[i]);
+  EXPECT_EQ(heap_->used_bytes(), 0);
+  EXPECT_NE(heap_->Allocate(kHeapCapacity - 64), nullptr);
+}
+
+TEST_F(HeapTest, Alignment) {
+  for (size_t alignment : {32, 64, 256, 4096}) {
+    void* small = heap_->Allocate(8);
+    void* aligned = heap_->Allocate(100, alignment);
+    ASSERT_NE(aligned, nullptr);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(aligned) % alignment, 0);
+    heap_->Free(small);
+  }
+  struct alignas(128) Aligned {
+    int value = 42;
+  };
+  Aligned* aligned = heap_->Allocate<Aligned>();
+  ASSERT_NE(aligned, nullptr);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(aligned) % 128, 0);
+  EXPECT_EQ(aligned->value, 42);
+}
+
+TEST_F(HeapTest, ConstructAndDestroy) {
+  struct Counted {
+    explicit Counted(int* count) : count(count) { ++*count; }
+    ~Counted() { --*count; }
+    int* count;
+  };
+  int count = 0;
+  Counted* counted = heap_->Allocate<Counted>(&count);
+  ASSERT_NE(counted, nullptr);
+  EXPECT_EQ(count, 1);
+  heap_->Free(counted);
+  EXPECT_EQ(count, 0);
+  EXPECT_EQ(heap_->used_bytes(), 0);
+}
+
+// Random allocations and frees, checking that blocks never overlap.
+TEST_F(HeapTest, RandomAllocations) {
+  std::mt19937 random(42);
+  std::map<uint8_t*, size_t> blocks;
+  for (int i = 0; i < 20000; ++i) {
+    if (blocks.empty() || random() % 3 != 0) {
+      size_t size = 1 + random() % (random() % 8 == 0 ? 16384 : 256);
+      auto* block = static_cast<uint8_t*>(heap_->Allocate(size));
+      if (block == nullptr) continue;
+      auto next = blocks.lower_bound(block);
+      if (next != blocks.end()) {
+        ASSERT_LE(block + size, next->first);
+      }
+      if (next != blocks.begin()) {
+        ASSERT_LE(std::prev(next)->first + std::prev(next)->second, block);
+      }
+      blocks.emplace(block, size);
+    } else {
+      auto it = std::next(blocks.begin(), random() % blocks.size());
+      heap_->Free(it->first);
+      blocks.erase(it);
+    }
+  }
+  for (auto [block, size] : blocks) heap_->Free(block);
+  EXPECT_EQ(heap_->used_bytes(), 0);
+}
+
+TEST_F(HeapTest, MultipleProcesses) {
+  const size_t heap_offset = reinterpret_cast<uint8_t*>(heap_) - buffer_.data();
+  auto* strings = buffer_.Allocate<std::array<std::atomic<uint64_t>, 100>>();
+  pid_t pid = fork();
+  if (pid == 0) {
+    sham::SharedMemoryBuffer buffer(kSharedMemoryName, 2 * kHeapCapacity,
+                                    sham::SharedMemoryBuffer::Type::kAccessExisting);
+    auto* heap = buffer.As<sham::Heap>(heap_offset);
+    for (size_t i = 0; i < strings->size(); ++i) {
+      std::string str = std::to_string(i);
+      auto* memory = static_cast<char*>(heap->Allocate(str.size() + 1));
+      if (memory == nullptr) _exit(1);
+      std::memcpy(memory, str.c_str(), str.size() + 1);
+      (*strings)[i] = reinterpret_cast<uint8_t*>(memory) - buffer.data();
+    }
+    _exit(0);
+  }
+  int status = 0;
+  ASSERT_EQ(waitpid(pid, &status, 0), pid);
+  ASSERT_TRUE(WIFEXITED(status));
+  ASSERT_EQ(WEXITSTATUS(status), 0);
+
+  for (size_t i = 0; i < strings->size(); ++i) {
+    char* str = buffer_.As<char>((*strings)[i]);
+    EXPECT_EQ(std::string(str), std::to_string(i));
+    heap_->Free(str);
+  }
+  EXPECT_EQ(heap_->used_bytes(), 0);
+}
@@ -0,0 +1,70 @@
+/*
+MIT License - Copyright (c) 2023 Pierric Gimmig
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#include "sham/numa.h"
+
+#include "gtest/gtest.h"
+#include "sham/benchmark.h"
+#include "sham/queue_mpmc.h"
+#include "sham/shared_memory_buffer.h"
+
+static constexpr const char* kSharedMemoryName = "numa_test";
+static constexpr size_t kBufferSize = 1024 * 1024;
+
+TEST(NumaTest, AtLeastOneNode) {
+  EXPECT_GE(sham::GetNumNumaNodes(), 1);
+  EXPECT_EQ(sham::GetNumaNodes().size(), sham::GetNumNumaNodes());
+}
+
+TEST(NumaTest, SharedMemoryBufferPolicies) {
+  int node = sham::GetNumaNodes().back();
+  for (sham::NumaPolicy policy : {sham::NumaPolicy(), sham::NumaPolicy::Bind(node),
+                                  sham::NumaPolicy::Interleave(), sham::NumaPolicy::Local()}) {
+    sham::SharedMemoryBufferOptions options;
+    options.numa_policy = policy;
+    sham::SharedMemoryBuffer buffer(kSharedMemoryName, kBufferSize,
+                                    sham::SharedMemoryBuffer::Type::kCreate, options);
+    ASSERT_TRUE(buffer.valid());
+    EXPECT_TRUE(sham::SetNumaPolicy(buffer.data(), buffer.capacity(), policy));
+    int* value = buffer.Allocate<int>(42);
+    ASSERT_NE(value, nullptr);
+    EXPECT_EQ(*buffer.As<int>(), 42);
+  }
+}
+
+TEST(NumaTest, PinThreadsInBenchmark) {
+  int node = sham::GetNumaNodes().front();
+  sham::Benchmark<sham::mpmc::Queue<sham::Element, 1023>> b(2, 2, 1024);
+  b.SetNumaNodes(node, sham::GetNumaNodes().back());
+  b.Run();
+  EXPECT_EQ(b.GetNumPushedElements(), b.GetNumPoppedElements());
+}
+
+#ifdef __linux__
+TEST(NumaTest, ParseKernelList) {
+  EXPECT_EQ(sham::detail::ParseKernelList("0"), std::vector<int>({0}));
+  EXPECT_EQ(sham::detail::ParseKernelList("0-3,8,10-11"),
+            std::vector<int>({0, 1, 2, 3, 8, 10, 11}));
+  EXPECT_TRUE(sham::detail::ParseKernelList("").empty());
+  EXPECT_TRUE(sham::detail::ParseKernelList("a-b").empty());
+}
+#endif
@@ -0,0 +1,198 @@
+/*
+MIT License - Copyright (c) 2023 Pierric Gimmig
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#include "sham/object_directory.h"
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "sham/benchmark.h"
+#include "sham/queue_mpmc.h"
+#include "sham/shared_memory_buffer.h"
+
+static constexpr const char* kSharedMemoryName = "object_directory_test";
+static constexpr size_t kCapacity = 1024 * 1024;
+
+static sham::SharedMemoryBufferOptions DirectoryOptions(size_t directory_capacity = 64) {
+  sham::SharedMemoryBufferOptions options;
+  options.directory_capacity = directory_capacity;
+  return options;
+}
+
+TEST(ObjectDirectoryTest, FindOrConstruct) {
+  sham::SharedMemoryBuffer buffer(kSharedMemoryName, kCapacity,
+                                  sham::SharedMemoryBuffer::Type::kCreate, DirectoryOptions());
+  EXPECT_EQ(buffer.directory().capacity(), 64);
+  EXPECT_EQ(buffer.Find<int>("answer"), nullptr);
+
+  int* answer = buffer.FindOrConstruct<int>("answer", 42);
+  ASSERT_NE(answer, nullptr);
+  EXPECT_EQ(*answer, 42);
+  EXPECT_EQ(buffer.FindOrConstruct<int>("answer", 43), answer);
+  EXPECT_EQ(*answer, 42);
+  EXPECT_EQ(buffer.Find<int>("answer"), answer);
+
+  // Another mapping, e.g. in another process, finds the same object.
+  sham::SharedMemoryBuffer attached(kSharedMemoryName, kCapacity,
+                                    sham::SharedMemoryBuffer::Type::kAccessExisting);
+  int* attached_answer = attached.Find<int>("answer");
+  ASSERT_NE(attached_answer, nullptr);
+  EXPECT_EQ(reinterpret_cast<uint8_t*>(attached_answer) - attached.data(),
+            reinterpret_cast<uint8_t*>(answer) - buffer.data());
+  EXPECT_EQ(*attached.FindOrConstruct<int>("answer", 0), 42);
+}
+
+TEST(ObjectDirectoryTest, TypeMismatch) {
+  sham::SharedMemoryBuffer buffer(kSharedMemoryName, kCapacity,
+                                  sham::SharedMemoryBuffer::Type::kCreate, DirectoryOptions());
+  ASSERT_NE(buffer.FindOrConstruct<int>("value"), nullptr);
+  EXPECT_EQ(buffer.FindOrConstruct<float>("value"), nullptr);
+  EXPECT_EQ(buffer.Find<unsigned>("value"), nullptr);
+  EXPECT_NE(buffer.Find<int>("value"), nullptr);
+}
+
+TEST(ObjectDirectoryTest, ConstructorThrows) {
+  struct Throwing {
+    explicit Throwing(std::atomic<bool>* may_throw) {
+      if (may_throw->load()) throw std::runtime_error("Throwing");
+    }
+  };
+  sham::SharedMemoryBuffer buffer(kSharedMemoryName, kCapacity,
+                                  sham::SharedMemoryBuffer::Type::kCreate, DirectoryOptions());
+  std::atomic<bool> may_throw = true;
+  EXPECT_THROW(buffer.FindOrConstruct<Throwing>("object", &may_throw), std::runtime_error);
+  EXPECT_EQ(buffer.Find<Throwing>("object"), nullptr);
+
+  // The name isn't poisoned, a later call constructs the object.
+  may_throw = false;
+  Throwing* object = buffer.FindOrConstruct<Throwing>("object", &may_throw);
+  EXPECT_NE(object, nullptr);
+  EXPECT_EQ(buffer.Find<Throwing>("object"), object);
+}
+
+TEST(ObjectDirectoryTest, WaitersTakeOverFailedConstruction) {
+  struct Slow {
+    Slow(std::atomic<bool>* constructing, std::atomic<bool>* may_throw) {
+      constructing->store(true);
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      if (may_throw->exchange(false)) throw std::runtime_error("Slow");
+    }
+  };
+  sham::SharedMemoryBuffer buffer(kSharedMemoryName, kCapacity,
+                                  sham::SharedMemoryBuffer::Type::kCreate, DirectoryOptions());
+  std::atomic<bool> constructing = false;
+  std::atomic<bool> may_throw = true;
+  std::thread thread([&] {
+    EXPECT_THROW(buffer.FindOrConstruct<Slow>("object", &constructing, &may_throw),
+                 std::runtime_error);
+  });
+  while (!constructing) std::this_thread::yield();
+  // Waits for the construction in the thread, then constructs the object itself.
+  Slow* object = buffer.FindOrConstruct<Slow>("object", &constructing, &may_throw);
+  thread.join();
+  EXPECT_NE(object, nullptr);
+  EXPECT_EQ(buffer.Find<Slow>("object"), object);
+}
+
+TEST(ObjectDirectoryTest, Limits) {
+  sham::SharedMemoryBuffer no_directory(kSharedMemoryName, kCapacity,
+                                        sham::SharedMemoryBuffer::Type::kCreate);
+  EXPECT_EQ(no_directory.FindOrConstruct<int>("value"), nullptr);
+  // Without a directory, allocations start at the beginning of the buffer.
+  EXPECT_EQ(no_directory.Allocate<int>(), no_directory.As<int>(0));
+
+  sham::SharedMemoryBuffer buffer("object_directory_test_limits", kCapacity,
+                                  sham::SharedMemoryBuffer::Type::kCreate, DirectoryOptions(4));
+  EXPECT_EQ(buffer.size(), 4 * sizeof(sham::ObjectDirectory::Entry));
+  EXPECT_EQ(buffer.FindOrConstruct<int>(std::string(sham::ObjectDirectory::kMaxNameSize + 1, 'a')),
+            nullptr);
+  for (int i = 0; i < 4; ++i) EXPECT_NE(buffer.FindOrConstruct<int>(std::to_string(i)), nullptr);
+  EXPECT_EQ(buffer.FindOrConstruct<int>("4"), nullptr);
+  EXPECT_NE(buffer.Find<int>("3"), nullptr);
+
+  // Failed constructions are remembered.
+  sham::ObjectDirectory directory = buffer.directory();
+  size_t num_entries = 0;
+  directory.ForEach([&](const sham::ObjectDirectory::Entry&) { ++num_entries; });
+  EXPECT_EQ(num_entries, 4);
+}
+
+TEST(ObjectDirectoryTest, ConstructedExactlyOnce) {
+  static constexpr size_t kNumThreads = 4;
+  static constexpr size_t kNumObjects = 100;
+  struct Counted {
+    explicit Counted(std::atomic<int>* count) { ++*count; }
+  };
+  sham::SharedMemoryBuffer buffer(kSharedMemoryName, kCapacity,
+                                  sham::SharedMemoryBuffer::Type::kCreate,
+                                  DirectoryOptions(2 * kNumObjects));
+  std::atomic<int> count = 0;
+  std::vector<std::vector<Counted*>> objects(kNumThreads);
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < kNumThreads; ++i) {
+    threads.emplace_back([&, i] {
+      sham::SharedMemoryBuffer attached(kSharedMemoryName, kCapacity,
+                                        sham::SharedMemoryBuffer::Type::kAccessExisting);
+      for (size_t j = 0; j < kNumObjects; ++j) {
+        auto* object = attached.FindOrConstruct<Counted>(std::to_string(j), &count);
+        objects[i].push_back(reinterpret_cast<Counted*>(
+            buffer.data() + (reinterpret_cast<uint8_t*>(object) - attached.data())));
+      }
+    });
+  }
+  for (std::thread& thread : threads) thread.join();
+  EXPECT_EQ(count, kNumObjects);
+  for (size_t i = 1; i < kNumThreads; ++i) EXPECT_EQ(objects[i], objects[0]);
+}
+
+TEST(ObjectDirectoryTest, QueueSharedByName) {
+  using QueueT = sham::mpmc::Queue<sham::Element, 15>;
+  sham::SharedMemoryBuffer buffer(kSharedMemoryName, kCapacity,
+                                  sham::SharedMemoryBuffer::Type::kCreate, DirectoryOptions());
+  pid_t pid = fork();
+  if (pid == 0) {
+    sham::SharedMemoryBuffer child(kSharedMemoryName, kCapacity,
+                                   sham::SharedMemoryBuffer::Type::kAccessExisting);
+    QueueT* queue = child.FindOrConstruct<QueueT>("orders", sham::kZeroInitialized);
+    if (queue == nullptr) _exit(1);
+    queue->push({1, 2, 3});
+    _exit(0);
+  }
+  int status = 0;
+  ASSERT_EQ(waitpid(pid, &status, 0), pid);
+  ASSERT_TRUE(WIFEXITED(status));
+  ASSERT_EQ(WEXITSTATUS(status), 0);
+
+  QueueT* queue = buffer.FindOrConstruct<QueueT>("orders", sham::kZeroInitialized);
+  ASSERT_NE(queue, nullptr);
+  sham::Element element;
+  ASSERT_TRUE(queue->try_pop(element));
+  EXPECT_EQ(element.value, 3);
+}
@@ -0,0 +1,192 @@
+/*
+MIT License - Copyright (c) 2023 Pierric Gimmig
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#include "sham/pool_allocator.h"
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <array>
+#include <cstring>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "sham/tagged_index_stack.h"
+
+static constexpr const char* kSharedMemoryName = "pool_allocator_test";
+static constexpr size_t kPoolCapacity = 16 * sham::PoolAllocator::kChunkSize;
+
+TEST(TaggedIndexStackTest, PushPop) {
+  std::atomic<uint32_t> links[4] = {};
+  auto link = [&](uint32_t index) -> std::atomic<uint32_t>& { return links[index]; };
+  sham::TaggedIndexStack stack;
+  EXPECT_TRUE(stack.empty());
+  EXPECT_EQ(stack.Pop(link), sham::TaggedIndexStack::kEmpty);
+  for (uint32_t i = 0; i < 4; ++i) stack.Push(i, link);
+  EXPECT_FALSE(stack.empty());
+  for (uint32_t i = 4; i > 0; --i) EXPECT_EQ(stack.Pop(link), i - 1);
+  EXPECT_EQ(stack.Pop(link), sham::TaggedIndexStack::kEmpty);
+}
+
+TEST(PoolAllocatorTest, SizeClasses) {
+  EXPECT_EQ(sham::PoolAllocator::BlockSize(0), 16);
+  EXPECT_EQ(sham::PoolAllocator::BlockSize(16), 16);
+  EXPECT_EQ(sham::PoolAllocator::BlockSize(17), 32);
+  EXPECT_EQ(sham::PoolAllocator::BlockSize(1000), 1024);
+  EXPECT_EQ(sham::PoolAllocator::BlockSize(64 * 1024), 64 * 1024);
+}
+
+TEST(PoolAllocatorTest, AllocateAndFree) {
+  sham::SharedMemoryBuffer buffer(kSharedMemoryName, 2 * kPoolCapacity,
+                                  sham::SharedMemoryBuffer::Type::kCreate);
+  auto* pool = buffer.Allocate<sham::PoolAllocator>(buffer, kPoolCapacity);
+  ASSERT_NE(pool, nullptr);
+  EXPECT_EQ(pool->capacity(), kPoolCapacity);
+  EXPECT_EQ(pool->num_free_chunks(), 16);
+
+  void* a = pool->Allocate(100);
+  void* b = pool->Allocate(100);
+  ASSERT_NE(a, nullptr);
+  ASSERT_NE(b, nullptr);
+  EXPECT_NE(a, b);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(a) % 128, 0);
+  EXPECT_EQ(pool->num_free_chunks(), 15);
+  EXPECT_EQ(pool->Allocate(sham::PoolAllocator::kMaxBlockSize + 1), nullptr);
+
+  // Freed blocks are reused.
+  pool->Free(a);
+  EXPECT_EQ(pool->Allocate(128), a);
+
+  sham::PoolAllocator::Cache cache(*pool);
+  void* c = cache.Allocate(2000);
+  ASSERT_NE(c, nullptr);
+  std::memset(c, 0xff, 2000);
+  cache.Free(c);
+  EXPECT_EQ(cache.Allocate(2048), c);
+  cache.Free(c);
+  pool->Free(b);
+  EXPECT_EQ(pool->num_free_chunks(), 14);
+}
+
+TEST(PoolAllocatorTest, OutOfMemory) {
+  sham::SharedMemoryBuffer buffer(kSharedMemoryName, 2 * kPoolCapacity,
+                                  sham::SharedMemoryBuffer::Type::kCreate);
+  auto* pool = buffer.Allocate<sham::PoolAllocator>(buffer, kPoolCapacity);
+  std::vector<void*> blocks;
+  while (void* block = pool->Allocate(sham::PoolAllocator::kMaxBlockSize)) blocks.push_back(block);
+  EXPECT_EQ(blocks.size(), kPoolCapacity / sham::PoolAllocator::kMaxBlockSize);
+  // Failed allocations don't count as used chunks.
+  for (int i = 0; i < 1000; ++i) EXPECT_EQ(pool->Allocate(16), nullptr);
+  EXPECT_EQ(pool->num_free_chunks(), 0);
+  EXPECT_EQ(std::set<void*>(blocks.begin(), blocks.end()).size(), blocks.size());
+  for (void* block : blocks) pool->Free(block);
+  EXPECT_NE(pool->Allocate(sham::PoolAllocator::kMaxBlockSize), nullptr);
+}
+
+// Threads keep blocks for a while, filled with their id, and check that no other thread wrote to
+// them before freeing them, possibly through another thread's cache.
+TEST(PoolAllocatorTest, ConcurrentCaches) {
+  static constexpr size_t kNumThreads = 4;
+  static constexpr size_t kNumIterations = 20000;
+  sham::SharedMemoryBuffer buffer(kSharedMemoryName, 2 * kPoolCapacity,
+                                  sham::SharedMemoryBuffer::Type::kCreate);
+  auto* pool = buffer.Allocate<sham::PoolAllocator>(buffer, kPoolCapacity);
+  std::atomic<void*> exchange[kNumThreads] = {};
+  std::atomic<size_t> num_errors = 0;
+
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < kNumThreads; ++i) {
+    threads.emplace_back([&, i] {
+      sham::PoolAllocator::Cache cache(*pool);
+      std::vector<uint8_t*> blocks;
+      for (size_t j = 0; j < kNumIterations; ++j) {
+        size_t size = 16 << (j % 6);
+        auto* block = static_cast<uint8_t*>(cache.Allocate(size));
+        if (block == nullptr) {
+          ++num_errors;
+          continue;
+        }
+        std::memset(block, static_cast<int>(i), size);
+        blocks.push_back(block);
+        if (blocks.size() == 64) {
+          for (uint8_t* block : blocks) {
+            if (block[0] != i) ++num_errors;
+          }
+          // Hand one block over to a neighbour, which frees it.
+          void* previous = exchange[(i + 1) % kNumThreads].exchange(blocks.back());
+          blocks.pop_back();
+          for (uint8_t* block : blocks) cache.Free(block);
+          blocks.clear();
+          cache.Free(exchange[i].exchange(nullptr));
+          pool->Free(previous);
+        }
+      }
+      for (uint8_t* block : blocks) cache.Free(block);
+    });
+  }
+  for (std::thread& thread : threads) thread.join();
+  for (std::atomic<void*>& block : exchange) pool->Free(block.load());
+  EXPECT_EQ(num_errors, 0);
+}
+
+TEST(PoolAllocatorTest, MultipleProcesses) {
+  static constexpr size_t kNumBlocks = 1000;
+  sham::SharedMemoryBuffer buffer(kSharedMemoryName, 2 * kPoolCapacity,
+                                  sham::SharedMemoryBuffer::Type::kCreate);
+  auto* pool = buffer.Allocate<sham::PoolAllocator>(buffer, kPoolCapacity);
+  auto* offsets = buffer.Allocate<std::array<std::atomic<uint64_t>, kNumBlocks>>();
+  const size_t pool_offset = reinterpret_cast<uint8_t*>(pool) - buffer.data();
+
+  // The child maps the buffer at another address, allocates blocks and publishes their offsets.
+  pid_t pid = fork();
+  if (pid == 0) {
+    sham::SharedMemoryBuffer child_buffer(kSharedMemoryName, 2 * kPoolCapacity,
+                                          sham::SharedMemoryBuffer::Type::kAccessExisting);
+    auto* child_pool = child_buffer.As<sham::PoolAllocator>(pool_offset);
+    sham::PoolAllocator::Cache cache(*child_pool);
+    for (size_t i = 0; i < kNumBlocks; ++i) {
+      auto* block = static_cast<uint64_t*>(cache.Allocate(64));
+      if (block == nullptr) _exit(1);
+      *block = i;
+      (*offsets)[i] = reinterpret_cast<uint8_t*>(block) - child_buffer.data();
+    }
+    _exit(0);
+  }
+  int status = 0;
+  ASSERT_EQ(waitpid(pid, &status, 0), pid);
+  ASSERT_TRUE(WIFEXITED(status));
+  ASSERT_EQ(WEXITSTATUS(status), 0);
+
+  // The parent frees them, the blocks cached by the child are lost.
+  std::set<void*> blocks;
+  sham::PoolAllocator::Cache cache(*pool);
+  for (size_t i = 0; i < kNumBlocks; ++i) {
+    auto* block = buffer.As<uint64_t>((*offsets)[i]);
+    EXPECT_EQ(*block, i);
+    blocks.insert(block);
+    cache.Free(block);
+  }
+  EXPECT_EQ(blocks.size(), kNumBlocks);
+  EXPECT_TRUE(blocks.count(cache.Allocate(64)));
+}
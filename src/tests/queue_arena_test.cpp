@@ -0,0 +1,122 @@
+/*
+MIT License - Copyright (c) 2023 Pierric Gimmig
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#include "sham/queue_arena.h"
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <set>
+
+#include "gtest/gtest.h"
+#include "sham/benchmark.h"
+#include "sham/queue_spsc.h"
+#include "sham/shared_memory_buffer.h"
+
+static constexpr const char* kSharedMemoryName = "queue_arena_test";
+static constexpr size_t kCapacity = 16 * 1024 * 1024;
+
+using QueueT = sham::SPSCQueue<sham::Element, 1023>;
+using Arena = sham::QueueArena<QueueT>;
+
+TEST(QueueArenaTest, AcquireRelease) {
+  static constexpr size_t kNumQueues = 100;
+  sham::SharedMemoryBuffer buffer(kSharedMemoryName, kCapacity,
+                                  sham::SharedMemoryBuffer::Type::kCreate);
+  Arena* arena = buffer.Allocate<Arena>(buffer, kNumQueues);
+  ASSERT_NE(arena, nullptr);
+  EXPECT_EQ(arena->capacity(), kNumQueues);
+  EXPECT_EQ(Arena::kStride % 128, 0);
+  EXPECT_GE(Arena::kStride, sizeof(QueueT));
+
+  std::set<Arena::Handle> handles;
+  for (size_t i = 0; i < kNumQueues; ++i) {
+    Arena::Handle handle = arena->Acquire();
+    ASSERT_NE(handle, Arena::kInvalidHandle);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(arena->Get(handle)) % 128, 0);
+    EXPECT_TRUE(arena->Get(handle)->empty());
+    handles.insert(handle);
+  }
+  EXPECT_EQ(handles.size(), kNumQueues);
+  EXPECT_EQ(arena->Acquire(), Arena::kInvalidHandle);
+
+  arena->Get(42)->push({1, 2, 3});
+  EXPECT_EQ(arena->Get(42)->size(), 1);
+  EXPECT_TRUE(arena->Get(43)->empty());
+
+  // A released queue is reused, and constructed again.
+  arena->Release(42);
+  EXPECT_EQ(arena->Acquire(), 42);
+  EXPECT_TRUE(arena->Get(42)->empty());
+  EXPECT_EQ(arena->Acquire(), Arena::kInvalidHandle);
+}
+
+TEST(QueueArenaTest, FullBuffer) {
+  sham::SharedMemoryBuffer buffer(kSharedMemoryName, 1024 * 1024,
+                                  sham::SharedMemoryBuffer::Type::kCreate);
+  Arena* arena = buffer.Allocate<Arena>(buffer, 1000);
+  ASSERT_NE(arena, nullptr);
+  EXPECT_EQ(arena->capacity(), 0);
+  EXPECT_EQ(arena->Acquire(), Arena::kInvalidHandle);
+  arena->Release(0);
+  arena->Release(Arena::kInvalidHandle);
+  EXPECT_EQ(arena->Acquire(), Arena::kInvalidHandle);
+}
+
+TEST(QueueArenaTest, SharedBetweenProcesses) {
+  static constexpr size_t kNumQueues = 64;
+  sham::SharedMemoryBufferOptions options;
+  options.huge_pages = true;
+  sham::SharedMemoryBuffer buffer(kSharedMemoryName, kCapacity,
+                                  sham::SharedMemoryBuffer::Type::kCreate, options);
+  ASSERT_TRUE(buffer.valid());
+  // The segment starts on a huge page.
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(buffer.data() - sham::SharedMemoryHeader::kSize) %
+                sham::kHugePageSize,
+            0);
+  Arena* arena = buffer.Allocate<Arena>(buffer, kNumQueues);
+  for (size_t i = 0; i < kNumQueues; ++i) ASSERT_EQ(arena->Acquire(), i);
+
+  // The child writes its index to each queue, finding the arena at the same offset.
+  size_t arena_offset = reinterpret_cast<uint8_t*>(arena) - buffer.data();
+  pid_t pid = fork();
+  if (pid == 0) {
+    sham::SharedMemoryBuffer child(kSharedMemoryName, kCapacity,
+                                   sham::SharedMemoryBuffer::Type::kAccessExisting, options);
+    Arena* child_arena = child.As<Arena>(arena_offset);
+    for (Arena::Handle handle = 0; handle < kNumQueues; ++handle) {
+      child_arena->Get(handle)->push({0, 0, handle});
+    }
+    _exit(0);
+  }
+  int status = 0;
+  ASSERT_EQ(waitpid(pid, &status, 0), pid);
+  ASSERT_TRUE(WIFEXITED(status));
+  ASSERT_EQ(WEXITSTATUS(status), 0);
+
+  for (Arena::Handle handle = 0; handle < kNumQueues; ++handle) {
+    sham::Element* element = arena->Get(handle)->front();
+    ASSERT_NE(element, nullptr);
+    EXPECT_EQ(element->value, handle);
+    arena->Get(handle)->pop();
+  }
+}
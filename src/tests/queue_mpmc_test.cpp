@@ -22,11 +22,17 @@ SOFTWARE.
 
 #include "sham/queue_mpmc.h"
 
+#include <algorithm>
+#include <filesystem>
+#include <string>
+
 #include "adapters/atomic_queue_adapter.h"
 #include "adapters/concurrentqueue_adapter.h"
+#include "adapters/segmented_queue_adapter.h"
 #include "gtest/gtest.h"
 #include "sham/benchmark.h"
 #include "sham/queue_locking.h"
+#include "sham/shared_memory_buffer.h"
 
 static constexpr size_t kQueueCapacity = 1 * 1024 * 1024 - 1;
 static constexpr size_t kNumPush = 8 * 1024 * 1024;
@@ -38,7 +44,8 @@ using BenchmarkQueueTypes = ::testing::Types<
   sham::mpmc::LockingQueue<sham::Element, kQueueCapacity>,
   sham::mpmc::Queue<sham::Element, kQueueCapacity>,
   sham::AtomicQueueAdapter<sham::Element, kQueueCapacity>,
-  sham::ConcurrentQueueAdapter<sham::Element>>;
+  sham::ConcurrentQueueAdapter<sham::Element>,
+  sham::SegmentedQueueAdapter<sham::Element>>;
 
 using SingleEmlementQueueTypes = ::testing::Types<
   sham::mpmc::LockingQueue<sham::Element, 1>,
@@ -122,4 +129,97 @@ TYPED_TEST(SimpleMpmcTest, SequentialQueueAndDequeue) {
   EXPECT_TRUE(q.try_pop(value));
   EXPECT_EQ(value, 5);
   EXPECT_FALSE(q.try_pop(value));
-}
\ No newline at end of file
+}
+
+TEST(MpmcQueueTest, ZeroInitializedQueueInSharedMemory) {
+  using QueueT = sham::mpmc::Queue<int, 3>;
+  sham::SharedMemoryBuffer buffer("queue_mpmc_test", sizeof(QueueT),
+                                  sham::SharedMemoryBuffer::Type::kCreate);
+  QueueT* q = buffer.Allocate<QueueT>(sham::kZeroInitialized);
+  ASSERT_NE(q, nullptr);
+  EXPECT_TRUE(q->empty());
+
+  // Cycle through the ring several times to exercise turns other than the initial one.
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_TRUE(q->try_push(i));
+    EXPECT_TRUE(q->try_push(i + 1));
+    int value;
+    EXPECT_TRUE(q->try_pop(value));
+    EXPECT_EQ(value, i);
+    EXPECT_TRUE(q->try_pop(value));
+    EXPECT_EQ(value, i + 1);
+    EXPECT_FALSE(q->try_pop(value));
+  }
+
+  // A second process attaching to the segment sees the same queue.
+  sham::SharedMemoryBuffer attached("queue_mpmc_test", sizeof(QueueT),
+                                    sham::SharedMemoryBuffer::Type::kAccessExisting);
+  EXPECT_TRUE(q->try_push(42));
+  int value;
+  EXPECT_TRUE(attached.As<QueueT>()->try_pop(value));
+  EXPECT_EQ(value, 42);
+}
+
+TEST(MpmcQueueTest, ReleaseUnusedMemory) {
+  using QueueT = sham::mpmc::Queue<sham::Element, 64 * 1024>;
+  sham::SharedMemoryBuffer buffer("queue_mpmc_test", sizeof(QueueT),
+                                  sham::SharedMemoryBuffer::Type::kCreate);
+  QueueT* q = buffer.Allocate<QueueT>(sham::kZeroInitialized);
+  ASSERT_NE(q, nullptr);
+  size_t initial_resident_size = q->resident_size();
+  EXPECT_LT(initial_resident_size, sizeof(QueueT) / 16);
+
+  // A spike fills the whole ring, which stays resident once drained.
+  sham::Element element;
+  for (uint64_t i = 0; i < q->capacity(); ++i) EXPECT_TRUE(q->try_push({0, 0, i}));
+  EXPECT_TRUE(q->try_pop(element));
+  EXPECT_FALSE(q->release_unused_memory());
+  for (uint64_t i = 1; i < q->capacity(); ++i) EXPECT_TRUE(q->try_pop(element));
+  EXPECT_GT(q->resident_size(), sizeof(QueueT) / 2);
+
+  EXPECT_TRUE(q->release_unused_memory());
+  EXPECT_LE(q->resident_size(), initial_resident_size);
+  EXPECT_EQ(q->head(), 0);
+  EXPECT_EQ(q->tail(), 0);
+
+  // The queue is still valid, including for processes that mapped it before, across several laps.
+  sham::SharedMemoryBuffer attached("queue_mpmc_test", sizeof(QueueT),
+                                    sham::SharedMemoryBuffer::Type::kAccessExisting);
+  QueueT* attached_q = attached.As<QueueT>(reinterpret_cast<uint8_t*>(q) - buffer.data());
+  for (uint64_t i = 0; i < 3 * q->capacity(); ++i) {
+    ASSERT_TRUE(q->try_push({0, 0, i}));
+    ASSERT_TRUE(attached_q->try_pop(element));
+    ASSERT_EQ(element.value, i);
+  }
+}
+
+TEST(MpmcQueueTest, ReleaseUnusedMemoryOfPersistentSegment) {
+  using QueueT = sham::mpmc::Queue<sham::Element, 64 * 1024>;
+  std::string path = (std::filesystem::temp_directory_path() / "queue_mpmc_test.sham").string();
+  std::filesystem::remove(path);
+  {
+    auto buffer = sham::SharedMemoryBuffer::CreatePersistent(path, sizeof(QueueT));
+    QueueT* q = buffer.Allocate<QueueT>(sham::kZeroInitialized);
+    ASSERT_NE(q, nullptr);
+    sham::Element element;
+    for (uint64_t i = 0; i < q->capacity(); ++i) EXPECT_TRUE(q->try_push({0, 0, i}));
+    for (uint64_t i = 0; i < q->capacity(); ++i) EXPECT_TRUE(q->try_pop(element));
+
+    // Whether the filesystem supports holes or not, the queue is only rewound if its slots were
+    // zero-filled, and stays valid.
+    size_t head = q->head();
+    if (q->release_unused_memory()) {
+      EXPECT_EQ(q->head(), 0);
+      auto* bytes = reinterpret_cast<const uint8_t*>(q);
+      EXPECT_TRUE(std::all_of(bytes, bytes + sizeof(QueueT), [](uint8_t b) { return b == 0; }));
+    } else {
+      EXPECT_EQ(q->head(), head);
+    }
+    for (uint64_t i = 0; i < 3 * q->capacity(); ++i) {
+      ASSERT_TRUE(q->try_push({0, 0, i}));
+      ASSERT_TRUE(q->try_pop(element));
+      ASSERT_EQ(element.value, i);
+    }
+  }
+  std::filesystem::remove(path);
+}
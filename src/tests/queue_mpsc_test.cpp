@@ -0,0 +1,185 @@
+/*
+MIT License - Copyright (c) 2023 Pierric Gimmig
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#include "sham/queue_mpsc.h"
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <memory>
+#include <vector>
+
+#include "adapters/mpsc_queue_adapter.h"
+#include "gtest/gtest.h"
+#include "sham/benchmark.h"
+#include "sham/pool_allocator.h"
+#include "sham/queue_mpmc.h"
+#include "sham/shared_memory_buffer.h"
+
+static constexpr const char* kSharedMemoryName = "queue_mpsc_test";
+static constexpr size_t kCapacity = 16 * 1024 * 1024;
+static constexpr size_t kQueueCapacity = 1 * 1024 * 1024 - 1;
+static constexpr size_t kNumPush = 8 * 1024 * 1024;
+
+using QueueT = sham::mpsc::Queue<sham::Element>;
+
+struct TestNode : sham::mpsc::Hook {
+  uint64_t value;
+};
+
+TEST(MpscQueueTest, IntrusiveQueue) {
+  sham::SharedMemoryBuffer buffer(kSharedMemoryName, kCapacity,
+                                  sham::SharedMemoryBuffer::Type::kCreate);
+  auto* queue = buffer.Allocate<sham::mpsc::IntrusiveQueue>();
+  ASSERT_NE(queue, nullptr);
+  std::vector<TestNode*> nodes;
+  for (uint64_t i = 0; i < 10; ++i) {
+    nodes.push_back(buffer.Allocate<TestNode>());
+    nodes.back()->value = i;
+  }
+  EXPECT_TRUE(queue->empty());
+  EXPECT_EQ(queue->Pop(), nullptr);
+
+  // Popping the last node puts the stub back, the queue keeps working.
+  for (int round = 0; round < 3; ++round) {
+    for (TestNode* node : nodes) queue->Push(node);
+    EXPECT_FALSE(queue->empty());
+    for (TestNode* node : nodes) EXPECT_EQ(queue->Pop(), node);
+    EXPECT_EQ(queue->Pop(), nullptr);
+    EXPECT_TRUE(queue->empty());
+  }
+
+  queue->Push(nodes[0]);
+  EXPECT_EQ(queue->Pop(), nodes[0]);
+  queue->Push(nodes[1]);
+  queue->Push(nodes[2]);
+  EXPECT_EQ(queue->Pop(), nodes[1]);
+  queue->Push(nodes[3]);
+  EXPECT_EQ(queue->Pop(), nodes[2]);
+  EXPECT_EQ(queue->Pop(), nodes[3]);
+  EXPECT_EQ(queue->Pop(), nullptr);
+}
+
+TEST(MpscQueueTest, QueueAllocatesNodesFromPool) {
+  sham::SharedMemoryBuffer buffer(kSharedMemoryName, kCapacity,
+                                  sham::SharedMemoryBuffer::Type::kCreate);
+  // A single chunk of the pool.
+  auto* pool = buffer.Allocate<sham::PoolAllocator>(buffer, sham::PoolAllocator::kChunkSize);
+  ASSERT_NE(pool, nullptr);
+  auto* queue = buffer.Allocate<QueueT>(*pool);
+  ASSERT_NE(queue, nullptr);
+  const size_t kMaxSize = sham::PoolAllocator::kChunkSize / QueueT::NodeSize();
+
+  for (uint64_t i = 0; i < kMaxSize; ++i) ASSERT_TRUE(queue->try_push({0, 0, i}));
+  EXPECT_FALSE(queue->try_push({0, 0, kMaxSize}));
+  sham::Element element;
+  for (uint64_t i = 0; i < kMaxSize; ++i) {
+    ASSERT_TRUE(queue->try_pop(element));
+    EXPECT_EQ(element.value, i);
+  }
+  EXPECT_FALSE(queue->try_pop(element));
+  EXPECT_TRUE(queue->empty());
+
+  // Popped nodes were returned to the pool, also through a cache.
+  {
+    sham::PoolAllocator::Cache cache(*pool);
+    for (uint64_t i = 0; i < kMaxSize; ++i) ASSERT_TRUE(queue->try_push({0, 0, i}, &cache));
+    for (uint64_t i = 0; i < kMaxSize; ++i) ASSERT_TRUE(queue->try_pop(element, &cache));
+  }
+  for (uint64_t i = 0; i < kMaxSize; ++i) ASSERT_TRUE(queue->try_push({0, 0, i}));
+  // The destructor frees the remaining nodes.
+  queue->~QueueT();
+  EXPECT_NE(pool->Allocate(QueueT::NodeSize()), nullptr);
+}
+
+TEST(MpscQueueTest, ProducerProcesses) {
+  static constexpr uint64_t kNumProducers = 4;
+  static constexpr uint64_t kNumPushPerProducer = 100'000;
+  sham::SharedMemoryBuffer buffer(kSharedMemoryName, kCapacity,
+                                  sham::SharedMemoryBuffer::Type::kCreate);
+  auto* pool = buffer.Allocate<sham::PoolAllocator>(buffer, kCapacity / 2);
+  auto* queue = buffer.Allocate<QueueT>(*pool);
+  ASSERT_NE(queue, nullptr);
+
+  std::vector<pid_t> producers;
+  for (uint64_t id = 0; id < kNumProducers; ++id) {
+    pid_t pid = fork();
+    if (pid == 0) {
+      sham::PoolAllocator::Cache cache(*pool);
+      for (uint64_t i = 0; i < kNumPushPerProducer; ++i) {
+        while (!queue->try_push({id, 0, i}, &cache)) {
+        }
+      }
+      cache.Flush();
+      _exit(0);
+    }
+    producers.push_back(pid);
+  }
+
+  // Elements of each producer are popped in order.
+  std::vector<uint64_t> next_values(kNumProducers, 0);
+  sham::PoolAllocator::Cache cache(*pool);
+  sham::Element element;
+  for (uint64_t i = 0; i < kNumProducers * kNumPushPerProducer;) {
+    if (!queue->try_pop(element, &cache)) continue;
+    ASSERT_LT(element.thread_id, kNumProducers);
+    ASSERT_EQ(element.value, next_values[element.thread_id]++);
+    ++i;
+  }
+  for (pid_t pid : producers) ASSERT_EQ(waitpid(pid, nullptr, 0), pid);
+  EXPECT_FALSE(queue->try_pop(element, &cache));
+}
+
+// The N-to-1 configurations of queue_mpmc_test.cpp, compared to mpmc::Queue.
+template <typename T>
+class MpscBenchmarkTest : public ::testing::Test {};
+using MpscBenchmarkQueueTypes =
+    ::testing::Types<sham::mpmc::Queue<sham::Element, kQueueCapacity>,
+                     sham::MpscQueueAdapter<sham::Element, kQueueCapacity>>;
+TYPED_TEST_SUITE(MpscBenchmarkTest, MpscBenchmarkQueueTypes);
+
+template <typename QueueT>
+static void RunTest(size_t num_push_threads, size_t num_elements_to_push) {
+  sham::Benchmark<QueueT> b(num_push_threads, 1, num_elements_to_push);
+  b.Run();
+  EXPECT_EQ(b.GetNumPushedElements(), num_elements_to_push);
+  EXPECT_EQ(b.GetNumPoppedElements(), num_elements_to_push);
+  EXPECT_TRUE(b.GetQueue()->empty());
+}
+
+TYPED_TEST(MpscBenchmarkTest, SameNumberOfPushAndPop_1_1_8M) { RunTest<TypeParam>(1, kNumPush); }
+
+TYPED_TEST(MpscBenchmarkTest, SameNumberOfPushAndPop_16_1_8M) { RunTest<TypeParam>(16, kNumPush); }
+
+TYPED_TEST(MpscBenchmarkTest, SameNumberOfPushAndPop_32_1_8M) { RunTest<TypeParam>(32, kNumPush); }
+
+TEST(MpscQueueAdapterTest, ThreadUsesSuccessiveAdapters) {
+  using AdapterT = sham::MpscQueueAdapter<sham::Element, 1024>;
+  for (uint64_t i = 0; i < 3; ++i) {
+    auto adapter = std::make_unique<AdapterT>();
+    adapter->push({0, 0, i});
+    sham::Element element;
+    ASSERT_TRUE(adapter->try_pop(element));
+    EXPECT_EQ(element.value, i);
+    EXPECT_TRUE(adapter->empty());
+  }
+}
@@ -0,0 +1,178 @@
+/*
+MIT License - Copyright (c) 2023 Pierric Gimmig
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#include "sham/queue_segmented.h"
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "sham/benchmark.h"
+#include "sham/pool_allocator.h"
+#include "sham/shared_memory_buffer.h"
+
+static constexpr const char* kSharedMemoryName = "queue_segmented_test";
+static constexpr size_t kCapacity = 64 * 1024 * 1024;
+
+// Small segments, to exercise the slow paths.
+using SmallQueueT = sham::mpmc::SegmentedQueue<sham::Element, 4>;
+
+TEST(SegmentedQueueTest, FifoAcrossSegments) {
+  sham::SharedMemoryBuffer buffer(kSharedMemoryName, kCapacity,
+                                  sham::SharedMemoryBuffer::Type::kCreate);
+  auto* pool = buffer.Allocate<sham::PoolAllocator>(buffer, kCapacity / 2);
+  auto* queue = buffer.Allocate<SmallQueueT>(buffer, *pool);
+  ASSERT_NE(queue, nullptr);
+  ASSERT_TRUE(queue->valid());
+  SmallQueueT::Handle handle(*queue);
+  ASSERT_TRUE(handle.valid());
+
+  sham::Element element;
+  EXPECT_TRUE(queue->empty());
+  EXPECT_FALSE(handle.try_pop(element));
+  for (int round = 0; round < 3; ++round) {
+    for (uint64_t i = 0; i < 1000; ++i) ASSERT_TRUE(handle.try_push({0, 0, i}));
+    EXPECT_FALSE(queue->empty());
+    for (uint64_t i = 0; i < 1000; ++i) {
+      ASSERT_TRUE(handle.try_pop(element));
+      EXPECT_EQ(element.value, i);
+    }
+    EXPECT_FALSE(handle.try_pop(element));
+    EXPECT_TRUE(queue->empty());
+  }
+}
+
+TEST(SegmentedQueueTest, DrainedSegmentsAreRecycled) {
+  sham::SharedMemoryBuffer buffer(kSharedMemoryName, kCapacity,
+                                  sham::SharedMemoryBuffer::Type::kCreate);
+  // A single chunk of the pool.
+  auto* pool = buffer.Allocate<sham::PoolAllocator>(buffer, sham::PoolAllocator::kChunkSize);
+  auto* queue = buffer.Allocate<SmallQueueT>(buffer, *pool);
+  ASSERT_TRUE(queue->valid());
+  SmallQueueT::Handle handle(*queue);
+
+  // Pushes until the pool is out of segments.
+  uint64_t max_size = 0;
+  while (handle.try_push({0, 0, max_size})) ++max_size;
+  EXPECT_GT(max_size, 100u);
+  sham::Element element;
+  for (uint64_t i = 0; i < max_size; ++i) {
+    ASSERT_TRUE(handle.try_pop(element));
+    EXPECT_EQ(element.value, i);
+  }
+
+  // Many more elements than fit at once go through the queue.
+  for (uint64_t i = 0; i < 100 * max_size; ++i) {
+    ASSERT_TRUE(handle.try_push({0, 0, i}));
+    ASSERT_TRUE(handle.try_pop(element));
+    ASSERT_EQ(element.value, i);
+  }
+}
+
+TEST(SegmentedQueueTest, ManyThreads) {
+  static constexpr uint64_t kNumThreads = 4;
+  static constexpr uint64_t kNumPushPerThread = 200'000;
+  sham::SharedMemoryBuffer buffer(kSharedMemoryName, kCapacity,
+                                  sham::SharedMemoryBuffer::Type::kCreate);
+  auto* pool = buffer.Allocate<sham::PoolAllocator>(buffer, kCapacity / 2);
+  auto* queue = buffer.Allocate<SmallQueueT>(buffer, *pool);
+  ASSERT_TRUE(queue->valid());
+
+  // Each thread pushes and pops, each element is popped once and those of a producer in order.
+  std::vector<std::vector<uint64_t>> popped(kNumThreads);
+  std::vector<std::thread> threads;
+  for (uint64_t id = 0; id < kNumThreads; ++id) {
+    threads.emplace_back([&, id] {
+      SmallQueueT::Handle handle(*queue);
+      std::vector<uint64_t> last_values(kNumThreads, 0);
+      sham::Element element;
+      for (uint64_t i = 1; i <= kNumPushPerThread; ++i) {
+        while (!handle.try_push({id, 0, i})) {
+        }
+        while (!handle.try_pop(element)) {
+        }
+        EXPECT_GT(element.value, last_values[element.thread_id]);
+        last_values[element.thread_id] = element.value;
+        popped[id].push_back(element.thread_id * kNumPushPerThread + element.value - 1);
+      }
+    });
+  }
+  for (std::thread& thread : threads) thread.join();
+
+  std::vector<bool> seen(kNumThreads * kNumPushPerThread, false);
+  for (const std::vector<uint64_t>& values : popped) {
+    for (uint64_t value : values) {
+      ASSERT_FALSE(seen[value]);
+      seen[value] = true;
+    }
+  }
+  EXPECT_TRUE(queue->empty());
+}
+
+TEST(SegmentedQueueTest, ProducerAndConsumerProcesses) {
+  static constexpr uint64_t kNumProducers = 2;
+  static constexpr uint64_t kNumConsumers = 2;
+  static constexpr uint64_t kNumPushPerProducer = 100'000;
+  sham::SharedMemoryBuffer buffer(kSharedMemoryName, kCapacity,
+                                  sham::SharedMemoryBuffer::Type::kCreate);
+  auto* pool = buffer.Allocate<sham::PoolAllocator>(buffer, kCapacity / 2);
+  auto* queue = buffer.Allocate<sham::mpmc::SegmentedQueue<sham::Element>>(buffer, *pool);
+  auto* num_popped = buffer.Allocate<std::atomic<uint64_t>>();
+  auto* sum = buffer.Allocate<std::atomic<uint64_t>>();
+  ASSERT_TRUE(queue->valid());
+
+  std::vector<pid_t> pids;
+  for (uint64_t id = 0; id < kNumProducers; ++id) {
+    pid_t pid = fork();
+    if (pid == 0) {
+      sham::mpmc::SegmentedQueue<sham::Element>::Handle handle(*queue);
+      for (uint64_t i = 1; i <= kNumPushPerProducer; ++i) {
+        while (!handle.try_push({id, 0, i})) {
+        }
+      }
+      _exit(0);
+    }
+    pids.push_back(pid);
+  }
+  for (uint64_t id = 0; id < kNumConsumers; ++id) {
+    pid_t pid = fork();
+    if (pid == 0) {
+      sham::mpmc::SegmentedQueue<sham::Element>::Handle handle(*queue);
+      sham::Element element;
+      while (num_popped->load() < kNumProducers * kNumPushPerProducer) {
+        if (!handle.try_pop(element)) continue;
+        sum->fetch_add(element.value);
+        num_popped->fetch_add(1);
+      }
+      _exit(0);
+    }
+    pids.push_back(pid);
+  }
+  for (pid_t pid : pids) ASSERT_EQ(waitpid(pid, nullptr, 0), pid);
+
+  EXPECT_EQ(num_popped->load(), kNumProducers * kNumPushPerProducer);
+  EXPECT_EQ(sum->load(), kNumProducers * kNumPushPerProducer * (kNumPushPerProducer + 1) / 2);
+  EXPECT_TRUE(queue->empty());
+}
@@ -0,0 +1,90 @@
+/*
+MIT License - Copyright (c) 2023 Pierric Gimmig
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#include "sham/queue_spsc.h"
+
+#include <memory>
+#include <thread>
+
+#include "gtest/gtest.h"
+#include "sham/benchmark.h"
+#include "sham/shared_memory_buffer.h"
+
+TEST(SpscQueueTest, PushPop) {
+  auto q = std::make_unique<sham::SPSCQueue<int, 3>>();
+  EXPECT_TRUE(q->empty());
+  EXPECT_TRUE(q->try_push(1));
+  EXPECT_TRUE(q->try_push(2));
+  EXPECT_TRUE(q->try_push(3));
+  EXPECT_FALSE(q->try_push(4));
+  EXPECT_EQ(q->size(), 3);
+  for (int i = 1; i <= 3; ++i) {
+    ASSERT_NE(q->front(), nullptr);
+    EXPECT_EQ(*q->front(), i);
+    q->pop();
+  }
+  EXPECT_EQ(q->front(), nullptr);
+}
+
+TEST(SpscQueueTest, ReleaseUnusedMemory) {
+  using QueueT = sham::SPSCQueue<sham::Element, 128 * 1024>;
+  sham::SharedMemoryBuffer buffer("queue_spsc_test", sizeof(QueueT),
+                                  sham::SharedMemoryBuffer::Type::kCreate);
+  QueueT* q = buffer.Allocate<QueueT>();
+  ASSERT_NE(q, nullptr);
+  size_t initial_resident_size = q->resident_size();
+
+  for (uint64_t i = 0; i < q->capacity(); ++i) q->push({0, 0, i});
+  EXPECT_FALSE(q->release_unused_memory());
+  while (q->front() != nullptr) q->pop();
+  EXPECT_GT(q->resident_size(), sizeof(QueueT) / 2);
+
+  EXPECT_TRUE(q->release_unused_memory());
+  EXPECT_LE(q->resident_size(), initial_resident_size);
+
+  // The queue is still valid, with a producer and a consumer in different threads.
+  static constexpr uint64_t kNumElements = 1024 * 1024;
+  std::thread producer([q] {
+    for (uint64_t i = 0; i < kNumElements; ++i) q->push({0, 0, i});
+  });
+  for (uint64_t i = 0; i < kNumElements; ++i) {
+    sham::Element* element = nullptr;
+    while ((element = q->front()) == nullptr) {
+    }
+    ASSERT_EQ(element->value, i);
+    q->pop();
+  }
+  producer.join();
+}
+
+TEST(SpscQueueTest, ReleaseUnusedMemoryOfHeapQueue) {
+  // Large allocations are private anonymous mappings.
+  using QueueT = sham::SPSCQueue<sham::Element, 128 * 1024>;
+  auto q = std::make_unique<QueueT>();
+  for (uint64_t i = 0; i < q->capacity(); ++i) q->push({0, 0, i});
+  while (q->front() != nullptr) q->pop();
+  size_t resident_size = q->resident_size();
+  EXPECT_TRUE(q->release_unused_memory());
+  EXPECT_LT(q->resident_size(), resident_size / 8);
+  q->push({0, 0, 42});
+  EXPECT_EQ(q->front()->value, 42);
+}
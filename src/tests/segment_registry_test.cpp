@@ -0,0 +1,173 @@
+/*
+MIT License - Copyright (c) 2023 Pierric Gimmig
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#include "sham/segment_registry.h"
+
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "sham/shared_memory_buffer.h"
+
+static constexpr const char* kRegistryName = "sham_segment_registry_test";
+static constexpr const char* kSegmentName = "segment_registry_test";
+static constexpr size_t kCapacity = 64 * 1024;
+
+class SegmentRegistryTest : public testing::Test {
+ protected:
+  void SetUp() override { sham::SegmentRegistry::Destroy(kRegistryName); }
+  void TearDown() override { sham::SegmentRegistry::Destroy(kRegistryName); }
+
+  static const sham::SegmentInfo* FindSegment(const std::vector<sham::SegmentInfo>& segments,
+                                              std::string_view name) {
+    auto it = std::find_if(segments.begin(), segments.end(),
+                           [&](const sham::SegmentInfo& info) { return info.name == name; });
+    return it == segments.end() ? nullptr : &*it;
+  }
+};
+
+TEST_F(SegmentRegistryTest, RegistersBuffers) {
+  sham::SegmentRegistry registry(kRegistryName);
+  ASSERT_TRUE(registry.valid());
+  sham::SharedMemoryBufferOptions options;
+  options.registry = &registry;
+  {
+    sham::SharedMemoryBuffer buffer(kSegmentName, kCapacity,
+                                    sham::SharedMemoryBuffer::Type::kCreate, options);
+    sham::SharedMemoryBuffer attached(kSegmentName, kCapacity,
+                                      sham::SharedMemoryBuffer::Type::kAccessExisting, options);
+    buffer.data()[0] = 1;
+
+    std::vector<sham::SegmentInfo> segments = registry.List();
+    ASSERT_EQ(segments.size(), 1);
+    const sham::SegmentInfo& info = segments[0];
+    EXPECT_EQ(info.name, kSegmentName);
+    EXPECT_EQ(info.size, sham::SharedMemoryHeader::kSize + kCapacity);
+    EXPECT_GT(info.allocated_size, 0);
+    EXPECT_LT(info.allocated_size, info.size);
+    EXPECT_EQ(info.creator_pid, getpid());
+    EXPECT_GT(info.creation_time, 0);
+    EXPECT_EQ(info.pids, std::vector<uint32_t>(2, getpid()));
+    EXPECT_FALSE(info.orphaned);
+    EXPECT_TRUE(registry.ReclaimOrphans().empty());
+
+    // Another registry object sees the same records.
+    sham::SegmentRegistry other_registry(kRegistryName);
+    EXPECT_EQ(other_registry.List().size(), 1);
+  }
+  EXPECT_TRUE(registry.List().empty());
+}
+
+TEST_F(SegmentRegistryTest, ReclaimsSegmentsOfCrashedProcesses) {
+  sham::SegmentRegistry registry(kRegistryName);
+  sham::SharedMemoryBufferOptions options;
+  options.registry = &registry;
+  sham::SharedMemoryBuffer live_buffer(kSegmentName, kCapacity,
+                                       sham::SharedMemoryBuffer::Type::kCreate, options);
+
+  // The child creates a segment and attaches to the parent's one, then exits without running any
+  // destructor, as if it crashed.
+  pid_t pid = fork();
+  if (pid == 0) {
+    sham::SegmentRegistry child_registry(kRegistryName);
+    sham::SharedMemoryBufferOptions child_options;
+    child_options.registry = &child_registry;
+    auto* leaked = new sham::SharedMemoryBuffer("segment_registry_test_leaked", kCapacity,
+                                                sham::SharedMemoryBuffer::Type::kCreate,
+                                                child_options);
+    auto* attached = new sham::SharedMemoryBuffer(
+        kSegmentName, kCapacity, sham::SharedMemoryBuffer::Type::kAccessExisting, child_options);
+    _exit(leaked->valid() && attached->valid() ? 0 : 1);
+  }
+  int status = 0;
+  ASSERT_EQ(waitpid(pid, &status, 0), pid);
+  ASSERT_TRUE(WIFEXITED(status));
+  ASSERT_EQ(WEXITSTATUS(status), 0);
+
+  std::vector<sham::SegmentInfo> segments = registry.List();
+  ASSERT_EQ(segments.size(), 2);
+  const sham::SegmentInfo* leaked = FindSegment(segments, "segment_registry_test_leaked");
+  ASSERT_NE(leaked, nullptr);
+  EXPECT_EQ(leaked->creator_pid, pid);
+  EXPECT_TRUE(leaked->orphaned);
+  const sham::SegmentInfo* live = FindSegment(segments, kSegmentName);
+  ASSERT_NE(live, nullptr);
+  EXPECT_EQ(live->pids.size(), 2);
+  EXPECT_FALSE(live->orphaned);
+
+  EXPECT_EQ(registry.ReclaimOrphans(), std::vector<std::string>{"segment_registry_test_leaked"});
+  EXPECT_FALSE(sham::UnlinkFileMapping("segment_registry_test_leaked"));
+  segments = registry.List();
+  ASSERT_EQ(segments.size(), 1);
+  EXPECT_EQ(segments[0].pids, std::vector<uint32_t>{static_cast<uint32_t>(getpid())});
+}
+
+TEST_F(SegmentRegistryTest, RecoversEntriesLockedByCrashedProcesses) {
+  sham::SegmentRegistry registry(kRegistryName);
+  // The child crashes while registering a segment, as reading its name faults.
+  pid_t pid = fork();
+  if (pid == 0) {
+    sham::SegmentRegistry child_registry(kRegistryName);
+    void* page = mmap(nullptr, 4096, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    child_registry.Register(std::string_view(static_cast<const char*>(page), 8), kCapacity);
+    _exit(0);
+  }
+  int status = 0;
+  ASSERT_EQ(waitpid(pid, &status, 0), pid);
+  ASSERT_TRUE(WIFSIGNALED(status));
+
+  // The entry locked by the child is lost until it is reclaimed.
+  for (size_t i = 0; i < sham::SegmentRegistry::kMaxSegments - 1; ++i) {
+    ASSERT_TRUE(registry.Register("segment_" + std::to_string(i), 1));
+  }
+  EXPECT_FALSE(registry.Register("last_segment", 1));
+  EXPECT_TRUE(registry.ReclaimOrphans().empty());
+  EXPECT_TRUE(registry.Register("last_segment", 1));
+  EXPECT_EQ(registry.List().size(), sham::SegmentRegistry::kMaxSegments);
+}
+
+TEST_F(SegmentRegistryTest, Limits) {
+  sham::SegmentRegistry registry(kRegistryName);
+  EXPECT_FALSE(registry.Register(std::string(sham::SegmentRegistry::kMaxNameSize + 1, 'a'), 1));
+  EXPECT_FALSE(registry.Attach("unknown"));
+  EXPECT_FALSE(registry.Detach("unknown"));
+  EXPECT_FALSE(registry.Unregister("unknown"));
+
+  for (size_t i = 0; i < sham::SegmentRegistry::kMaxSegments; ++i) {
+    ASSERT_TRUE(registry.Register("segment_" + std::to_string(i), 1));
+  }
+  EXPECT_FALSE(registry.Register("one_too_many", 1));
+  // Registering a name again replaces its record.
+  EXPECT_TRUE(registry.Register("segment_0", 2));
+  EXPECT_EQ(registry.List().size(), sham::SegmentRegistry::kMaxSegments);
+
+  for (size_t i = 1; i < sham::SegmentRegistry::kMaxProcessesPerSegment; ++i) {
+    EXPECT_TRUE(registry.Attach("segment_0"));
+  }
+  EXPECT_FALSE(registry.Attach("segment_0"));
+  EXPECT_TRUE(registry.Detach("segment_0"));
+  EXPECT_TRUE(registry.Attach("segment_0"));
+}
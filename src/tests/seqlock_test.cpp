@@ -0,0 +1,153 @@
+/*
+MIT License - Copyright (c) 2023 Pierric Gimmig
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#include "sham/seqlock.h"
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <thread>
+
+#include "gtest/gtest.h"
+#include "sham/shared_memory_buffer.h"
+
+static constexpr const char* kSharedMemoryName = "seqlock_test";
+static constexpr size_t kCapacity = 1024 * 1024;
+
+// All fields equal, so that a torn read is detected.
+struct Quote {
+  uint64_t fields[12];
+
+  static Quote Make(uint64_t value) {
+    Quote quote;
+    for (uint64_t& field : quote.fields) field = value;
+    return quote;
+  }
+
+  bool IsConsistent() const {
+    for (uint64_t field : fields) {
+      if (field != fields[0]) return false;
+    }
+    return true;
+  }
+};
+
+TEST(SeqLockTest, StoreLoad) {
+  sham::SharedMemoryBuffer buffer(kSharedMemoryName, kCapacity,
+                                  sham::SharedMemoryBuffer::Type::kCreate);
+  auto* cell = buffer.Allocate<sham::SeqLock<Quote>>();
+  ASSERT_NE(cell, nullptr);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(cell) % 64, 0);
+  EXPECT_EQ(cell->version(), 0);
+  EXPECT_EQ(cell->Load().fields[0], 0);
+
+  cell->Store(Quote::Make(42));
+  EXPECT_EQ(cell->version(), 1);
+  Quote quote;
+  ASSERT_TRUE(cell->TryLoad(&quote));
+  EXPECT_EQ(quote.fields[11], 42);
+
+  cell->Update([](Quote& current) { current.fields[0] = 7; });
+  EXPECT_EQ(cell->version(), 2);
+  EXPECT_EQ(cell->Load().fields[0], 7);
+  EXPECT_EQ(cell->Load().fields[1], 42);
+}
+
+TEST(SeqLockTest, TryLoadFailsDuringWrite) {
+  sham::SeqLock<Quote> cell(Quote::Make(1));
+  cell.Update([&cell](Quote& current) {
+    Quote quote;
+    EXPECT_FALSE(cell.TryLoad(&quote));
+    current = Quote::Make(2);
+  });
+  Quote quote;
+  ASSERT_TRUE(cell.TryLoad(&quote));
+  EXPECT_EQ(quote.fields[0], 2);
+}
+
+TEST(SeqLockTest, ReadersNeverSeeTornValues) {
+  static constexpr uint64_t kNumWrites = 200'000;
+  sham::SharedMemoryBuffer buffer(kSharedMemoryName, kCapacity,
+                                  sham::SharedMemoryBuffer::Type::kCreate);
+  auto* cell = buffer.Allocate<sham::SeqLock<Quote>>();
+  ASSERT_NE(cell, nullptr);
+
+  pid_t pid = fork();
+  if (pid == 0) {
+    for (uint64_t i = 1; i <= kNumWrites; ++i) cell->Store(Quote::Make(i));
+    _exit(0);
+  }
+  std::thread reader([cell] {
+    uint64_t last = 0;
+    while (last != kNumWrites) {
+      Quote quote = cell->Load();
+      ASSERT_TRUE(quote.IsConsistent());
+      ASSERT_GE(quote.fields[0], last);
+      last = quote.fields[0];
+    }
+  });
+  uint64_t last = 0;
+  while (last != kNumWrites) {
+    Quote quote = cell->Load();
+    ASSERT_TRUE(quote.IsConsistent());
+    ASSERT_GE(quote.fields[0], last);
+    last = quote.fields[0];
+  }
+  reader.join();
+  ASSERT_EQ(waitpid(pid, nullptr, 0), pid);
+  EXPECT_EQ(cell->version(), kNumWrites);
+}
+
+TEST(SeqLockTest, Array) {
+  static constexpr size_t kSize = 100;
+  sham::SharedMemoryBuffer buffer(kSharedMemoryName, kCapacity,
+                                  sham::SharedMemoryBuffer::Type::kCreate);
+  auto* array = buffer.Allocate<sham::SeqLockArray<Quote>>(buffer, kSize);
+  ASSERT_NE(array, nullptr);
+  ASSERT_EQ(array->size(), kSize);
+  for (size_t i = 0; i < kSize; ++i) array->Store(i, Quote::Make(i));
+
+  // Cells don't share cache lines.
+  EXPECT_EQ(sizeof(sham::SeqLock<Quote>) % 64, 0);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(&(*array)[1]) % 64, 0);
+
+  pid_t pid = fork();
+  if (pid == 0) {
+    bool ok = true;
+    for (size_t i = 0; i < kSize; ++i) ok &= array->Load(i).fields[5] == i;
+    array->Store(3, Quote::Make(1000));
+    _exit(ok ? 0 : 1);
+  }
+  int status = 0;
+  ASSERT_EQ(waitpid(pid, &status, 0), pid);
+  EXPECT_EQ(WEXITSTATUS(status), 0);
+  EXPECT_EQ(array->Load(3).fields[0], 1000);
+  EXPECT_EQ((*array)[3].version(), 2);
+  EXPECT_EQ((*array)[4].version(), 1);
+}
+
+TEST(SeqLockTest, ArrayInFullBuffer) {
+  sham::SharedMemoryBuffer buffer(kSharedMemoryName, 4096, sham::SharedMemoryBuffer::Type::kCreate);
+  auto* array = buffer.Allocate<sham::SeqLockArray<Quote>>(buffer, 1000);
+  ASSERT_NE(array, nullptr);
+  EXPECT_EQ(array->size(), 0);
+}
@@ -0,0 +1,186 @@
+/*
+MIT License - Copyright (c) 2023 Pierric Gimmig
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#include "sham/sequenced_ring.h"
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "sham/shared_memory_buffer.h"
+
+static constexpr const char* kSharedMemoryName = "sequenced_ring_test";
+static constexpr size_t kCapacity = 64 * 1024 * 1024;
+
+struct Event {
+  uint64_t value;
+  uint64_t enriched;
+  uint64_t risk;
+  uint64_t persisted;
+};
+
+using RingT = sham::SequencedRing<Event, 64>;
+
+TEST(SequencedRingTest, AddStage) {
+  sham::SequencedRing<Event, 4, 3> ring;
+  EXPECT_FALSE(ring.AddStage({0}).has_value());
+  EXPECT_EQ(ring.AddStage(), 0);
+  EXPECT_EQ(ring.AddStage({0}), 1);
+  EXPECT_FALSE(ring.AddStage({2}).has_value());
+  EXPECT_FALSE(ring.AddStage({-1}).has_value());
+  EXPECT_EQ(ring.AddStage({0, 1}), 2);
+  EXPECT_FALSE(ring.AddStage().has_value());
+  EXPECT_EQ(ring.num_stages(), 3);
+}
+
+TEST(SequencedRingTest, StagesWaitForUpstreamStages) {
+  RingT ring;
+  int enrich = *ring.AddStage();
+  int risk = *ring.AddStage({enrich});
+  int persist = *ring.AddStage({enrich});
+  int publish = *ring.AddStage({risk, persist});
+  RingT::Producer producer(ring);
+  RingT::Stage enrich_stage(ring, enrich);
+  RingT::Stage risk_stage(ring, risk);
+  RingT::Stage persist_stage(ring, persist);
+  RingT::Stage publish_stage(ring, publish);
+  auto ignore = [](Event&, int64_t) {};
+
+  // Claimed events are only visible once published.
+  int64_t first = producer.Claim(10);
+  EXPECT_EQ(first, 0);
+  for (int64_t i = first; i < first + 10; ++i) producer[i] = {static_cast<uint64_t>(i), 0, 0, 0};
+  EXPECT_EQ(enrich_stage.Available(), 0u);
+  producer.Publish();
+  EXPECT_EQ(ring.cursor(), 10);
+  EXPECT_EQ(risk_stage.Available(), 0u);
+
+  // Stages process events in place, in batches.
+  EXPECT_EQ(enrich_stage.TryConsume([](Event& event, int64_t) { event.enriched = 1; }, 4), 4u);
+  EXPECT_EQ(risk_stage.TryConsume([](Event& event, int64_t) { event.risk = event.enriched; }), 4u);
+  EXPECT_EQ(publish_stage.TryConsume(ignore), 0u);
+  EXPECT_EQ(persist_stage.TryConsume(ignore, 2), 2u);
+  EXPECT_EQ(publish_stage.TryConsume([](Event& event, int64_t sequence) {
+    EXPECT_EQ(event.value, static_cast<uint64_t>(sequence));
+    EXPECT_EQ(event.risk, 1u);
+  }),
+            2u);
+  EXPECT_EQ(ring.cursor(publish), 2);
+
+  // The producer can't claim slots that the publish stage hasn't released.
+  EXPECT_EQ(producer.TryClaim(RingT::capacity() - 8), 10);
+  producer.Publish();
+  EXPECT_FALSE(producer.TryClaim(1).has_value());
+  while (enrich_stage.TryConsume(ignore) + risk_stage.TryConsume(ignore) +
+             persist_stage.TryConsume(ignore) + publish_stage.TryConsume(ignore) >
+         0) {
+  }
+  EXPECT_EQ(ring.cursor(publish), static_cast<int64_t>(RingT::capacity()) + 2);
+  EXPECT_EQ(producer.TryClaim(RingT::capacity()), static_cast<int64_t>(RingT::capacity()) + 2);
+  EXPECT_FALSE(producer.TryClaim(RingT::capacity() + 1).has_value());
+}
+
+// Runs decode -> enrich -> (risk, persist) -> publish on `ring`, with the stage of index `stage` in
+// the calling thread, or the producer if it is -1.
+static void RunPipeline(RingT& ring, int stage, uint64_t num_events) {
+  auto consume = [&](auto&& process) {
+    RingT::Stage handle(ring, stage);
+    for (uint64_t n = 0; n < num_events;) n += handle.Consume(process);
+  };
+  switch (stage) {
+    case -1: {
+      RingT::Producer producer(ring);
+      for (uint64_t i = 0; i < num_events; i += 8) {
+        int64_t first = producer.Claim(8);
+        for (int64_t j = 0; j < 8; ++j) producer[first + j] = {i + j, 0, 0, 0};
+        producer.Publish();
+      }
+      break;
+    }
+    case 0:
+      consume([](Event& event, int64_t) { event.enriched = event.value + 1; });
+      break;
+    case 1:
+      consume([](Event& event, int64_t) { event.risk = event.enriched * 2; });
+      break;
+    case 2:
+      consume([](Event& event, int64_t) { event.persisted = event.enriched * 3; });
+      break;
+    case 3: {
+      uint64_t num_errors = 0;
+      consume([&](Event& event, int64_t sequence) {
+        num_errors += event.value != static_cast<uint64_t>(sequence) ||
+                      event.risk != (event.value + 1) * 2 ||
+                      event.persisted != (event.value + 1) * 3;
+      });
+      EXPECT_EQ(num_errors, 0u);
+      break;
+    }
+  }
+}
+
+static void AddPipelineStages(RingT& ring) {
+  int enrich = *ring.AddStage();
+  int risk = *ring.AddStage({enrich});
+  int persist = *ring.AddStage({enrich});
+  ring.AddStage({risk, persist});
+}
+
+TEST(SequencedRingTest, PipelineThreads) {
+  static constexpr uint64_t kNumEvents = 1'000'000;
+  RingT ring;
+  AddPipelineStages(ring);
+  std::vector<std::thread> threads;
+  for (int stage = -1; stage < 4; ++stage) {
+    threads.emplace_back([&, stage] { RunPipeline(ring, stage, kNumEvents); });
+  }
+  for (std::thread& thread : threads) thread.join();
+  for (int stage = 0; stage < 4; ++stage) EXPECT_EQ(ring.cursor(stage), kNumEvents);
+}
+
+TEST(SequencedRingTest, PipelineProcesses) {
+  static constexpr uint64_t kNumEvents = 100'000;
+  sham::SharedMemoryBuffer buffer(kSharedMemoryName, kCapacity,
+                                  sham::SharedMemoryBuffer::Type::kCreate);
+  auto* ring = buffer.Allocate<RingT>();
+  ASSERT_NE(ring, nullptr);
+  AddPipelineStages(*ring);
+  std::vector<pid_t> pids;
+  for (int stage = 0; stage < 4; ++stage) {
+    pid_t pid = fork();
+    if (pid == 0) {
+      RunPipeline(*ring, stage, kNumEvents);
+      _exit(::testing::Test::HasFailure() ? 1 : 0);
+    }
+    pids.push_back(pid);
+  }
+  RunPipeline(*ring, -1, kNumEvents);
+  for (pid_t pid : pids) {
+    int status = 0;
+    ASSERT_EQ(waitpid(pid, &status, 0), pid);
+    EXPECT_EQ(WEXITSTATUS(status), 0);
+  }
+  EXPECT_EQ(ring->cursor(3), kNumEvents);
+}
@@ -22,7 +22,19 @@ SOFTWARE.
 
 #include "sham/shared_memory_buffer.h"
 
+#ifndef _WIN32
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <thread>
+#include <vector>
+
 #include "gtest/gtest.h"
+#include "sham/queue_mpmc.h"
 
 static constexpr const char* kSharedMemoryName = "shared_memory_buffer_test";
 
@@ -61,6 +73,89 @@ TEST(SharedMemoryBufferTest, MultipleAccess) {
   EXPECT_EQ(*ptr2, 123);
 }
 
+#ifndef _WIN32
+// Windows mappings are sized on creation.
+TEST(SharedMemoryBufferTest, AttacherWaitsForCreator) {
+  // A creator between the creation of the segment and the initialization of its header.
+  sham::FileHandle handle = sham::CreateFileMapping(kSharedMemoryName, 0);
+  ASSERT_NE(handle, sham::kInvalidFileHandle);
+  std::unique_ptr<sham::SharedMemoryBuffer> attached;
+  std::thread attacher([&] {
+    attached = std::make_unique<sham::SharedMemoryBuffer>(
+        kSharedMemoryName, 4096, sham::SharedMemoryBuffer::Type::kAccessExisting);
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  ASSERT_TRUE(sham::ResizeFileMapping(handle, sham::SharedMemoryHeader::kSize + 1024));
+  uint8_t* view = sham::MapViewOfFile(handle, sham::SharedMemoryHeader::kSize);
+  ASSERT_NE(view, nullptr);
+  auto* header = reinterpret_cast<sham::SharedMemoryHeader*>(view);
+  header->capacity = 1024;
+  header->max_capacity = 1024;
+  header->magic.store(sham::SharedMemoryHeader::kMagic, std::memory_order_release);
+  attacher.join();
+
+  // The attacher uses the capacity of the creator and doesn't write the header.
+  ASSERT_TRUE(attached->valid());
+  EXPECT_EQ(attached->capacity(), 1024);
+  EXPECT_EQ(header->capacity, 1024);
+  EXPECT_EQ(header->max_capacity, 1024);
+  attached.reset();
+  sham::UnMapViewOfFile(view, sham::SharedMemoryHeader::kSize);
+  sham::DestroyFileMapping(handle, kSharedMemoryName);
+}
+#endif
+
+TEST(SharedMemoryBufferTest, AttacherRejectsUninitializedHeader) {
+  sham::FileHandle handle =
+      sham::CreateFileMapping(kSharedMemoryName, sham::SharedMemoryHeader::kSize + 1024);
+  ASSERT_NE(handle, sham::kInvalidFileHandle);
+  sham::SharedMemoryBuffer attached(kSharedMemoryName, 1024,
+                                    sham::SharedMemoryBuffer::Type::kAccessExisting);
+  EXPECT_FALSE(attached.valid());
+  uint8_t* view = sham::MapViewOfFile(handle, sham::SharedMemoryHeader::kSize);
+  ASSERT_NE(view, nullptr);
+  EXPECT_FALSE(reinterpret_cast<sham::SharedMemoryHeader*>(view)->valid());
+  sham::UnMapViewOfFile(view, sham::SharedMemoryHeader::kSize);
+  sham::DestroyFileMapping(handle, kSharedMemoryName);
+}
+
+TEST(SharedMemoryBufferTest, CreateDoesNotReplaceLiveSegment) {
+  sham::SharedMemoryBuffer buffer(kSharedMemoryName, 1024,
+                                  sham::SharedMemoryBuffer::Type::kCreate);
+  *buffer.Allocate<int>() = 42;
+  sham::SharedMemoryBuffer second(kSharedMemoryName, 4096,
+                                  sham::SharedMemoryBuffer::Type::kCreate);
+  EXPECT_FALSE(second.valid());
+  EXPECT_EQ(*buffer.As<int>(), 42);
+  EXPECT_EQ(sham::GetFileMappingSize(buffer.handle()), sham::SharedMemoryHeader::kSize + 1024);
+}
+
+#ifndef _WIN32
+TEST(SharedMemoryBufferTest, CreateReplacesSegmentOfCrashedCreator) {
+  pid_t pid = fork();
+  if (pid == 0) {
+    // Exits without destroying the buffer, as a crashed process would.
+    auto* buffer = new sham::SharedMemoryBuffer(kSharedMemoryName, 1024,
+                                                sham::SharedMemoryBuffer::Type::kCreate);
+    *buffer->Allocate<int>() = 42;
+    _exit(0);
+  }
+  waitpid(pid, nullptr, 0);
+  sham::SharedMemoryBuffer buffer(kSharedMemoryName, 4096,
+                                  sham::SharedMemoryBuffer::Type::kCreate);
+  ASSERT_TRUE(buffer.valid());
+  EXPECT_EQ(buffer.capacity(), 4096);
+  EXPECT_EQ(buffer.size(), 0);
+  EXPECT_EQ(*buffer.As<int>(), 0);
+}
+#endif
+
+TEST(SharedMemoryBufferTest, DataIsPageAligned) {
+  sham::SharedMemoryBuffer buffer(kSharedMemoryName, 1024,
+                                  sham::SharedMemoryBuffer::Type::kCreate);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(buffer.data()) % sham::GetPageSize(), 0);
+}
+
 TEST(SharedMemoryBuffer, AllocateTooMuch) {
   // Allocate memory
   auto buffer = std::make_unique<sham::SharedMemoryBuffer>(kSharedMemoryName, sizeof(int),
@@ -122,3 +217,185 @@ TEST(SharedMemoryBuffer, MoveAssignment) {
 
   ASSERT_EQ(buf2.capacity(), 1024);
 }
+
+#ifdef __linux__
+TEST(SharedMemoryBuffer, CreateAnonymous) {
+  using QueueT = sham::mpmc::Queue<int, 15>;
+  sham::SharedMemoryBuffer buffer = sham::SharedMemoryBuffer::CreateAnonymous(sizeof(QueueT));
+  ASSERT_TRUE(buffer.valid());
+  EXPECT_EQ(buffer.capacity(), sizeof(QueueT));
+  QueueT* queue = buffer.Allocate<QueueT>(sham::kZeroInitialized);
+  ASSERT_NE(queue, nullptr);
+  EXPECT_TRUE(queue->try_push(42));
+
+  // Access the same memory through a duplicated handle, as a peer process would.
+  sham::SharedMemoryBuffer peer = sham::SharedMemoryBuffer::FromFileHandle(dup(buffer.handle()));
+  ASSERT_TRUE(peer.valid());
+  EXPECT_EQ(peer.capacity(), buffer.capacity());
+  int value = 0;
+  EXPECT_TRUE(peer.As<QueueT>()->try_pop(value));
+  EXPECT_EQ(value, 42);
+}
+
+TEST(SharedMemoryBuffer, AnonymousSealing) {
+  auto sealed = sham::SharedMemoryBuffer::CreateAnonymous(1024, /*seal_size=*/true);
+  EXPECT_TRUE(sham::IsFileMappingSizeSealed(sealed.handle()));
+  auto unsealed = sham::SharedMemoryBuffer::CreateAnonymous(1024, /*seal_size=*/false);
+  EXPECT_FALSE(sham::IsFileMappingSizeSealed(unsealed.handle()));
+}
+#endif
+
+TEST(SharedMemoryBuffer, PersistentQueueSurvivesRestart) {
+  using QueueT = sham::mpmc::Queue<int, 15>;
+  std::string path =
+      (std::filesystem::temp_directory_path() / "shared_memory_buffer_test.sham").string();
+  std::filesystem::remove(path);
+
+  {
+    auto buffer = sham::SharedMemoryBuffer::CreatePersistent(path, sizeof(QueueT));
+    ASSERT_TRUE(buffer.valid());
+    QueueT* queue = buffer.Allocate<QueueT>(sham::kZeroInitialized);
+    ASSERT_NE(queue, nullptr);
+    for (int i = 0; i < 4; ++i) EXPECT_TRUE(queue->try_push(i));
+    int value = 0;
+    EXPECT_TRUE(queue->try_pop(value));
+    EXPECT_TRUE(buffer.Checkpoint());
+  }
+
+  // Follow the queue without modifying it.
+  {
+    auto buffer = sham::SharedMemoryBuffer::OpenPersistentReadOnly(path);
+    ASSERT_TRUE(buffer.valid());
+    EXPECT_TRUE(buffer.read_only());
+    EXPECT_EQ(buffer.capacity(), sizeof(QueueT));
+    EXPECT_EQ(buffer.Allocate<int>(), nullptr);
+    const QueueT* queue = buffer.As<QueueT>();
+    EXPECT_EQ(queue->size(), 3);
+    int value = 0;
+    EXPECT_FALSE(queue->try_peek(queue->tail() - 1, value));
+    for (size_t i = queue->tail(); i < queue->head(); ++i) {
+      EXPECT_TRUE(queue->try_peek(i, value));
+      EXPECT_EQ(value, static_cast<int>(i));
+    }
+    EXPECT_FALSE(queue->try_peek(queue->head(), value));
+  }
+
+  // Resume consuming where the previous process left off.
+  {
+    auto buffer = sham::SharedMemoryBuffer::CreatePersistent(path, sizeof(QueueT));
+    ASSERT_TRUE(buffer.valid());
+    QueueT* queue = buffer.As<QueueT>();
+    int value = 0;
+    for (int i = 1; i < 4; ++i) {
+      EXPECT_TRUE(queue->try_pop(value));
+      EXPECT_EQ(value, i);
+    }
+    EXPECT_FALSE(queue->try_pop(value));
+  }
+
+  EXPECT_TRUE(std::filesystem::remove(path));
+}
+
+TEST(SharedMemoryBuffer, Grow) {
+  sham::SharedMemoryBufferOptions options;
+  options.max_capacity = 1024 * 1024;
+  sham::SharedMemoryBuffer buffer(kSharedMemoryName, 1024, sham::SharedMemoryBuffer::Type::kCreate,
+                                  options);
+  sham::SharedMemoryBuffer attached(kSharedMemoryName, 1024,
+                                    sham::SharedMemoryBuffer::Type::kAccessExisting);
+  EXPECT_EQ(buffer.max_capacity(), options.max_capacity);
+  EXPECT_EQ(attached.max_capacity(), options.max_capacity);
+  EXPECT_EQ(buffer.generation(), 0);
+
+  int* first = buffer.Allocate<int>(1);
+  ASSERT_NE(first, nullptr);
+
+  // Allocating past the capacity grows the buffer.
+  uint8_t* large = buffer.Allocate(4096);
+  ASSERT_NE(large, nullptr);
+  EXPECT_GE(buffer.capacity(), buffer.size());
+  EXPECT_GT(buffer.size(), 4096);
+  EXPECT_EQ(buffer.generation(), 1);
+  large[4095] = 42;
+
+  // Previous allocations are still valid.
+  EXPECT_EQ(first, buffer.As<int>());
+  EXPECT_EQ(*first, 1);
+
+  // Other processes map the new range on first access.
+  EXPECT_EQ(attached.capacity(), 1024);
+  EXPECT_EQ(attached.generation(), 1);
+  uint8_t* value = attached.As<uint8_t>(large - buffer.data() + 4095);
+  ASSERT_NE(value, nullptr);
+  EXPECT_EQ(*value, 42);
+  EXPECT_EQ(attached.capacity(), buffer.capacity());
+  EXPECT_EQ(*attached.As<int>(), 1);
+
+  // Only the creator can grow, up to the maximum capacity.
+  EXPECT_FALSE(attached.Grow(8192));
+  EXPECT_FALSE(buffer.Grow(2 * options.max_capacity));
+  EXPECT_TRUE(buffer.Grow(options.max_capacity));
+  EXPECT_EQ(buffer.capacity(), options.max_capacity);
+  EXPECT_EQ(buffer.Allocate(options.max_capacity), nullptr);
+  EXPECT_NE(attached.As<uint8_t>(options.max_capacity - 1), nullptr);
+}
+
+TEST(SharedMemoryBuffer, FixedCapacityDoesNotGrow) {
+  sham::SharedMemoryBuffer buffer(kSharedMemoryName, 1024, sham::SharedMemoryBuffer::Type::kCreate);
+  EXPECT_EQ(buffer.max_capacity(), 1024);
+  EXPECT_FALSE(buffer.Grow(2048));
+  EXPECT_NE(buffer.Allocate(1024), nullptr);
+  EXPECT_EQ(buffer.Allocate(1), nullptr);
+}
+
+TEST(SharedMemoryBuffer, AllocationsAreAligned) {
+  sham::SharedMemoryBuffer buffer(kSharedMemoryName, 1024, sham::SharedMemoryBuffer::Type::kCreate);
+  struct alignas(64) CacheLine {
+    char data[64];
+  };
+  EXPECT_NE(buffer.Allocate<char>('a'), nullptr);
+  CacheLine* line = buffer.Allocate<CacheLine>();
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(line) % 64, 0);
+  EXPECT_EQ(buffer.size(), 128);
+  EXPECT_NE(buffer.Allocate<char>('b'), nullptr);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(buffer.Allocate(1, 8)) % 8, 0);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(buffer.Allocate(1)) % alignof(std::max_align_t), 0);
+  EXPECT_EQ(buffer.Allocate(1, 2 * sham::SharedMemoryHeader::kSize), nullptr);
+}
+
+TEST(SharedMemoryBuffer, AllocationCursorIsShared) {
+  static constexpr size_t kNumThreads = 4;
+  static constexpr size_t kNumAllocations = 1000;
+  static constexpr size_t kCapacity = kNumThreads * kNumAllocations * sizeof(uint64_t);
+  sham::SharedMemoryBuffer buffer(kSharedMemoryName, kCapacity,
+                                  sham::SharedMemoryBuffer::Type::kCreate);
+
+  // Each thread allocates through its own mapping, like separate processes would.
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < kNumThreads; ++i) {
+    threads.emplace_back([i] {
+      sham::SharedMemoryBuffer attached(kSharedMemoryName, kCapacity,
+                                        sham::SharedMemoryBuffer::Type::kAccessExisting);
+      for (size_t j = 0; j < kNumAllocations; ++j) {
+        uint64_t* value = attached.Allocate<uint64_t>(i);
+        ASSERT_NE(value, nullptr);
+      }
+    });
+  }
+  for (std::thread& thread : threads) thread.join();
+
+  EXPECT_EQ(buffer.size(), kCapacity);
+  EXPECT_EQ(buffer.Allocate<uint64_t>(), nullptr);
+  std::vector<size_t> counts(kNumThreads);
+  for (size_t offset = 0; offset < kCapacity; offset += sizeof(uint64_t)) {
+    uint64_t thread_index = *buffer.As<uint64_t>(offset);
+    ASSERT_LT(thread_index, kNumThreads);
+    ++counts[thread_index];
+  }
+  EXPECT_EQ(counts, std::vector<size_t>(kNumThreads, kNumAllocations));
+
+  // New mappings see the allocated size.
+  sham::SharedMemoryBuffer attached(kSharedMemoryName, kCapacity,
+                                    sham::SharedMemoryBuffer::Type::kAccessExisting);
+  EXPECT_EQ(attached.size(), kCapacity);
+}
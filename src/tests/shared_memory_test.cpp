@@ -23,6 +23,7 @@ SOFTWARE.
 #include "sham/shared_memory.h"
 
 #include "gtest/gtest.h"
+#include "sham/unix_socket.h"
 
 static constexpr const char* kSharedMemoryName = "shared_memory_test";
 static constexpr const char* kChildMessage = "Hello World!";
@@ -91,4 +92,65 @@ TEST_F(SharedMemoryTest, MultipleProcesses) {
     sham::UnMapViewOfFile(ptr, 1024);
   }
 }
-#endif
\ No newline at end of file
+
+// Same as MultipleProcesses, but the child creates an anonymous file mapping and hands its handle
+// to the parent over a Unix domain socket.
+#ifdef __linux__
+TEST(AnonymousSharedMemoryTest, MultipleProcesses) {
+  static constexpr const char* kSocketPath = "@sham_anonymous_shared_memory_test";
+  sham::SocketHandle listening_socket = sham::ListenUnixSocket(kSocketPath);
+  ASSERT_NE(listening_socket, sham::kInvalidSocketHandle);
+
+  // Fork process.
+  pid_t pid = fork();
+
+  if (pid == 0) {
+    // Child process.
+
+    // Create sealed anonymous shared memory.
+    sham::FileHandle handle = sham::CreateAnonymousFileMapping("test", 1024, /*seal_size=*/true);
+
+    // Write to shared memory.
+    uint8_t* ptr = sham::MapViewOfFile(handle, 1024);
+    strcpy((char*)ptr, kChildMessage);
+    sham::UnMapViewOfFile(ptr, 1024);
+
+    // Send handle to parent and wait for it to be done with the socket.
+    sham::SocketHandle socket = sham::ConnectUnixSocket(kSocketPath);
+    bool sent = sham::SendFileHandle(socket, handle);
+    char ack;
+    bool acked = read(socket, &ack, 1) == 1;
+    sham::CloseUnixSocket(socket);
+    sham::CloseFileMapping(handle);
+    exit(sent && acked ? 0 : 1);
+  } else {
+    // Parent process.
+
+    // Receive handle from child.
+    sham::SocketHandle socket = sham::AcceptUnixSocket(listening_socket);
+    sham::FileHandle handle = sham::ReceiveFileHandle(socket);
+    ASSERT_NE(handle, sham::kInvalidFileHandle);
+    char ack = 0;
+    EXPECT_EQ(write(socket, &ack, 1), 1);
+
+    // The size is sealed and can be trusted.
+    EXPECT_TRUE(sham::IsFileMappingSizeSealed(handle));
+    EXPECT_EQ(sham::GetFileMappingSize(handle), 1024);
+    EXPECT_EQ(ftruncate(handle, 512), -1);
+
+    // Check value written by child, which is still readable after the child exited.
+    int status;
+    waitpid(pid, &status, 0);
+    EXPECT_EQ(WEXITSTATUS(status), 0);
+    uint8_t* ptr = sham::MapViewOfFile(handle, 1024);
+    EXPECT_STREQ((char*)ptr, kChildMessage);
+
+    // Unmap and close shared memory.
+    sham::UnMapViewOfFile(ptr, 1024);
+    sham::CloseFileMapping(handle);
+    sham::CloseUnixSocket(socket);
+    sham::CloseUnixSocket(listening_socket);
+  }
+}
+#endif  // __linux__
+#endif
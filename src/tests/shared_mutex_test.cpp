@@ -0,0 +1,128 @@
+/*
+MIT License - Copyright (c) 2023 Pierric Gimmig
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#include "sham/shared_mutex.h"
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "sham/shared_memory_buffer.h"
+
+static constexpr const char* kSharedMemoryName = "shared_mutex_test";
+static constexpr size_t kCapacity = 1024 * 1024;
+
+// Writers keep both values equal, readers check that they never see them differ.
+struct SharedData {
+  sham::SharedMutex mutex;
+  uint64_t a = 0;
+  uint64_t b = 0;
+};
+
+static bool ReadAndCheck(SharedData* data, size_t num_reads) {
+  bool consistent = true;
+  for (size_t i = 0; i < num_reads; ++i) {
+    std::shared_lock lock(data->mutex);
+    consistent &= data->a == data->b;
+  }
+  return consistent;
+}
+
+static void Write(SharedData* data, size_t num_writes) {
+  for (size_t i = 0; i < num_writes; ++i) {
+    std::unique_lock lock(data->mutex);
+    ++data->a;
+    std::this_thread::yield();
+    ++data->b;
+  }
+}
+
+TEST(SharedMutexTest, ReadersAndWriterExclude) {
+  SharedData data;
+  {
+    std::shared_lock lock(data.mutex);
+    // Readers share the lock, writers are excluded.
+    std::thread([&data] {
+      EXPECT_TRUE(data.mutex.try_lock_shared());
+      data.mutex.unlock_shared();
+      EXPECT_FALSE(data.mutex.try_lock());
+    }).join();
+  }
+  {
+    std::unique_lock lock(data.mutex);
+    std::thread([&data] {
+      EXPECT_FALSE(data.mutex.try_lock_shared());
+      EXPECT_FALSE(data.mutex.try_lock());
+    }).join();
+  }
+  EXPECT_TRUE(data.mutex.try_lock());
+  data.mutex.unlock();
+}
+
+TEST(SharedMutexTest, Threads) {
+  static constexpr size_t kNumReaders = 8;
+  SharedData data;
+  std::vector<std::thread> readers;
+  std::atomic<bool> consistent = true;
+  for (size_t i = 0; i < kNumReaders; ++i) {
+    readers.emplace_back([&] {
+      if (!ReadAndCheck(&data, 20'000)) consistent = false;
+    });
+  }
+  std::thread writer([&data] { Write(&data, 1'000); });
+  std::thread second_writer([&data] { Write(&data, 1'000); });
+  for (std::thread& reader : readers) reader.join();
+  writer.join();
+  second_writer.join();
+  EXPECT_TRUE(consistent);
+  EXPECT_EQ(data.a, 2'000);
+  EXPECT_EQ(data.b, 2'000);
+}
+
+TEST(SharedMutexTest, Processes) {
+  sham::SharedMemoryBuffer buffer(kSharedMemoryName, kCapacity,
+                                  sham::SharedMemoryBuffer::Type::kCreate);
+  auto* data = buffer.Allocate<SharedData>();
+  ASSERT_NE(data, nullptr);
+
+  pid_t reader = fork();
+  if (reader == 0) _exit(ReadAndCheck(data, 50'000) ? 0 : 1);
+  pid_t writer = fork();
+  if (writer == 0) {
+    Write(data, 1'000);
+    _exit(0);
+  }
+  Write(data, 1'000);
+  EXPECT_TRUE(ReadAndCheck(data, 10'000));
+
+  int status = 0;
+  ASSERT_EQ(waitpid(reader, &status, 0), reader);
+  EXPECT_EQ(WEXITSTATUS(status), 0);
+  ASSERT_EQ(waitpid(writer, nullptr, 0), writer);
+  EXPECT_EQ(data->a, 2'000);
+  EXPECT_EQ(data->b, 2'000);
+}
@@ -0,0 +1,123 @@
+/*
+MIT License - Copyright (c) 2023 Pierric Gimmig
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#include "sham/snapshot.h"
+
+#include <atomic>
+#include <filesystem>
+#include <thread>
+
+#include "gtest/gtest.h"
+#include "sham/benchmark.h"
+#include "sham/queue_mpmc.h"
+#include "sham/shared_memory_buffer.h"
+
+static constexpr const char* kSharedMemoryName = "snapshot_test";
+static constexpr size_t kCapacity = 1024 * 1024;
+
+using QueueT = sham::mpmc::Queue<sham::Element, 64>;
+
+static std::string SnapshotPath() {
+  return (std::filesystem::temp_directory_path() / "sham_snapshot_test.snap").string();
+}
+
+static sham::SharedMemoryBuffer CreateBuffer() {
+  sham::SharedMemoryBufferOptions options;
+  options.directory_capacity = 16;
+  return sham::SharedMemoryBuffer(kSharedMemoryName, kCapacity,
+                                  sham::SharedMemoryBuffer::Type::kCreate, options);
+}
+
+TEST(SnapshotTest, CapturesQueue) {
+  sham::SharedMemoryBuffer buffer = CreateBuffer();
+  QueueT* queue = buffer.FindOrConstruct<QueueT>("orders", sham::kZeroInitialized);
+  ASSERT_NE(queue, nullptr);
+  for (uint64_t i = 0; i < 10; ++i) queue->push({0, 0, i});
+  sham::Element element;
+  for (int i = 0; i < 3; ++i) queue->pop(element);
+
+  sham::SnapshotInfo info;
+  ASSERT_TRUE(sham::WriteSnapshot(buffer, SnapshotPath(), &info));
+  EXPECT_EQ(info.size, buffer.size());
+  EXPECT_EQ(info.capacity, kCapacity);
+  EXPECT_GT(info.capture_time_ns, 0);
+  // Writes after the capture are not in the snapshot.
+  queue->push({0, 0, 10});
+
+  sham::SnapshotInfo read_info;
+  ASSERT_TRUE(sham::ReadSnapshotInfo(SnapshotPath(), &read_info));
+  EXPECT_EQ(read_info.capture_time_ns, info.capture_time_ns);
+  EXPECT_EQ(read_info.size, info.size);
+
+  sham::SharedMemoryBuffer snapshot =
+      sham::SharedMemoryBuffer::OpenPersistentReadOnly(SnapshotPath());
+  ASSERT_TRUE(snapshot.valid());
+  EXPECT_EQ(snapshot.capacity(), kCapacity);
+  const QueueT* captured = snapshot.Find<QueueT>("orders");
+  ASSERT_NE(captured, nullptr);
+  EXPECT_EQ(captured->head(), 10);
+  EXPECT_EQ(captured->tail(), 3);
+  EXPECT_FALSE(captured->try_peek(2, element));
+  for (uint64_t i = 3; i < 10; ++i) {
+    ASSERT_TRUE(captured->try_peek(i, element));
+    EXPECT_EQ(element.value, i);
+  }
+  EXPECT_FALSE(captured->try_peek(10, element));
+  std::filesystem::remove(SnapshotPath());
+}
+
+TEST(SnapshotTest, DoesNotStopWriters) {
+  sham::SharedMemoryBuffer buffer = CreateBuffer();
+  QueueT* queue = buffer.FindOrConstruct<QueueT>("orders", sham::kZeroInitialized);
+  std::atomic<bool> done = false;
+  std::thread writer([&] {
+    sham::Element element;
+    for (uint64_t i = 0; !done; ++i) {
+      queue->push({0, 0, i});
+      queue->pop(element);
+    }
+  });
+  for (int i = 0; i < 10; ++i) ASSERT_TRUE(sham::WriteSnapshot(buffer, SnapshotPath()));
+  done = true;
+  writer.join();
+
+  // head_ and tail_ are copied at slightly different times, either can be ahead of the other.
+  sham::SharedMemoryBuffer snapshot =
+      sham::SharedMemoryBuffer::OpenPersistentReadOnly(SnapshotPath());
+  const QueueT* captured = snapshot.Find<QueueT>("orders");
+  ASSERT_NE(captured, nullptr);
+  EXPECT_LE(captured->head(), queue->head());
+  EXPECT_LE(captured->tail(), queue->tail());
+  std::filesystem::remove(SnapshotPath());
+}
+
+TEST(SnapshotTest, InvalidFiles) {
+  sham::SnapshotInfo info;
+  EXPECT_FALSE(sham::ReadSnapshotInfo("/nonexistent/sham_snapshot", &info));
+  sham::SharedMemoryBuffer buffer = CreateBuffer();
+  std::string path = SnapshotPath();
+  {
+    sham::SharedMemoryBuffer persistent = sham::SharedMemoryBuffer::CreatePersistent(path, 4096);
+  }
+  EXPECT_FALSE(sham::ReadSnapshotInfo(path, &info));
+  std::filesystem::remove(path);
+}
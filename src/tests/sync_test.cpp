@@ -0,0 +1,313 @@
+/*
+MIT License - Copyright (c) 2023 Pierric Gimmig
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#include "sham/sync.h"
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "sham/shared_memory_buffer.h"
+
+using namespace std::chrono_literals;
+
+static constexpr const char* kSharedMemoryName = "sync_test";
+
+// Forks a child running `fn`, which returns its exit code. Returns the exit code of the child once
+// it exited, or -1 if it didn't exit normally.
+template <typename Fn>
+static int RunInChildProcess(Fn&& fn) {
+  pid_t pid = fork();
+  if (pid == 0) _exit(fn());
+  int status = 0;
+  if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status)) return -1;
+  return WEXITSTATUS(status);
+}
+
+TEST(SyncTest, MutexExcludesThreads) {
+  static constexpr size_t kNumThreads = 4;
+  static constexpr size_t kNumIncrements = 100'000;
+  sham::Mutex mutex;
+  size_t counter = 0;
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < kNumThreads; ++i) {
+    threads.emplace_back([&] {
+      for (size_t j = 0; j < kNumIncrements; ++j) {
+        std::lock_guard lock(mutex);
+        ++counter;
+      }
+    });
+  }
+  for (std::thread& thread : threads) thread.join();
+  EXPECT_EQ(counter, kNumThreads * kNumIncrements);
+}
+
+TEST(SyncTest, MutexExcludesProcesses) {
+  static constexpr size_t kNumIncrements = 100'000;
+  struct Shared {
+    sham::Mutex mutex;
+    size_t counter = 0;
+  };
+  sham::SharedMemoryBuffer buffer(kSharedMemoryName, 4096,
+                                  sham::SharedMemoryBuffer::Type::kCreate);
+  Shared* shared = buffer.Allocate<Shared>();
+  pid_t pid = fork();
+  if (pid == 0) {
+    for (size_t i = 0; i < kNumIncrements; ++i) {
+      std::lock_guard lock(shared->mutex);
+      ++shared->counter;
+    }
+    _exit(0);
+  }
+  for (size_t i = 0; i < kNumIncrements; ++i) {
+    std::lock_guard lock(shared->mutex);
+    ++shared->counter;
+  }
+  ASSERT_EQ(waitpid(pid, nullptr, 0), pid);
+  EXPECT_EQ(shared->counter, 2 * kNumIncrements);
+}
+
+TEST(SyncTest, MutexTimeout) {
+  sham::Mutex mutex;
+  EXPECT_TRUE(mutex.try_lock());
+  EXPECT_FALSE(mutex.try_lock());
+  std::thread([&] {
+    EXPECT_EQ(mutex.try_lock_for(10ms), sham::SyncStatus::kTimedOut);
+  }).join();
+  mutex.unlock();
+  EXPECT_EQ(mutex.try_lock_for(10ms), sham::SyncStatus::kOk);
+  mutex.unlock();
+}
+
+TEST(SyncTest, RobustMutexOwnerDies) {
+  sham::SharedMemoryBuffer buffer(kSharedMemoryName, 4096,
+                                  sham::SharedMemoryBuffer::Type::kCreate);
+  sham::Mutex* robust = buffer.Allocate<sham::Mutex>(/*robust=*/true);
+  sham::Mutex* mutex = buffer.Allocate<sham::Mutex>();
+  EXPECT_EQ(RunInChildProcess([&] {
+              robust->lock();
+              mutex->lock();
+              return 0;
+            }),
+            0);
+  EXPECT_EQ(robust->lock(), sham::SyncStatus::kOwnerDied);
+  robust->unlock();
+  EXPECT_EQ(robust->lock(), sham::SyncStatus::kOk);
+  robust->unlock();
+  EXPECT_EQ(mutex->try_lock_for(50ms), sham::SyncStatus::kTimedOut);
+}
+
+TEST(SyncTest, ConditionVariable) {
+  sham::Mutex mutex;
+  sham::ConditionVariable condition;
+  int value = 0;
+  int acknowledged = 0;
+  std::thread consumer([&] {
+    for (int expected = 1; expected <= 100; ++expected) {
+      std::unique_lock lock(mutex);
+      condition.wait(mutex, [&] { return value == expected; });
+      acknowledged = expected;
+      condition.notify_all();
+    }
+  });
+  for (int i = 1; i <= 100; ++i) {
+    std::unique_lock lock(mutex);
+    value = i;
+    condition.notify_one();
+    condition.wait(mutex, [&] { return acknowledged == i; });
+  }
+  consumer.join();
+
+  std::unique_lock lock(mutex);
+  EXPECT_EQ(condition.wait_for(mutex, 10ms), sham::SyncStatus::kTimedOut);
+}
+
+TEST(SyncTest, ConditionVariableBetweenProcesses) {
+  struct Shared {
+    sham::Mutex mutex;
+    sham::ConditionVariable condition;
+    bool ready = false;
+  };
+  sham::SharedMemoryBuffer buffer(kSharedMemoryName, 4096,
+                                  sham::SharedMemoryBuffer::Type::kCreate);
+  Shared* shared = buffer.Allocate<Shared>();
+  pid_t pid = fork();
+  if (pid == 0) {
+    std::this_thread::sleep_for(10ms);
+    {
+      std::lock_guard lock(shared->mutex);
+      shared->ready = true;
+      shared->condition.notify_one();
+    }
+    _exit(0);
+  }
+  {
+    std::unique_lock lock(shared->mutex);
+    EXPECT_EQ(shared->condition.wait(shared->mutex, [&] { return shared->ready; }),
+              sham::SyncStatus::kOk);
+  }
+  ASSERT_EQ(waitpid(pid, nullptr, 0), pid);
+}
+
+TEST(SyncTest, Semaphore) {
+  sham::Semaphore semaphore(2);
+  EXPECT_TRUE(semaphore.try_acquire());
+  EXPECT_TRUE(semaphore.try_acquire());
+  EXPECT_FALSE(semaphore.try_acquire());
+  EXPECT_FALSE(semaphore.try_acquire_for(10ms));
+
+  std::thread releaser([&] {
+    std::this_thread::sleep_for(10ms);
+    semaphore.release(3);
+  });
+  for (int i = 0; i < 3; ++i) semaphore.acquire();
+  releaser.join();
+  EXPECT_EQ(semaphore.count(), 0);
+}
+
+TEST(SyncTest, RobustSemaphoreHolderDies) {
+  sham::SharedMemoryBuffer buffer(kSharedMemoryName, 4096,
+                                  sham::SharedMemoryBuffer::Type::kCreate);
+  sham::Semaphore* semaphore = buffer.Allocate<sham::Semaphore>(3, /*robust=*/true);
+  semaphore->acquire();
+  EXPECT_EQ(RunInChildProcess([&] {
+              semaphore->acquire();
+              semaphore->acquire();
+              return 0;
+            }),
+            0);
+  EXPECT_EQ(semaphore->count(), 0);
+  // The units held by the child come back, not the one held by this process.
+  EXPECT_TRUE(semaphore->try_acquire_for(1s));
+  EXPECT_TRUE(semaphore->try_acquire_for(1s));
+  EXPECT_FALSE(semaphore->try_acquire_for(50ms));
+}
+
+TEST(SyncTest, Event) {
+  sham::Event event;
+  EXPECT_FALSE(event.try_wait());
+  event.set();
+  event.set();
+  EXPECT_TRUE(event.try_wait());
+  EXPECT_FALSE(event.try_wait());
+  EXPECT_EQ(event.wait_for(10ms), sham::SyncStatus::kTimedOut);
+
+  sham::Event reply;
+  std::thread responder([&] {
+    for (int i = 0; i < 100; ++i) {
+      EXPECT_EQ(event.wait(), sham::SyncStatus::kOk);
+      reply.set();
+    }
+  });
+  for (int i = 0; i < 100; ++i) {
+    event.set();
+    EXPECT_EQ(reply.wait(), sham::SyncStatus::kOk);
+  }
+  responder.join();
+}
+
+TEST(SyncTest, RobustEventSetterDies) {
+  sham::SharedMemoryBuffer buffer(kSharedMemoryName, 4096,
+                                  sham::SharedMemoryBuffer::Type::kCreate);
+  sham::Event* event = buffer.Allocate<sham::Event>(/*robust=*/true);
+  EXPECT_EQ(RunInChildProcess([&] {
+              event->set();
+              return 0;
+            }),
+            0);
+  // The event set before the setter died is still consumed.
+  EXPECT_EQ(event->wait(), sham::SyncStatus::kOk);
+  EXPECT_EQ(event->wait(), sham::SyncStatus::kOwnerDied);
+}
+
+TEST(SyncTest, RobustEventSetterDetaches) {
+  sham::SharedMemoryBuffer buffer(kSharedMemoryName, 4096,
+                                  sham::SharedMemoryBuffer::Type::kCreate);
+  sham::Event* event = buffer.Allocate<sham::Event>(/*robust=*/true);
+  EXPECT_EQ(RunInChildProcess([&] {
+              event->set();
+              event->detach();
+              return 0;
+            }),
+            0);
+  EXPECT_EQ(event->wait(), sham::SyncStatus::kOk);
+  EXPECT_EQ(event->wait_for(50ms), sham::SyncStatus::kTimedOut);
+}
+
+TEST(SyncTest, Barrier) {
+  static constexpr size_t kNumThreads = 4;
+  static constexpr size_t kNumPhases = 100;
+  sham::Barrier barrier(kNumThreads);
+  std::atomic<size_t> arrivals[kNumPhases] = {};
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < kNumThreads; ++i) {
+    threads.emplace_back([&] {
+      for (size_t phase = 0; phase < kNumPhases; ++phase) {
+        ++arrivals[phase];
+        EXPECT_EQ(barrier.arrive_and_wait(), sham::SyncStatus::kOk);
+        EXPECT_EQ(arrivals[phase], kNumThreads);
+      }
+    });
+  }
+  for (std::thread& thread : threads) thread.join();
+}
+
+TEST(SyncTest, RobustBarrierParticipantDies) {
+  sham::SharedMemoryBuffer buffer(kSharedMemoryName, 4096,
+                                  sham::SharedMemoryBuffer::Type::kCreate);
+  sham::Barrier* barrier = buffer.Allocate<sham::Barrier>(2, /*robust=*/true);
+  pid_t pid = fork();
+  if (pid == 0) {
+    // Takes part in the first phase, then dies.
+    barrier->arrive_and_wait();
+    _exit(0);
+  }
+  EXPECT_EQ(barrier->arrive_and_wait(), sham::SyncStatus::kOk);
+  ASSERT_EQ(waitpid(pid, nullptr, 0), pid);
+  EXPECT_EQ(barrier->arrive_and_wait(), sham::SyncStatus::kOwnerDied);
+  EXPECT_TRUE(barrier->broken());
+  EXPECT_EQ(barrier->arrive_and_wait(), sham::SyncStatus::kOwnerDied);
+}
+
+TEST(SyncTest, RobustBarrierParticipantDetaches) {
+  sham::SharedMemoryBuffer buffer(kSharedMemoryName, 4096,
+                                  sham::SharedMemoryBuffer::Type::kCreate);
+  sham::Barrier* barrier = buffer.Allocate<sham::Barrier>(2, /*robust=*/true);
+  pid_t pid = fork();
+  if (pid == 0) {
+    // Takes part in the first phase, then exits normally.
+    barrier->arrive_and_wait();
+    barrier->detach();
+    _exit(0);
+  }
+  EXPECT_EQ(barrier->arrive_and_wait(), sham::SyncStatus::kOk);
+  ASSERT_EQ(waitpid(pid, nullptr, 0), pid);
+  // A thread replaces the child.
+  std::thread thread([&] { EXPECT_EQ(barrier->arrive_and_wait(), sham::SyncStatus::kOk); });
+  EXPECT_EQ(barrier->arrive_and_wait(), sham::SyncStatus::kOk);
+  thread.join();
+  EXPECT_FALSE(barrier->broken());
+}
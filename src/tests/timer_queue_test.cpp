@@ -0,0 +1,189 @@
+/*
+MIT License - Copyright (c) 2023 Pierric Gimmig
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#include "sham/timer_queue.h"
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "sham/pool_allocator.h"
+#include "sham/shared_memory_buffer.h"
+
+static constexpr const char* kSharedMemoryName = "timer_queue_test";
+static constexpr size_t kCapacity = 64 * 1024 * 1024;
+
+struct Timer {
+  uint64_t id;
+  uint64_t deadline_ns;
+};
+
+using TimerQueueT = sham::TimerQueue<Timer>;
+
+TEST(TimerQueueTest, DeliversAtDeadline) {
+  sham::SharedMemoryBuffer buffer(kSharedMemoryName, kCapacity,
+                                  sham::SharedMemoryBuffer::Type::kCreate);
+  auto* pool = buffer.Allocate<sham::PoolAllocator>(buffer, kCapacity / 2);
+  // Ticks of 1ms from time 0.
+  auto* timers = buffer.Allocate<TimerQueueT>(*pool, 1'000'000, 0);
+  ASSERT_NE(timers, nullptr);
+  EXPECT_TRUE(timers->empty());
+
+  std::vector<uint64_t> delivered;
+  auto deliver = [&](Timer& timer) { delivered.push_back(timer.id); };
+  ASSERT_TRUE(timers->ScheduleAt(1'500'000, {0, 0}));
+  ASSERT_TRUE(timers->ScheduleAt(1'000'000, {1, 0}));
+  ASSERT_TRUE(timers->ScheduleAt(0, {2, 0}));
+  ASSERT_TRUE(timers->ScheduleAt(300'000'000, {3, 0}));
+  EXPECT_FALSE(timers->empty());
+
+  EXPECT_EQ(timers->PopDue(0, deliver), 1u);
+  EXPECT_EQ(delivered, std::vector<uint64_t>{2});
+  EXPECT_EQ(timers->PopDue(999'999, deliver), 0u);
+  EXPECT_EQ(timers->PopDue(1'000'000, deliver), 1u);
+  // Deadlines are rounded up to the next tick.
+  EXPECT_EQ(timers->PopDue(1'999'999, deliver), 0u);
+  EXPECT_EQ(timers->PopDue(2'000'000, deliver), 1u);
+  EXPECT_EQ(timers->PopDue(299'999'999, deliver), 0u);
+  EXPECT_EQ(timers->PopDue(1'000'000'000, deliver), 1u);
+  EXPECT_EQ(delivered, (std::vector<uint64_t>{2, 1, 0, 3}));
+  EXPECT_TRUE(timers->empty());
+
+  // Timers scheduled while delivering are delivered by a later call.
+  ASSERT_TRUE(timers->ScheduleAt(1'001'000'000, {4, 0}));
+  auto reschedule = [&](Timer& timer) {
+    delivered.push_back(timer.id);
+    if (timer.id < 6) {
+      ASSERT_TRUE(timers->ScheduleAt(1'002'000'000, {timer.id + 1, 0}));
+    }
+  };
+  EXPECT_EQ(timers->PopDue(1'002'000'000, reschedule), 1u);
+  EXPECT_EQ(timers->PopDue(1'002'000'000, reschedule), 1u);
+  EXPECT_EQ(timers->PopDue(1'002'000'000, reschedule), 1u);
+  EXPECT_EQ(timers->PopDue(1'002'000'000, reschedule), 0u);
+}
+
+TEST(TimerQueueTest, DeliversInTheFirstCallAfterDeadline) {
+  sham::SharedMemoryBuffer buffer(kSharedMemoryName, kCapacity,
+                                  sham::SharedMemoryBuffer::Type::kCreate);
+  auto* pool = buffer.Allocate<sham::PoolAllocator>(buffer, kCapacity / 2);
+  // Ticks of 1ns, so that deadlines spread over all the levels and beyond.
+  auto* timers = buffer.Allocate<TimerQueueT>(*pool, 1, 0);
+  ASSERT_NE(timers, nullptr);
+  sham::PoolAllocator::Cache cache(*pool);
+
+  // Timers record the iteration that scheduled them, and must be delivered by the first call to
+  // PopDue() whose time isn't before their deadline.
+  std::mt19937_64 random(1);
+  uint64_t now = 0;
+  uint64_t previous_now = 0;
+  uint64_t iteration = 0;
+  uint64_t num_scheduled = 0;
+  uint64_t num_delivered = 0;
+  uint64_t num_errors = 0;
+  auto deliver = [&](Timer& timer) {
+    num_errors += timer.deadline_ns > now ||
+                  (timer.deadline_ns <= previous_now && timer.id != iteration);
+    ++num_delivered;
+  };
+  for (iteration = 0; iteration < 2000; ++iteration) {
+    for (int j = 0; j < 50; ++j) {
+      // Deadlines from 0 to 2^36 ticks ahead, more of them close.
+      uint64_t deadline = now + (random() >> (28 + random() % 36));
+      ASSERT_TRUE(timers->ScheduleAt(deadline, {iteration, deadline}, &cache));
+      ++num_scheduled;
+    }
+    previous_now = now;
+    now += random() >> (24 + random() % 40);
+    timers->PopDue(now, deliver, &cache);
+  }
+  previous_now = now;
+  now = std::numeric_limits<uint64_t>::max() / 2;
+  timers->PopDue(now, deliver, &cache);
+  EXPECT_EQ(num_errors, 0u);
+  EXPECT_EQ(num_delivered, num_scheduled);
+  EXPECT_TRUE(timers->empty());
+}
+
+TEST(TimerQueueTest, DestructorFreesPendingTimers) {
+  sham::SharedMemoryBuffer buffer(kSharedMemoryName, kCapacity,
+                                  sham::SharedMemoryBuffer::Type::kCreate);
+  // A single chunk of the pool.
+  auto* pool = buffer.Allocate<sham::PoolAllocator>(buffer, sham::PoolAllocator::kChunkSize);
+  auto* timers = buffer.Allocate<TimerQueueT>(*pool, 1, 0);
+  uint64_t num_timers = 0;
+  while (timers->ScheduleAt(num_timers, {num_timers, 0})) ++num_timers;
+  EXPECT_EQ(num_timers, sham::PoolAllocator::kChunkSize / TimerQueueT::NodeSize());
+  EXPECT_EQ(timers->PopDue(num_timers / 2, [](Timer&) {}), num_timers / 2 + 1);
+  timers->~TimerQueueT();
+  for (uint64_t i = 0; i < num_timers; ++i) {
+    EXPECT_NE(pool->Allocate(TimerQueueT::NodeSize()), nullptr);
+  }
+}
+
+TEST(TimerQueueTest, ProducerProcesses) {
+  static constexpr uint64_t kNumProducers = 4;
+  static constexpr uint64_t kNumTimersPerProducer = 20'000;
+  sham::SharedMemoryBuffer buffer(kSharedMemoryName, kCapacity,
+                                  sham::SharedMemoryBuffer::Type::kCreate);
+  auto* pool = buffer.Allocate<sham::PoolAllocator>(buffer, kCapacity / 2);
+  // Ticks of 100us, on the coarse clock.
+  auto* timers = buffer.Allocate<TimerQueueT>(*pool, 100'000);
+  ASSERT_NE(timers, nullptr);
+
+  std::vector<pid_t> pids;
+  for (uint64_t id = 0; id < kNumProducers; ++id) {
+    pid_t pid = fork();
+    if (pid == 0) {
+      sham::PoolAllocator::Cache cache(*pool);
+      for (uint64_t i = 0; i < kNumTimersPerProducer; ++i) {
+        uint64_t deadline = sham::CoarseClockNs() + i % 20 * 1'000'000;
+        while (!timers->ScheduleAt(deadline, {id, deadline}, &cache)) {
+        }
+      }
+      cache.Flush();
+      _exit(0);
+    }
+    pids.push_back(pid);
+  }
+
+  uint64_t num_delivered = 0;
+  uint64_t num_early = 0;
+  sham::PoolAllocator::Cache cache(*pool);
+  while (num_delivered < kNumProducers * kNumTimersPerProducer) {
+    uint64_t now = sham::CoarseClockNs();
+    timers->PopDue(
+        now,
+        [&](Timer& timer) {
+          num_early += timer.deadline_ns > now;
+          ++num_delivered;
+        },
+        &cache);
+  }
+  for (pid_t pid : pids) ASSERT_EQ(waitpid(pid, nullptr, 0), pid);
+  EXPECT_EQ(num_early, 0u);
+  EXPECT_TRUE(timers->empty());
+}
@@ -0,0 +1,105 @@
+/*
+MIT License - Copyright (c) 2023 Pierric Gimmig
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#include "sham/triple_buffer.h"
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "gtest/gtest.h"
+#include "sham/shared_memory_buffer.h"
+
+static constexpr const char* kSharedMemoryName = "triple_buffer_test";
+static constexpr size_t kCapacity = 1024 * 1024;
+
+// Large enough that a torn copy would be likely, all words equal so that one is detected.
+struct Snapshot {
+  uint64_t words[2048];
+
+  void Fill(uint64_t value) {
+    for (uint64_t& word : words) word = value;
+  }
+
+  bool IsConsistent() const {
+    for (uint64_t word : words) {
+      if (word != words[0]) return false;
+    }
+    return true;
+  }
+};
+
+TEST(TripleBufferTest, ReadReturnsNewestValue) {
+  sham::TripleBuffer<Snapshot> triple_buffer;
+  EXPECT_FALSE(triple_buffer.has_new_value());
+  EXPECT_EQ(triple_buffer.Read().words[0], 0);
+
+  triple_buffer.write_buffer()->Fill(1);
+  triple_buffer.Publish();
+  EXPECT_TRUE(triple_buffer.has_new_value());
+  EXPECT_EQ(triple_buffer.Read().words[0], 1);
+  EXPECT_FALSE(triple_buffer.has_new_value());
+  // Without a new value, Read() returns the same buffer.
+  const Snapshot* front = &triple_buffer.Read();
+  EXPECT_EQ(front->words[0], 1);
+  EXPECT_EQ(&triple_buffer.Read(), front);
+
+  // Values published between two reads are skipped.
+  for (uint64_t i = 2; i <= 10; ++i) {
+    triple_buffer.write_buffer()->Fill(i);
+    triple_buffer.Publish();
+    // The writer never writes to the buffer the reader holds.
+    EXPECT_NE(triple_buffer.write_buffer(), front);
+    EXPECT_EQ(front->words[0], 1);
+  }
+  EXPECT_EQ(triple_buffer.Read().words[0], 10);
+
+  Snapshot snapshot;
+  snapshot.Fill(11);
+  triple_buffer.Store(snapshot);
+  EXPECT_EQ(triple_buffer.Read().words[0], 11);
+}
+
+TEST(TripleBufferTest, BetweenProcesses) {
+  static constexpr uint64_t kNumWrites = 20'000;
+  sham::SharedMemoryBuffer buffer(kSharedMemoryName, kCapacity,
+                                  sham::SharedMemoryBuffer::Type::kCreate);
+  auto* triple_buffer = buffer.Allocate<sham::TripleBuffer<Snapshot>>();
+  ASSERT_NE(triple_buffer, nullptr);
+
+  pid_t pid = fork();
+  if (pid == 0) {
+    for (uint64_t i = 1; i <= kNumWrites; ++i) {
+      triple_buffer->write_buffer()->Fill(i);
+      triple_buffer->Publish();
+    }
+    _exit(0);
+  }
+  uint64_t last = 0;
+  while (last != kNumWrites) {
+    const Snapshot& snapshot = triple_buffer->Read();
+    ASSERT_TRUE(snapshot.IsConsistent());
+    ASSERT_GE(snapshot.words[0], last);
+    last = snapshot.words[0];
+  }
+  ASSERT_EQ(waitpid(pid, nullptr, 0), pid);
+  EXPECT_FALSE(triple_buffer->has_new_value());
+}
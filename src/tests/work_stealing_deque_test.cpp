@@ -0,0 +1,111 @@
+/*
+MIT License - Copyright (c) 2023 Pierric Gimmig
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#include "sham/work_stealing_deque.h"
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "sham/shared_memory_buffer.h"
+
+static constexpr const char* kSharedMemoryName = "work_stealing_deque_test";
+static constexpr size_t kCapacity = 1024 * 1024;
+
+TEST(WorkStealingDequeTest, OwnerIsLifoThievesAreFifo) {
+  sham::WorkStealingDeque<uint32_t, 8> deque;
+  EXPECT_TRUE(deque.empty());
+  EXPECT_FALSE(deque.pop().has_value());
+  EXPECT_FALSE(deque.steal().has_value());
+
+  for (uint32_t i = 0; i < 8; ++i) EXPECT_TRUE(deque.push(i));
+  EXPECT_FALSE(deque.push(8));
+  EXPECT_EQ(deque.size(), 8);
+  EXPECT_EQ(deque.pop(), 7);
+  EXPECT_EQ(deque.steal(), 0);
+  EXPECT_EQ(deque.steal(), 1);
+  EXPECT_EQ(deque.pop(), 6);
+  // The circular array wraps around.
+  for (uint32_t i = 8; i < 12; ++i) EXPECT_TRUE(deque.push(i));
+  EXPECT_FALSE(deque.push(12));
+  for (uint32_t i = 2; i < 6; ++i) EXPECT_EQ(deque.steal(), i);
+  for (uint32_t i = 11; i >= 8; --i) EXPECT_EQ(deque.pop(), i);
+  EXPECT_TRUE(deque.empty());
+  EXPECT_FALSE(deque.pop().has_value());
+}
+
+// The owner pushes and pops while thieves steal: every element is taken exactly once.
+TEST(WorkStealingDequeTest, ConcurrentSteals) {
+  static constexpr uint32_t kNumElements = 200'000;
+  static constexpr size_t kNumThieves = 3;
+  auto deque = std::make_unique<sham::WorkStealingDeque<uint32_t, 1024>>();
+  std::vector<std::atomic<uint32_t>> taken(kNumElements);
+  std::atomic<bool> done = false;
+
+  std::vector<std::thread> thieves;
+  for (size_t i = 0; i < kNumThieves; ++i) {
+    thieves.emplace_back([&] {
+      while (!done) {
+        if (std::optional<uint32_t> value = deque->steal()) ++taken[*value];
+      }
+    });
+  }
+  for (uint32_t i = 0; i < kNumElements; ++i) {
+    while (!deque->push(i)) {
+      if (std::optional<uint32_t> value = deque->pop()) ++taken[*value];
+    }
+    // Pops one element out of three, often racing with thieves for the last one.
+    if (i % 3 == 0) {
+      if (std::optional<uint32_t> value = deque->pop()) ++taken[*value];
+    }
+  }
+  while (std::optional<uint32_t> value = deque->pop()) ++taken[*value];
+  done = true;
+  for (std::thread& thief : thieves) thief.join();
+  for (uint32_t i = 0; i < kNumElements; ++i) ASSERT_EQ(taken[i], 1) << i;
+}
+
+TEST(WorkStealingDequeTest, StealFromOtherProcess) {
+  using Deque = sham::WorkStealingDeque<uint64_t, 256>;
+  sham::SharedMemoryBuffer buffer(kSharedMemoryName, kCapacity,
+                                  sham::SharedMemoryBuffer::Type::kCreate);
+  auto* deque = buffer.Allocate<Deque>();
+  ASSERT_NE(deque, nullptr);
+  for (uint64_t i = 0; i < 100; ++i) ASSERT_TRUE(deque->push(i));
+
+  pid_t pid = fork();
+  if (pid == 0) {
+    bool ok = true;
+    for (uint64_t i = 0; i < 50; ++i) ok &= deque->steal() == i;
+    _exit(ok ? 0 : 1);
+  }
+  int status = 0;
+  ASSERT_EQ(waitpid(pid, &status, 0), pid);
+  EXPECT_EQ(WEXITSTATUS(status), 0);
+  EXPECT_EQ(deque->size(), 50);
+  EXPECT_EQ(deque->pop(), 99);
+  EXPECT_EQ(deque->steal(), 50);
+}
@@ -0,0 +1,101 @@
+/*
+MIT License - Copyright (c) 2023 Pierric Gimmig
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+// Lists the shared memory segments recorded in a sham::SegmentRegistry and reclaims the ones
+// leaked by crashed processes.
+//
+// Usage: sham_registry [--registry <name>] [list|reclaim]
+
+#include <cstdio>
+#include <ctime>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "sham/segment_registry.h"
+
+static void PrintUsage() {
+  std::printf("Usage: sham_registry [--registry <name>] [list|reclaim]\n");
+  std::printf("  list     Lists the registered segments and their memory use (default).\n");
+  std::printf("  reclaim  Unlinks the segments whose processes all died.\n");
+}
+
+static std::string FormatTime(int64_t seconds) {
+  std::time_t time = static_cast<std::time_t>(seconds);
+  char buffer[32] = {};
+  std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", std::localtime(&time));
+  return buffer;
+}
+
+static void List(const sham::SegmentRegistry& registry) {
+  std::printf("%-40s %12s %12s %8s %-19s %-8s %s\n", "NAME", "SIZE_KB", "USED_KB", "CREATOR",
+              "CREATED", "STATUS", "PIDS");
+  size_t total_used = 0;
+  size_t num_orphaned = 0;
+  std::vector<sham::SegmentInfo> segments = registry.List();
+  for (const sham::SegmentInfo& segment : segments) {
+    std::string pids;
+    for (uint32_t pid : segment.pids) {
+      if (!pids.empty()) pids += ',';
+      pids += std::to_string(pid);
+    }
+    std::printf("%-40s %12zu %12zu %8u %-19s %-8s %s\n", segment.name.c_str(), segment.size / 1024,
+                segment.allocated_size / 1024, segment.creator_pid,
+                FormatTime(segment.creation_time).c_str(), segment.orphaned ? "orphaned" : "live",
+                pids.c_str());
+    total_used += segment.allocated_size;
+    num_orphaned += segment.orphaned;
+  }
+  std::printf("%zu segments, %zu orphaned, %zu KB used\n", segments.size(), num_orphaned,
+              total_used / 1024);
+}
+
+int main(int argc, char* argv[]) {
+  std::string registry_name = sham::SegmentRegistry::kDefaultName;
+  std::string_view command = "list";
+  for (int i = 1; i < argc; ++i) {
+    std::string_view arg = argv[i];
+    if (arg == "--registry" && i + 1 < argc) {
+      registry_name = argv[++i];
+    } else if (arg == "list" || arg == "reclaim") {
+      command = arg;
+    } else {
+      PrintUsage();
+      return arg == "--help" || arg == "-h" ? 0 : 1;
+    }
+  }
+
+  sham::SegmentRegistry registry(registry_name);
+  if (!registry.valid()) {
+    std::fprintf(stderr, "Can't open registry %s\n", registry_name.c_str());
+    return 1;
+  }
+
+  if (command == "reclaim") {
+    std::vector<std::string> reclaimed = registry.ReclaimOrphans();
+    for (const std::string& name : reclaimed) std::printf("Reclaimed %s\n", name.c_str());
+    std::printf("%zu segments reclaimed\n", reclaimed.size());
+  } else {
+    List(registry);
+  }
+  return 0;
+}
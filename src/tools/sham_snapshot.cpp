@@ -0,0 +1,126 @@
+/*
+MIT License - Copyright (c) 2023 Pierric Gimmig
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+// Captures snapshots of live shared memory segments and inspects them, see sham/snapshot.h.
+//
+// Usage: sham_snapshot capture <segment name> <snapshot file>
+//        sham_snapshot inspect <snapshot file> [<offset> <size>]
+
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <string>
+#include <string_view>
+
+#include "sham/snapshot.h"
+
+static void PrintUsage() {
+  std::printf("Usage: sham_snapshot capture <segment name> <snapshot file>\n");
+  std::printf("       sham_snapshot inspect <snapshot file> [<offset> <size>]\n");
+  std::printf("  capture  Writes a snapshot of a live segment without pausing its writers.\n");
+  std::printf("  inspect  Prints the header and named objects of a snapshot, and hex dumps\n");
+  std::printf("           [offset, offset + size) of its buffer if given.\n");
+}
+
+static int Capture(const char* segment_name, const char* path) {
+  sham::SharedMemoryBuffer buffer(segment_name, 0,
+                                  sham::SharedMemoryBuffer::Type::kAccessExisting);
+  if (!buffer.valid()) {
+    std::fprintf(stderr, "Can't open segment %s\n", segment_name);
+    return 1;
+  }
+  sham::SnapshotInfo info;
+  if (!sham::WriteSnapshot(buffer, path, &info)) {
+    std::fprintf(stderr, "Can't write snapshot to %s\n", path);
+    return 1;
+  }
+  std::printf("Captured %llu bytes of %s in %.3f ms\n", static_cast<unsigned long long>(info.size),
+              segment_name, info.capture_duration_ns / 1e6);
+  return 0;
+}
+
+static void HexDump(const uint8_t* data, size_t offset, size_t size) {
+  for (size_t line = 0; line < size; line += 16) {
+    std::printf("%010zx ", offset + line);
+    for (size_t i = line; i < line + 16; ++i) {
+      if (i < size) {
+        std::printf(" %02x", data[offset + i]);
+      } else {
+        std::printf("   ");
+      }
+    }
+    std::printf("  ");
+    for (size_t i = line; i < line + 16 && i < size; ++i) {
+      std::printf("%c", std::isprint(data[offset + i]) ? data[offset + i] : '.');
+    }
+    std::printf("\n");
+  }
+}
+
+static int Inspect(const char* path, int argc, char* argv[]) {
+  sham::SnapshotInfo info;
+  if (!sham::ReadSnapshotInfo(path, &info)) {
+    std::fprintf(stderr, "%s is not a snapshot\n", path);
+    return 1;
+  }
+  sham::SharedMemoryBuffer snapshot = sham::SharedMemoryBuffer::OpenPersistentReadOnly(path);
+  if (!snapshot.valid()) {
+    std::fprintf(stderr, "Can't map %s\n", path);
+    return 1;
+  }
+
+  std::time_t capture_time = static_cast<std::time_t>(info.capture_time_ns / 1'000'000'000);
+  char time[32] = {};
+  std::strftime(time, sizeof(time), "%Y-%m-%d %H:%M:%S", std::localtime(&capture_time));
+  std::printf("Captured:     %s, in %.3f ms\n", time, info.capture_duration_ns / 1e6);
+  std::printf("Capacity:     %zu bytes (max %zu)\n", snapshot.capacity(), snapshot.max_capacity());
+  std::printf("Allocated:    %zu bytes\n", snapshot.size());
+  std::printf("Generation:   %llu\n", static_cast<unsigned long long>(snapshot.generation()));
+
+  sham::ObjectDirectory directory = snapshot.directory();
+  std::printf("Directory:    %zu entries\n", directory.capacity());
+  directory.ForEach([](const sham::ObjectDirectory::Entry& entry) {
+    std::printf("  %-40.*s offset %10llu size %8llu type %016llx%s\n",
+                static_cast<int>(entry.name().size()), entry.name().data(),
+                static_cast<unsigned long long>(entry.offset),
+                static_cast<unsigned long long>(entry.size),
+                static_cast<unsigned long long>(entry.type_hash),
+                entry.ready() ? "" : " (not ready)");
+  });
+
+  if (argc >= 2) {
+    size_t offset = std::strtoull(argv[0], nullptr, 0);
+    size_t size = std::strtoull(argv[1], nullptr, 0);
+    if (offset > snapshot.capacity()) return 0;
+    HexDump(snapshot.data(), offset, std::min(size, snapshot.capacity() - offset));
+  }
+  return 0;
+}
+
+int main(int argc, char* argv[]) {
+  std::string_view command = argc > 1 ? argv[1] : "";
+  if (command == "capture" && argc == 4) return Capture(argv[2], argv[3]);
+  if (command == "inspect" && argc >= 3) return Inspect(argv[2], argc - 3, argv + 3);
+  PrintUsage();
+  return command == "--help" || command == "-h" ? 0 : 1;
+}